@@ -39,6 +39,9 @@ concept HasGetAuthorizationUrl = requires(typename T::Auth v) {
 template <typename T>
 concept HasAuthHandler = requires { typename T::Auth::AuthHandler; };
 
+template <typename T>
+concept HasConfig = requires { typename T::Config; };
+
 template <typename Auth>
 class RefreshTokenImpl {
  public:
@@ -164,6 +167,7 @@ class CloudFactoryUtil {
                    const util::ThumbnailGenerator* thumbnail_generator,
                    const util::Muxer* muxer,
                    util::RandomNumberGenerator* random_number_generator,
+                   util::CacheManager* cache_manager,
                    const util::AuthData* auth_data)
       : type_(type),
         event_loop_(event_loop),
@@ -172,6 +176,7 @@ class CloudFactoryUtil {
         thumbnail_generator_(thumbnail_generator),
         muxer_(muxer),
         random_number_generator_(random_number_generator),
+        cache_manager_(cache_manager),
         auth_data_(auth_data) {}
 
   auto Create(AuthToken auth_token,
@@ -211,13 +216,25 @@ class CloudFactoryUtil {
   }
 
   auto GetConfig() const {
-    auto injector = di::make_injector(
+    auto base_injector = di::make_injector(
         di::bind<coro::http::Http>.to(http_),
         di::bind<coro::util::EventLoop>().to(event_loop_),
         di::bind<coro::util::ThreadPool>().to(thread_pool_),
         di::bind<coro::cloudstorage::util::Muxer>().to(muxer_),
         di::bind<coro::cloudstorage::util::RandomNumberGenerator>().to(
-            random_number_generator_));
+            random_number_generator_),
+        di::bind<coro::cloudstorage::util::CacheManager>().to(cache_manager_));
+
+    auto injector = [&] {
+      if constexpr (HasConfig<CloudProvider>) {
+        return di::make_injector(
+            std::move(base_injector),
+            di::bind<typename CloudProvider::Config>().to(
+                typename CloudProvider::Config{}));
+      } else {
+        return base_injector;
+      }
+    }();
 
     if constexpr (HasAuthData<Auth>) {
       return di::make_injector(
@@ -250,6 +267,7 @@ class CloudFactoryUtil {
   const util::ThumbnailGenerator* thumbnail_generator_;
   const util::Muxer* muxer_;
   util::RandomNumberGenerator* random_number_generator_;
+  util::CacheManager* cache_manager_;
   const util::AuthData* auth_data_;
 };
 
@@ -306,6 +324,7 @@ CloudFactory::CloudFactory(const coro::util::EventLoop* event_loop,
                            const util::ThumbnailGenerator* thumbnail_generator,
                            const util::Muxer* muxer,
                            util::RandomNumberGenerator* random_number_generator,
+                           util::CacheManager* cache_manager,
                            util::AuthData auth_data)
     : event_loop_(event_loop),
       thread_pool_(thread_pool),
@@ -313,6 +332,7 @@ CloudFactory::CloudFactory(const coro::util::EventLoop* event_loop,
       thumbnail_generator_(thumbnail_generator),
       muxer_(muxer),
       random_number_generator_(random_number_generator),
+      cache_manager_(cache_manager),
       auth_data_(std::move(auth_data)) {
   for (auto type : GetSupportedCloudProviders()) {
     factory_.emplace_back(CreateCloudFactory(type));
@@ -325,7 +345,8 @@ std::unique_ptr<AbstractCloudFactory> CloudFactory::CreateCloudFactory(
     return std::make_unique<CloudFactoryImpl<T>>(
         type, CloudFactoryUtil<T>{type, event_loop_, thread_pool_, http_,
                                   thumbnail_generator_, muxer_,
-                                  random_number_generator_, &auth_data_});
+                                  random_number_generator_, cache_manager_,
+                                  &auth_data_});
   };
 
   switch (type) {
@@ -7,6 +7,7 @@
 #include "coro/cloudstorage/util/auth_data.h"
 #include "coro/cloudstorage/util/auth_handler.h"
 #include "coro/cloudstorage/util/auth_manager.h"
+#include "coro/cloudstorage/util/cache_manager.h"
 #include "coro/cloudstorage/util/muxer.h"
 #include "coro/cloudstorage/util/random_number_generator.h"
 #include "coro/cloudstorage/util/thumbnail_generator.h"
@@ -24,7 +25,7 @@ class CloudFactory : public util::AbstractCloudFactory {
                const util::ThumbnailGenerator* thumbnail_generator,
                const util::Muxer* muxer,
                util::RandomNumberGenerator* random_number_generator,
-               util::AuthData auth_data);
+               util::CacheManager* cache_manager, util::AuthData auth_data);
 
   std::unique_ptr<util::AbstractCloudProvider> Create(
       util::AbstractCloudProvider::Auth::AuthToken auth_token,
@@ -48,6 +49,7 @@ class CloudFactory : public util::AbstractCloudFactory {
   const util::ThumbnailGenerator* thumbnail_generator_;
   const util::Muxer* muxer_;
   util::RandomNumberGenerator* random_number_generator_;
+  util::CacheManager* cache_manager_;
   util::AuthData auth_data_;
   std::vector<std::unique_ptr<util::AbstractCloudFactory>> factory_;
 };
@@ -188,6 +188,33 @@ auto Box::ListDirectoryPage(Directory directory,
   co_return std::move(result);
 }
 
+auto Box::SearchItemsPage(std::string query,
+                          std::optional<std::string> page_token,
+                          stdx::stop_token stop_token) -> Task<PageData> {
+  std::vector<std::pair<std::string, std::string>> params = {
+      {"query", std::move(query)},
+      {"content_types", "name"},
+      {"fields", std::string(kFileProperties)}};
+  if (page_token) {
+    params.emplace_back("offset", std::move(*page_token));
+  }
+  Request request{.url = StrCat(GetEndpoint("/search"), '?',
+                                http::FormDataToString(params))};
+  auto json = co_await auth_manager_.FetchJson(std::move(request),
+                                               std::move(stop_token));
+  PageData result;
+  for (const auto& entry : json["entries"]) {
+    result.items.emplace_back(ToItem(entry));
+  }
+  int64_t offset = json["offset"];
+  int64_t limit = json["limit"];
+  int64_t total_count = json["total_count"];
+  if (offset + limit < total_count) {
+    result.next_page_token = std::to_string(offset + limit);
+  }
+  co_return std::move(result);
+}
+
 Generator<std::string> Box::GetFileContent(File file, http::Range range,
                                            stdx::stop_token stop_token) {
   Request request{.url = GetEndpoint(StrCat("/files/", file.id.id, "/content")),
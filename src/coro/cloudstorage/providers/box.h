@@ -100,6 +100,10 @@ class Box {
                                    std::optional<std::string> page_token,
                                    stdx::stop_token stop_token);
 
+  Task<PageData> SearchItemsPage(std::string query,
+                                 std::optional<std::string> page_token,
+                                 stdx::stop_token stop_token);
+
   Generator<std::string> GetFileContent(File file, http::Range range,
                                         stdx::stop_token stop_token);
 
@@ -1,10 +1,15 @@
 #include "coro/cloudstorage/providers/dropbox.h"
 
+#include <algorithm>
 #include <nlohmann/json.hpp>
+#include <unordered_map>
+#include <vector>
 
 #include "coro/cloudstorage/util/abstract_cloud_provider_impl.h"
 #include "coro/cloudstorage/util/generator_utils.h"
 #include "coro/cloudstorage/util/string_utils.h"
+#include "coro/http/http_exception.h"
+#include "coro/when_all.h"
 
 namespace coro::cloudstorage {
 
@@ -12,6 +17,7 @@ namespace {
 
 constexpr std::string_view kEndpoint = "https://api.dropboxapi.com/2";
 constexpr int kChunkSize = 8 * 1024 * 1024;
+constexpr size_t kMaxConcurrentParentLookups = 16;
 
 using ::coro::cloudstorage::util::StrCat;
 using ::coro::http::GetBody;
@@ -231,6 +237,131 @@ auto Dropbox::ListDirectoryPage(Directory directory,
   co_return page_data;
 }
 
+auto Dropbox::SearchItemsPage(std::string query,
+                              std::optional<std::string> page_token,
+                              stdx::stop_token stop_token) -> Task<PageData> {
+  http::Request<std::string> request;
+  json body;
+  if (page_token) {
+    body["cursor"] = std::move(*page_token);
+    request = {.url = GetEndpoint("/files/search/continue_v2"),
+               .method = http::Method::kPost,
+               .headers = {{"Content-Type", "application/json"}},
+               .body = body.dump(),
+               .invalidates_cache = false};
+  } else {
+    body["query"] = std::move(query);
+    body["options"]["filename_only"] = true;
+    request = {.url = GetEndpoint("/files/search_v2"),
+               .method = http::Method::kPost,
+               .headers = {{"Content-Type", "application/json"}},
+               .body = body.dump(),
+               .invalidates_cache = false};
+  }
+  auto response = co_await auth_manager_.FetchJson(std::move(request),
+                                                   std::move(stop_token));
+
+  PageData page_data;
+  for (const json& match : response["matches"]) {
+    page_data.items.emplace_back(ToItem(match["metadata"]["metadata"]));
+  }
+  if (response["has_more"]) {
+    page_data.next_page_token = response["cursor"];
+  }
+  co_return page_data;
+}
+
+auto Dropbox::GetChangeCursor(stdx::stop_token stop_token)
+    -> Task<std::string> {
+  json body;
+  body["path"] = "";
+  body["recursive"] = true;
+  body["include_deleted"] = true;
+  http::Request<std::string> request{
+      .url = GetEndpoint("/files/list_folder/get_latest_cursor"),
+      .method = http::Method::kPost,
+      .headers = {{"Content-Type", "application/json"}},
+      .body = body.dump(),
+      .invalidates_cache = false};
+  auto response = co_await auth_manager_.FetchJson(std::move(request),
+                                                   std::move(stop_token));
+  co_return std::string(response["cursor"]);
+}
+
+// The entries only carry their paths, so the ids of their parents are looked up
+// once per page. Deleted entries don't have an id either and are reported by
+// name.
+auto Dropbox::GetChanges(std::string cursor, stdx::stop_token stop_token)
+    -> Task<ChangePage> {
+  json body;
+  body["cursor"] = std::move(cursor);
+  http::Request<std::string> request{
+      .url = GetEndpoint("/files/list_folder/continue"),
+      .method = http::Method::kPost,
+      .headers = {{"Content-Type", "application/json"}},
+      .body = body.dump(),
+      .invalidates_cache = false};
+  auto response =
+      co_await auth_manager_.FetchJson(std::move(request), stop_token);
+
+  // Ids of the parents of the changed items, unset for the removed ones.
+  std::unordered_map<std::string, std::optional<std::string>> parent_ids{
+      {"", ""}};
+  std::vector<std::string> parent_paths;
+  for (const json& entry : response["entries"]) {
+    std::string parent_path =
+        GetDirectoryPath(std::string(entry["path_lower"]));
+    if (parent_ids.emplace(parent_path, std::nullopt).second) {
+      parent_paths.emplace_back(std::move(parent_path));
+    }
+  }
+  auto get_parent_id = [](Dropbox* dropbox, std::string path,
+                          stdx::stop_token stop_token)
+      -> Task<std::optional<std::string>> {
+    try {
+      auto parent =
+          co_await dropbox->GetItem(std::move(path), std::move(stop_token));
+      co_return std::visit([](auto& d) { return std::move(d.id); }, parent);
+    } catch (const http::HttpException& e) {
+      if (e.status() != 409) {
+        throw;
+      }
+    }
+    co_return std::nullopt;
+  };
+  for (size_t i = 0; i < parent_paths.size();
+       i += kMaxConcurrentParentLookups) {
+    size_t end = std::min(parent_paths.size(), i + kMaxConcurrentParentLookups);
+    std::vector<Task<std::optional<std::string>>> tasks;
+    for (size_t j = i; j < end; j++) {
+      tasks.emplace_back(get_parent_id(this, parent_paths[j], stop_token));
+    }
+    auto results = co_await WhenAll(std::move(tasks));
+    for (size_t j = i; j < end; j++) {
+      parent_ids[parent_paths[j]] = std::move(results[j - i]);
+    }
+  }
+
+  ChangePage page;
+  for (const json& entry : response["entries"]) {
+    auto it =
+        parent_ids.find(GetDirectoryPath(std::string(entry["path_lower"])));
+    if (!it->second) {
+      // The parent was removed as well, which is reported on its own.
+      continue;
+    }
+    Change change{.name = entry["name"], .parents = {*it->second}};
+    if (entry[".tag"] != "deleted") {
+      change.item = ToItem(entry);
+      change.id = std::visit([](const auto& d) { return d.id; }, *change.item);
+    }
+    page.changes.emplace_back(std::move(change));
+  }
+  page.cursor = response["cursor"];
+  page.has_more = response["has_more"];
+  co_return page;
+}
+
 Generator<std::string> Dropbox::GetFileContent(File file, http::Range range,
                                                stdx::stop_token stop_token) {
   json json;
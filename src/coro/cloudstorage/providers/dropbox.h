@@ -43,6 +43,19 @@ class Dropbox {
     std::optional<std::string> next_page_token;
   };
 
+  struct Change {
+    std::string id;
+    std::string name;
+    std::vector<std::string> parents;
+    std::optional<Item> item;
+  };
+
+  struct ChangePage {
+    std::vector<Change> changes;
+    std::string cursor;
+    bool has_more;
+  };
+
   struct Auth {
     using json = nlohmann::json;
 
@@ -103,6 +116,14 @@ class Dropbox {
                                    std::optional<std::string> page_token,
                                    stdx::stop_token stop_token);
 
+  Task<PageData> SearchItemsPage(std::string query,
+                                 std::optional<std::string> page_token,
+                                 stdx::stop_token stop_token);
+
+  Task<std::string> GetChangeCursor(stdx::stop_token stop_token);
+
+  Task<ChangePage> GetChanges(std::string cursor, stdx::stop_token stop_token);
+
   Generator<std::string> GetFileContent(File file, http::Range range,
                                         stdx::stop_token stop_token);
 
@@ -32,6 +32,19 @@ std::string GetIconLink(std::string_view link) {
          std::string(link.begin() + it + strlen(kDefaultSize), link.end());
 }
 
+// Quotes `value` as a string literal of the Drive query language.
+std::string QuoteQueryString(std::string_view value) {
+  std::string result = "'";
+  for (char c : value) {
+    if (c == '\'' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  result += '\'';
+  return result;
+}
+
 template <typename T>
 T ToItemImpl(const nlohmann::json& json) {
   T result = {};
@@ -161,6 +174,94 @@ auto GoogleDrive::ListDirectoryPage(Directory directory,
                              : std::nullopt};
 }
 
+auto GoogleDrive::SearchItemsPage(std::string query,
+                                  std::optional<std::string> page_token,
+                                  stdx::stop_token stop_token)
+    -> Task<PageData> {
+  std::vector<std::pair<std::string, std::string>> params = {
+      {"q", StrCat("name contains ", QuoteQueryString(query),
+                   " and trashed = false")},
+      {"fields",
+       "files(" + std::string(kFileProperties) + "),kind,nextPageToken"}};
+  if (page_token) {
+    params.emplace_back("pageToken", std::move(*page_token));
+  }
+  auto request = Request{.url = GetEndpoint("/files") + "?" +
+                                http::FormDataToString(params)};
+  json data = co_await auth_manager_.FetchJson(std::move(request),
+                                               std::move(stop_token));
+  std::vector<Item> result;
+  for (const json& item : data["files"]) {
+    result.emplace_back(ToItem(item));
+  }
+  co_return PageData{
+      .items = std::move(result),
+      .next_page_token = data.contains("nextPageToken")
+                             ? std::make_optional(data["nextPageToken"])
+                             : std::nullopt};
+}
+
+// The cursor also holds the id of the root directory, which the changes report
+// as a parent instead of its "root" alias.
+auto GoogleDrive::GetChangeCursor(stdx::stop_token stop_token)
+    -> Task<std::string> {
+  json root = co_await auth_manager_.FetchJson(
+      Request{.url = GetEndpoint("/files/root?fields=id")}, stop_token);
+  json start = co_await auth_manager_.FetchJson(
+      Request{.url = GetEndpoint("/changes/startPageToken")},
+      std::move(stop_token));
+  json cursor;
+  cursor["root_id"] = root["id"];
+  cursor["page_token"] = start["startPageToken"];
+  co_return cursor.dump();
+}
+
+auto GoogleDrive::GetChanges(std::string cursor, stdx::stop_token stop_token)
+    -> Task<ChangePage> {
+  json state = json::parse(cursor);
+  std::string root_id = state["root_id"];
+  auto request = Request{
+      .url = GetEndpoint("/changes") + "?" +
+             http::FormDataToString(
+                 {{"pageToken", std::string(state["page_token"])},
+                  {"pageSize", "1000"},
+                  {"fields", StrCat("changes(changeType,fileId,removed,file(",
+                                    kFileProperties,
+                                    ")),nextPageToken,newStartPageToken")}})};
+  json data = co_await auth_manager_.FetchJson(std::move(request),
+                                               std::move(stop_token));
+  ChangePage page;
+  for (const json& entry : data["changes"]) {
+    // Changes of shared drives themselves carry no file.
+    if (entry.value("changeType", "file") != "file" ||
+        !entry.contains("fileId")) {
+      continue;
+    }
+    Change change{.id = entry.at("fileId")};
+    // Trashed items and items without a parent, e.g. the ones shared with the
+    // user, are not in the tree of the account.
+    if (!entry.value("removed", false) && entry.contains("file") &&
+        !entry.at("file").value("trashed", false) &&
+        entry.at("file").contains("parents")) {
+      change.item = ToItem(entry.at("file"));
+      std::visit(
+          [&](const auto& d) {
+            change.name = d.name;
+            for (const auto& parent : d.parents) {
+              change.parents.emplace_back(parent == root_id ? "root" : parent);
+            }
+          },
+          *change.item);
+    }
+    page.changes.emplace_back(std::move(change));
+  }
+  page.has_more = data.contains("nextPageToken");
+  state["page_token"] =
+      page.has_more ? data["nextPageToken"] : data["newStartPageToken"];
+  page.cursor = state.dump();
+  co_return page;
+}
+
 auto GoogleDrive::GetGeneralData(stdx::stop_token stop_token)
     -> Task<GeneralData> {
   auto request = Request{.url = GetEndpoint("/about?fields=user,storageQuota")};
@@ -398,6 +499,17 @@ nlohmann::json GoogleDrive::ToJson(const Item& item) {
       item);
 }
 
+void GoogleDrive::WriteItemData(const ItemData& item,
+                                util::ItemDataWriter& writer) {
+  writer.WriteStringList(item.parents);
+  writer.WriteString(item.thumbnail_url);
+}
+
+void GoogleDrive::ReadItemData(util::ItemDataReader& reader, ItemData& item) {
+  item.parents = reader.ReadStringList();
+  item.thumbnail_url = reader.ReadString();
+}
+
 namespace util {
 
 template <>
@@ -9,6 +9,7 @@
 #include "coro/cloudstorage/util/auth_data.h"
 #include "coro/cloudstorage/util/auth_manager.h"
 #include "coro/cloudstorage/util/fetch_json.h"
+#include "coro/cloudstorage/util/item_data_codec.h"
 #include "coro/http/http.h"
 #include "coro/http/http_parse.h"
 #include "coro/stdx/coroutine.h"
@@ -75,6 +76,19 @@ class GoogleDrive {
     std::optional<std::string> next_page_token;
   };
 
+  struct Change {
+    std::string id;
+    std::string name;
+    std::vector<std::string> parents;
+    std::optional<Item> item;
+  };
+
+  struct ChangePage {
+    std::vector<Change> changes;
+    std::string cursor;
+    bool has_more;
+  };
+
   struct FileContent {
     Generator<std::string> data;
     std::optional<int64_t> size;
@@ -99,10 +113,18 @@ class GoogleDrive {
                                    std::optional<std::string> page_token,
                                    stdx::stop_token stop_token);
 
+  Task<PageData> SearchItemsPage(std::string query,
+                                 std::optional<std::string> page_token,
+                                 stdx::stop_token stop_token);
+
   Task<GeneralData> GetGeneralData(stdx::stop_token stop_token);
 
   Task<Item> GetItem(std::string id, stdx::stop_token stop_token);
 
+  Task<std::string> GetChangeCursor(stdx::stop_token stop_token);
+
+  Task<ChangePage> GetChanges(std::string cursor, stdx::stop_token stop_token);
+
   Generator<std::string> GetFileContent(File file, http::Range range,
                                         stdx::stop_token stop_token);
 
@@ -133,6 +155,9 @@ class GoogleDrive {
   static Item ToItem(const nlohmann::json&);
   static nlohmann::json ToJson(const Item&);
 
+  static void WriteItemData(const ItemData&, util::ItemDataWriter&);
+  static void ReadItemData(util::ItemDataReader&, ItemData&);
+
  private:
   Task<File> UploadFile(std::optional<std::string_view> id,
                         nlohmann::json metadata, FileContent content,
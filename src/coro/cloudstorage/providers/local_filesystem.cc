@@ -1,5 +1,6 @@
 #include "coro/cloudstorage/providers/local_filesystem.h"
 
+#include "coro/cloudstorage/cloud_exception.h"
 #include "coro/cloudstorage/util/abstract_cloud_provider_impl.h"
 #include "coro/cloudstorage/util/string_utils.h"
 
@@ -15,19 +16,42 @@
 #undef CreateFile
 
 #else
+#include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
+#include <memory>
+#include <span>
+#include <system_error>
+#include <utility>
+
+#include "coro/shared_promise.h"
+#include "coro/when_all.h"
 
 namespace coro::cloudstorage {
 
 namespace {
 
-constexpr const int kBufferSize = 4096;
+constexpr const int kBufferSize = 2 * 1024 * 1024;
+
+constexpr size_t kListPageSize = 1024;
+constexpr size_t kStatBatchSize = 128;
+constexpr auto kStalePartFileAge = std::chrono::hours(24);
+
+#ifdef WIN32
+std::atomic<int64_t> temporary_file_count;
+#endif
 
 std::string GetHomeDirectory() {
 #ifdef WINRT
@@ -46,15 +70,12 @@ std::string GetHomeDirectory() {
 #endif
 }
 
-bool IsFileHidden(const std::filesystem::directory_entry& e) {
 #ifdef WIN32
+bool IsFileHidden(const std::filesystem::directory_entry& e) {
   return GetFileAttributesW(e.path().c_str()) &
          (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM);
-#else
-  return e.path().filename().c_str()[0] == '.' ||
-         e.path().filename() == "lost+found";
-#endif
 }
+#endif
 
 int64_t GetTimestamp(const std::filesystem::directory_entry& e) {
 #if defined(WIN32)
@@ -90,6 +111,515 @@ T ToItem(const std::filesystem::directory_entry& entry) {
   return item;
 }
 
+// Renames `from` to `to` unless `to` exists. Returns the error on failure.
+std::error_code RenameNoReplace(const std::filesystem::path& from,
+                                const std::filesystem::path& to) {
+  std::error_code ec;
+#ifndef WIN32
+#ifdef RENAME_NOREPLACE
+  if (renameat2(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(),
+                RENAME_NOREPLACE) == 0) {
+    return ec;
+  }
+  // The kernel or the filesystem may not support the flag.
+  if (errno != EINVAL && errno != ENOSYS) {
+    return std::error_code(errno, std::generic_category());
+  }
+#endif
+  if (!std::filesystem::is_directory(from)) {
+    if (link(from.c_str(), to.c_str()) == 0) {
+      if (unlink(from.c_str()) != 0) {
+        ec = std::error_code(errno, std::generic_category());
+        unlink(to.c_str());
+      }
+      return ec;
+    }
+    if (errno != EPERM && errno != EOPNOTSUPP) {
+      return std::error_code(errno, std::generic_category());
+    }
+  }
+#endif
+  // Neither is available, so there is a window between the check and the
+  // rename.
+  if (std::filesystem::exists(to)) {
+    return std::make_error_code(std::errc::file_exists);
+  }
+  std::filesystem::rename(from, to, ec);
+  return ec;
+}
+
+// Copies `from` to `to` unless `to` exists. Whatever was created at `to` is
+// removed if the copy fails.
+void CopyNoReplace(const std::filesystem::path& from,
+                   const std::filesystem::path& to) {
+  if (std::filesystem::is_directory(from)
+          ? !std::filesystem::create_directory(to)
+          : std::filesystem::exists(to)) {
+    throw CloudException("item already exists");
+  }
+  try {
+    std::filesystem::copy(from, to, std::filesystem::copy_options::recursive);
+  } catch (const std::filesystem::filesystem_error& e) {
+    // Somebody else created the file meanwhile.
+    if (e.code() == std::errc::file_exists) {
+      throw CloudException("item already exists");
+    }
+    std::error_code ec;
+    std::filesystem::remove_all(to, ec);
+    throw;
+  }
+}
+
+// Moves `from` to `to`, which must not exist, falling back to a copy when
+// `to` is on another device.
+void MoveOrCopy(const std::filesystem::path& from,
+                const std::filesystem::path& to) {
+  std::error_code ec = RenameNoReplace(from, to);
+  if (!ec) {
+    return;
+  }
+  if (ec == std::errc::file_exists || ec == std::errc::directory_not_empty) {
+    throw CloudException("item already exists");
+  }
+  if (ec != std::errc::cross_device_link) {
+    throw std::filesystem::filesystem_error("couldn't move item", from, to, ec);
+  }
+  CopyNoReplace(from, to);
+  std::filesystem::remove_all(from);
+}
+
+// Removes the temporary files of uploads into `path` which were left behind by
+// a crash. They are told apart from the ones still being written by age.
+void RemoveStalePartFiles(const std::filesystem::path& path) {
+  std::string prefix = util::StrCat('.', path.filename().string(), '.');
+  auto now = std::filesystem::file_time_type::clock::now();
+  try {
+    for (const auto& entry :
+         std::filesystem::directory_iterator(path.parent_path())) {
+      std::string name = entry.path().filename().string();
+      if (!name.starts_with(prefix) || !name.ends_with(".part")) {
+        continue;
+      }
+      std::error_code ec;
+      auto time = entry.last_write_time(ec);
+      if (!ec && now - time > kStalePartFileAge) {
+        std::filesystem::remove(entry.path(), ec);
+      }
+    }
+  } catch (const std::filesystem::filesystem_error&) {
+  }
+}
+
+#ifdef WIN32
+
+Generator<std::string> ReadFile(coro::util::ThreadPool* thread_pool,
+                                std::string path, http::Range range,
+                                stdx::stop_token stop_token) {
+  std::ifstream stream = co_await thread_pool->Do(stop_token, [&] {
+    return std::ifstream(path, std::ifstream::binary);
+  });
+  co_await thread_pool->Do(stop_token, [&] { stream.seekg(range.start); });
+  int64_t bytes_read = 0;
+  int64_t size = *range.end - range.start + 1;
+  while (bytes_read < size) {
+    if (stop_token.stop_requested()) {
+      throw InterruptedException();
+    }
+    std::string buffer(std::min<int64_t>(size - bytes_read, kBufferSize), 0);
+    bool read_status = co_await thread_pool->Do(stop_token, [&] {
+      return bool(stream.read(buffer.data(),
+                              static_cast<std::streamsize>(buffer.size())));
+    });
+    if (!read_status) {
+      throw RuntimeError("couldn't read file");
+    }
+    bytes_read += static_cast<int64_t>(buffer.size());
+    co_yield std::move(buffer);
+  }
+}
+
+// Writes a new file to a hidden `.<name>.<pid>.<n>.part` file next to `path`
+// and moves it in place on `Commit`, unless an item took `path` meanwhile.
+// Such a file is always used, so `use_named_temporary_file` has no effect.
+class FileWriter {
+ public:
+  FileWriter(std::filesystem::path path, std::optional<int64_t> size,
+             bool /*use_named_temporary_file*/)
+      : path_(std::move(path)),
+        size_(size),
+        temporary_path_(path_.parent_path() /
+                        util::StrCat('.', path_.filename().string(), '.',
+                                     GetCurrentProcessId(), '.',
+                                     temporary_file_count++, ".part")) {
+    RemoveStalePartFiles(path_);
+    stream_.open(temporary_path_, std::ofstream::binary);
+    if (!stream_) {
+      throw RuntimeError("couldn't create file");
+    }
+  }
+  FileWriter(const FileWriter&) = delete;
+  FileWriter& operator=(const FileWriter&) = delete;
+  ~FileWriter() {
+    if (!temporary_path_.empty()) {
+      stream_.close();
+      std::error_code ec;
+      std::filesystem::remove(temporary_path_, ec);
+    }
+  }
+
+  void Write(std::string_view data) {
+    if (!stream_.write(data.data(),
+                       static_cast<std::streamsize>(data.size()))) {
+      throw RuntimeError("couldn't write file");
+    }
+    written_ += static_cast<int64_t>(data.size());
+  }
+
+  void Commit() {
+    if (size_ && *size_ != written_) {
+      throw CloudException("file size doesn't match the declared size");
+    }
+    stream_.close();
+    if (!stream_) {
+      throw RuntimeError("couldn't write file");
+    }
+    MoveOrCopy(temporary_path_, path_);
+    temporary_path_.clear();
+  }
+
+ private:
+  std::filesystem::path path_;
+  std::optional<int64_t> size_;
+  std::filesystem::path temporary_path_;
+  std::ofstream stream_;
+  int64_t written_ = 0;
+};
+
+#else
+
+class FileDescriptor {
+ public:
+  explicit FileDescriptor(int fd) : fd_(fd) {}
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+  ~FileDescriptor() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  int get() const { return fd_; }
+  int release() { return std::exchange(fd_, -1); }
+
+ private:
+  int fd_;
+};
+
+// Writes a new file which shows up at `path` only once `Commit` succeeds, and
+// never in place of an existing item. On Linux the data goes to an unnamed
+// O_TMPFILE file which is then linked at `path`. Elsewhere, or if the
+// filesystem doesn't support that, or `use_named_temporary_file` is set, it
+// goes to a hidden `.<name>.XXXXXX.part` file next to `path`.
+class FileWriter {
+ public:
+  FileWriter(std::filesystem::path path, std::optional<int64_t> size,
+             bool use_named_temporary_file)
+      : path_(std::move(path)),
+        size_(size),
+        fd_(OpenTemporaryFile(use_named_temporary_file)) {
+#ifdef FALLOC_FL_KEEP_SIZE
+    if (size_ && *size_ > 0) {
+      // Reserves the blocks without growing the file, so that an upload cut
+      // short doesn't leave zeros behind its data.
+      fallocate(fd_.get(), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(*size_));
+    }
+#endif
+  }
+  FileWriter(const FileWriter&) = delete;
+  FileWriter& operator=(const FileWriter&) = delete;
+  ~FileWriter() {
+    if (!temporary_path_.empty()) {
+      std::error_code ec;
+      std::filesystem::remove(temporary_path_, ec);
+    }
+  }
+
+  void Write(std::string_view data) {
+    while (!data.empty()) {
+      auto result = write(fd_.get(), data.data(), data.size());
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result <= 0) {
+        throw RuntimeError("couldn't write file");
+      }
+      data.remove_prefix(static_cast<size_t>(result));
+      written_ += result;
+    }
+  }
+
+  void Commit() {
+    if (size_ && *size_ != written_) {
+      throw CloudException("file size doesn't match the declared size");
+    }
+    if (temporary_path_.empty()) {
+      // An O_TMPFILE file can only be linked while it is open.
+      std::string fd_path = util::StrCat("/proc/self/fd/", fd_.get());
+      if (linkat(AT_FDCWD, fd_path.c_str(), AT_FDCWD, path_.c_str(),
+                 AT_SYMLINK_FOLLOW) != 0) {
+        ThrowLinkError(errno);
+      }
+      if (close(fd_.release()) != 0) {
+        std::error_code ec;
+        std::filesystem::remove(path_, ec);
+        throw RuntimeError("couldn't write file");
+      }
+      return;
+    }
+    if (close(fd_.release()) != 0) {
+      throw RuntimeError("couldn't write file");
+    }
+    if (link(temporary_path_.c_str(), path_.c_str()) == 0) {
+      return;
+    }
+    if (errno != EPERM && errno != EOPNOTSUPP) {
+      ThrowLinkError(errno);
+    }
+    // The filesystem has no hard links.
+    MoveOrCopy(temporary_path_, path_);
+    temporary_path_.clear();
+  }
+
+ private:
+  int OpenTemporaryFile([[maybe_unused]] bool use_named_temporary_file) {
+#ifdef O_TMPFILE
+    if (!use_named_temporary_file) {
+      if (int fd = open(path_.parent_path().c_str(),
+                        O_TMPFILE | O_WRONLY | O_CLOEXEC, 0644);
+          fd >= 0 || (errno != EOPNOTSUPP && errno != EISDIR)) {
+        return CheckCreated(fd);
+      }
+    }
+#endif
+    RemoveStalePartFiles(path_);
+    std::string temporary_path =
+        (path_.parent_path() /
+         util::StrCat('.', path_.filename().string(), ".XXXXXX.part"))
+            .string();
+    int fd = CheckCreated(mkstemps(temporary_path.data(), 5));
+    temporary_path_ = std::move(temporary_path);
+    fchmod(fd, 0644);
+    return fd;
+  }
+
+  static int CheckCreated(int fd) {
+    if (fd < 0) {
+      throw RuntimeError("couldn't create file");
+    }
+    return fd;
+  }
+
+  [[noreturn]] void ThrowLinkError(int error) const {
+    if (error == EEXIST) {
+      throw CloudException("item already exists");
+    }
+    throw std::filesystem::filesystem_error(
+        "couldn't create file", path_,
+        std::error_code(error, std::generic_category()));
+  }
+
+  std::filesystem::path path_;
+  std::optional<int64_t> size_;
+  std::filesystem::path temporary_path_;
+  FileDescriptor fd_;
+  int64_t written_ = 0;
+};
+
+// Reads `size` bytes at `offset` with pread on a thread pool worker. Shares
+// ownership of the descriptor, so that a read still running after the reader
+// went away doesn't touch a closed or reused descriptor.
+struct ReadChunk {
+  Task<std::string> operator()() const {
+    co_return co_await thread_pool->Do(stop_token, [fd = fd, offset = offset,
+                                                    size = size] {
+      std::string buffer(static_cast<size_t>(size), 0);
+      int64_t bytes_read = 0;
+      while (bytes_read < size) {
+        auto result = pread(fd->get(), buffer.data() + bytes_read,
+                            static_cast<size_t>(size - bytes_read),
+                            static_cast<off_t>(offset + bytes_read));
+        if (result < 0 && errno == EINTR) {
+          continue;
+        }
+        if (result <= 0) {
+          throw RuntimeError("couldn't read file");
+        }
+        bytes_read += result;
+      }
+      return buffer;
+    });
+  }
+
+  coro::util::ThreadPool* thread_pool;
+  std::shared_ptr<FileDescriptor> fd;
+  int64_t offset;
+  int64_t size;
+  stdx::stop_token stop_token;
+};
+
+// Reads the range in large pieces. The read of the next piece is already
+// running on the thread pool while the current one is consumed.
+//
+// Every piece gets a buffer of its own. Yielding moves the string to the
+// consumer, which may keep it past the next resumption, and nothing hands it
+// back once it's dropped, so a free list here would never be refilled.
+Generator<std::string> ReadFile(coro::util::ThreadPool* thread_pool,
+                                std::string path, http::Range range,
+                                stdx::stop_token stop_token) {
+  int64_t size = *range.end - range.start + 1;
+  auto fd = co_await thread_pool->Do(stop_token, [&] {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      throw RuntimeError("couldn't open file");
+    }
+    auto result = std::make_shared<FileDescriptor>(fd);
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, static_cast<off_t>(range.start),
+                  static_cast<off_t>(size), POSIX_FADV_SEQUENTIAL);
+#endif
+    return result;
+  });
+  auto read = [&](int64_t offset) {
+    auto chunk = std::make_shared<SharedPromise<ReadChunk>>(ReadChunk{
+        .thread_pool = thread_pool,
+        .fd = fd,
+        .offset = offset,
+        .size = std::min<int64_t>(*range.end - offset + 1, kBufferSize),
+        .stop_token = stop_token});
+    RunTask([chunk, stop_token]() -> Task<> {
+      try {
+        co_await chunk->Get(stop_token);
+      } catch (...) {
+      }
+    });
+    return chunk;
+  };
+  int64_t offset = range.start;
+  auto pending = offset <= *range.end ? read(offset) : nullptr;
+  while (pending) {
+    std::string buffer = co_await pending->Get(stop_token);
+    offset += static_cast<int64_t>(buffer.size());
+    pending = offset <= *range.end ? read(offset) : nullptr;
+    co_yield std::move(buffer);
+  }
+}
+
+bool IsFileHidden(std::string_view name) {
+  return name.starts_with('.') || name == "lost+found";
+}
+
+int64_t GetTimestamp(const struct stat& file_info) {
+#ifdef __APPLE__
+  return file_info.st_mtimespec.tv_sec;
+#else
+  return file_info.st_mtim.tv_sec;
+#endif
+}
+
+struct DirDeleter {
+  void operator()(DIR* dir) const { closedir(dir); }
+};
+
+// Positions in the directory stream handed out as page tokens. On Linux the
+// telldir cookies stay valid across streams of the same directory; elsewhere
+// the token is the number of entries already read.
+#ifdef __linux__
+void SeekDirectory(DIR* dir, int64_t position) { seekdir(dir, position); }
+
+int64_t GetDirectoryPosition(DIR* dir, int64_t) { return telldir(dir); }
+#else
+void SeekDirectory(DIR* dir, int64_t position) {
+  for (int64_t i = 0; i < position && readdir(dir); i++) {
+  }
+}
+
+int64_t GetDirectoryPosition(DIR*, int64_t entries_read) {
+  return entries_read;
+}
+#endif
+
+struct DirectoryPage {
+  std::unique_ptr<DIR, DirDeleter> dir;
+  std::vector<std::string> names;
+  std::optional<std::string> next_page_token;
+};
+
+// Reads up to `kListPageSize` names of visible entries, without stating them.
+DirectoryPage ReadDirectoryPage(const std::string& path,
+                                const std::optional<std::string>& page_token) {
+  DirectoryPage page{.dir = std::unique_ptr<DIR, DirDeleter>(opendir(
+                         path.c_str()))};
+  if (!page.dir) {
+    throw CloudException(CloudException::Type::kNotFound);
+  }
+  int64_t position = page_token ? std::stoll(*page_token) : 0;
+  if (page_token) {
+    SeekDirectory(page.dir.get(), position);
+  }
+  while (page.names.size() < kListPageSize) {
+    errno = 0;
+    const dirent* entry = readdir(page.dir.get());
+    if (!entry) {
+      if (errno != 0) {
+        throw RuntimeError("couldn't read directory");
+      }
+      return page;
+    }
+    position++;
+    std::string_view name = entry->d_name;
+    if (name != "." && name != ".." && !IsFileHidden(name)) {
+      page.names.emplace_back(name);
+    }
+  }
+  page.next_page_token =
+      std::to_string(GetDirectoryPosition(page.dir.get(), position));
+  return page;
+}
+
+// Stats `names` relative to the directory's descriptor. Entries that vanished
+// or can't be stated are left empty.
+void StatEntries(DIR* dir, const std::string& directory_path,
+                 std::span<const std::string> names,
+                 std::span<std::optional<LocalFileSystem::Item>> items) {
+  for (size_t i = 0; i < names.size(); i++) {
+    struct stat file_info;
+    if (fstatat(dirfd(dir), names[i].c_str(), &file_info, 0) != 0) {
+      continue;
+    }
+    auto fill = [&]<typename T>(T item) {
+      item.id = (std::filesystem::path(directory_path) / names[i]).string();
+      item.name = names[i];
+      item.timestamp = GetTimestamp(file_info);
+      if constexpr (std::is_same_v<T, LocalFileSystem::File>) {
+        item.size = file_info.st_size;
+      }
+      items[i] = std::move(item);
+    };
+    if (S_ISDIR(file_info.st_mode)) {
+      fill(LocalFileSystem::Directory{});
+    } else {
+      fill(LocalFileSystem::File{});
+    }
+  }
+}
+
+#endif
+
+template <typename T>
+T ToItem(const std::filesystem::path& path) {
+  return ToItem<T>(std::filesystem::directory_entry(path));
+}
+
 template <typename T>
 T ToItemImpl(const nlohmann::json& json) {
   T item;
@@ -166,9 +696,33 @@ auto LocalFileSystem::GetItem(std::string id, stdx::stop_token stop_token) const
 }
 
 auto LocalFileSystem::ListDirectoryPage(Directory directory,
-                                        std::optional<std::string>,
+                                        std::optional<std::string> page_token,
                                         stdx::stop_token stop_token) const
     -> Task<PageData> {
+#ifndef WIN32
+  auto page = co_await thread_pool_->Do(
+      stop_token, [&] { return ReadDirectoryPage(directory.id, page_token); });
+  std::vector<std::optional<Item>> items(page.names.size());
+  std::vector<Task<>> tasks;
+  for (size_t i = 0; i < page.names.size(); i += kStatBatchSize) {
+    size_t count = std::min(kStatBatchSize, page.names.size() - i);
+    tasks.emplace_back(thread_pool_->Do(
+        stop_token,
+        [dir = page.dir.get(), &directory,
+         names = std::span<const std::string>(page.names).subspan(i, count),
+         batch = std::span<std::optional<Item>>(items).subspan(i, count)] {
+          StatEntries(dir, directory.id, names, batch);
+        }));
+  }
+  co_await WhenAll(std::move(tasks));
+  PageData page_data{.next_page_token = std::move(page.next_page_token)};
+  for (auto& item : items) {
+    if (item) {
+      page_data.items.emplace_back(std::move(*item));
+    }
+  }
+  co_return page_data;
+#else
   co_return co_await thread_pool_->Do(std::move(stop_token), [&] {
     PageData page_data;
     for (const auto& e : std::filesystem::directory_iterator(
@@ -184,6 +738,7 @@ auto LocalFileSystem::ListDirectoryPage(Directory directory,
     }
     return page_data;
   });
+#endif
 }
 
 auto LocalFileSystem::GetGeneralData(stdx::stop_token stop_token) const
@@ -199,64 +754,88 @@ auto LocalFileSystem::GetGeneralData(stdx::stop_token stop_token) const
 
 Generator<std::string> LocalFileSystem::GetFileContent(
     File file, http::Range range, stdx::stop_token stop_token) const {
-  std::ifstream stream = co_await thread_pool_->Do(stop_token, [&] {
-    return std::ifstream(file.id, std::ifstream::binary);
-  });
   if (!range.end) {
     range.end = file.size - 1;
   }
-  std::string buffer(kBufferSize, 0);
-  co_await thread_pool_->Do(stop_token, [&] { stream.seekg(range.start); });
-  int64_t bytes_read = 0;
-  int64_t size = *range.end - range.start + 1;
-  while (bytes_read < size) {
-    if (stop_token.stop_requested()) {
-      throw InterruptedException();
-    }
-    bool read_status = co_await thread_pool_->Do(stop_token, [&] {
-      return bool(stream.read(
-          buffer.data(), std::min<int64_t>(size - bytes_read, kBufferSize)));
-    });
-    if (!read_status) {
-      throw RuntimeError("couldn't read file");
-    }
-    co_yield std::string(buffer.data(), stream.gcount());
-    bytes_read += stream.gcount();
-  }
+  return ReadFile(thread_pool_, std::move(file.id), range,
+                  std::move(stop_token));
 }
 
 template <typename ItemT>
-Task<ItemT> LocalFileSystem::RenameItem(ItemT /*item*/,
-                                        std::string /*new_name*/,
-                                        stdx::stop_token /*stop_token*/) {
-  throw RuntimeError("unimplemented");
+Task<ItemT> LocalFileSystem::RenameItem(ItemT item, std::string new_name,
+                                        stdx::stop_token stop_token) {
+  co_return co_await thread_pool_->Do(std::move(stop_token), [&] {
+    std::filesystem::path path(item.id);
+    std::filesystem::path new_path = path.parent_path() / new_name;
+    MoveOrCopy(path, new_path);
+    return coro::cloudstorage::ToItem<ItemT>(new_path);
+  });
 }
 
-auto LocalFileSystem::CreateDirectory(Directory /*parent*/,
-                                      std::string /*name*/,
-                                      stdx::stop_token /*stop_token*/)
+auto LocalFileSystem::CreateDirectory(Directory parent, std::string name,
+                                      stdx::stop_token stop_token)
     -> Task<Directory> {
-  throw RuntimeError("unimplemented");
+  co_return co_await thread_pool_->Do(std::move(stop_token), [&] {
+    std::filesystem::path path = std::filesystem::path(parent.id) / name;
+    if (!std::filesystem::create_directory(path)) {
+      throw CloudException("item already exists");
+    }
+    return coro::cloudstorage::ToItem<Directory>(path);
+  });
 }
 
-Task<> LocalFileSystem::RemoveItem(Item /*item*/,
-                                   stdx::stop_token /*stop_token*/) {
-  throw RuntimeError("unimplemented");
+Task<> LocalFileSystem::RemoveItem(Item item, stdx::stop_token stop_token) {
+  co_await thread_pool_->Do(std::move(stop_token), [&] {
+    std::visit(
+        [](const auto& d) {
+          if (std::filesystem::remove_all(d.id) == 0) {
+            throw CloudException(CloudException::Type::kNotFound);
+          }
+        },
+        item);
+  });
 }
 
 template <typename ItemT>
-Task<ItemT> LocalFileSystem::MoveItem(ItemT /*source*/,
-                                      Directory /*destination*/,
-                                      stdx::stop_token /*stop_token*/) {
-  throw RuntimeError("unimplemented");
-}
-
-auto LocalFileSystem::CreateFile(Directory /*parent*/,
-                                 std::string_view /*name*/,
-                                 FileContent /*content*/,
-                                 stdx::stop_token /*stop_token*/)
-    -> Task<File> {
-  throw RuntimeError("unimplemented");
+Task<ItemT> LocalFileSystem::MoveItem(ItemT source, Directory destination,
+                                      stdx::stop_token stop_token) {
+  co_return co_await thread_pool_->Do(std::move(stop_token), [&] {
+    std::filesystem::path path(source.id);
+    std::filesystem::path new_path =
+        std::filesystem::path(destination.id) / path.filename();
+    MoveOrCopy(path, new_path);
+    return coro::cloudstorage::ToItem<ItemT>(new_path);
+  });
+}
+
+// The content only shows up at its final path once it is complete and has the
+// declared size, so concurrent uploads never observe or clobber a partially
+// written file. See `FileWriter`.
+auto LocalFileSystem::CreateFile(Directory parent, std::string_view name,
+                                 FileContent content,
+                                 stdx::stop_token stop_token) -> Task<File> {
+  std::filesystem::path path =
+      std::filesystem::path(parent.id) / std::string(name);
+  auto writer = co_await thread_pool_->Do(stop_token, [&] {
+    return std::make_unique<FileWriter>(path, content.size,
+                                        config_.use_named_temporary_files);
+  });
+  std::string buffer;
+  FOR_CO_AWAIT(std::string & chunk, content.data) {
+    buffer += chunk;
+    if (buffer.size() >= kBufferSize) {
+      co_await thread_pool_->Do(stop_token, [&] { writer->Write(buffer); });
+      buffer.clear();
+    }
+  }
+  co_await thread_pool_->Do(stop_token, [&] {
+    writer->Write(buffer);
+    writer->Commit();
+    writer.reset();
+  });
+  co_return co_await thread_pool_->Do(std::move(stop_token), [&] {
+    return coro::cloudstorage::ToItem<File>(path);
+  });
 }
 
 auto LocalFileSystem::ToItem(const nlohmann::json& json) -> Item {
@@ -56,9 +56,22 @@ class LocalFileSystem {
   static constexpr std::string_view kId = "local";
   static inline constexpr const auto& kIcon = util::kLocalDriveIcon;
 
+  struct Config {
+    // Writes new files through hidden `.part` files next to their path even
+    // where unnamed temporary files are supported.
+    bool use_named_temporary_files;
+  };
+
   LocalFileSystem(coro::util::ThreadPool* thread_pool,
                   Auth::AuthToken auth_token)
-      : thread_pool_(thread_pool), auth_token_(std::move(auth_token)) {}
+      : LocalFileSystem(thread_pool, std::move(auth_token),
+                        Config{.use_named_temporary_files = false}) {}
+
+  LocalFileSystem(coro::util::ThreadPool* thread_pool,
+                  Auth::AuthToken auth_token, Config config)
+      : thread_pool_(thread_pool),
+        auth_token_(std::move(auth_token)),
+        config_(config) {}
 
   Task<Directory> GetRoot(stdx::stop_token) const;
 
@@ -95,6 +108,7 @@ class LocalFileSystem {
  private:
   coro::util::ThreadPool* thread_pool_;
   Auth::AuthToken auth_token_;
+  Config config_;
 };
 
 struct LocalFileSystem::Auth::AuthHandler {
@@ -1283,6 +1283,41 @@ nlohmann::json Mega::ToJson(const Item& item) {
       item);
 }
 
+void Mega::WriteItemData(const File& item, util::ItemDataWriter& writer) {
+  writer.WriteUint64(item.parent);
+  writer.WriteString(item.user);
+  writer.WriteString(item.attr.dump());
+  writer.WriteBytes(item.compkey);
+  writer.WriteBool(item.thumbnail_id.has_value());
+  if (item.thumbnail_id) {
+    writer.WriteUint64(*item.thumbnail_id);
+  }
+}
+
+void Mega::WriteItemData(const Directory& item, util::ItemDataWriter& writer) {
+  writer.WriteUint64(item.parent);
+  writer.WriteString(item.user);
+  writer.WriteString(item.attr.dump());
+  writer.WriteBytes(item.compkey);
+}
+
+void Mega::ReadItemData(util::ItemDataReader& reader, File& item) {
+  item.parent = reader.ReadUint64();
+  item.user = reader.ReadString();
+  item.attr = nlohmann::json::parse(reader.ReadString());
+  reader.ReadBytes(item.compkey);
+  if (reader.ReadBool()) {
+    item.thumbnail_id = reader.ReadUint64();
+  }
+}
+
+void Mega::ReadItemData(util::ItemDataReader& reader, Directory& item) {
+  item.parent = reader.ReadUint64();
+  item.user = reader.ReadString();
+  item.attr = nlohmann::json::parse(reader.ReadString());
+  reader.ReadBytes(item.compkey);
+}
+
 namespace util {
 
 template <>
@@ -7,6 +7,7 @@
 #include "coro/cloudstorage/util/auth_data.h"
 #include "coro/cloudstorage/util/auth_handler.h"
 #include "coro/cloudstorage/util/fetch_json.h"
+#include "coro/cloudstorage/util/item_data_codec.h"
 #include "coro/cloudstorage/util/random_number_generator.h"
 #include "coro/cloudstorage/util/serialize_utils.h"
 #include "coro/cloudstorage/util/thumbnail_generator.h"
@@ -186,6 +187,11 @@ class Mega {
   static Item ToItem(const nlohmann::json& serialized);
   static nlohmann::json ToJson(const Item&);
 
+  static void WriteItemData(const File&, util::ItemDataWriter&);
+  static void WriteItemData(const Directory&, util::ItemDataWriter&);
+  static void ReadItemData(util::ItemDataReader&, File&);
+  static void ReadItemData(util::ItemDataReader&, Directory&);
+
  private:
   struct PreloginData {
     int version;
@@ -13,6 +13,10 @@ using ::coro::cloudstorage::util::StrCat;
 constexpr std::string_view kFileProperties =
     "name,folder,audio,image,photo,video,id,size,lastModifiedDateTime,"
     "thumbnails,@content.downloadUrl,mimeType";
+// `kFileProperties` and the ones which locate an item in the delta query.
+constexpr std::string_view kChangeProperties =
+    "name,folder,audio,image,photo,video,id,size,lastModifiedDateTime,"
+    "thumbnails,@content.downloadUrl,mimeType,parentReference,deleted,root";
 
 template <typename T>
 T ToItemImpl(const nlohmann::json& json) {
@@ -164,6 +168,84 @@ auto OneDrive::ListDirectoryPage(Directory directory,
                              : std::nullopt};
 }
 
+auto OneDrive::SearchItemsPage(std::string query,
+                               std::optional<std::string> page_token,
+                               stdx::stop_token stop_token) -> Task<PageData> {
+  std::string escaped_query;
+  for (char c : query) {
+    escaped_query += c;
+    if (c == '\'') {
+      escaped_query += c;
+    }
+  }
+  auto request = Request{
+      .url = page_token.value_or(
+          GetEndpoint(StrCat("/drive/root/search(q='",
+                             http::EncodeUri(escaped_query), "')")) +
+          "?" + http::FormDataToString({{"select", kFileProperties}}))};
+  json data = co_await auth_manager_.FetchJson(std::move(request),
+                                               std::move(stop_token));
+  std::vector<Item> result;
+  for (const json& item : data["value"]) {
+    result.emplace_back(ToItem(item));
+  }
+  co_return PageData{
+      .items = std::move(result),
+      .next_page_token = data.contains("@odata.nextLink")
+                             ? std::make_optional(data["@odata.nextLink"])
+                             : std::nullopt};
+}
+
+// The cursor also holds the id of the root directory, which the changes report
+// as a parent instead of its "root" alias.
+auto OneDrive::GetChangeCursor(stdx::stop_token stop_token)
+    -> Task<std::string> {
+  Task<json> task1 = auth_manager_.FetchJson(
+      Request{.url = GetEndpoint("/drive/root") + "?" +
+                     http::FormDataToString({{"select", "id"}})},
+      stop_token);
+  Task<json> task2 = auth_manager_.FetchJson(
+      Request{.url = GetEndpoint("/drive/root/delta") + "?" +
+                     http::FormDataToString({{"token", "latest"},
+                                             {"select", kChangeProperties}})},
+      stop_token);
+  auto [root, delta] = co_await WhenAll(std::move(task1), std::move(task2));
+  json cursor;
+  cursor["root_id"] = root["id"];
+  cursor["link"] = delta["@odata.deltaLink"];
+  co_return cursor.dump();
+}
+
+auto OneDrive::GetChanges(std::string cursor, stdx::stop_token stop_token)
+    -> Task<ChangePage> {
+  json state = json::parse(cursor);
+  std::string root_id = state["root_id"];
+  json data = co_await auth_manager_.FetchJson(
+      Request{.url = std::string(state["link"])}, std::move(stop_token));
+  ChangePage page;
+  for (const json& entry : data["value"]) {
+    if (entry.contains("root")) {
+      continue;
+    }
+    Change change{.id = entry["id"], .name = entry.value("name", "")};
+    if (entry.contains("parentReference") &&
+        entry["parentReference"].contains("id")) {
+      std::string parent_id = entry["parentReference"]["id"];
+      change.parents.emplace_back(parent_id == root_id ? "root"
+                                                       : std::move(parent_id));
+    }
+    if (!entry.contains("deleted")) {
+      change.item = ToItem(entry);
+    }
+    page.changes.emplace_back(std::move(change));
+  }
+  page.has_more = data.contains("@odata.nextLink");
+  state["link"] =
+      page.has_more ? data["@odata.nextLink"] : data["@odata.deltaLink"];
+  page.cursor = state.dump();
+  co_return page;
+}
+
 Generator<std::string> OneDrive::GetFileContent(File file, http::Range range,
                                                 stdx::stop_token stop_token) {
   auto request =
@@ -346,6 +428,15 @@ nlohmann::json OneDrive::ToJson(const Item& item) {
       item);
 }
 
+void OneDrive::WriteItemData(const ItemData& item,
+                             util::ItemDataWriter& writer) {
+  writer.WriteOptionalString(item.thumbnail_url);
+}
+
+void OneDrive::ReadItemData(util::ItemDataReader& reader, ItemData& item) {
+  item.thumbnail_url = reader.ReadOptionalString();
+}
+
 namespace util {
 
 template <>
@@ -5,6 +5,7 @@
 #include "coro/cloudstorage/util/auth_data.h"
 #include "coro/cloudstorage/util/auth_manager.h"
 #include "coro/cloudstorage/util/fetch_json.h"
+#include "coro/cloudstorage/util/item_data_codec.h"
 #include "coro/when_all.h"
 
 namespace coro::cloudstorage {
@@ -71,6 +72,19 @@ class OneDrive {
     std::optional<std::string> next_page_token;
   };
 
+  struct Change {
+    std::string id;
+    std::string name;
+    std::vector<std::string> parents;
+    std::optional<Item> item;
+  };
+
+  struct ChangePage {
+    std::vector<Change> changes;
+    std::string cursor;
+    bool has_more;
+  };
+
   struct FileContent {
     Generator<std::string> data;
     int64_t size;
@@ -99,6 +113,14 @@ class OneDrive {
                                    std::optional<std::string> page_token,
                                    stdx::stop_token stop_token);
 
+  Task<PageData> SearchItemsPage(std::string query,
+                                 std::optional<std::string> page_token,
+                                 stdx::stop_token stop_token);
+
+  Task<std::string> GetChangeCursor(stdx::stop_token stop_token);
+
+  Task<ChangePage> GetChanges(std::string cursor, stdx::stop_token stop_token);
+
   Generator<std::string> GetFileContent(File file, http::Range range,
                                         stdx::stop_token stop_token);
 
@@ -125,6 +147,9 @@ class OneDrive {
   static Item ToItem(const nlohmann::json&);
   static nlohmann::json ToJson(const Item&);
 
+  static void WriteItemData(const ItemData&, util::ItemDataWriter&);
+  static void ReadItemData(util::ItemDataReader&, ItemData&);
+
  private:
   std::string GetEndpoint(std::string_view path) const;
 
@@ -307,6 +307,14 @@ nlohmann::json YandexDisk::ToJson(const Item& item) {
       item);
 }
 
+void YandexDisk::WriteItemData(const File& item, util::ItemDataWriter& writer) {
+  writer.WriteOptionalString(item.thumbnail_url);
+}
+
+void YandexDisk::ReadItemData(util::ItemDataReader& reader, File& item) {
+  item.thumbnail_url = reader.ReadOptionalString();
+}
+
 namespace util {
 
 template <>
@@ -7,6 +7,7 @@
 #include "coro/cloudstorage/util/assets.h"
 #include "coro/cloudstorage/util/auth_data.h"
 #include "coro/cloudstorage/util/fetch_json.h"
+#include "coro/cloudstorage/util/item_data_codec.h"
 #include "coro/http/http.h"
 #include "coro/util/event_loop.h"
 #include "coro/when_all.h"
@@ -121,6 +122,9 @@ class YandexDisk {
   static Item ToItem(const nlohmann::json&);
   static nlohmann::json ToJson(const Item&);
 
+  static void WriteItemData(const File&, util::ItemDataWriter&);
+  static void ReadItemData(util::ItemDataReader&, File&);
+
  private:
   template <typename ItemT>
   Task<ItemT> MoveItem(std::string_view from, std::string_view path,
@@ -1,15 +1,22 @@
 #include "coro/cloudstorage/providers/youtube.h"
 
 #include <algorithm>
+#include <charconv>
+#include <deque>
+#include <functional>
+#include <list>
 #include <sstream>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "coro/cloudstorage/util/abstract_cloud_provider_impl.h"
+#include "coro/cloudstorage/util/clock.h"
 #include "coro/cloudstorage/util/evaluate_javascript.h"
 #include "coro/cloudstorage/util/string_utils.h"
+#include "coro/util/raii_utils.h"
 #include "coro/util/regex.h"
+#include "coro/util/stop_token_or.h"
 #include "coro/when_all.h"
 
 namespace coro::cloudstorage {
@@ -23,6 +30,8 @@ using ::coro::cloudstorage::util::MediaContainer;
 using ::coro::cloudstorage::util::StrCat;
 using ::coro::cloudstorage::util::ThumbnailQuality;
 using ::coro::cloudstorage::util::ToStringView;
+using ::coro::util::AtScopeExit;
+using ::coro::util::MakeUniqueStopTokenOr;
 using ::nlohmann::json;
 
 using JsFunction = coro::cloudstorage::util::js::Function;
@@ -33,14 +42,21 @@ constexpr std::string_view kEndpoint = "https://www.googleapis.com/youtube/v3";
 constexpr std::string_view kChannelPlayListsPageToken = "CHANNEL_PLAYLISTS";
 constexpr std::string_view kUserPlayListsPageToken = "USER_PLAYLISTS";
 constexpr int kMaxRedirectCount = 8;
+constexpr size_t kMaxCachedPlayerCount = 4;
+// Player scripts are replaced every few days; persisted ones are dropped a
+// week after they were parsed.
+constexpr int64_t kPlayerTimeToLive = 7 * 24 * 60 * 60;
+// Persisted stream data is refetched this long before its urls expire.
+constexpr int64_t kStreamDataExpiryMargin = 10 * 60;
+constexpr int64_t kDefaultStreamDataTimeToLive = 60 * 60;
 
 std::string GetEndpoint(std::string_view path) {
   return StrCat(kEndpoint, path);
 }
 
 std::string EscapeRegex(std::string_view input) {
-  re::regex special_characters{R"([-[\]{}()*+?.,\^$|#\s])"};
-  return re::regex_replace(std::string(input), special_characters, R"(\\$&)");
+  static const re::regex kSpecialCharacters{R"([-[\]{}()*+?.,\^$|#\s])"};
+  return re::regex_replace(std::string(input), kSpecialCharacters, R"(\\$&)");
 }
 
 std::string XmlAttributes(
@@ -58,10 +74,11 @@ std::string XmlAttributes(
   return stream.str();
 }
 
-std::optional<std::string> Find(std::string_view text,
-                                const std::initializer_list<re::regex>& re) {
+std::optional<std::string> Find(
+    std::string_view text,
+    std::initializer_list<std::reference_wrapper<const re::regex>> re) {
   re::match_results<std::string_view::iterator> match;
-  for (const auto& regex : re) {
+  for (const re::regex& regex : re) {
     if (re::regex_search(text.begin(), text.end(), match, regex)) {
       return match[static_cast<int>(match.size() - 1)].str();
     }
@@ -316,83 +333,108 @@ std::string GenerateDashManifest(const util::ItemUrlProvider& item_url_provider,
 }
 
 std::string GetPlayerUrl(std::string_view page_data) {
+  static const re::regex kPlayerUrlRegex(R"re("jsUrl":"([^"]*)")re");
   re::match_results<std::string_view::iterator> match;
   if (re::regex_search(page_data.begin(), page_data.end(), match,
-                       re::regex(R"re("jsUrl":"([^"]*)")re"))) {
+                       kPlayerUrlRegex)) {
     return StrCat("https://www.youtube.com/", match[1].str());
   } else {
     throw CloudException("jsUrl not found");
   }
 }
 
-std::function<std::string(std::string_view)> GetDescrambler(
-    std::string_view page_data) {
+struct CipherTransform {
+  TransformType type;
+  int argument;
+};
+
+// Everything needed to descramble stream urls, extracted from a player
+// script. Players are shared by all videos, so this is parsed once per player
+// url.
+struct Player {
+  std::optional<std::vector<CipherTransform>> cipher;
+  std::optional<JsFunction> nsig;
+};
+
+std::vector<CipherTransform> GetCipherTransforms(std::string_view page_data) {
+  static const re::regex kDescramblerRegex(
+      R"re(([a-zA-Z0-9$]+)\s*=\s*function\(\s*a\s*\)\s*\{\s*a\s*=\s*a\.split\(\s*""\s*\))re");
+  static const re::regex kShortDescramblerRegex(
+      R"re((?:\b|[^a-zA-Z0-9$])([a-zA-Z0-9$]{2})\s*=\s*function\(\s*a\s*\)\s*\{\s*a\s*=\s*a\.split\(\s*""\s*\))re");
+  static const re::regex kHelperRegex(R"(;([^\.]*)\.)");
+  static const re::regex kReverseRegex(R"(([^:]{2}):[^:]*reverse)");
+  static const re::regex kSpliceRegex(R"(([^:]{2}):[^:]*splice)");
+  static const re::regex kSwapRegex(R"(([^:]{2}):[^:]*\[0\])");
+
   auto descrambler =
-      Find(
-          page_data,
-          {re::regex(
-               R"re(([a-zA-Z0-9$]+)\s*=\s*function\(\s*a\s*\)\s*\{\s*a\s*=\s*a\.split\(\s*""\s*\))re"),
-           re::regex(
-               R"re((?:\b|[^a-zA-Z0-9$])([a-zA-Z0-9$]{2})\s*=\s*function\(\s*a\s*\)\s*\{\s*a\s*=\s*a\.split\(\s*""\s*\))re")})
-          .value();
+      Find(page_data, {kDescramblerRegex, kShortDescramblerRegex}).value();
   auto rules =
       Find(page_data, {re::regex(StrCat(EscapeRegex(descrambler),
                                         R"(=function[^{]*\{([^}]*)\};)"))})
           .value();
-  auto helper = Find(rules, {re::regex(R"(;([^\.]*)\.)")}).value();
+  auto helper = Find(rules, {kHelperRegex}).value();
   auto transforms =
       Find(page_data,
            {re::regex(StrCat(EscapeRegex(helper), R"(=\{([\s\S]*?)\};)"))})
           .value();
   std::unordered_map<std::string, TransformType> transform_type;
-  transform_type[Find(transforms, {re::regex(R"(([^:]{2}):[^:]*reverse)")})
-                     .value()] = TransformType::kReverse;
-  transform_type[Find(transforms, {re::regex(R"(([^:]{2}):[^:]*splice)")})
-                     .value()] = TransformType::kSplice;
-  transform_type[Find(transforms, {re::regex(R"(([^:]{2}):[^:]*\[0\])")})
-                     .value()] = TransformType::kSwap;
-
-  return [rules, helper, transform_type](std::string_view sig) {
+  transform_type[Find(transforms, {kReverseRegex}).value()] =
+      TransformType::kReverse;
+  transform_type[Find(transforms, {kSpliceRegex}).value()] =
+      TransformType::kSplice;
+  transform_type[Find(transforms, {kSwapRegex}).value()] =
+      TransformType::kSwap;
+
+  re::regex transform_regex(
+      StrCat(EscapeRegex(helper), R"re(\.([^\(]*)\([^,]*,([^\)]*)\))re"));
+  std::vector<CipherTransform> result;
+  size_t it = 0;
+  while (it < rules.size()) {
+    auto next = rules.find(';', it);
+    if (next == std::string_view::npos) {
+      break;
+    }
+    std::string_view transform(rules.data() + it, next - it);
+    re::match_results<std::string_view::iterator> match;
+    if (re::regex_match(transform.begin(), transform.end(), match,
+                        transform_regex)) {
+      result.push_back(
+          CipherTransform{.type = transform_type.at(match[1].str()),
+                          .argument = std::stoi(match[2].str())});
+    }
+    it = next + 1;
+  }
+  return result;
+}
+
+std::function<std::string(std::string_view)> GetDescrambler(
+    std::vector<CipherTransform> transforms) {
+  return [transforms = std::move(transforms)](std::string_view sig) {
     auto data = http::ParseQuery(sig);
     std::string signature = data["s"];
-    size_t it = 0;
-    while (it < rules.size()) {
-      auto next = rules.find(';', it);
-      if (next == std::string_view::npos) {
-        break;
-      }
-      std::string_view transform(rules.data() + it, next - it);
-      re::match_results<std::string_view::iterator> match;
-      if (re::regex_match(
-              transform.begin(), transform.end(), match,
-              re::regex(StrCat(EscapeRegex(helper),
-                               R"re(\.([^\(]*)\([^,]*,([^\)]*)\))re")))) {
-        std::string func = match[1].str();
-        int arg = std::stoi(match[2].str());
-        switch (transform_type.at(func)) {
-          case TransformType::kReverse:
-            std::reverse(signature.begin(), signature.end());
-            break;
-          case TransformType::kSplice:
-            signature.erase(0, arg);
-            break;
-          case TransformType::kSwap:
-            std::swap(signature[0], signature[arg % signature.length()]);
-            break;
-        }
+    for (const auto& [type, arg] : transforms) {
+      switch (type) {
+        case TransformType::kReverse:
+          std::reverse(signature.begin(), signature.end());
+          break;
+        case TransformType::kSplice:
+          signature.erase(0, arg);
+          break;
+        case TransformType::kSwap:
+          std::swap(signature[0], signature[arg % signature.length()]);
+          break;
       }
-      it = next + 1;
     }
     return StrCat(data["url"], "&", data["sp"], "=", signature);
   };
 }
 
-std::optional<std::function<std::string(std::string_view cipher)>>
-GetNewDescrambler(std::string_view page_data) {
-  re::regex regex(
+std::optional<JsFunction> GetNsigFunction(std::string_view page_data) {
+  static const re::regex kNsigRegex(
       R"(\.get\("n"\)\)&&\(b=([a-zA-Z0-9$]{3})(?:\[(\d+)\])?\([a-zA-Z0-9]\))");
   re::match_results<std::string_view::iterator> match;
-  if (!re::regex_search(page_data.begin(), page_data.end(), match, regex)) {
+  if (!re::regex_search(page_data.begin(), page_data.end(), match,
+                        kNsigRegex)) {
     return std::nullopt;
   }
   std::optional<std::string> nsig_function_name =
@@ -418,13 +460,52 @@ GetNewDescrambler(std::string_view page_data) {
   if (!nsig_function_name) {
     return std::nullopt;
   }
-  return [nsig_function = GetFunction(page_data, *nsig_function_name)](
-             std::string_view nsig) {
+  return GetFunction(page_data, *nsig_function_name);
+}
+
+std::function<std::string(std::string_view)> GetNewDescrambler(
+    JsFunction nsig_function) {
+  return [nsig_function = std::move(nsig_function)](std::string_view nsig) {
     return util::js::EvaluateJavascript(nsig_function,
                                         std::vector{std::string(nsig)});
   };
 }
 
+nlohmann::json ToJson(const Player& player) {
+  nlohmann::json json;
+  if (player.cipher) {
+    json["cipher"] = nlohmann::json::array();
+    for (const auto& [type, argument] : *player.cipher) {
+      json["cipher"].push_back({static_cast<int>(type), argument});
+    }
+  }
+  if (player.nsig) {
+    json["nsig"] = {{"name", player.nsig->name},
+                    {"args", player.nsig->args},
+                    {"source", player.nsig->source}};
+  }
+  return json;
+}
+
+Player ToPlayer(const nlohmann::json& json) {
+  Player player;
+  if (auto it = json.find("cipher"); it != json.end()) {
+    player.cipher.emplace();
+    for (const auto& transform : *it) {
+      player.cipher->push_back(CipherTransform{
+          .type = static_cast<TransformType>(int(transform.at(0))),
+          .argument = transform.at(1)});
+    }
+  }
+  if (auto it = json.find("nsig"); it != json.end()) {
+    player.nsig = JsFunction{
+        .name = it->at("name"),
+        .args = it->at("args").get<std::vector<std::string>>(),
+        .source = it->at("source")};
+  }
+  return player;
+}
+
 template <typename T>
 T ToItem(const nlohmann::json& json) {
   T item;
@@ -484,8 +565,152 @@ std::string GetVideoUrl(const YouTube::StreamData& data, int64_t itag) {
   return *url;
 }
 
+// Looks the player up in memory, then in the cache database, and only
+// downloads and parses the player script if it was never seen before or if
+// the cipher is needed but wasn't extracted yet. `players` holds the most
+// recently used players, most recent first.
+Task<Player> GetPlayer(const http::Http& http,
+                       util::CacheManager* cache_manager,
+                       std::list<std::pair<std::string, Player>>& players,
+                       std::string player_url, bool needs_cipher,
+                       stdx::stop_token stop_token) {
+  auto is_player = [&](const std::pair<std::string, Player>& entry) {
+    return entry.first == player_url;
+  };
+  std::optional<Player> player;
+  if (auto it = std::find_if(players.begin(), players.end(), is_player);
+      it != players.end()) {
+    player = it->second;
+  } else if (auto data = co_await cache_manager->Get(
+                 util::CacheManager::ProviderDataKey{
+                     .provider_type = std::string(YouTube::kId),
+                     .key = player_url},
+                 stop_token)) {
+    player = ToPlayer(json::from_cbor(data->value));
+  }
+  if (!player || (needs_cipher && !player->cipher)) {
+    auto response = co_await http.Fetch(player_url, stop_token);
+    auto player_content = co_await http::GetBody(std::move(response.body));
+    if (!player) {
+      player = Player{.nsig = GetNsigFunction(player_content)};
+    }
+    if (needs_cipher) {
+      player->cipher = GetCipherTransforms(player_content);
+    }
+    std::vector<char> value;
+    json::to_cbor(ToJson(*player), value);
+    int64_t now = util::Clock().Now();
+    co_await cache_manager->Put(
+        util::CacheManager::ProviderDataKey{
+            .provider_type = std::string(YouTube::kId), .key = player_url},
+        util::CacheManager::ProviderData{
+            .value = std::move(value),
+            .update_time = now,
+            .expire_time = now + kPlayerTimeToLive},
+        stop_token);
+  }
+  std::erase_if(players, is_player);
+  players.emplace_front(std::move(player_url), *player);
+  if (players.size() > kMaxCachedPlayerCount) {
+    players.pop_back();
+  }
+  co_return std::move(*player);
+}
+
+util::CacheManager::ProviderDataKey GetStreamDataKey(
+    std::string_view video_id) {
+  return util::CacheManager::ProviderDataKey{
+      .provider_type = std::string(YouTube::kId),
+      .key = StrCat("stream/", video_id)};
+}
+
+// Signed stream urls carry their expiry time in the `expire` parameter.
+std::optional<int64_t> GetExpireTime(const json& format) {
+  std::string url;
+  if (auto it = format.find("url"); it != format.end()) {
+    url = *it;
+  } else if (auto it = format.find("signatureCipher"); it != format.end()) {
+    auto params = http::ParseQuery(std::string(*it));
+    if (auto url_it = params.find("url"); url_it != params.end()) {
+      url = std::move(url_it->second);
+    }
+  }
+  if (url.empty()) {
+    return std::nullopt;
+  }
+  auto uri = http::ParseUri(url);
+  if (!uri.query) {
+    return std::nullopt;
+  }
+  auto params = http::ParseQuery(*uri.query);
+  if (auto it = params.find("expire"); it != params.end()) {
+    // A malformed value falls back to the default time to live.
+    const std::string& value = it->second;
+    int64_t expire_time;
+    auto [end, error] =
+        std::from_chars(value.data(), value.data() + value.size(), expire_time);
+    if (error == std::errc() && end == value.data() + value.size()) {
+      return expire_time;
+    }
+  }
+  return std::nullopt;
+}
+
+// The player response often lacks the size of progressive formats. It is
+// probed with a HEAD request the first time such a format is needed.
+Task<> ProbeContentLength(const http::Http& http,
+                          const YouTube::StreamData& stream_data,
+                          json& format, stdx::stop_token stop_token) {
+  if (format.contains("contentLength")) {
+    co_return;
+  }
+  int64_t itag = format["itag"];
+  auto& probed_content_length = *stream_data.probed_content_length;
+  if (auto it = probed_content_length.find(itag);
+      it != probed_content_length.end()) {
+    format["contentLength"] = std::to_string(it->second);
+    co_return;
+  }
+  auto request = http::Request<>{.url = GetVideoUrl(stream_data, itag),
+                                 .method = http::Method::kHead};
+  auto response = co_await http.Fetch(std::move(request), stop_token);
+  int max_redirect_count = kMaxRedirectCount;
+  while (response.status == 302 && max_redirect_count-- > 0) {
+    auto redirect_request = YouTube::Request{
+        .url = coro::http::GetHeader(response.headers, "Location").value(),
+        .method = http::Method::kHead};
+    response = co_await http.Fetch(std::move(redirect_request), stop_token);
+  }
+  if (response.status / 100 != 2) {
+    throw http::HttpException(response.status);
+  }
+  if (auto content_length =
+          http::GetHeader(response.headers, "Content-Length")) {
+    probed_content_length.insert_or_assign(itag,
+                                           std::stoll(*content_length));
+    format["contentLength"] = std::move(*content_length);
+  }
+}
+
 }  // namespace
 
+struct YouTube::PlayerCache {
+  std::list<std::pair<std::string, Player>> players;
+};
+
+YouTube::YouTube(AuthManager auth_manager, const http::Http* http,
+                 const util::Muxer* muxer, util::CacheManager* cache_manager,
+                 util::ItemUrlProvider item_url_provider, Config config)
+    : auth_manager_(std::move(auth_manager)),
+      http_(http),
+      muxer_(muxer),
+      cache_manager_(cache_manager),
+      item_url_provider_(std::move(item_url_provider)),
+      prefetch_chunk_count_(config.prefetch_chunk_count),
+      stream_cache_(config.stream_cache_size,
+                    GetStreamData{*http, cache_manager,
+                                  std::make_shared<PlayerCache>()}) {}
+
 std::string YouTube::Auth::GetAuthorizationUrl(const AuthData& data) {
   return "https://accounts.google.com/o/oauth2/auth?" +
          http::FormDataToString({{"response_type", "code"},
@@ -561,9 +786,10 @@ auto YouTube::GetItem(ItemId id, stdx::stop_token stop_token) -> Task<Item> {
     }
     case ItemId::Type::kStream: {
       StreamData data = co_await stream_cache_.Get(id.id, stop_token);
-      for (const auto& formats : {data.adaptive_formats, data.formats}) {
-        for (const auto& d : formats) {
+      for (auto* formats : {&data.adaptive_formats, &data.formats}) {
+        for (auto& d : *formats) {
           if (d["itag"] == id.itag) {
+            co_await ProbeContentLength(*http_, data, d, stop_token);
             co_return ToStream(id.id, data.title, d);
           }
         }
@@ -623,8 +849,15 @@ auto YouTube::ListDirectoryPage(StreamDirectory directory,
                                 stdx::stop_token stop_token) -> Task<PageData> {
   PageData result;
   StreamData data = co_await stream_cache_.Get(directory.id.id, stop_token);
-  for (const auto& formats : {data.adaptive_formats, data.formats}) {
-    for (const auto& d : formats) {
+  std::vector<Task<>> tasks;
+  for (auto* formats : {&data.adaptive_formats, &data.formats}) {
+    for (auto& d : *formats) {
+      tasks.emplace_back(ProbeContentLength(*http_, data, d, stop_token));
+    }
+  }
+  co_await WhenAll(std::move(tasks));
+  for (const auto* formats : {&data.adaptive_formats, &data.formats}) {
+    for (const auto& d : *formats) {
       if (!d.contains("contentLength")) {
         continue;
       }
@@ -783,12 +1016,53 @@ Generator<std::string> YouTube::GetFileContent(Stream file, http::Range range,
     range.end = file.size - 1;
   }
   const auto kChunkSize = 10'000'000;
-  for (int64_t i = range.start; i <= *range.end; i += kChunkSize) {
-    http::Range subrange{
-        .start = i, .end = std::min<int64_t>(i + kChunkSize - 1, *range.end)};
-    FOR_CO_AWAIT(std::string & chunk,
-                 GetFileContentImpl(file, subrange, stop_token)) {
-      co_yield std::move(chunk);
+  stdx::stop_source stop_source;
+  auto stop_token_or =
+      MakeUniqueStopTokenOr(std::move(stop_token), stop_source.get_token());
+  auto guard = AtScopeExit([&] { stop_source.request_stop(); });
+  int64_t next = range.start;
+  auto get_subrange = [&](int64_t start) {
+    return http::Range{
+        .start = start,
+        .end = std::min<int64_t>(start + kChunkSize - 1, *range.end)};
+  };
+  // The chunk being read is streamed directly, while up to
+  // `prefetch_chunk_count_` chunks after it are fetched concurrently.
+  std::deque<std::shared_ptr<SharedPromise<FetchChunk>>> prefetched;
+  auto prefetch = [&] {
+    while (static_cast<int>(prefetched.size()) < prefetch_chunk_count_ &&
+           next <= *range.end) {
+      auto chunk = std::make_shared<SharedPromise<FetchChunk>>(
+          FetchChunk{.youtube = this,
+                     .file = file,
+                     .range = get_subrange(next),
+                     .stop_token = stop_token_or->GetToken()});
+      RunTask([chunk, stop_token = stop_token_or->GetToken()]() -> Task<> {
+        try {
+          co_await chunk->Get(stop_token);
+        } catch (...) {
+        }
+      });
+      prefetched.push_back(std::move(chunk));
+      next += kChunkSize;
+    }
+  };
+  while (next <= *range.end || !prefetched.empty()) {
+    if (prefetched.empty()) {
+      http::Range subrange = get_subrange(next);
+      next += kChunkSize;
+      prefetch();
+      FOR_CO_AWAIT(std::string & chunk,
+                   GetFileContentImpl(file, subrange,
+                                      stop_token_or->GetToken())) {
+        co_yield std::move(chunk);
+      }
+    } else {
+      auto chunk = std::move(prefetched.front());
+      prefetched.pop_front();
+      prefetch();
+      std::string data = co_await chunk->Get(stop_token_or->GetToken());
+      co_yield std::move(data);
     }
   }
 }
@@ -859,12 +1133,14 @@ Generator<std::string> YouTube::GetMuxedFileContent(
   StreamData data = co_await stream_cache_.Get(file.id.id, stop_token);
   Stream video_stream{};
   auto best_video = data.GetBestVideo(StrCat("video/", type));
+  co_await ProbeContentLength(*http_, data, best_video, stop_token);
   video_stream.id.id = file.id.id;
   video_stream.id.itag = best_video["itag"];
   video_stream.size = std::stoll(std::string(best_video["contentLength"]));
   Stream audio_stream{};
   audio_stream.id.id = std::move(file.id.id);
   auto best_audio = data.GetBestAudio(StrCat("audio/", type));
+  co_await ProbeContentLength(*http_, data, best_audio, stop_token);
   audio_stream.id.itag = best_audio["itag"];
   audio_stream.size = std::stoll(std::string(best_audio["contentLength"]));
   auto impl = CreateAbstractCloudProviderImpl(this);
@@ -884,14 +1160,26 @@ Generator<std::string> YouTube::GetFileContentImpl(
     Stream file, http::Range range, stdx::stop_token stop_token) const {
   auto stream_data = co_await stream_cache_.Get(file.id.id, stop_token);
   std::string video_url = GetVideoUrl(stream_data, file.id.itag);
-  Request request{.url = std::move(video_url),
-                  .headers = {http::ToRangeHeader(range)}};
+  Request request{.url = video_url, .headers = {http::ToRangeHeader(range)}};
   auto response = co_await http_->Fetch(std::move(request), stop_token);
   if (response.status / 100 == 4) {
-    stream_cache_.Invalidate(file.id.id);
-    video_url = GetVideoUrl(co_await stream_cache_.Get(file.id.id, stop_token),
-                            file.id.itag);
-    Request retry_request{.url = std::move(video_url),
+    std::string current_url = GetVideoUrl(
+        co_await stream_cache_.Get(file.id.id, stop_token), file.id.itag);
+    if (current_url == video_url) {
+      auto it = stream_data_refresh_.find(file.id.id);
+      if (it == stream_data_refresh_.end()) {
+        it = stream_data_refresh_
+                 .emplace(file.id.id,
+                          std::make_shared<SharedPromise<RefreshStreamData>>(
+                              RefreshStreamData{.youtube = this,
+                                                .video_id = file.id.id}))
+                 .first;
+      }
+      auto refresh = it->second;
+      current_url =
+          GetVideoUrl(co_await refresh->Get(stop_token), file.id.itag);
+    }
+    Request retry_request{.url = std::move(current_url),
                           .headers = {http::ToRangeHeader(range)}};
     response = co_await http_->Fetch(std::move(retry_request), stop_token);
   }
@@ -942,64 +1230,93 @@ auto YouTube::GetItemThumbnailImpl(ItemT item, ThumbnailQuality quality,
   co_return result;
 }
 
+auto YouTube::FetchChunk::operator()() const -> Task<std::string> {
+  std::string result;
+  result.reserve(static_cast<size_t>(*range.end - range.start + 1));
+  FOR_CO_AWAIT(std::string & chunk,
+               youtube->GetFileContentImpl(file, range, stop_token)) {
+    result += chunk;
+  }
+  co_return result;
+}
+
+auto YouTube::RefreshStreamData::operator()() const -> Task<StreamData> {
+  auto guard = AtScopeExit([youtube = youtube, video_id = video_id] {
+    youtube->stream_data_refresh_.erase(video_id);
+  });
+  auto stop_token = youtube->stop_source_.get_token();
+  co_await youtube->cache_manager_->Remove(GetStreamDataKey(video_id),
+                                           stop_token);
+  youtube->stream_cache_.Invalidate(video_id);
+  co_return co_await youtube->stream_cache_.Get(video_id, stop_token);
+}
+
 auto YouTube::GetStreamData::operator()(std::string video_id,
                                         stdx::stop_token stop_token) const
     -> Task<StreamData> {
-  std::string page =
-      co_await GetVideoPage(http, std::move(video_id), stop_token);
-  json config = GetConfig(page);
-  if (!config.contains("videoDetails")) {
-    throw CloudException("GetStreamData error.");
+  auto key = GetStreamDataKey(video_id);
+  int64_t now = util::Clock().Now();
+  json entry;
+  if (auto data = co_await cache_manager->Get(key, stop_token);
+      data && data->expire_time &&
+      *data->expire_time > now + kStreamDataExpiryMargin) {
+    entry = json::from_cbor(data->value);
+  } else {
+    std::string page =
+        co_await GetVideoPage(http, std::move(video_id), stop_token);
+    json config = GetConfig(page);
+    if (!config.contains("videoDetails")) {
+      throw CloudException("GetStreamData error.");
+    }
+    entry["title"] = config["videoDetails"]["title"];
+    entry["adaptive_formats"] = config["streamingData"]["adaptiveFormats"];
+    entry["formats"] = config["streamingData"]["formats"];
+    entry["player_url"] = GetPlayerUrl(page);
+    std::optional<int64_t> expire_time;
+    for (const auto* formats :
+         {&entry["adaptive_formats"], &entry["formats"]}) {
+      for (const auto& d : *formats) {
+        if (auto format_expire_time = GetExpireTime(d)) {
+          expire_time = std::min(expire_time.value_or(*format_expire_time),
+                                 *format_expire_time);
+        }
+      }
+    }
+    std::vector<char> value;
+    json::to_cbor(entry, value);
+    co_await cache_manager->Put(
+        key,
+        util::CacheManager::ProviderData{
+            .value = std::move(value),
+            .update_time = now,
+            .expire_time =
+                expire_time.value_or(now + kDefaultStreamDataTimeToLive)},
+        stop_token);
   }
   StreamData result{
-      .title = config["videoDetails"]["title"],
-      .adaptive_formats = config["streamingData"]["adaptiveFormats"],
-      .formats = config["streamingData"]["formats"]};
-  auto response = co_await http.Fetch(GetPlayerUrl(page), stop_token);
-  auto player_content = co_await http::GetBody(std::move(response.body));
-  result.new_descrambler = GetNewDescrambler(player_content);
-  for (const auto& formats : {result.adaptive_formats, result.formats}) {
-    if (result.descrambler) {
-      break;
-    }
-    for (const auto& d : formats) {
+      .title = entry["title"],
+      .adaptive_formats = std::move(entry["adaptive_formats"]),
+      .formats = std::move(entry["formats"]),
+      .probed_content_length =
+          std::make_shared<std::unordered_map<int64_t, int64_t>>()};
+  bool needs_cipher = false;
+  for (const auto* formats : {&result.adaptive_formats, &result.formats}) {
+    for (const auto& d : *formats) {
       if (!d.contains("url")) {
-        result.descrambler = GetDescrambler(player_content);
+        needs_cipher = true;
         break;
       }
     }
   }
-  std::vector<Task<>> tasks;
-  for (auto& format : result.formats) {
-    if (format.contains("contentLength")) {
-      continue;
-    }
-    tasks.emplace_back([](const http::Http& http, const StreamData& stream_data,
-                          nlohmann::json& format,
-                          stdx::stop_token stop_token) -> Task<> {
-      auto request =
-          http::Request<>{.url = GetVideoUrl(stream_data, format["itag"]),
-                          .method = http::Method::kHead};
-      auto response = co_await http.Fetch(std::move(request), stop_token);
-      int max_redirect_count = kMaxRedirectCount;
-      while (response.status == 302 && max_redirect_count-- > 0) {
-        auto redirect_request = Request{
-            .url = coro::http::GetHeader(response.headers, "Location").value(),
-            .method = http::Method::kHead};
-        response = co_await http.Fetch(std::move(redirect_request), stop_token);
-      }
-      if (response.status / 100 != 2) {
-        throw http::HttpException(response.status);
-      }
-      if (auto content_length =
-              http::GetHeader(response.headers, "Content-Length")) {
-        format["contentLength"] = *content_length;
-      }
-    }(http, result, format, stop_token));
+  Player player = co_await GetPlayer(
+      http, cache_manager, player_cache->players,
+      std::string(entry["player_url"]), needs_cipher, stop_token);
+  if (player.nsig) {
+    result.new_descrambler = GetNewDescrambler(std::move(*player.nsig));
+  }
+  if (needs_cipher) {
+    result.descrambler = GetDescrambler(std::move(*player.cipher));
   }
-
-  co_await WhenAll(std::move(tasks));
-
   co_return result;
 }
 
@@ -1084,6 +1401,29 @@ nlohmann::json YouTube::ToJson(const Item& item) {
       item);
 }
 
+void YouTube::WriteItemData(const MuxedStreamWebm& item,
+                            util::ItemDataWriter& writer) {
+  writer.WriteOptionalString(item.thumbnail.default_quality_url);
+  writer.WriteOptionalString(item.thumbnail.high_quality_url);
+}
+
+void YouTube::WriteItemData(const DashManifest& item,
+                            util::ItemDataWriter& writer) {
+  writer.WriteOptionalString(item.thumbnail.default_quality_url);
+  writer.WriteOptionalString(item.thumbnail.high_quality_url);
+}
+
+void YouTube::ReadItemData(util::ItemDataReader& reader,
+                           MuxedStreamWebm& item) {
+  item.thumbnail.default_quality_url = reader.ReadOptionalString();
+  item.thumbnail.high_quality_url = reader.ReadOptionalString();
+}
+
+void YouTube::ReadItemData(util::ItemDataReader& reader, DashManifest& item) {
+  item.thumbnail.default_quality_url = reader.ReadOptionalString();
+  item.thumbnail.high_quality_url = reader.ReadOptionalString();
+}
+
 namespace util {
 
 template <>
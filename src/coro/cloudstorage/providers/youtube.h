@@ -4,16 +4,21 @@
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string>
+#include <unordered_map>
 
 #include "coro/cloudstorage/cloud_exception.h"
 #include "coro/cloudstorage/providers/google_drive.h"
 #include "coro/cloudstorage/util/assets.h"
 #include "coro/cloudstorage/util/avio_context.h"
+#include "coro/cloudstorage/util/cache_manager.h"
+#include "coro/cloudstorage/util/item_data_codec.h"
 #include "coro/cloudstorage/util/item_url_provider.h"
 #include "coro/cloudstorage/util/muxer.h"
 #include "coro/cloudstorage/util/string_utils.h"
 #include "coro/http/http.h"
 #include "coro/http/http_parse.h"
+#include "coro/shared_promise.h"
+#include "coro/stdx/stop_source.h"
 #include "coro/task.h"
 #include "coro/util/lru_cache.h"
 
@@ -91,6 +96,9 @@ class YouTube {
     json formats;
     std::optional<std::function<std::string(std::string_view)>> descrambler;
     std::optional<std::function<std::string(std::string_view)>> new_descrambler;
+    // Sizes of formats without contentLength, by itag. Filled in on first
+    // use and shared by all copies.
+    std::shared_ptr<std::unordered_map<int64_t, int64_t>> probed_content_length;
 
     json GetBestVideo(std::string_view mime_type) const;
     json GetBestAudio(std::string_view mime_type) const;
@@ -123,13 +131,21 @@ class YouTube {
   static constexpr std::string_view kId = "youtube";
   static inline constexpr auto& kIcon = util::kYouTubeIcon;
 
+  struct Config {
+    // Number of videos whose stream data is kept in memory. Stream data is
+    // also persisted in the cache database until its urls expire.
+    int stream_cache_size = 32;
+    // Number of 10 MB chunks of a stream fetched concurrently ahead of the
+    // one being read. Each of them is buffered in memory until it is read.
+    int prefetch_chunk_count = 2;
+  };
+
   YouTube(AuthManager auth_manager, const http::Http* http,
-          const util::Muxer* muxer, util::ItemUrlProvider item_url_provider)
-      : auth_manager_(std::move(auth_manager)),
-        http_(http),
-        muxer_(muxer),
-        item_url_provider_(std::move(item_url_provider)),
-        stream_cache_(32, GetStreamData{*http}) {}
+          const util::Muxer* muxer, util::CacheManager* cache_manager,
+          util::ItemUrlProvider item_url_provider, Config config);
+  YouTube(YouTube&&) noexcept = default;
+  YouTube& operator=(YouTube&&) noexcept = default;
+  ~YouTube() { stop_source_.request_stop(); }
 
   Task<RootDirectory> GetRoot(stdx::stop_token);
 
@@ -176,11 +192,37 @@ class YouTube {
   static Item ToItem(const nlohmann::json&);
   static nlohmann::json ToJson(const Item&);
 
+  static void WriteItemData(const MuxedStreamWebm&, util::ItemDataWriter&);
+  static void WriteItemData(const DashManifest&, util::ItemDataWriter&);
+  static void ReadItemData(util::ItemDataReader&, MuxedStreamWebm&);
+  static void ReadItemData(util::ItemDataReader&, DashManifest&);
+
  private:
+  struct PlayerCache;
+
   struct GetStreamData {
     Task<StreamData> operator()(std::string video_id,
                                 stdx::stop_token stop_token) const;
     const http::Http& http;
+    util::CacheManager* cache_manager;
+    std::shared_ptr<PlayerCache> player_cache;
+  };
+
+  struct FetchChunk {
+    Task<std::string> operator()() const;
+    const YouTube* youtube;
+    Stream file;
+    http::Range range;
+    stdx::stop_token stop_token;
+  };
+
+  // Refetches stream data whose urls went stale. Shared by all the chunks
+  // that were in flight with the stale urls, so it runs until the provider is
+  // destroyed rather than until the reader which started it goes away.
+  struct RefreshStreamData {
+    Task<StreamData> operator()() const;
+    const YouTube* youtube;
+    std::string video_id;
   };
 
   template <typename MuxedStream>
@@ -201,8 +243,14 @@ class YouTube {
   AuthManager auth_manager_;
   const http::Http* http_;
   const util::Muxer* muxer_;
+  util::CacheManager* cache_manager_;
   util::ItemUrlProvider item_url_provider_;
+  int prefetch_chunk_count_;
   mutable coro::util::LRUCache<std::string, GetStreamData> stream_cache_;
+  mutable std::unordered_map<std::string,
+                             std::shared_ptr<SharedPromise<RefreshStreamData>>>
+      stream_data_refresh_;
+  stdx::stop_source stop_source_;
 };
 
 namespace util {
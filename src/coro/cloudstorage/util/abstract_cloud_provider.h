@@ -5,11 +5,14 @@
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 #include "coro/cloudstorage/cloud_exception.h"
+#include "coro/cloudstorage/util/item_data_codec.h"
 #include "coro/cloudstorage/util/thumbnail_quality.h"
+#include "coro/exception.h"
 #include "coro/generator.h"
 #include "coro/http/http.h"
 #include "coro/stdx/stop_token.h"
@@ -89,6 +92,26 @@ class AbstractCloudProvider {
     std::optional<std::string> next_page_token;
   };
 
+  struct Change {
+    // Empty for a removed item if the cloud does not report its id, in which
+    // case it is matched by `name` within `parents`.
+    std::string id;
+    std::string name;
+    // Ids of the directories which contain the item, or which contained it if
+    // it was removed. Empty if the cloud does not report them.
+    std::vector<std::string> parents;
+    // Unset if the item was removed.
+    std::optional<Item> item;
+  };
+
+  struct ChangePage {
+    std::vector<Change> changes;
+    // Cursor to the changes made after this page.
+    std::string cursor;
+    // Whether more changes can be fetched right away.
+    bool has_more;
+  };
+
   struct GeneralData {
     std::string username;
     std::optional<int64_t> space_used;
@@ -118,12 +141,52 @@ class AbstractCloudProvider {
 
   virtual Item ToItem(const nlohmann::json&) const = 0;
 
+  // Encodes the provider specific data of `item`. Providers which can't tell
+  // it apart from the common fields store all of `ToJson` instead.
+  virtual std::string EncodeItemData(const Item& item) const {
+    std::string data(1, static_cast<char>(ItemDataFormat::kCbor));
+    nlohmann::json::to_cbor(ToJson(item), data);
+    return data;
+  }
+
+  // Restores the provider specific data of `item`, whose common fields are
+  // already set, from the output of `EncodeItemData`.
+  virtual void DecodeItemData(std::string_view data, Item& item) const {
+    ItemDataReader reader(data);
+    if (reader.ReadFormat() != ItemDataFormat::kCbor) {
+      throw RuntimeError("unsupported item data format");
+    }
+    std::string_view cbor = reader.remaining();
+    item = ToItem(nlohmann::json::from_cbor(cbor.begin(), cbor.end()));
+  }
+
   virtual bool IsFileContentSizeRequired(const Directory&) const = 0;
 
   virtual Task<PageData> ListDirectoryPage(
       Directory directory, std::optional<std::string> page_token,
       stdx::stop_token stop_token) const = 0;
 
+  // Whether the cloud can search items by name on its side.
+  virtual bool IsSearchSupported() const = 0;
+
+  // Returns a page of the items anywhere in the account whose name contains
+  // `query`. Throws if `IsSearchSupported()` is false.
+  virtual Task<PageData> SearchItemsPage(std::string query,
+                                         std::optional<std::string> page_token,
+                                         stdx::stop_token stop_token) const = 0;
+
+  // Whether the cloud reports the changes made to the items of the account.
+  virtual bool IsChangeFeedSupported() const = 0;
+
+  // Returns a cursor to the changes made from now on. Throws if
+  // `IsChangeFeedSupported()` is false.
+  virtual Task<std::string> GetChangeCursor(
+      stdx::stop_token stop_token) const = 0;
+
+  // Returns the changes made after `cursor` was issued.
+  virtual Task<ChangePage> GetChanges(std::string cursor,
+                                      stdx::stop_token stop_token) const = 0;
+
   virtual Task<GeneralData> GetGeneralData(stdx::stop_token) const = 0;
 
   virtual Generator<std::string> GetFileContent(
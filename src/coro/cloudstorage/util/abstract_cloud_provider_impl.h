@@ -2,8 +2,12 @@
 #define CORO_CLOUDSTORAGE_ABSTRACT_CLOUD_PROVIDER_IMPL_H
 
 #include <sstream>
+#include <string_view>
+#include <type_traits>
+#include <variant>
 
 #include "coro/cloudstorage/util/abstract_cloud_provider.h"
+#include "coro/cloudstorage/util/item_data_codec.h"
 #include "coro/cloudstorage/util/string_utils.h"
 
 namespace coro::cloudstorage::util {
@@ -25,6 +29,26 @@ concept IsDirectory = requires(CloudProvider& provider, T v,
   } -> Awaitable<typename CloudProvider::PageData>;
 };
 
+template <typename CloudProvider>
+concept CanSearch =
+    requires(CloudProvider& provider, std::string query,
+             std::optional<std::string> page_token,
+             stdx::stop_token stop_token) {
+      {
+        provider.SearchItemsPage(query, page_token, stop_token)
+      } -> Awaitable<typename CloudProvider::PageData>;
+    };
+
+template <typename CloudProvider>
+concept HasChangeFeed =
+    requires(CloudProvider& provider, std::string cursor,
+             stdx::stop_token stop_token) {
+      { provider.GetChangeCursor(stop_token) } -> Awaitable<std::string>;
+      {
+        provider.GetChanges(cursor, stop_token)
+      } -> Awaitable<typename CloudProvider::ChangePage>;
+    };
+
 template <typename Parent, typename CloudProvider>
 concept CanCreateFile = requires(
     CloudProvider& provider, Parent parent, std::string_view name,
@@ -136,6 +160,33 @@ concept HasTimestamp = requires(T v) {
   { v.timestamp } -> stdx::convertible_to<std::optional<int64_t>>;
 };
 
+// Whether the field is a data member rather than a constant of the type.
+template <typename T>
+concept HasMutableSize = HasSize<T> && !std::is_const_v<decltype(T::size)>;
+
+template <typename T>
+concept HasMutableTimestamp =
+    HasTimestamp<T> && !std::is_const_v<decltype(T::timestamp)>;
+
+template <typename T>
+concept HasMutableMimeType =
+    HasMimeType<T> && !std::is_const_v<decltype(T::mime_type)>;
+
+template <typename T>
+concept HasOptionalMimeType =
+    HasMutableMimeType<T> &&
+    std::is_same_v<decltype(T::mime_type), std::optional<std::string>>;
+
+// Provider specific fields of an item which aren't derived from the fields
+// common to all providers. Written into the data that the cache keeps next to
+// the common fields.
+template <typename T, typename CloudProvider>
+concept HasItemData = requires(const T& d, T& mutable_d, ItemDataWriter& writer,
+                               ItemDataReader& reader) {
+  CloudProvider::WriteItemData(d, writer);
+  CloudProvider::ReadItemData(reader, mutable_d);
+};
+
 template <typename T>
 concept HasUsageData = requires(T v) {
   { v.space_used } -> stdx::convertible_to<std::optional<int64_t>>;
@@ -213,6 +264,31 @@ class AbstractCloudProviderImpl : public AbstractCloudProvider,
         CloudProviderT::ToItem(json));
   }
 
+  std::string EncodeItemData(
+      const AbstractCloudProvider::Item& item) const override {
+    const auto& impl = std::visit(
+        [](const auto& d) -> const ItemT& {
+          return std::any_cast<const ItemT&>(d.impl);
+        },
+        item);
+    ItemDataWriter writer(ItemDataFormat::kCompact);
+    writer.WriteUint64(impl.index());
+    std::visit([&](const auto& d) { WriteItemData(d, writer); }, impl);
+    return std::move(writer).data();
+  }
+
+  void DecodeItemData(std::string_view data,
+                      AbstractCloudProvider::Item& item) const override {
+    ItemDataReader reader(data);
+    if (reader.ReadFormat() != ItemDataFormat::kCompact) {
+      AbstractCloudProvider::DecodeItemData(data, item);
+      return;
+    }
+    uint64_t index = reader.ReadUint64();
+    std::visit([&](auto& d) { d.impl = ReadItemData(index, d, reader); },
+               item);
+  }
+
   bool IsFileContentSizeRequired(const Directory& d) const override {
     return std::visit(IsFileContentSizeRequiredF{provider()},
                       std::any_cast<const ItemT&>(d.impl));
@@ -224,20 +300,8 @@ class AbstractCloudProviderImpl : public AbstractCloudProvider,
     co_return co_await std::visit(
         [&]<typename DirectoryT>(DirectoryT directory) -> Task<PageData> {
           if constexpr (IsDirectory<DirectoryT, CloudProviderT>) {
-            auto page = co_await provider()->ListDirectoryPage(
-                directory, std::move(page_token), std::move(stop_token));
-
-            PageData result;
-            result.next_page_token = std::move(page.next_page_token);
-            for (auto& p : page.items) {
-              result.items.emplace_back(std::visit(
-                  [&]<typename ItemT>(ItemT& entry) -> Item {
-                    return Convert(std::move(entry));
-                  },
-                  p));
-            }
-
-            co_return result;
+            co_return ConvertPage(co_await provider()->ListDirectoryPage(
+                directory, std::move(page_token), std::move(stop_token)));
           } else {
             throw CloudException("not a directory");
           }
@@ -245,6 +309,59 @@ class AbstractCloudProviderImpl : public AbstractCloudProvider,
         std::any_cast<ItemT&&>(std::move(directory.impl)));
   }
 
+  bool IsSearchSupported() const override {
+    return CanSearch<CloudProviderT>;
+  }
+
+  Task<PageData> SearchItemsPage(std::string query,
+                                 std::optional<std::string> page_token,
+                                 stdx::stop_token stop_token) const override {
+    if constexpr (CanSearch<CloudProviderT>) {
+      co_return ConvertPage(co_await provider()->SearchItemsPage(
+          std::move(query), std::move(page_token), std::move(stop_token)));
+    } else {
+      throw CloudException("search not supported");
+    }
+  }
+
+  bool IsChangeFeedSupported() const override {
+    return HasChangeFeed<CloudProviderT>;
+  }
+
+  Task<std::string> GetChangeCursor(
+      stdx::stop_token stop_token) const override {
+    if constexpr (HasChangeFeed<CloudProviderT>) {
+      co_return co_await provider()->GetChangeCursor(std::move(stop_token));
+    } else {
+      throw CloudException("change feed not supported");
+    }
+  }
+
+  Task<ChangePage> GetChanges(std::string cursor,
+                              stdx::stop_token stop_token) const override {
+    if constexpr (HasChangeFeed<CloudProviderT>) {
+      auto page = co_await provider()->GetChanges(std::move(cursor),
+                                                  std::move(stop_token));
+      ChangePage result{.cursor = std::move(page.cursor),
+                        .has_more = page.has_more};
+      for (auto& change : page.changes) {
+        result.changes.emplace_back(Change{
+            .id = std::move(change.id),
+            .name = std::move(change.name),
+            .parents = std::move(change.parents),
+            .item = change.item ? std::make_optional(std::visit(
+                                      [](auto& entry) -> Item {
+                                        return Convert(std::move(entry));
+                                      },
+                                      *change.item))
+                                : std::nullopt});
+      }
+      co_return result;
+    } else {
+      throw CloudException("change feed not supported");
+    }
+  }
+
   Task<GeneralData> GetGeneralData(stdx::stop_token stop_token) const override {
     auto data = co_await provider()->GetGeneralData(std::move(stop_token));
     GeneralData result;
@@ -386,6 +503,78 @@ class AbstractCloudProviderImpl : public AbstractCloudProvider,
     }
   }
 
+  template <typename PageDataT>
+  static PageData ConvertPage(PageDataT page) {
+    PageData result;
+    result.next_page_token = std::move(page.next_page_token);
+    for (auto& p : page.items) {
+      result.items.emplace_back(std::visit(
+          [&]<typename ItemT>(ItemT& entry) -> Item {
+            return Convert(std::move(entry));
+          },
+          p));
+    }
+    return result;
+  }
+
+  // Of the common fields only whether an optional mime type was set has to be
+  // stored, the rest is restored from the abstract item.
+  template <typename T>
+  static void WriteItemData(const T& d, ItemDataWriter& writer) {
+    if constexpr (HasOptionalMimeType<T>) {
+      writer.WriteBool(d.mime_type.has_value());
+    }
+    if constexpr (HasItemData<T, CloudProviderT>) {
+      CloudProviderT::WriteItemData(d, writer);
+    }
+  }
+
+  template <size_t Index = 0, typename From>
+  static ItemT ReadItemData(uint64_t index, const From& common,
+                            ItemDataReader& reader) {
+    if constexpr (Index == std::variant_size_v<ItemT>) {
+      throw RuntimeError("invalid item type");
+    } else if (index != Index) {
+      return ReadItemData<Index + 1>(index, common, reader);
+    } else {
+      using T = std::variant_alternative_t<Index, ItemT>;
+      T d{};
+      d.id = FromString<ItemIdTypeT<CloudProviderT>>(common.id);
+      if constexpr (!std::is_const_v<decltype(T::name)>) {
+        d.name = common.name;
+      }
+      if constexpr (HasMutableSize<T>) {
+        SetField(d.size, common.size);
+      }
+      if constexpr (HasMutableTimestamp<T>) {
+        SetField(d.timestamp, common.timestamp);
+      }
+      if constexpr (HasOptionalMimeType<T>) {
+        if (reader.ReadBool()) {
+          if constexpr (std::is_same_v<From, File>) {
+            d.mime_type = common.mime_type;
+          }
+        }
+      } else if constexpr (HasMutableMimeType<T> &&
+                           std::is_same_v<From, File>) {
+        d.mime_type = common.mime_type;
+      }
+      if constexpr (HasItemData<T, CloudProviderT>) {
+        CloudProviderT::ReadItemData(reader, d);
+      }
+      return ItemT(std::in_place_index<Index>, std::move(d));
+    }
+  }
+
+  template <typename Field>
+  static void SetField(Field& field, std::optional<int64_t> value) {
+    if constexpr (std::is_same_v<Field, std::optional<int64_t>>) {
+      field = value;
+    } else {
+      field = value.value_or(0);
+    }
+  }
+
   template <typename T>
   static std::optional<int64_t> GetSize(const T& d) {
     if constexpr (HasSize<T>) {
@@ -12,9 +12,11 @@
 #include "coro/cloudstorage/util/list_directory_handler.h"
 #include "coro/cloudstorage/util/mux_handler.h"
 #include "coro/cloudstorage/util/on_auth_token_updated.h"
+#include "coro/cloudstorage/util/search_handler.h"
 #include "coro/cloudstorage/util/settings_handler.h"
 #include "coro/cloudstorage/util/static_file_handler.h"
 #include "coro/cloudstorage/util/theme_handler.h"
+#include "coro/cloudstorage/util/transfer_handler.h"
 #include "coro/cloudstorage/util/webdav_handler.h"
 #include "coro/cloudstorage/util/webdav_utils.h"
 #include "coro/util/stop_token_or.h"
@@ -117,17 +119,32 @@ auto CreateCloudProvider(const AbstractCloudFactory* factory,
 }  // namespace
 
 AccountManagerHandler::AccountManagerHandler(
+    const coro::util::EventLoop* event_loop,
     const AbstractCloudFactory* factory,
     const ThumbnailGenerator* thumbnail_generator, const Muxer* muxer,
     const Clock* clock, AccountListener account_listener,
-    SettingsManager* settings_manager, CacheManager* cache_manager)
-    : factory_(factory),
+    SettingsManager* settings_manager, CacheManager* cache_manager,
+    ThumbnailPrefetcher* thumbnail_prefetcher,
+    TransferManager* transfer_manager, MetadataIndex* metadata_index,
+    MetadataIndexer* metadata_indexer, ChangeFeedPoller* change_feed_poller)
+    : event_loop_(event_loop),
+      factory_(factory),
       thumbnail_generator_(thumbnail_generator),
       muxer_(muxer),
       clock_(clock),
       account_listener_(std::move(account_listener)),
       settings_manager_(settings_manager),
-      cache_manager_(cache_manager) {
+      cache_manager_(cache_manager),
+      thumbnail_prefetcher_(thumbnail_prefetcher),
+      transfer_manager_(transfer_manager),
+      metadata_index_(metadata_index),
+      metadata_indexer_(metadata_indexer),
+      change_feed_poller_(change_feed_poller) {
+  for (AbstractCloudProvider::Type type :
+       factory_->GetSupportedCloudProviders()) {
+    auth_routes_.emplace_back(StrCat("/auth/", factory_->GetAuth(type).GetId()),
+                              type);
+  }
   for (auto auth_token : settings_manager_->LoadTokenData()) {
     CloudProviderAccount::Id provider_id{
         std::string(CreateCloudProvider(factory_, auth_token)->GetId()),
@@ -140,6 +157,7 @@ AccountManagerHandler::AccountManagerHandler(
             CreateItemUrlProvider(provider_id)),
         provider_id.username, version_++)));
   }
+  UpdateAccountIndex();
 }
 
 AccountManagerHandler::~AccountManagerHandler() { Quit(); }
@@ -151,6 +169,7 @@ void AccountManagerHandler::Quit() {
     account_listener_.OnDestroy(std::move(*it));
     accounts_.erase(it);
   }
+  account_index_.clear();
 }
 
 auto AccountManagerHandler::operator()(http::Request<> request,
@@ -196,21 +215,25 @@ auto AccountManagerHandler::HandleRequest(http::Request<> request,
   if (!path) {
     co_return http::Response<>{.status = 400};
   }
-  if (auto handler = ChooseHandler(*path)) {
+  if (auto handler = ChooseHandler(*path, request.method)) {
+    bool coalesce_body = handler->coalesce_body;
+    http::Response<> response;
     if (handler->account) {
       auto stop_token_or = MakeUniqueStopTokenOr(handler->account->stop_token(),
                                                  std::move(stop_token));
-      auto response = co_await handler->handler(std::move(request),
-                                                stop_token_or->GetToken());
+      response = co_await handler->handler(std::move(request),
+                                           stop_token_or->GetToken());
       response.body = Validate(std::move(response.body),
                                std::move(stop_token_or), std::move(handler));
-      co_return response;
     } else {
-      auto response =
+      response =
           co_await handler->handler(std::move(request), std::move(stop_token));
       response.body = Validate(std::move(response.body), std::move(handler));
-      co_return response;
     }
+    if (coalesce_body) {
+      response.body = Coalesce(event_loop_, std::move(response.body));
+    }
+    co_return response;
   } else if (*path == "/" || *path == "") {
     co_return http::Response<>{.status = 200, .body = GetHomePage()};
   }
@@ -266,13 +289,28 @@ auto AccountManagerHandler::GetWebDAVResponse(
       .body = http::CreateBody(GetMultiStatusResponse(responses))};
 }
 
-auto AccountManagerHandler::ChooseHandler(std::string_view path)
+auto AccountManagerHandler::ChooseHandler(std::string_view path,
+                                          http::Method method)
     -> std::optional<Handler> {
   if (path.starts_with("/static/")) {
     return Handler{.handler = StaticFileHandler{factory_}};
   } else if (path.starts_with("/size")) {
-    return Handler{.handler = GetSizeHandler{
-                       std::span<const CloudProviderAccount>(accounts_)}};
+    return Handler{
+        .handler =
+            GetSizeHandler{std::span<const CloudProviderAccount>(accounts_)},
+        .coalesce_body = true};
+  } else if (path.starts_with("/search")) {
+    return Handler{
+        .handler = SearchHandler{event_loop_, metadata_index_,
+                                 std::span<const CloudProviderAccount>(
+                                     accounts_)},
+        .coalesce_body = true};
+  } else if (path.starts_with("/transfer")) {
+    return Handler{
+        .handler = TransferHandler{transfer_manager_,
+                                   std::span<const CloudProviderAccount>(
+                                       accounts_)},
+        .coalesce_body = true};
   } else if (path.starts_with("/settings/theme-toggle")) {
     return Handler{.handler = ThemeHandler{}};
   } else if (path.starts_with("/settings")) {
@@ -282,73 +320,95 @@ auto AccountManagerHandler::ChooseHandler(std::string_view path)
         .handler = MuxHandler{
             muxer_, std::span<const CloudProviderAccount>(accounts_)}};
   } else {
-    for (AbstractCloudProvider::Type type :
-         factory_->GetSupportedCloudProviders()) {
-      if (path.starts_with(StrCat("/auth/", factory_->GetAuth(type).GetId()))) {
+    for (const auto& [prefix, type] : auth_routes_) {
+      if (path.starts_with(prefix)) {
         return Handler{.handler = AuthHandler{type, this}};
       }
     }
+    return ChooseAccountHandler(path, method);
+  }
+}
 
-    for (const auto& account : accounts_) {
-      auto match = [&](std::string_view prefix) {
-        std::string account_prefix =
-            StrCat(prefix, account.type(), '/',
-                   http::EncodeUri(account.username()), '/');
-        return path.starts_with(account_prefix) ||
-               StrCat(path, '/') == account_prefix;
-      };
-      if (match("/list/")) {
-        return Handler{
-            .account = account,
-            .handler = ListDirectoryHandler(
-                account,
-                [account_id = account.id()](std::string_view item_id) {
-                  return StrCat("/list/", account_id.type, '/',
-                                http::EncodeUri(account_id.username), '/',
-                                http::EncodeUri(item_id));
-                },
-                [account_id = account.id()](std::string_view item_id) {
-                  return StrCat("/thumbnail/", account_id.type, '/',
-                                http::EncodeUri(account_id.username), '/',
-                                http::EncodeUri(item_id));
-                },
-                [account_id =
-                     account.id()](const AbstractCloudProvider::File& file) {
-                  return StrCat(file.mime_type == "application/dash+xml"
-                                    ? "/dash/"
-                                    : "/content/",
-                                account_id.type, '/',
-                                http::EncodeUri(account_id.username), '/',
-                                http::EncodeUri(file.id));
-                })};
-      } else if (match("/webdav/")) {
-        return Handler{.account = account, .handler = WebDAVHandler(account)};
-      } else if (match("/thumbnail/")) {
-        return Handler{.account = account,
-                       .handler = ItemThumbnailHandler(account)};
-      } else if (match("/dash/")) {
-        return Handler{
-            .account = account,
-            .handler = DashHandler(
-                CreateItemUrlProvider(account.id()),
-                [account_id = account.id()](std::string_view item_id) {
-                  return StrCat("/thumbnail/", account_id.type, '/',
-                                http::EncodeUri(account_id.username), '/',
-                                http::EncodeUri(item_id), '?', "quality=high");
-                })};
-      } else if (match("/content/")) {
-        return Handler{.account = account,
-                       .handler = ItemContentHandler{account}};
-      } else if (match("/remove/")) {
-        return Handler{
-            .account = account,
-            .handler = OnRemoveHandler{.d = this, .account = account}};
-      }
-    }
+auto AccountManagerHandler::ChooseAccountHandler(std::string_view path,
+                                                 http::Method method)
+    -> std::optional<Handler> {
+  auto route_end = path.find('/', 1);
+  if (!path.starts_with('/') || route_end == std::string_view::npos) {
+    return std::nullopt;
+  }
+  std::string_view route = path.substr(1, route_end - 1);
+  std::string_view account_path = path.substr(route_end + 1);
+  auto type_end = account_path.find('/');
+  if (type_end == std::string_view::npos) {
+    return std::nullopt;
+  }
+  auto it = account_index_.find(
+      account_path.substr(0, account_path.find('/', type_end + 1)));
+  if (it == account_index_.end()) {
+    return std::nullopt;
+  }
+  const CloudProviderAccount& account = accounts_[it->second];
+  if (route == "list") {
+    return Handler{
+        .account = account,
+        .handler = ListDirectoryHandler(
+            account,
+            [account_id = account.id()](std::string_view item_id) {
+              return StrCat("/list/", account_id.type, '/',
+                            http::EncodeUri(account_id.username), '/',
+                            http::EncodeUri(item_id));
+            },
+            [account_id = account.id()](std::string_view item_id) {
+              return StrCat("/thumbnail/", account_id.type, '/',
+                            http::EncodeUri(account_id.username), '/',
+                            http::EncodeUri(item_id));
+            },
+            [account_id =
+                 account.id()](const AbstractCloudProvider::File& file) {
+              return StrCat(file.mime_type == "application/dash+xml"
+                                ? "/dash/"
+                                : "/content/",
+                            account_id.type, '/',
+                            http::EncodeUri(account_id.username), '/',
+                            http::EncodeUri(file.id));
+            }),
+        .coalesce_body = true};
+  } else if (route == "webdav") {
+    return Handler{.account = account,
+                   .handler = WebDAVHandler(account),
+                   .coalesce_body = method == http::Method::kPropfind ||
+                                    method == http::Method::kProppatch};
+  } else if (route == "thumbnail") {
+    return Handler{.account = account,
+                   .handler = ItemThumbnailHandler(account)};
+  } else if (route == "dash") {
+    return Handler{
+        .account = account,
+        .handler = DashHandler(
+            CreateItemUrlProvider(account.id()),
+            [account_id = account.id()](std::string_view item_id) {
+              return StrCat("/thumbnail/", account_id.type, '/',
+                            http::EncodeUri(account_id.username), '/',
+                            http::EncodeUri(item_id), '?', "quality=high");
+            })};
+  } else if (route == "content") {
+    return Handler{.account = account, .handler = ItemContentHandler{account}};
+  } else if (route == "remove") {
+    return Handler{.account = account,
+                   .handler = OnRemoveHandler{.d = this, .account = account}};
   }
   return std::nullopt;
 }
 
+void AccountManagerHandler::UpdateAccountIndex() {
+  account_index_.clear();
+  for (size_t i = 0; i < accounts_.size(); i++) {
+    account_index_.emplace(StrCat(accounts_[i].type(), '/',
+                                  http::EncodeUri(accounts_[i].username())),
+                           i);
+  }
+}
+
 Generator<std::string> AccountManagerHandler::GetHomePage() const {
   std::stringstream supported_providers;
   for (auto type : factory_->GetSupportedCloudProviders()) {
@@ -380,6 +440,8 @@ Generator<std::string> AccountManagerHandler::GetHomePage() const {
 
 void AccountManagerHandler::OnCloudProviderCreated(
     CloudProviderAccount account) {
+  metadata_indexer_->Add(account.account_key(), account.stop_token());
+  change_feed_poller_->Add(account.account_key(), account.stop_token());
   account_listener_.OnCreate(std::move(account));
 }
 
@@ -395,13 +457,15 @@ void AccountManagerHandler::RemoveCloudProvider(const F& predicate) {
       it++;
     }
   }
+  UpdateAccountIndex();
 }
 
 CloudProviderAccount AccountManagerHandler::CreateAccount(
     std::unique_ptr<AbstractCloudProvider> provider, std::string username,
     int64_t version) {
-  return {std::move(username), version, std::move(provider),
-          cache_manager_,      clock_,  thumbnail_generator_};
+  return {std::move(username),   version, std::move(provider),
+          cache_manager_,        clock_,  thumbnail_generator_,
+          thumbnail_prefetcher_, metadata_index_};
 }
 
 Task<CloudProviderAccount> AccountManagerHandler::Create(
@@ -425,6 +489,7 @@ Task<CloudProviderAccount> AccountManagerHandler::Create(
       }));
   auto d = accounts_.emplace_back(
       CreateAccount(std::move(provider), general_data.username, version));
+  UpdateAccountIndex();
   settings_manager_->SaveToken(std::move(auth_token), general_data.username);
   OnCloudProviderCreated(d);
   co_return d;
@@ -1,16 +1,28 @@
 #ifndef CORO_CLOUDSTORAGE_ACCOUNT_MANAGER_HANDLER_H
 #define CORO_CLOUDSTORAGE_ACCOUNT_MANAGER_HANDLER_H
 
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "coro/cloudstorage/util/cache_manager.h"
+#include "coro/cloudstorage/util/change_feed_poller.h"
 #include "coro/cloudstorage/util/clock.h"
 #include "coro/cloudstorage/util/cloud_provider_account.h"
+#include "coro/cloudstorage/util/metadata_index.h"
+#include "coro/cloudstorage/util/metadata_indexer.h"
 #include "coro/cloudstorage/util/muxer.h"
 #include "coro/cloudstorage/util/settings_manager.h"
 #include "coro/cloudstorage/util/string_utils.h"
 #include "coro/cloudstorage/util/thumbnail_generator.h"
+#include "coro/cloudstorage/util/thumbnail_prefetcher.h"
+#include "coro/cloudstorage/util/transfer_manager.h"
 #include "coro/http/http.h"
 #include "coro/http/http_parse.h"
 #include "coro/stdx/any_invocable.h"
+#include "coro/util/event_loop.h"
 #include "coro/when_all.h"
 
 namespace coro::cloudstorage::util {
@@ -63,12 +75,18 @@ class AccountListener {
 
 class AccountManagerHandler {
  public:
-  AccountManagerHandler(const AbstractCloudFactory* factory,
+  AccountManagerHandler(const coro::util::EventLoop* event_loop,
+                        const AbstractCloudFactory* factory,
                         const ThumbnailGenerator* thumbnail_generator,
                         const Muxer* muxer, const Clock* clock,
                         AccountListener account_listener,
                         SettingsManager* settings_manager,
-                        CacheManager* cache_manager);
+                        CacheManager* cache_manager,
+                        ThumbnailPrefetcher* thumbnail_prefetcher,
+                        TransferManager* transfer_manager,
+                        MetadataIndex* metadata_index,
+                        MetadataIndexer* metadata_indexer,
+                        ChangeFeedPoller* change_feed_poller);
   AccountManagerHandler(AccountManagerHandler&&) noexcept = default;
   AccountManagerHandler(const AccountManagerHandler&) = delete;
   ~AccountManagerHandler();
@@ -102,6 +120,17 @@ class AccountManagerHandler {
     stdx::any_invocable<Task<http::Response<>>(http::Request<>,
                                                stdx::stop_token)>
         handler;
+    // Whether the response body is generated in many small pieces, e.g. an
+    // HTML listing or a WebDAV multistatus, rather than streamed from a file.
+    bool coalesce_body = false;
+  };
+
+  struct StringHash {
+    using is_transparent = void;
+
+    size_t operator()(std::string_view text) const {
+      return std::hash<std::string_view>{}(text);
+    }
   };
 
   Task<http::Response<>> HandleRequest(http::Request<> request,
@@ -124,10 +153,17 @@ class AccountManagerHandler {
       AbstractCloudProvider::Auth::AuthToken auth_token,
       stdx::stop_token stop_token);
 
-  std::optional<Handler> ChooseHandler(std::string_view path);
+  std::optional<Handler> ChooseHandler(std::string_view path,
+                                       http::Method method);
+
+  std::optional<Handler> ChooseAccountHandler(std::string_view path,
+                                              http::Method method);
+
+  void UpdateAccountIndex();
 
   Generator<std::string> GetHomePage() const;
 
+  const coro::util::EventLoop* event_loop_;
   const AbstractCloudFactory* factory_;
   const ThumbnailGenerator* thumbnail_generator_;
   const Muxer* muxer_;
@@ -135,7 +171,17 @@ class AccountManagerHandler {
   AccountListener account_listener_;
   SettingsManager* settings_manager_;
   CacheManager* cache_manager_;
+  ThumbnailPrefetcher* thumbnail_prefetcher_;
+  TransferManager* transfer_manager_;
+  MetadataIndex* metadata_index_;
+  MetadataIndexer* metadata_indexer_;
+  ChangeFeedPoller* change_feed_poller_;
   std::vector<CloudProviderAccount> accounts_;
+  // Maps `<account type>/<encoded username>` to an index into `accounts_`.
+  std::unordered_map<std::string, size_t, StringHash, std::equal_to<>>
+      account_index_;
+  std::vector<std::pair<std::string, AbstractCloudProvider::Type>>
+      auth_routes_;
   int64_t version_ = 0;
 };
 
@@ -1,26 +1,398 @@
 #include "coro/cloudstorage/util/avio_context.h"
 
-#include "coro/cloudstorage/util/generator_utils.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
 #include "coro/http/http.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/raii_utils.h"
 
 namespace coro::cloudstorage::util {
 
 namespace {
 
+using ::coro::RunTask;
+
+constexpr int kIOBufferSize = 64 * 1024;
+constexpr size_t kMinReadAheadSize = 256 * 1024;
+constexpr size_t kMaxReadAheadSize = 16 * 1024 * 1024;
+constexpr int64_t kReadAheadDurationMs = 2000;
+constexpr int64_t kBitrateSampleIntervalMs = 100;
+constexpr int64_t kBlockSize = 64 * 1024;
+constexpr size_t kBlockCacheSize = 8 * 1024 * 1024;
+constexpr int64_t kPinnedRegionSize = 1024 * 1024;
+
+// Keeps recently read, block-aligned regions of the file around so that FFmpeg
+// seeking back into them, which happens a lot while probing containers, doesn't
+// cost a new range request. Blocks within `kPinnedRegionSize` of either end of
+// the file are evicted last, as that's where container metadata lives.
+class BlockCache {
+ public:
+  explicit BlockCache(std::optional<int64_t> file_size)
+      : file_size_(file_size) {}
+
+  // Returns the cached data starting at `offset` up to the end of its block.
+  std::optional<std::string_view> Get(int64_t offset) {
+    auto it = blocks_.find(offset / kBlockSize);
+    if (it == blocks_.end()) {
+      return std::nullopt;
+    }
+    auto block_offset = static_cast<size_t>(offset % kBlockSize);
+    if (block_offset >= it->second.data.size()) {
+      return std::nullopt;
+    }
+    it->second.last_access = ++access_counter_;
+    return std::string_view(it->second.data).substr(block_offset);
+  }
+
+  // Records data the stream produced at `offset`. Only blocks which were read
+  // from their first byte up to their last one end up in the cache.
+  void Append(int64_t offset, std::string_view data) {
+    while (!data.empty()) {
+      int64_t block_index = offset / kBlockSize;
+      auto block_offset = static_cast<size_t>(offset % kBlockSize);
+      size_t size =
+          std::min(data.size(), static_cast<size_t>(kBlockSize) - block_offset);
+      if (pending_block_index_ == block_index &&
+          pending_block_.size() == block_offset) {
+        pending_block_.append(data.substr(0, size));
+      } else if (block_offset == 0) {
+        pending_block_index_ = block_index;
+        pending_block_.assign(data.substr(0, size));
+      } else {
+        pending_block_index_ = -1;
+      }
+      offset += static_cast<int64_t>(size);
+      data.remove_prefix(size);
+      if (pending_block_index_ != -1 &&
+          (pending_block_.size() == static_cast<size_t>(kBlockSize) ||
+           (file_size_ && offset == *file_size_))) {
+        Insert(pending_block_index_, std::move(pending_block_));
+        pending_block_index_ = -1;
+        pending_block_.clear();
+      }
+    }
+  }
+
+ private:
+  struct Block {
+    std::string data;
+    int64_t last_access;
+  };
+
+  bool IsPinned(int64_t block_index) const {
+    int64_t start = block_index * kBlockSize;
+    return start < kPinnedRegionSize ||
+           (file_size_ && start + kBlockSize > *file_size_ - kPinnedRegionSize);
+  }
+
+  void Insert(int64_t block_index, std::string data) {
+    size_ += data.size();
+    auto [it, inserted] = blocks_.insert_or_assign(
+        block_index,
+        Block{.data = std::move(data), .last_access = ++access_counter_});
+    while (size_ > kBlockCacheSize) {
+      auto victim = blocks_.end();
+      for (auto jt = blocks_.begin(); jt != blocks_.end(); jt++) {
+        if (jt == it) {
+          continue;
+        }
+        if (victim == blocks_.end() ||
+            std::make_pair(IsPinned(jt->first), jt->second.last_access) <
+                std::make_pair(IsPinned(victim->first),
+                               victim->second.last_access)) {
+          victim = jt;
+        }
+      }
+      if (victim == blocks_.end()) {
+        break;
+      }
+      size_ -= victim->second.data.size();
+      blocks_.erase(victim);
+    }
+  }
+
+  std::optional<int64_t> file_size_;
+  std::unordered_map<int64_t, Block> blocks_;
+  size_t size_ = 0;
+  int64_t access_counter_ = 0;
+  int64_t pending_block_index_ = -1;
+  std::string pending_block_;
+};
+
+// State shared between the FFmpeg thread, which reads from the buffered
+// chunks, and the event loop, which keeps them filled from the provider's
+// content generator. Fields guarded by `mutex` are touched by both; the rest is
+// only ever accessed from the event loop.
 struct Context {
   const coro::util::EventLoop* event_loop;
   const AbstractCloudProvider* provider;
   AbstractCloudProvider::File file;
-  int64_t offset;
   stdx::stop_token stop_token;
-  std::optional<Generator<std::string>> generator;
-  std::optional<Generator<std::string>::iterator> it;
+
+  std::mutex mutex;
+  std::condition_variable buffer_changed;
+  std::deque<std::string> chunks;
+  size_t front_chunk_offset = 0;
+  size_t buffered_size = 0;
+  // File offset of the first buffered byte.
+  int64_t stream_offset = 0;
+  // File offset FFmpeg reads from next. Differs from `stream_offset` when
+  // FFmpeg seeks into a region served by `block_cache`.
+  int64_t offset = 0;
+  // Bumped whenever the buffered data gets discarded; fill tasks from a stale
+  // generation drop their data and exit.
+  int64_t generation = 0;
+  size_t read_ahead_size = kMinReadAheadSize;
+  bool eof = false;
+  bool error = false;
+  bool fill_waiting = false;
+  std::chrono::steady_clock::time_point sample_start =
+      std::chrono::steady_clock::now();
+  int64_t sample_bytes = 0;
+  std::optional<BlockCache> block_cache;
+
+  stdx::stop_source* fill_stop_source = nullptr;
+  Promise<void>* fill_resume = nullptr;
 };
 
+void ResumeFill(Context* d) {
+  if (auto* resume = std::exchange(d->fill_resume, nullptr)) {
+    resume->SetValue();
+  }
+}
+
+void CancelFill(Context* d) {
+  if (d->fill_stop_source) {
+    d->fill_stop_source->request_stop();
+  }
+  ResumeFill(d);
+}
+
+Task<> FillReadAheadBuffer(std::shared_ptr<Context> d, int64_t generation,
+                           int64_t offset) {
+  stdx::stop_source stop_source;
+  stdx::stop_callback cb(d->stop_token, [&] { stop_source.request_stop(); });
+  d->fill_stop_source = &stop_source;
+  auto scope_guard = coro::util::AtScopeExit([&] {
+    if (d->fill_stop_source == &stop_source) {
+      d->fill_stop_source = nullptr;
+    }
+  });
+  try {
+    auto generator = d->provider->GetFileContent(
+        d->file, http::Range{.start = offset}, stop_source.get_token());
+    FOR_CO_AWAIT(std::string & chunk, generator) {
+      if (chunk.empty()) {
+        continue;
+      }
+      while (true) {
+        std::unique_lock lock(d->mutex);
+        if (d->generation != generation) {
+          co_return;
+        }
+        if (d->buffered_size < d->read_ahead_size) {
+          break;
+        }
+        d->fill_waiting = true;
+        lock.unlock();
+        Promise<void> resume;
+        d->fill_resume = &resume;
+        co_await resume;
+      }
+      std::unique_lock lock(d->mutex);
+      d->buffered_size += chunk.size();
+      d->chunks.emplace_back(std::move(chunk));
+      d->buffer_changed.notify_all();
+    }
+    std::unique_lock lock(d->mutex);
+    if (d->generation == generation) {
+      d->eof = true;
+      d->buffer_changed.notify_all();
+    }
+  } catch (...) {
+    std::unique_lock lock(d->mutex);
+    if (d->generation == generation) {
+      d->error = true;
+      d->buffer_changed.notify_all();
+    }
+  }
+}
+
+// Must be called with `d->mutex` held. Discards the buffered data and
+// schedules a fill task which starts reading at `offset`.
+void RestartFill(const std::shared_ptr<Context>& d, int64_t offset) {
+  d->generation++;
+  d->chunks.clear();
+  d->front_chunk_offset = 0;
+  d->buffered_size = 0;
+  d->stream_offset = offset;
+  d->eof = d->file.size && offset >= *d->file.size;
+  d->error = false;
+  d->fill_waiting = false;
+  if (d->eof) {
+    d->event_loop->RunOnEventLoop([d] { CancelFill(d.get()); });
+    return;
+  }
+  d->event_loop->RunOnEventLoop([d, generation = d->generation, offset] {
+    CancelFill(d.get());
+    RunTask(FillReadAheadBuffer(d, generation, offset));
+  });
+}
+
+// Must be called with `d->mutex` held. Drops `size` bytes from the front of the
+// buffer, copying them to `output` if it's not null.
+void Consume(Context* d, char* output, size_t size) {
+  while (size > 0) {
+    std::string& chunk = d->chunks.front();
+    size_t n = std::min(size, chunk.size() - d->front_chunk_offset);
+    std::string_view data(chunk.data() + d->front_chunk_offset, n);
+    if (output) {
+      memcpy(output, data.data(), n);
+      output += n;
+    }
+    d->block_cache->Append(d->stream_offset, data);
+    d->front_chunk_offset += n;
+    d->buffered_size -= n;
+    d->stream_offset += static_cast<int64_t>(n);
+    size -= n;
+    if (d->front_chunk_offset == chunk.size()) {
+      d->chunks.pop_front();
+      d->front_chunk_offset = 0;
+    }
+  }
+}
+
+// Must be called with `d->mutex` held. Sizes the read-ahead window so that it
+// covers `kReadAheadDurationMs` worth of data at the rate FFmpeg consumes it.
+void UpdateReadAheadSize(Context* d, size_t consumed) {
+  d->sample_bytes += static_cast<int64_t>(consumed);
+  auto now = std::chrono::steady_clock::now();
+  auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        now - d->sample_start)
+                        .count();
+  if (elapsed_ms < kBitrateSampleIntervalMs) {
+    return;
+  }
+  int64_t bytes_per_second = d->sample_bytes * 1000 / elapsed_ms;
+  d->read_ahead_size = std::clamp<size_t>(
+      static_cast<size_t>(bytes_per_second * kReadAheadDurationMs / 1000),
+      kMinReadAheadSize, kMaxReadAheadSize);
+  d->sample_start = now;
+  d->sample_bytes = 0;
+}
+
+// Must be called with `d->mutex` held.
+int ReadFromStream(const std::shared_ptr<Context>& d,
+                   std::unique_lock<std::mutex>& lock, uint8_t* buf,
+                   int buf_size) {
+  d->buffer_changed.wait(lock, [&] {
+    return d->buffered_size > 0 || d->eof || d->error ||
+           d->stop_token.stop_requested();
+  });
+  if (d->buffered_size == 0) {
+    if (d->error) {
+      return AVERROR(EIO);
+    }
+    if (d->eof) {
+      return AVERROR_EOF;
+    }
+    return AVERROR(EINTR);
+  }
+  size_t size = std::min(d->buffered_size, static_cast<size_t>(buf_size));
+  Consume(d.get(), reinterpret_cast<char*>(buf), size);
+  d->offset += static_cast<int64_t>(size);
+  UpdateReadAheadSize(d.get(), size);
+  if (d->fill_waiting && d->buffered_size < d->read_ahead_size / 2) {
+    d->fill_waiting = false;
+    d->event_loop->RunOnEventLoop([d] { ResumeFill(d.get()); });
+  }
+  return static_cast<int>(size);
+}
+
+int ReadPacket(const std::shared_ptr<Context>& d, uint8_t* buf, int buf_size) {
+  std::unique_lock lock(d->mutex);
+  while (true) {
+    if (d->stop_token.stop_requested()) {
+      return AVERROR(EINTR);
+    }
+    if (d->offset == d->stream_offset) {
+      return ReadFromStream(d, lock, buf, buf_size);
+    }
+    if (d->offset > d->stream_offset &&
+        d->offset <=
+            d->stream_offset + static_cast<int64_t>(d->buffered_size)) {
+      Consume(d.get(), /*output=*/nullptr,
+              static_cast<size_t>(d->offset - d->stream_offset));
+      continue;
+    }
+    if (d->file.size && d->offset >= *d->file.size) {
+      return AVERROR_EOF;
+    }
+    if (auto cached = d->block_cache->Get(d->offset)) {
+      size_t size = std::min(cached->size(), static_cast<size_t>(buf_size));
+      memcpy(buf, cached->data(), size);
+      d->offset += static_cast<int64_t>(size);
+      return static_cast<int>(size);
+    }
+    RestartFill(d, d->offset);
+  }
+}
+
+int64_t Seek(const std::shared_ptr<Context>& d, int64_t offset, int whence) {
+  whence &= ~AVSEEK_FORCE;
+  if (whence == AVSEEK_SIZE) {
+    return d->file.size.value_or(AVERROR(ENOSYS));
+  }
+  std::unique_lock lock(d->mutex);
+  int64_t new_offset = -1;
+  if (whence == SEEK_SET) {
+    new_offset = offset;
+  } else if (whence == SEEK_CUR) {
+    new_offset = d->offset + offset;
+  } else if (whence == SEEK_END) {
+    auto size = d->file.size;
+    if (!size) {
+      return AVERROR(ENOSYS);
+    }
+    new_offset = *size + offset;
+  } else {
+    return AVERROR(EINVAL);
+  }
+  if (new_offset < 0) {
+    return AVERROR(EINVAL);
+  }
+  if (d->stop_token.stop_requested()) {
+    return AVERROR(EINTR);
+  }
+  // The stream gets restarted lazily on the next read, unless the data at
+  // `new_offset` is buffered or cached by then.
+  d->offset = new_offset;
+  if (d->error) {
+    RestartFill(d, new_offset);
+  }
+  return new_offset;
+}
+
 }  // namespace
 
 void AVIOContextDeleter::operator()(AVIOContext* context) {
-  delete reinterpret_cast<Context*>(context->opaque);
+  auto* d = reinterpret_cast<std::shared_ptr<Context>*>(context->opaque);
+  {
+    std::unique_lock lock((*d)->mutex);
+    (*d)->generation++;
+  }
+  (*d)->event_loop->RunOnEventLoop([d = *d] { CancelFill(d.get()); });
+  delete d;
   av_free(context->buffer);
   avio_context_free(&context);
 }
@@ -29,91 +401,30 @@ std::unique_ptr<AVIOContext, AVIOContextDeleter> CreateIOContext(
     const coro::util::EventLoop* event_loop,
     const AbstractCloudProvider* provider, AbstractCloudProvider::File file,
     stdx::stop_token stop_token) {
-  const int kBufferSize = 32 * 1024;
-  auto* buffer = static_cast<uint8_t*>(av_malloc(kBufferSize));
+  auto d = std::make_shared<Context>();
+  d->event_loop = event_loop;
+  d->provider = provider;
+  d->file = std::move(file);
+  d->stop_token = std::move(stop_token);
+  d->block_cache.emplace(d->file.size);
+  auto* buffer = static_cast<uint8_t*>(av_malloc(kIOBufferSize));
   std::unique_ptr<AVIOContext, AVIOContextDeleter> context(avio_alloc_context(
-      buffer, kBufferSize, /*write_flag=*/0,
-      new Context{event_loop, provider, std::move(file), 0,
-                  std::move(stop_token), std::nullopt, std::nullopt},
+      buffer, kIOBufferSize, /*write_flag=*/0, new std::shared_ptr<Context>(d),
       [](void* opaque, uint8_t* buf, int buf_size) -> int {
-        auto* data = reinterpret_cast<Context*>(opaque);
-        return data->event_loop->Do([&]() -> Task<int> {
-          try {
-            if (data->offset == -1) {
-              co_return AVERROR(EIO);
-            }
-            if (data->offset == data->file.size) {
-              co_return AVERROR_EOF;
-            }
-            if (data->stop_token.stop_requested()) {
-              co_return AVERROR(EINTR);
-            }
-            if (!data->generator) {
-              data->generator = data->provider->GetFileContent(
-                  data->file, http::Range{.start = data->offset},
-                  data->stop_token);
-              data->it = co_await data->generator->begin();
-            }
-            auto buffer = co_await http::GetBody(util::Take(
-                *data->generator, *data->it, static_cast<size_t>(buf_size)));
-            data->offset += static_cast<int64_t>(buffer.size());
-            memcpy(buf, buffer.data(), buffer.size());
-            if (buffer.empty()) {
-              co_return AVERROR_EOF;
-            }
-            co_return static_cast<int>(buffer.size());
-          } catch (...) {
-            data->generator.reset();
-            data->offset = -1;
-            co_return AVERROR(EIO);
-          }
-        });
+        return ReadPacket(*reinterpret_cast<std::shared_ptr<Context>*>(opaque),
+                          buf, buf_size);
       },
       /*write_packet=*/nullptr,
       [](void* opaque, int64_t offset, int whence) -> int64_t {
-        auto* data = reinterpret_cast<Context*>(opaque);
-        whence &= ~AVSEEK_FORCE;
-        if (whence == AVSEEK_SIZE) {
-          return data->file.size.value_or(AVERROR(ENOSYS));
-        }
-        int64_t new_offset = -1;
-        if (whence == SEEK_SET) {
-          new_offset = offset;
-        } else if (whence == SEEK_CUR) {
-          new_offset = data->offset + offset;
-        } else if (whence == SEEK_END) {
-          auto size = data->file.size;
-          if (!size) {
-            return AVERROR(ENOSYS);
-          }
-          new_offset = *size + offset;
-        } else {
-          return AVERROR(EINVAL);
-        }
-        if (data->offset == new_offset) {
-          return new_offset;
-        }
-        return data->event_loop->Do([&]() -> Task<int64_t> {
-          try {
-            if (data->stop_token.stop_requested()) {
-              data->offset = -1;
-              co_return AVERROR(EINTR);
-            }
-            data->generator = data->provider->GetFileContent(
-                data->file, http::Range{.start = new_offset}, data->stop_token);
-            data->it = co_await data->generator->begin();
-            co_return data->offset = new_offset;
-          } catch (...) {
-            data->generator.reset();
-            data->offset = -1;
-            co_return AVERROR(EIO);
-          }
-        });
+        return Seek(*reinterpret_cast<std::shared_ptr<Context>*>(opaque),
+                    offset, whence);
       }));
   if (!context) {
     throw RuntimeError("avio_alloc_context");
   }
+  std::unique_lock lock(d->mutex);
+  RestartFill(d, /*offset=*/0);
   return context;
 }
 
-}  // namespace coro::cloudstorage::util
\ No newline at end of file
+}  // namespace coro::cloudstorage::util
@@ -2,30 +2,69 @@
 
 #include <sqlite_orm/sqlite_orm.h>
 
+#include <algorithm>
+#include <iterator>
 #include <nlohmann/json.hpp>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "coro/cloudstorage/util/item_data_codec.h"
+#include "coro/cloudstorage/util/string_utils.h"
 
 namespace coro::cloudstorage::util {
 
 namespace {
 
+using ::coro::RunTask;
 using ::sqlite_orm::and_;
 using ::sqlite_orm::c;
 using ::sqlite_orm::columns;
+using ::sqlite_orm::default_value;
 using ::sqlite_orm::foreign_key;
+using ::sqlite_orm::in;
 using ::sqlite_orm::join;
+using ::sqlite_orm::like;
+using ::sqlite_orm::limit;
 using ::sqlite_orm::make_column;
 using ::sqlite_orm::make_storage;
 using ::sqlite_orm::make_table;
 using ::sqlite_orm::on;
+using ::sqlite_orm::or_;
 using ::sqlite_orm::order_by;
 using ::sqlite_orm::primary_key;
 using ::sqlite_orm::where;
 
+// Bumped whenever the layout of the stored items changes. Rows of version 0
+// predate the typed columns, rows of version 1 hold the CBOR of the whole item
+// in `content`. Rows with an older version can still be read and are
+// rewritten in batches in the background, see `CacheManager::MigrateItems`.
+constexpr int kItemEncodingVersion = 2;
+
+constexpr int kMigrationBatchSize = 256;
+
+constexpr int kBusyTimeoutMs = 10000;
+
+enum class DbItemType { kFile, kDirectory };
+
+// Fields common to all providers are kept in typed columns so that they can
+// be read and queried without decoding `content`, which holds only the
+// provider specific data of the item, see
+// `AbstractCloudProvider::EncodeItemData`.
 struct DbItem {
   std::string account_type;
   std::string account_username;
   std::string id;
+  int encoding_version;
+  int type;
+  std::string name;
+  std::optional<int64_t> size;
+  std::optional<int64_t> timestamp;
+  std::string mime_type;
   std::vector<char> content;
+  int64_t content_hash;
   int64_t update_time;
 };
 
@@ -44,6 +83,12 @@ struct DbDirectoryContent {
   int32_t order;
 };
 
+struct CachedDirectoryEntry {
+  int32_t order;
+  int64_t content_hash;
+  int encoding_version;
+};
+
 struct DbImage {
   std::string account_type;
   std::string account_username;
@@ -54,13 +99,48 @@ struct DbImage {
   int64_t update_time;
 };
 
+struct DbDirectorySize {
+  std::string account_type;
+  std::string account_username;
+  std::string directory_id;
+  int64_t size;
+  int64_t file_count;
+  int64_t update_time;
+};
+
+struct DbChangeFeed {
+  std::string account_type;
+  std::string account_username;
+  std::string cursor;
+  int64_t start_time;
+  int64_t update_time;
+};
+
+struct DbProviderData {
+  std::string provider_type;
+  std::string key;
+  std::vector<char> value;
+  int64_t update_time;
+  std::optional<int64_t> expire_time;
+};
+
 auto CreateStorage(std::string path) {
   auto storage = make_storage(
       std::move(path),
       make_table("item", make_column("account_type", &DbItem::account_type),
                  make_column("account_username", &DbItem::account_username),
                  make_column("id", &DbItem::id),
+                 make_column("encoding_version", &DbItem::encoding_version,
+                             default_value(0)),
+                 make_column("type", &DbItem::type, default_value(0)),
+                 make_column("name", &DbItem::name, default_value("")),
+                 make_column("size", &DbItem::size),
+                 make_column("timestamp", &DbItem::timestamp),
+                 make_column("mime_type", &DbItem::mime_type,
+                             default_value("")),
                  make_column("content", &DbItem::content),
+                 make_column("content_hash", &DbItem::content_hash,
+                             default_value(0)),
                  make_column("update_time", &DbItem::update_time),
                  primary_key(&DbItem::account_type, &DbItem::account_username,
                              &DbItem::id)),
@@ -109,7 +189,41 @@ auto CreateStorage(std::string path) {
                  make_column("image_bytes", &DbImage::image_bytes),
                  make_column("update_time", &DbImage::update_time),
                  primary_key(&DbImage::account_type, &DbImage::account_username,
-                             &DbImage::item_id)));
+                             &DbImage::item_id, &DbImage::quality)),
+      make_table(
+          "directory_size",
+          make_column("account_type", &DbDirectorySize::account_type),
+          make_column("account_username", &DbDirectorySize::account_username),
+          make_column("directory_id", &DbDirectorySize::directory_id),
+          make_column("size", &DbDirectorySize::size),
+          make_column("file_count", &DbDirectorySize::file_count),
+          make_column("update_time", &DbDirectorySize::update_time),
+          primary_key(&DbDirectorySize::account_type,
+                      &DbDirectorySize::account_username,
+                      &DbDirectorySize::directory_id)),
+      make_table(
+          "change_feed",
+          make_column("account_type", &DbChangeFeed::account_type),
+          make_column("account_username", &DbChangeFeed::account_username),
+          make_column("cursor", &DbChangeFeed::cursor),
+          make_column("start_time", &DbChangeFeed::start_time),
+          make_column("update_time", &DbChangeFeed::update_time),
+          primary_key(&DbChangeFeed::account_type,
+                      &DbChangeFeed::account_username)),
+      make_table(
+          "provider_data",
+          make_column("provider_type", &DbProviderData::provider_type),
+          make_column("key", &DbProviderData::key),
+          make_column("value", &DbProviderData::value),
+          make_column("update_time", &DbProviderData::update_time),
+          make_column("expire_time", &DbProviderData::expire_time),
+          primary_key(&DbProviderData::provider_type, &DbProviderData::key)));
+  // `MetadataIndex` writes to the same file over a connection of its own.
+  storage.on_open = [](sqlite3* db) {
+    sqlite3_busy_timeout(db, kBusyTimeoutMs);
+    sqlite3_exec(db, "PRAGMA journal_mode=WAL", /*callback=*/nullptr,
+                 /*arg=*/nullptr, /*errmsg=*/nullptr);
+  };
   storage.sync_schema();
   return storage;
 }
@@ -120,10 +234,367 @@ auto* GetDb(CacheDatabase* any) {
   return reinterpret_cast<CacheDatabaseT*>(any);
 }
 
-std::vector<char> ToCbor(const nlohmann::json& json) {
-  std::vector<char> output;
-  nlohmann::json::to_cbor(json, output);
-  return output;
+std::unordered_map<std::string, DbDirectorySize> GetDirectorySizes(
+    CacheDatabaseT* db, std::string_view account_type,
+    std::string_view account_username,
+    const std::vector<std::string>& directory_ids) {
+  std::unordered_map<std::string, DbDirectorySize> result;
+  if (directory_ids.empty()) {
+    return result;
+  }
+  for (auto& entry : db->get_all<DbDirectorySize>(where(
+           and_(and_(c(&DbDirectorySize::account_type) == account_type,
+                     c(&DbDirectorySize::account_username) ==
+                         account_username),
+                in(&DbDirectorySize::directory_id, directory_ids))))) {
+    std::string directory_id = entry.directory_id;
+    result.emplace(std::move(directory_id), std::move(entry));
+  }
+  return result;
+}
+
+// Adds `size` and `file_count` to the stored sizes of all the ancestors of
+// `directory_id` found in the stored listings, or drops them if `sizes` is
+// not set.
+void UpdateAncestorSizes(
+    CacheDatabaseT* db, const std::string& account_type,
+    const std::string& account_username, const std::string& directory_id,
+    std::optional<std::pair<int64_t, int64_t>> sizes, int64_t update_time) {
+  std::unordered_set<std::string> visited{directory_id};
+  std::vector<std::string> queue{directory_id};
+  while (!queue.empty()) {
+    std::string id = std::move(queue.back());
+    queue.pop_back();
+    auto parent_ids = db->select(
+        &DbDirectoryContent::parent_item_id,
+        where(and_(
+            and_(c(&DbDirectoryContent::account_type) == account_type,
+                 c(&DbDirectoryContent::account_username) == account_username),
+            c(&DbDirectoryContent::child_item_id) == id)));
+    for (auto& parent_id : parent_ids) {
+      if (!visited.insert(parent_id).second) {
+        continue;
+      }
+      if (!sizes) {
+        db->remove<DbDirectorySize>(account_type, account_username, parent_id);
+      } else if (auto entry = db->get_pointer<DbDirectorySize>(
+                     account_type, account_username, parent_id)) {
+        entry->size += sizes->first;
+        entry->file_count += sizes->second;
+        entry->update_time = update_time;
+        db->replace(*entry);
+      }
+      queue.emplace_back(std::move(parent_id));
+    }
+  }
+}
+
+// Recomputes the stored size of the directory `directory_id` with the
+// content `items` and propagates the change to its ancestors.
+void UpdateDirectorySize(CacheDatabaseT* db, const std::string& account_type,
+                         const std::string& account_username,
+                         const std::string& directory_id,
+                         const std::vector<DbItem>& items,
+                         int64_t update_time) {
+  auto previous = db->get_pointer<DbDirectorySize>(
+      account_type, account_username, directory_id);
+  std::optional<DbDirectorySize> current;
+  if (previous) {
+    std::vector<std::string> subdirectory_ids;
+    current = DbDirectorySize{.account_type = account_type,
+                              .account_username = account_username,
+                              .directory_id = directory_id,
+                              .size = 0,
+                              .file_count = 0,
+                              .update_time = update_time};
+    for (const DbItem& item : items) {
+      if (item.type == static_cast<int>(DbItemType::kDirectory)) {
+        subdirectory_ids.emplace_back(item.id);
+      } else {
+        current->size += item.size.value_or(0);
+        current->file_count++;
+      }
+    }
+    auto subdirectory_sizes = GetDirectorySizes(db, account_type,
+                                                account_username,
+                                                subdirectory_ids);
+    for (const auto& id : subdirectory_ids) {
+      auto it = subdirectory_sizes.find(id);
+      if (it == subdirectory_sizes.end()) {
+        current = std::nullopt;
+        break;
+      }
+      current->size += it->second.size;
+      current->file_count += it->second.file_count;
+    }
+  }
+  if (current) {
+    db->replace(*current);
+    UpdateAncestorSizes(
+        db, account_type, account_username, directory_id,
+        std::make_pair(current->size - previous->size,
+                       current->file_count - previous->file_count),
+        update_time);
+  } else {
+    db->remove<DbDirectorySize>(account_type, account_username, directory_id);
+    UpdateAncestorSizes(db, account_type, account_username, directory_id,
+                        std::nullopt, update_time);
+  }
+}
+
+auto JoinDirectoryContent() {
+  return join<DbDirectoryContent>(
+      on(and_(and_(c(&DbItem::account_type) ==
+                       &DbDirectoryContent::account_type,
+                   c(&DbItem::account_username) ==
+                       &DbDirectoryContent::account_username),
+              c(&DbItem::id) == &DbDirectoryContent::child_item_id)));
+}
+
+// Returns the stored listing of `directory_id` with only the columns needed
+// by `UpdateDirectorySize`.
+std::vector<DbItem> GetDirectoryItems(CacheDatabaseT* db,
+                                      const std::string& account_type,
+                                      const std::string& account_username,
+                                      const std::string& directory_id) {
+  std::vector<DbItem> items;
+  for (auto& [id, type, size] : db->select(
+           columns(&DbItem::id, &DbItem::type, &DbItem::size),
+           JoinDirectoryContent(),
+           where(and_(
+               and_(c(&DbDirectoryContent::account_type) == account_type,
+                    c(&DbDirectoryContent::account_username) ==
+                        account_username),
+               c(&DbDirectoryContent::parent_item_id) == directory_id)))) {
+    items.emplace_back(DbItem{.id = std::move(id), .type = type, .size = size});
+  }
+  return items;
+}
+
+// Drops the item `id`, its listing and its entries in the listings of its
+// parents, which are added to `changed_directory_ids`.
+void RemoveItem(CacheDatabaseT* db, const std::string& account_type,
+                const std::string& account_username, const std::string& id,
+                std::unordered_set<std::string>& changed_directory_ids) {
+  auto account_filter =
+      and_(c(&DbDirectoryContent::account_type) == account_type,
+           c(&DbDirectoryContent::account_username) == account_username);
+  for (auto& parent_id :
+       db->select(&DbDirectoryContent::parent_item_id,
+                  where(and_(account_filter,
+                             c(&DbDirectoryContent::child_item_id) == id)))) {
+    changed_directory_ids.insert(std::move(parent_id));
+  }
+  db->remove_all<DbDirectoryContent>(
+      where(and_(account_filter,
+                 or_(c(&DbDirectoryContent::child_item_id) == id,
+                     c(&DbDirectoryContent::parent_item_id) == id))));
+  db->remove<DbDirectoryMetadata>(account_type, account_username, id);
+  db->remove<DbDirectorySize>(account_type, account_username, id);
+  db->remove<DbItem>(account_type, account_username, id);
+}
+
+// Moves `item` to the stored listings of `parent_ids` and stores it if it is
+// in any listing or was stored before. The listings which change are added
+// to `changed_directory_ids`.
+void PutItem(CacheDatabaseT* db, const DbItem& item,
+             const std::vector<std::string>& parent_ids,
+             std::unordered_set<std::string>& changed_directory_ids) {
+  auto account_filter =
+      and_(c(&DbDirectoryContent::account_type) == item.account_type,
+           c(&DbDirectoryContent::account_username) == item.account_username);
+  auto previous = db->get_pointer<DbItem>(item.account_type,
+                                          item.account_username, item.id);
+  bool changed = !previous || previous->content_hash != item.content_hash;
+  bool stored = previous != nullptr;
+  auto current_parent_ids = db->select(
+      &DbDirectoryContent::parent_item_id,
+      where(and_(account_filter,
+                 c(&DbDirectoryContent::child_item_id) == item.id)));
+  for (auto& parent_id : current_parent_ids) {
+    if (std::find(parent_ids.begin(), parent_ids.end(), parent_id) ==
+        parent_ids.end()) {
+      db->remove<DbDirectoryContent>(item.account_type, item.account_username,
+                                     parent_id, item.id);
+      changed_directory_ids.insert(parent_id);
+    } else if (changed) {
+      changed_directory_ids.insert(parent_id);
+    }
+  }
+  for (const auto& parent_id : parent_ids) {
+    if (std::find(current_parent_ids.begin(), current_parent_ids.end(),
+                  parent_id) != current_parent_ids.end() ||
+        !db->get_pointer<DbDirectoryMetadata>(
+            item.account_type, item.account_username, parent_id)) {
+      continue;
+    }
+    auto last_order = db->max(
+        &DbDirectoryContent::order,
+        where(and_(account_filter,
+                   c(&DbDirectoryContent::parent_item_id) == parent_id)));
+    db->replace(DbDirectoryContent{
+        .account_type = item.account_type,
+        .account_username = item.account_username,
+        .parent_item_id = parent_id,
+        .child_item_id = item.id,
+        .order = last_order ? *last_order + 1 : 0});
+    changed_directory_ids.insert(parent_id);
+    stored = true;
+  }
+  if (stored && changed) {
+    db->replace(item);
+  }
+}
+
+// 64-bit FNV-1a. The hashes are persisted, so this must not depend on the
+// standard library implementation.
+int64_t GetContentHash(std::string_view content) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (char byte : content) {
+    hash ^= static_cast<uint8_t>(byte);
+    hash *= 1099511628211ULL;
+  }
+  return static_cast<int64_t>(hash);
+}
+
+// Escapes the wildcards of a LIKE pattern with '\'.
+std::string EscapeLikePattern(std::string_view text) {
+  std::string result;
+  for (char c : text) {
+    if (c == '%' || c == '_' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+DbItem ToDbItem(const CacheManager::AccountKey& account,
+                std::string_view account_type, std::string id,
+                const AbstractCloudProvider::Item& item, int64_t update_time) {
+  std::string content = account.provider->EncodeItemData(item);
+  DbItem db_item{.account_type = std::string(account_type),
+                 .account_username = account.username,
+                 .id = std::move(id),
+                 .encoding_version = kItemEncodingVersion,
+                 .content = std::vector<char>(content.begin(), content.end()),
+                 .update_time = update_time};
+  std::visit(
+      [&]<typename T>(const T& d) {
+        db_item.name = d.name;
+        db_item.size = d.size;
+        db_item.timestamp = d.timestamp;
+        if constexpr (std::is_same_v<T, AbstractCloudProvider::File>) {
+          db_item.type = static_cast<int>(DbItemType::kFile);
+          db_item.mime_type = d.mime_type;
+        } else {
+          db_item.type = static_cast<int>(DbItemType::kDirectory);
+        }
+      },
+      item);
+  // The common fields aren't part of `content` anymore.
+  ItemDataWriter hashed(ItemDataFormat::kCompact);
+  hashed.WriteUint64(db_item.type);
+  hashed.WriteString(db_item.name);
+  for (const auto& field : {db_item.size, db_item.timestamp}) {
+    hashed.WriteBool(field.has_value());
+    hashed.WriteInt64(field.value_or(0));
+  }
+  hashed.WriteString(db_item.mime_type);
+  hashed.WriteString(content);
+  db_item.content_hash = GetContentHash(std::move(hashed).data());
+  return db_item;
+}
+
+// Builds the item from the typed columns and lets the provider fill in its
+// own data from `content`. Rows in an older encoding hold the CBOR of the
+// whole item instead.
+AbstractCloudProvider::Item ToItem(const AbstractCloudProvider& provider,
+                                   DbItem db_item) {
+  if (db_item.encoding_version < kItemEncodingVersion) {
+    return provider.ToItem(nlohmann::json::from_cbor(db_item.content));
+  }
+  AbstractCloudProvider::Item item;
+  if (db_item.type == static_cast<int>(DbItemType::kDirectory)) {
+    item = AbstractCloudProvider::Directory{.id = std::move(db_item.id),
+                                            .name = std::move(db_item.name),
+                                            .size = db_item.size,
+                                            .timestamp = db_item.timestamp};
+  } else {
+    item = AbstractCloudProvider::File{
+        .id = std::move(db_item.id),
+        .name = std::move(db_item.name),
+        .size = db_item.size,
+        .timestamp = db_item.timestamp,
+        .mime_type = std::move(db_item.mime_type)};
+  }
+  provider.DecodeItemData(
+      std::string_view(db_item.content.data(), db_item.content.size()), item);
+  return item;
+}
+
+auto ItemColumns() {
+  return columns(&DbItem::id, &DbItem::encoding_version, &DbItem::type,
+                 &DbItem::name, &DbItem::size, &DbItem::timestamp,
+                 &DbItem::mime_type, &DbItem::content);
+}
+
+DbItem FromItemColumns(auto row) {
+  return DbItem{.id = std::move(std::get<0>(row)),
+                .encoding_version = std::get<1>(row),
+                .type = std::get<2>(row),
+                .name = std::move(std::get<3>(row)),
+                .size = std::get<4>(row),
+                .timestamp = std::get<5>(row),
+                .mime_type = std::move(std::get<6>(row)),
+                .content = std::move(std::get<7>(row))};
+}
+
+// Rewrites up to `kMigrationBatchSize` rows of the account which are stored
+// in an older encoding. Rows which fail to decode are dropped, together with
+// the listings they were in, so that those get fetched again. Returns whether
+// no such rows are left.
+bool MigrateItemBatch(CacheDatabaseT* db,
+                      const CacheManager::AccountKey& account) {
+  std::string account_type(account.provider->GetId());
+  auto rows = db->get_all<DbItem>(
+      where(and_(and_(c(&DbItem::account_type) == account_type,
+                      c(&DbItem::account_username) == account.username),
+                 c(&DbItem::encoding_version) < kItemEncodingVersion)),
+      limit(kMigrationBatchSize));
+  if (rows.empty()) {
+    return true;
+  }
+  db->transaction([&] {
+    std::unordered_set<std::string> changed_directory_ids;
+    for (DbItem& row : rows) {
+      std::string id = row.id;
+      int64_t update_time = row.update_time;
+      std::optional<DbItem> migrated;
+      try {
+        migrated = ToDbItem(account, account_type, id,
+                            ToItem(*account.provider, std::move(row)),
+                            update_time);
+      } catch (const std::exception&) {
+      }
+      if (migrated) {
+        db->replace(*migrated);
+      } else {
+        RemoveItem(db, account_type, account.username, id,
+                   changed_directory_ids);
+      }
+    }
+    for (const auto& directory_id : changed_directory_ids) {
+      db->remove<DbDirectoryMetadata>(account_type, account.username,
+                                      directory_id);
+      db->remove<DbDirectorySize>(account_type, account.username,
+                                  directory_id);
+      UpdateAncestorSizes(db, account_type, account.username, directory_id,
+                          std::nullopt, /*update_time=*/0);
+    }
+    return true;
+  });
+  return rows.size() < kMigrationBatchSize;
 }
 
 }  // namespace
@@ -143,59 +614,114 @@ CacheManager::CacheManager(CacheDatabase* db,
                            const coro::util::EventLoop* event_loop)
     : db_(db), worker_(event_loop, /*thread_count=*/1, "db") {}
 
-Task<> CacheManager::Put(AccountKey account, DirectoryContent content,
-                         stdx::stop_token stop_token) {
+CacheManager::~CacheManager() { stop_source_.request_stop(); }
+
+void CacheManager::MigrateItems(const AccountKey& account) const {
+  std::pair<std::string, std::string> key(account.provider->GetId(),
+                                          account.username);
+  if (migrated_accounts_.contains(key) ||
+      !migrating_accounts_.insert(key).second) {
+    return;
+  }
+  RunTask([d = this, db = GetDb(db_), account, key = std::move(key),
+           stop_token = stop_source_.get_token()]() mutable -> Task<> {
+    bool migrated = false;
+    try {
+      while (!co_await d->worker_.Do(
+          stop_token, [&] { return MigrateItemBatch(db, account); })) {
+      }
+      migrated = true;
+    } catch (...) {
+    }
+    if (stop_token.stop_requested()) {
+      co_return;
+    }
+    // Retried on the next access if it failed.
+    d->migrating_accounts_.erase(key);
+    if (migrated) {
+      d->migrated_accounts_.insert(std::move(key));
+    }
+  });
+}
+
+Task<bool> CacheManager::Put(AccountKey account, DirectoryContent content,
+                             stdx::stop_token stop_token) {
   auto* db = GetDb(db_);
-  std::vector<DbItem> db_items(content.items.size() + 1);
-  std::vector<DbDirectoryContent> db_directory_content(content.items.size());
   std::string account_type{account.provider->GetId()};
-  db_items[0] =
-      DbItem{.account_type = account_type,
-             .account_username = account.username,
-             .id = content.parent.id,
-             .content = ToCbor(account.provider->ToJson(content.parent)),
-             .update_time = content.update_time};
-  int32_t order = 0;
-  for (size_t i = 0; i < content.items.size(); i++) {
-    db_items[i + 1] = std::visit(
-        [&](const auto& e) {
-          return DbItem{
-              .account_type = account_type,
-              .account_username = account.username,
-              .id = e.id,
-              .content = ToCbor(account.provider->ToJson(content.items[i])),
-              .update_time = content.update_time};
-        },
-        content.items[i]);
-    db_directory_content[i] = std::visit(
-        [&](const auto& i) {
-          return DbDirectoryContent{.account_type = account_type,
-                                    .account_username = account.username,
-                                    .parent_item_id = content.parent.id,
-                                    .child_item_id = i.id,
-                                    .order = order++};
-        },
-        content.items[i]);
+  DbItem db_parent =
+      ToDbItem(account, account_type, content.parent.id, content.parent,
+               content.update_time);
+  std::vector<DbItem> db_items;
+  db_items.reserve(content.items.size());
+  for (const auto& item : content.items) {
+    db_items.emplace_back(ToDbItem(
+        account, account_type,
+        std::visit([](const auto& d) { return d.id; }, item), item,
+        content.update_time));
   }
   DbDirectoryMetadata metadata{.account_type = account_type,
                                .account_username = account.username,
                                .parent_item_id = content.parent.id,
                                .update_time = content.update_time};
   co_return co_await worker_.Do(std::move(stop_token), [&] {
+    bool changed = false;
     db->transaction([&] {
-      db->remove_all<DbDirectoryContent>(where(and_(
-          c(&DbDirectoryContent::account_type) == account_type,
-          and_(c(&DbDirectoryContent::account_username) == account.username,
-               c(&DbDirectoryContent::parent_item_id) == content.parent.id))));
-      for (const auto& d : db_items) {
-        db->replace(d);
+      db->replace(db_parent);
+      auto previous = db->select(
+          columns(&DbItem::id, &DbDirectoryContent::order,
+                  &DbItem::content_hash, &DbItem::encoding_version),
+          JoinDirectoryContent(),
+          where(and_(
+              c(&DbDirectoryContent::account_type) == account_type,
+              and_(c(&DbDirectoryContent::account_username) ==
+                       account.username,
+                   c(&DbDirectoryContent::parent_item_id) ==
+                       content.parent.id))));
+      std::unordered_map<std::string_view, CachedDirectoryEntry>
+          previous_entries;
+      for (const auto& [id, order, content_hash, encoding_version] :
+           previous) {
+        previous_entries.emplace(
+            id, CachedDirectoryEntry{.order = order,
+                                     .content_hash = content_hash,
+                                     .encoding_version = encoding_version});
+      }
+      for (int32_t order = 0; order < static_cast<int32_t>(db_items.size());
+           order++) {
+        const DbItem& d = db_items[order];
+        auto it = previous_entries.find(d.id);
+        if (it == previous_entries.end() ||
+            it->second.content_hash != d.content_hash) {
+          db->replace(d);
+          changed = true;
+        } else if (it->second.encoding_version != kItemEncodingVersion) {
+          db->replace(d);
+        }
+        if (it == previous_entries.end() || it->second.order != order) {
+          db->replace(DbDirectoryContent{.account_type = account_type,
+                                         .account_username = account.username,
+                                         .parent_item_id = content.parent.id,
+                                         .child_item_id = d.id,
+                                         .order = order});
+          changed = true;
+        }
+        if (it != previous_entries.end()) {
+          previous_entries.erase(it);
+        }
       }
-      for (const auto& d : db_directory_content) {
-        db->replace(d);
+      for (const auto& [id, entry] : previous_entries) {
+        db->remove<DbDirectoryContent>(account_type, account.username,
+                                       content.parent.id, std::string(id));
+        changed = true;
       }
       db->replace(metadata);
+      if (changed) {
+        UpdateDirectorySize(db, account_type, account.username,
+                            content.parent.id, db_items, content.update_time);
+      }
       return true;
     });
+    return changed;
   });
 }
 
@@ -203,23 +729,108 @@ Task<> CacheManager::Put(AccountKey account, ItemKey key, ItemData item,
                          stdx::stop_token stop_token) {
   auto* db = GetDb(db_);
   DbItem db_item =
-      DbItem{.account_type = std::string{account.provider->GetId()},
-             .account_username = account.username,
-             .id = std::move(key.item_id),
-             .content = ToCbor(account.provider->ToJson(item.item)),
-             .update_time = item.update_time};
+      ToDbItem(account, account.provider->GetId(), std::move(key.item_id),
+               item.item, item.update_time);
   co_return co_await worker_.Do(std::move(stop_token),
                                 [&] { db->replace(db_item); });
 }
 
+Task<> CacheManager::ApplyChanges(
+    AccountKey account, std::vector<AbstractCloudProvider::Change> changes,
+    ChangeFeedState state, stdx::stop_token stop_token) {
+  auto* db = GetDb(db_);
+  std::string account_type{account.provider->GetId()};
+  std::vector<std::optional<DbItem>> db_items;
+  db_items.reserve(changes.size());
+  for (const auto& change : changes) {
+    if (change.item) {
+      db_items.emplace_back(ToDbItem(account, account_type, change.id,
+                                     *change.item, state.update_time));
+    } else {
+      db_items.emplace_back(std::nullopt);
+    }
+  }
+  DbChangeFeed feed{.account_type = account_type,
+                    .account_username = account.username,
+                    .cursor = std::move(state.cursor),
+                    .start_time = state.start_time,
+                    .update_time = state.update_time};
+  MigrateItems(account);
+  co_await worker_.Do(std::move(stop_token), [&] {
+    db->transaction([&] {
+      std::unordered_set<std::string> changed_directory_ids;
+      for (size_t i = 0; i < changes.size(); i++) {
+        const auto& change = changes[i];
+        if (db_items[i]) {
+          PutItem(db, *db_items[i], change.parents, changed_directory_ids);
+        } else if (!change.id.empty()) {
+          RemoveItem(db, account_type, account.username, change.id,
+                     changed_directory_ids);
+        } else {
+          for (const auto& parent_id : change.parents) {
+            for (auto& row : db->select(
+                     ItemColumns(), JoinDirectoryContent(),
+                     where(and_(
+                         and_(c(&DbDirectoryContent::account_type) ==
+                                  account_type,
+                              c(&DbDirectoryContent::account_username) ==
+                                  account.username),
+                         and_(c(&DbDirectoryContent::parent_item_id) ==
+                                  parent_id,
+                              or_(c(&DbItem::name) == change.name,
+                                  c(&DbItem::encoding_version) == 0)))))) {
+              DbItem db_item = FromItemColumns(std::move(row));
+              std::string id = db_item.id;
+              // Rows which weren't migrated yet may have no name column.
+              if (db_item.encoding_version == 0) {
+                try {
+                  if (std::visit([](const auto& d) { return d.name; },
+                                 ToItem(*account.provider,
+                                        std::move(db_item))) != change.name) {
+                    continue;
+                  }
+                } catch (const std::exception&) {
+                  continue;
+                }
+              }
+              RemoveItem(db, account_type, account.username, id,
+                         changed_directory_ids);
+            }
+          }
+        }
+      }
+      for (const auto& directory_id : changed_directory_ids) {
+        auto metadata = db->get_pointer<DbDirectoryMetadata>(
+            account_type, account.username, directory_id);
+        if (!metadata) {
+          continue;
+        }
+        // A listing stored before the feed started may miss earlier changes
+        // and must not appear to be up to date.
+        if (metadata->update_time >= feed.start_time) {
+          metadata->update_time = feed.update_time;
+          db->replace(*metadata);
+        }
+        UpdateDirectorySize(db, account_type, account.username, directory_id,
+                            GetDirectoryItems(db, account_type,
+                                              account.username, directory_id),
+                            feed.update_time);
+      }
+      db->replace(feed);
+      return true;
+    });
+  });
+}
+
 auto CacheManager::Get(AccountKey account, ParentDirectoryKey key,
                        stdx::stop_token stop_token) const
     -> Task<std::optional<DirectoryContent>> {
   auto* db = GetDb(db_);
+  MigrateItems(account);
   auto result = co_await worker_.Do(
       std::move(stop_token),
-      [&]() -> std::optional<std::pair<DbDirectoryMetadata,
-                                       std::vector<std::vector<char>>>> {
+      [&]() -> std::optional<
+                std::pair<DbDirectoryMetadata, std::vector<DbItem>>> {
         auto lock = db->transaction_guard();
         auto metadata = db->get_all<DbDirectoryMetadata>(where(and_(
             c(&DbDirectoryMetadata::account_type) == account.provider->GetId(),
@@ -228,32 +839,28 @@ auto CacheManager::Get(AccountKey account, ParentDirectoryKey key,
         if (metadata.empty()) {
           return std::nullopt;
         }
-        return std::make_pair(
-            std::move(metadata[0]),
-            db->select(
-                &DbItem::content,
-                join<DbDirectoryContent>(on(and_(
-                    and_(c(&DbItem::account_type) ==
-                             &DbDirectoryContent::account_type,
-                         c(&DbItem::account_username) ==
-                             &DbDirectoryContent::account_username),
-                    c(&DbItem::id) == &DbDirectoryContent::child_item_id))),
-                where(and_(c(&DbDirectoryContent::account_type) ==
-                               account.provider->GetId(),
-                           and_(c(&DbDirectoryContent::account_username) ==
-                                    account.username,
-                                c(&DbDirectoryContent::parent_item_id) ==
-                                    key.item_id))),
-                order_by(&DbDirectoryContent::order)));
+        std::vector<DbItem> items;
+        for (auto& row : db->select(
+                 ItemColumns(), JoinDirectoryContent(),
+                 where(and_(c(&DbDirectoryContent::account_type) ==
+                                account.provider->GetId(),
+                            and_(c(&DbDirectoryContent::account_username) ==
+                                     account.username,
+                                 c(&DbDirectoryContent::parent_item_id) ==
+                                     key.item_id))),
+                 order_by(&DbDirectoryContent::order))) {
+          items.emplace_back(FromItemColumns(std::move(row)));
+        }
+        return std::make_pair(std::move(metadata[0]), std::move(items));
       });
   if (!result) {
     co_return std::nullopt;
   }
 
-  std::vector<AbstractCloudProvider::Item> items{result->second.size()};
-  for (size_t i = 0; i < items.size(); i++) {
-    items[i] =
-        account.provider->ToItem(nlohmann::json::from_cbor(result->second[i]));
+  std::vector<AbstractCloudProvider::Item> items;
+  items.reserve(result->second.size());
+  for (auto& db_item : result->second) {
+    items.emplace_back(ToItem(*account.provider, std::move(db_item)));
   }
   co_return DirectoryContent{.items = std::move(items),
                              .update_time = result->first.update_time};
@@ -275,6 +882,85 @@ Task<> CacheManager::Put(AccountKey account, ImageKey key, ImageData image,
       });
 }
 
+Task<> CacheManager::Put(AccountKey account,
+                         std::vector<std::pair<ImageKey, ImageData>> images,
+                         stdx::stop_token stop_token) {
+  auto* db = GetDb(db_);
+  std::vector<DbImage> entries;
+  entries.reserve(images.size());
+  for (auto& [key, image] : images) {
+    entries.emplace_back(
+        DbImage{.account_type = std::string{account.provider->GetId()},
+                .account_username = account.username,
+                .item_id = std::move(key.item_id),
+                .quality = static_cast<int>(key.quality),
+                .mime_type = std::move(image.mime_type),
+                .image_bytes = std::move(image.image_bytes),
+                .update_time = image.update_time});
+  }
+  co_await worker_.Do(std::move(stop_token), [&] {
+    db->transaction([&] {
+      for (const auto& entry : entries) {
+        db->replace(entry);
+      }
+      return true;
+    });
+  });
+}
+
+Task<> CacheManager::Put(
+    AccountKey account,
+    std::vector<std::pair<DirectorySizeKey, DirectorySize>> sizes,
+    stdx::stop_token stop_token) {
+  auto* db = GetDb(db_);
+  std::vector<DbDirectorySize> entries;
+  entries.reserve(sizes.size());
+  for (auto& [key, size] : sizes) {
+    entries.emplace_back(
+        DbDirectorySize{.account_type = std::string{account.provider->GetId()},
+                        .account_username = account.username,
+                        .directory_id = std::move(key.directory_id),
+                        .size = size.size,
+                        .file_count = size.file_count,
+                        .update_time = size.update_time});
+  }
+  co_await worker_.Do(std::move(stop_token), [&] {
+    db->transaction([&] {
+      for (const auto& entry : entries) {
+        db->replace(entry);
+      }
+      return true;
+    });
+  });
+}
+
+Task<> CacheManager::Put(ProviderDataKey key, ProviderData data,
+                         stdx::stop_token stop_token) {
+  co_await worker_.Do(
+      std::move(stop_token),
+      [db = GetDb(db_),
+       entry = DbProviderData{.provider_type = std::move(key.provider_type),
+                              .key = std::move(key.key),
+                              .value = std::move(data.value),
+                              .update_time = data.update_time,
+                              .expire_time = data.expire_time}] {
+        db->transaction([&] {
+          db->remove_all<DbProviderData>(
+              where(and_(c(&DbProviderData::provider_type) ==
+                             entry.provider_type,
+                         c(&DbProviderData::expire_time) < entry.update_time)));
+          db->replace(entry);
+          return true;
+        });
+      });
+}
+
+Task<> CacheManager::Remove(ProviderDataKey key, stdx::stop_token stop_token) {
+  co_await worker_.Do(std::move(stop_token), [&] {
+    GetDb(db_)->remove<DbProviderData>(key.provider_type, key.key);
+  });
+}
+
 auto CacheManager::Get(AccountKey account, ImageKey key,
                        stdx::stop_token stop_token)
     -> Task<std::optional<ImageData>> {
@@ -300,6 +986,7 @@ auto CacheManager::Get(AccountKey account, ImageKey key,
 Task<std::optional<CacheManager::ItemData>> CacheManager::Get(
     AccountKey account, ItemKey key, stdx::stop_token stop_token) const {
   auto* db = GetDb(db_);
+  MigrateItems(account);
   auto item = co_await worker_.Do(
       std::move(stop_token), [&]() -> std::optional<DbItem> {
         auto result = db->get_all<DbItem>(where(
@@ -313,12 +1000,127 @@ Task<std::optional<CacheManager::ItemData>> CacheManager::Get(
         }
       });
   if (item) {
-    co_return ItemData{.item = account.provider->ToItem(
-                           nlohmann::json::from_cbor(item->content)),
-                       .update_time = item->update_time};
+    int64_t update_time = item->update_time;
+    co_return ItemData{.item = ToItem(*account.provider, std::move(*item)),
+                       .update_time = update_time};
   } else {
     co_return std::nullopt;
   }
 }
 
-}  // namespace coro::cloudstorage::util
\ No newline at end of file
+auto CacheManager::Get(ProviderDataKey key, stdx::stop_token stop_token) const
+    -> Task<std::optional<ProviderData>> {
+  auto* db = GetDb(db_);
+  auto result = co_await worker_.Do(std::move(stop_token), [&] {
+    return db->select(
+        columns(&DbProviderData::value, &DbProviderData::update_time,
+                &DbProviderData::expire_time),
+        where(and_(c(&DbProviderData::provider_type) == key.provider_type,
+                   c(&DbProviderData::key) == key.key)));
+  });
+  if (result.empty()) {
+    co_return std::nullopt;
+  }
+  co_return ProviderData{.value = std::move(std::get<0>(result[0])),
+                         .update_time = std::get<1>(result[0]),
+                         .expire_time = std::get<2>(result[0])};
+}
+
+auto CacheManager::Get(AccountKey account, DirectorySizeKey key,
+                       stdx::stop_token stop_token) const
+    -> Task<std::optional<DirectorySize>> {
+  auto* db = GetDb(db_);
+  auto entry = co_await worker_.Do(std::move(stop_token), [&] {
+    return db->get_pointer<DbDirectorySize>(
+        std::string(account.provider->GetId()), account.username,
+        key.directory_id);
+  });
+  if (!entry) {
+    co_return std::nullopt;
+  }
+  co_return DirectorySize{.size = entry->size,
+                          .file_count = entry->file_count,
+                          .update_time = entry->update_time};
+}
+
+auto CacheManager::Get(AccountKey account, ChangeFeedKey,
+                       stdx::stop_token stop_token) const
+    -> Task<std::optional<ChangeFeedState>> {
+  auto* db = GetDb(db_);
+  auto entry = co_await worker_.Do(std::move(stop_token), [&] {
+    return db->get_pointer<DbChangeFeed>(
+        std::string(account.provider->GetId()), account.username);
+  });
+  if (!entry) {
+    co_return std::nullopt;
+  }
+  co_return ChangeFeedState{.cursor = std::move(entry->cursor),
+                            .start_time = entry->start_time,
+                            .update_time = entry->update_time};
+}
+
+auto CacheManager::GetDirectorySizes(AccountKey account,
+                                     std::vector<std::string> directory_ids,
+                                     stdx::stop_token stop_token) const
+    -> Task<std::unordered_map<std::string, DirectorySize>> {
+  auto* db = GetDb(db_);
+  auto entries = co_await worker_.Do(std::move(stop_token), [&] {
+    return ::coro::cloudstorage::util::GetDirectorySizes(
+        db, account.provider->GetId(), account.username, directory_ids);
+  });
+  std::unordered_map<std::string, DirectorySize> result;
+  for (auto& [id, entry] : entries) {
+    result.emplace(id, DirectorySize{.size = entry.size,
+                                     .file_count = entry.file_count,
+                                     .update_time = entry.update_time});
+  }
+  co_return result;
+}
+
+auto CacheManager::GetImageItemIds(AccountKey account,
+                                   std::vector<std::string> item_ids,
+                                   ThumbnailQuality quality,
+                                   stdx::stop_token stop_token) const
+    -> Task<std::unordered_set<std::string>> {
+  if (item_ids.empty()) {
+    co_return std::unordered_set<std::string>{};
+  }
+  auto* db = GetDb(db_);
+  auto ids = co_await worker_.Do(std::move(stop_token), [&] {
+    return db->select(
+        &DbImage::item_id,
+        where(and_(
+            and_(c(&DbImage::account_type) == account.provider->GetId(),
+                 c(&DbImage::account_username) == account.username),
+            and_(c(&DbImage::quality) == static_cast<int>(quality),
+                 in(&DbImage::item_id, item_ids)))));
+  });
+  co_return std::unordered_set<std::string>(
+      std::make_move_iterator(ids.begin()), std::make_move_iterator(ids.end()));
+}
+
+auto CacheManager::SearchItems(AccountKey account, std::string query,
+                               int limit_count,
+                               stdx::stop_token stop_token) const
+    -> Task<std::vector<AbstractCloudProvider::Item>> {
+  auto* db = GetDb(db_);
+  std::string pattern = StrCat('%', EscapeLikePattern(query), '%');
+  MigrateItems(account);
+  auto result = co_await worker_.Do(std::move(stop_token), [&] {
+    return db->select(
+        ItemColumns(),
+        where(and_(and_(c(&DbItem::account_type) == account.provider->GetId(),
+                        c(&DbItem::account_username) == account.username),
+                   like(&DbItem::name, pattern, "\\"))),
+        order_by(&DbItem::name), limit(limit_count));
+  });
+  std::vector<AbstractCloudProvider::Item> items;
+  items.reserve(result.size());
+  for (auto& row : result) {
+    items.emplace_back(
+        ToItem(*account.provider, FromItemColumns(std::move(row))));
+  }
+  co_return items;
+}
+
+}  // namespace coro::cloudstorage::util
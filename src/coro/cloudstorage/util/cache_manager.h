@@ -2,8 +2,15 @@
 #define CORO_CLOUDSTORAGE_CACHE_MANAGER_H
 
 #include <any>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "coro/cloudstorage/util/abstract_cloud_provider.h"
+#include "coro/stdx/stop_source.h"
 #include "coro/task.h"
 #include "coro/util/event_loop.h"
 #include "coro/util/thread_pool.h"
@@ -56,14 +63,84 @@ class CacheManager {
     int64_t update_time;
   };
 
+  struct DirectorySizeKey {
+    std::string directory_id;
+  };
+
+  // Total size and number of the files anywhere under a directory.
+  struct DirectorySize {
+    int64_t size;
+    int64_t file_count;
+    int64_t update_time;
+  };
+
+  // Position of the account in the change feed of its cloud.
+  struct ChangeFeedKey {};
+
+  struct ChangeFeedState {
+    std::string cursor;
+    // When the feed was started. Listings stored before then were not kept up
+    // to date by it.
+    int64_t start_time;
+    // When the changes were last fetched.
+    int64_t update_time;
+  };
+
+  // Data a provider shares between all of its accounts, e.g. the parsed
+  // scripts of a video player.
+  struct ProviderDataKey {
+    std::string provider_type;
+    std::string key;
+  };
+
+  struct ProviderData {
+    std::vector<char> value;
+    int64_t update_time;
+    std::optional<int64_t> expire_time;
+  };
+
   CacheManager(CacheDatabase*, const coro::util::EventLoop* event_loop);
+  CacheManager(const CacheManager&) = delete;
+  ~CacheManager();
 
-  Task<> Put(AccountKey, DirectoryContent, stdx::stop_token stop_token);
+  CacheManager& operator=(const CacheManager&) = delete;
+
+  // Diffs `content` against the stored listing by item id and content hash
+  // and writes only the rows that changed. Returns whether anything did.
+  //
+  // If it did, the stored size of the directory is recomputed from its files
+  // and the stored sizes of its subdirectories and the difference is applied
+  // to the stored sizes of its ancestors. If a subdirectory has no stored
+  // size, the sizes of the directory and of its ancestors are dropped.
+  Task<bool> Put(AccountKey, DirectoryContent, stdx::stop_token stop_token);
 
   Task<> Put(AccountKey, ItemKey, ItemData, stdx::stop_token);
 
   Task<> Put(AccountKey, ImageKey, ImageData, stdx::stop_token stop_token);
 
+  // Stores all images in a single transaction.
+  Task<> Put(AccountKey, std::vector<std::pair<ImageKey, ImageData>>,
+             stdx::stop_token stop_token);
+
+  // Stores all sizes in a single transaction.
+  Task<> Put(AccountKey,
+             std::vector<std::pair<DirectorySizeKey, DirectorySize>>,
+             stdx::stop_token stop_token);
+
+  // Also drops the entries of the same provider that expired before
+  // `update_time`.
+  Task<> Put(ProviderDataKey, ProviderData, stdx::stop_token stop_token);
+
+  Task<> Remove(ProviderDataKey, stdx::stop_token stop_token);
+
+  // Applies `changes` to the stored items and to the stored listings which
+  // contain them and stores `state`, in a single transaction. Items are
+  // appended to the listings they are added to. The stored sizes of the
+  // affected directories are recomputed as in `Put(DirectoryContent)`.
+  Task<> ApplyChanges(AccountKey,
+                      std::vector<AbstractCloudProvider::Change> changes,
+                      ChangeFeedState state, stdx::stop_token stop_token);
+
   Task<std::optional<DirectoryContent>> Get(AccountKey, ParentDirectoryKey,
                                             stdx::stop_token stop_token) const;
 
@@ -73,9 +150,42 @@ class CacheManager {
   Task<std::optional<ItemData>> Get(AccountKey, ItemKey id,
                                     stdx::stop_token stop_token) const;
 
+  Task<std::optional<ProviderData>> Get(ProviderDataKey,
+                                        stdx::stop_token stop_token) const;
+
+  Task<std::optional<DirectorySize>> Get(AccountKey, DirectorySizeKey,
+                                         stdx::stop_token stop_token) const;
+
+  Task<std::optional<ChangeFeedState>> Get(AccountKey, ChangeFeedKey,
+                                           stdx::stop_token stop_token) const;
+
+  // Returns the stored sizes of those of `directory_ids` that have one.
+  Task<std::unordered_map<std::string, DirectorySize>> GetDirectorySizes(
+      AccountKey, std::vector<std::string> directory_ids,
+      stdx::stop_token stop_token) const;
+
+  // Returns those of `item_ids` that have an image of `quality` stored.
+  Task<std::unordered_set<std::string>> GetImageItemIds(
+      AccountKey, std::vector<std::string> item_ids, ThumbnailQuality quality,
+      stdx::stop_token stop_token) const;
+
+  // Returns at most `limit` cached items of the account whose name contains
+  // `query`, ignoring the case of ASCII letters.
+  Task<std::vector<AbstractCloudProvider::Item>> SearchItems(
+      AccountKey, std::string query, int limit,
+      stdx::stop_token stop_token) const;
+
  private:
+  // Starts rewriting the rows of the account stored in an older encoding, in
+  // batches and in the background, unless it's running or done already.
+  void MigrateItems(const AccountKey&) const;
+
   CacheDatabase* db_;
   mutable coro::util::ThreadPool worker_;
+  // Accounts by type and username. Only accessed from the event loop thread.
+  mutable std::set<std::pair<std::string, std::string>> migrating_accounts_;
+  mutable std::set<std::pair<std::string, std::string>> migrated_accounts_;
+  stdx::stop_source stop_source_;
 };
 
 }  // namespace coro::cloudstorage::util
@@ -0,0 +1,123 @@
+#include "coro/cloudstorage/util/change_feed_poller.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/util/stop_token_or.h"
+
+namespace coro::cloudstorage::util {
+
+namespace {
+
+using ::coro::RunTask;
+using ::coro::util::MakeUniqueStopTokenOr;
+
+// Number of failures in a row after which the cursor is assumed to be no
+// longer valid.
+constexpr int kMaxFailureCount = 3;
+// How long after the last successful poll the feed is still trusted.
+constexpr int64_t kMaxFeedAge = 2LL * 60;
+
+// Fetches a page of the changes of `account` and applies them, or starts the
+// feed over if there is none yet or `restart` is set. Returns whether more
+// changes can be fetched right away.
+Task<bool> Poll(CacheManager* cache_manager, const Clock* clock,
+                const CacheManager::AccountKey& account, bool restart,
+                stdx::stop_token stop_token) {
+  int64_t now = clock->Now();
+  auto state = co_await cache_manager->Get(
+      account, CacheManager::ChangeFeedKey{}, stop_token);
+  if (!state || restart) {
+    auto cursor = co_await account.provider->GetChangeCursor(stop_token);
+    co_await cache_manager->ApplyChanges(
+        account, /*changes=*/{},
+        CacheManager::ChangeFeedState{
+            .cursor = std::move(cursor), .start_time = now, .update_time = now},
+        std::move(stop_token));
+    co_return false;
+  }
+  auto page = co_await account.provider->GetChanges(std::move(state->cursor),
+                                                    stop_token);
+  co_await cache_manager->ApplyChanges(
+      account, std::move(page.changes),
+      CacheManager::ChangeFeedState{.cursor = std::move(page.cursor),
+                                    .start_time = state->start_time,
+                                    .update_time = now},
+      std::move(stop_token));
+  co_return page.has_more;
+}
+
+Task<> PollChanges(const coro::util::EventLoop* event_loop,
+                   CacheManager* cache_manager, const Clock* clock,
+                   ChangeFeedPoller::Config config,
+                   CacheManager::AccountKey account,
+                   stdx::stop_token stop_token) {
+  co_await event_loop->Wait(config.start_delay_ms, stop_token);
+  int failure_count = 0;
+  int retry_delay_ms = config.min_retry_delay_ms;
+  while (true) {
+    int delay_ms;
+    try {
+      bool has_more =
+          co_await Poll(cache_manager, clock, account,
+                        /*restart=*/failure_count >= kMaxFailureCount,
+                        stop_token);
+      failure_count = 0;
+      retry_delay_ms = config.min_retry_delay_ms;
+      delay_ms =
+          has_more ? config.request_interval_ms : config.poll_interval_ms;
+    } catch (const InterruptedException&) {
+      throw;
+    } catch (...) {
+      if (stop_token.stop_requested()) {
+        throw InterruptedException();
+      }
+      failure_count++;
+      delay_ms = retry_delay_ms;
+      retry_delay_ms = std::min(retry_delay_ms * 2, config.max_retry_delay_ms);
+    }
+    co_await event_loop->Wait(delay_ms, stop_token);
+  }
+}
+
+}  // namespace
+
+ChangeFeedPoller::ChangeFeedPoller(const coro::util::EventLoop* event_loop,
+                                   CacheManager* cache_manager,
+                                   const Clock* clock, Config config)
+    : event_loop_(event_loop),
+      cache_manager_(cache_manager),
+      clock_(clock),
+      config_(config) {}
+
+ChangeFeedPoller::~ChangeFeedPoller() { stop_source_.request_stop(); }
+
+void ChangeFeedPoller::Add(CacheManager::AccountKey account,
+                           stdx::stop_token stop_token) {
+  if (!account.provider->IsChangeFeedSupported()) {
+    return;
+  }
+  RunTask([event_loop = event_loop_, cache_manager = cache_manager_,
+           clock = clock_, config = config_, account = std::move(account),
+           stop_token = std::move(stop_token),
+           poller_stop_token = stop_source_.get_token()]() -> Task<> {
+    auto stop_token_or =
+        MakeUniqueStopTokenOr(std::move(stop_token), poller_stop_token);
+    try {
+      co_await PollChanges(event_loop, cache_manager, clock, config, account,
+                           stop_token_or->GetToken());
+    } catch (const InterruptedException&) {
+    }
+  });
+}
+
+bool ChangeFeedPoller::IsUpToDate(const CacheManager::ChangeFeedState& state,
+                                  int64_t listing_update_time,
+                                  int64_t current_time) {
+  return listing_update_time >= state.start_time &&
+         current_time - state.update_time <= kMaxFeedAge;
+}
+
+}  // namespace coro::cloudstorage::util
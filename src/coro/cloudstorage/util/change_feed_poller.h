@@ -0,0 +1,58 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_CHANGE_FEED_POLLER_H
+#define CORO_CLOUDSTORAGE_UTIL_CHANGE_FEED_POLLER_H
+
+#include "coro/cloudstorage/util/cache_manager.h"
+#include "coro/cloudstorage/util/clock.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::cloudstorage::util {
+
+// Polls the change feeds of the accounts whose cloud has one and applies the
+// changes to the cached items and listings. If the feed of an account fails
+// repeatedly, e.g. because its cursor expired, it is started over. Must only
+// be used from the event loop thread.
+class ChangeFeedPoller {
+ public:
+  struct Config {
+    // Leaves the startup to the requests of the user.
+    int start_delay_ms = 10 * 1000;
+    int poll_interval_ms = 30 * 1000;
+    // Delay between the pages of a backlog of changes.
+    int request_interval_ms = 1000;
+    int min_retry_delay_ms = 10 * 1000;
+    int max_retry_delay_ms = 10 * 60 * 1000;
+  };
+
+  ChangeFeedPoller(const coro::util::EventLoop* event_loop,
+                   CacheManager* cache_manager, const Clock* clock,
+                   Config config);
+  ChangeFeedPoller(const coro::util::EventLoop* event_loop,
+                   CacheManager* cache_manager, const Clock* clock)
+      : ChangeFeedPoller(event_loop, cache_manager, clock, Config{}) {}
+  ChangeFeedPoller(const ChangeFeedPoller&) = delete;
+  ~ChangeFeedPoller();
+
+  ChangeFeedPoller& operator=(const ChangeFeedPoller&) = delete;
+
+  // Keeps the cache of `account` up to date until `stop_token` is stopped.
+  // Does nothing if the cloud of the account has no change feed.
+  void Add(CacheManager::AccountKey account, stdx::stop_token stop_token);
+
+  // Whether a listing stored at `listing_update_time` is kept up to date by
+  // the feed in `state` and so doesn't have to be listed again.
+  static bool IsUpToDate(const CacheManager::ChangeFeedState& state,
+                         int64_t listing_update_time, int64_t current_time);
+
+ private:
+  const coro::util::EventLoop* event_loop_;
+  CacheManager* cache_manager_;
+  const Clock* clock_;
+  Config config_;
+  stdx::stop_source stop_source_;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_CHANGE_FEED_POLLER_H
@@ -1,5 +1,7 @@
 #include "coro/cloudstorage/util/cloud_factory_context.h"
 
+#include <algorithm>
+
 namespace coro::cloudstorage::util {
 
 using ::coro::http::CurlHttpConfig;
@@ -29,18 +31,39 @@ CloudFactoryContext::CloudFactoryContext(CloudFactoryConfig config)
       cached_http_(http::CacheHttp(config.http_cache_config, &http_)),
       thumbnail_thread_pool_(
           event_loop_, std::thread::hardware_concurrency() / 2, "coro-thumb"),
-      thumbnail_generator_(&thumbnail_thread_pool_, event_loop_),
-      muxer_(event_loop_, &thumbnail_thread_pool_),
+      thumbnail_scheduler_(event_loop_, &thumbnail_thread_pool_,
+                           std::thread::hardware_concurrency() / 2),
+      thumbnail_generator_(&thumbnail_scheduler_, event_loop_),
+      muxer_(event_loop_, &thumbnail_scheduler_),
       random_number_generator_(std::move(config.random_number_generator)),
       cache_(cache_db_.get(), event_loop_),
+      thumbnail_prefetcher_(
+          &thumbnail_generator_, &cache_, &clock_,
+          std::max<int>(1, std::thread::hardware_concurrency() / 4)),
+      transfer_manager_(event_loop_,
+                        /*max_concurrent_uploads_per_account=*/4),
+      metadata_index_(config.cache_path, event_loop_),
+      metadata_indexer_(event_loop_, &metadata_index_, &clock_),
+      change_feed_poller_(event_loop_, &cache_, &clock_),
       factory_(event_loop_, &thread_pool_, &cached_http_, &thumbnail_generator_,
-               &muxer_, &random_number_generator_, config.auth_data),
+               &muxer_, &random_number_generator_, &cache_, config.auth_data),
       settings_manager_(&factory_, std::move(config)) {}
 
 AccountManagerHandler CloudFactoryContext::CreateAccountManagerHandler(
     AccountListener listener) {
-  return {&factory_,           &thumbnail_generator_, &muxer_, &clock_,
-          std::move(listener), &settings_manager_,    &cache_};
+  return {event_loop_,
+          &factory_,
+          &thumbnail_generator_,
+          &muxer_,
+          &clock_,
+          std::move(listener),
+          &settings_manager_,
+          &cache_,
+          &thumbnail_prefetcher_,
+          &transfer_manager_,
+          &metadata_index_,
+          &metadata_indexer_,
+          &change_feed_poller_};
 }
 
 coro::util::TcpServer CloudFactoryContext::CreateHttpServer(
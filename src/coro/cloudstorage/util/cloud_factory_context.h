@@ -5,10 +5,16 @@
 #include "coro/cloudstorage/util/account_manager_handler.h"
 #include "coro/cloudstorage/util/auth_data.h"
 #include "coro/cloudstorage/util/cache_manager.h"
+#include "coro/cloudstorage/util/change_feed_poller.h"
 #include "coro/cloudstorage/util/clock.h"
+#include "coro/cloudstorage/util/metadata_index.h"
+#include "coro/cloudstorage/util/metadata_indexer.h"
 #include "coro/cloudstorage/util/muxer.h"
 #include "coro/cloudstorage/util/random_number_generator.h"
+#include "coro/cloudstorage/util/thread_pool_scheduler.h"
 #include "coro/cloudstorage/util/thumbnail_generator.h"
+#include "coro/cloudstorage/util/thumbnail_prefetcher.h"
+#include "coro/cloudstorage/util/transfer_manager.h"
 #include "coro/http/cache_http.h"
 #include "coro/http/curl_http.h"
 #include "coro/http/http_server.h"
@@ -53,10 +59,16 @@ class CloudFactoryContext {
   http::Http http_;
   http::Http cached_http_;
   coro::util::ThreadPool thumbnail_thread_pool_;
+  util::ThreadPoolScheduler thumbnail_scheduler_;
   util::ThumbnailGenerator thumbnail_generator_;
   util::Muxer muxer_;
   util::RandomNumberGenerator random_number_generator_;
   util::CacheManager cache_;
+  util::ThumbnailPrefetcher thumbnail_prefetcher_;
+  util::TransferManager transfer_manager_;
+  util::MetadataIndex metadata_index_;
+  util::MetadataIndexer metadata_indexer_;
+  util::ChangeFeedPoller change_feed_poller_;
   CloudFactory factory_;
   util::SettingsManager settings_manager_;
   util::Clock clock_;
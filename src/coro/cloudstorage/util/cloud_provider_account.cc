@@ -1,7 +1,12 @@
 #include "coro/cloudstorage/util/cloud_provider_account.h"
 
+#include <iterator>
+#include <unordered_set>
+
+#include "coro/cloudstorage/util/change_feed_poller.h"
 #include "coro/cloudstorage/util/cloud_provider_utils.h"
 #include "coro/cloudstorage/util/generator_utils.h"
+#include "coro/when_all.h"
 
 namespace coro::cloudstorage::util {
 
@@ -10,6 +15,20 @@ namespace {
 using ::coro::RunTask;
 
 constexpr const int64_t kThumbnailTimeToLive = 60LL * 60;
+constexpr const int64_t kGeneralDataTimeToLive = 5LL * 60;
+constexpr const int kMaxSearchResultCount = 1000;
+constexpr const size_t kMaxConcurrentDirectorySizeListings = 4;
+
+AbstractCloudProvider::Thumbnail ToThumbnail(CacheManager::ImageData image_data,
+                                             http::Range range) {
+  int64_t size = static_cast<int64_t>(image_data.image_bytes.size());
+  std::string data(image_data.image_bytes.begin(),
+                   image_data.image_bytes.end());
+  return AbstractCloudProvider::Thumbnail{
+      .data = ToGenerator(Trim(std::move(data), range)),
+      .size = size,
+      .mime_type = std::move(image_data.mime_type)};
+}
 
 Task<> UpdateDirectoryListCache(
     CacheManager::AccountKey account, CacheManager* cache_manager,
@@ -18,7 +37,6 @@ Task<> UpdateDirectoryListCache(
         Promise<std::optional<std::vector<AbstractCloudProvider::Item>>>>
         updated,
     AbstractCloudProvider::Directory directory,
-    std::vector<AbstractCloudProvider::Item> previous,
     stdx::stop_token stop_token) {
   try {
     std::vector<AbstractCloudProvider::Item> items;
@@ -30,16 +48,12 @@ Task<> UpdateDirectoryListCache(
                 std::back_inserter(items));
       page_token = std::move(page_data.next_page_token);
     } while (page_token);
-    if (!std::equal(items.begin(), items.end(), previous.begin(),
-                    previous.end(), [&](const auto& item1, const auto& item2) {
-                      return account.provider->ToJson(item1) ==
-                             account.provider->ToJson(item2);
-                    })) {
-      co_await cache_manager->Put(
-          std::move(account),
-          CacheManager::DirectoryContent{
-              .parent = directory, .items = items, .update_time = current_time},
-          std::move(stop_token));
+    if (co_await cache_manager->Put(
+            std::move(account),
+            CacheManager::DirectoryContent{.parent = std::move(directory),
+                                           .items = items,
+                                           .update_time = current_time},
+            std::move(stop_token))) {
       updated->SetValue(std::move(items));
     } else {
       updated->SetValue(std::nullopt);
@@ -49,6 +63,29 @@ Task<> UpdateDirectoryListCache(
   }
 }
 
+// Lists the whole `directory` and stores the listing in the cache.
+Task<std::vector<AbstractCloudProvider::Item>> ListAndCacheDirectory(
+    CacheManager::AccountKey account, CacheManager* cache_manager,
+    int64_t current_time, AbstractCloudProvider::Directory directory,
+    stdx::stop_token stop_token) {
+  std::vector<AbstractCloudProvider::Item> items;
+  std::optional<std::string> page_token;
+  do {
+    auto page_data = co_await account.provider->ListDirectoryPage(
+        directory, std::move(page_token), stop_token);
+    std::move(page_data.items.begin(), page_data.items.end(),
+              std::back_inserter(items));
+    page_token = std::move(page_data.next_page_token);
+  } while (page_token);
+  co_await cache_manager->Put(
+      std::move(account),
+      CacheManager::DirectoryContent{.parent = std::move(directory),
+                                     .items = items,
+                                     .update_time = current_time},
+      std::move(stop_token));
+  co_return items;
+}
+
 }  // namespace
 
 Task<VersionedDirectoryContent> CloudProviderAccount::ListDirectory(
@@ -62,9 +99,10 @@ Task<VersionedDirectoryContent> CloudProviderAccount::ListDirectory(
       Promise<std::optional<std::vector<AbstractCloudProvider::Item>>>>();
   if (!cached) {
     auto generator =
-        [](auto* cache_manager, auto current_time, auto updated, auto account,
-           auto directory,
-           auto stop_token) -> Generator<AbstractCloudProvider::PageData> {
+        [](auto* cache_manager, auto* thumbnail_prefetcher, auto current_time,
+           auto updated, auto account, auto directory, auto stop_token,
+           auto account_stop_token)
+        -> Generator<AbstractCloudProvider::PageData> {
       std::optional<std::string> page_token;
       std::vector<AbstractCloudProvider::Item> items;
       try {
@@ -76,6 +114,8 @@ Task<VersionedDirectoryContent> CloudProviderAccount::ListDirectory(
           co_yield page_data;
           page_token = std::move(page_data.next_page_token);
         } while (page_token);
+        thumbnail_prefetcher->Enqueue(account, items,
+                                      std::move(account_stop_token));
         co_await cache_manager->Put(
             std::move(account),
             CacheManager::DirectoryContent{.parent = std::move(directory),
@@ -87,14 +127,27 @@ Task<VersionedDirectoryContent> CloudProviderAccount::ListDirectory(
         updated->SetException(std::current_exception());
         throw;
       }
-    }(cache_manager_, current_time, updated, account_key(),
-                            std::move(directory), std::move(stop_token));
+    }(cache_manager_, thumbnail_prefetcher_, current_time, updated,
+                            account_key(), std::move(directory),
+                            std::move(stop_token), stop_source_.get_token());
     co_return VersionedDirectoryContent{std::move(generator), current_time,
                                         std::move(updated)};
   } else {
-    RunTask(UpdateDirectoryListCache, account_key(), cache_manager_,
-            current_time, updated, std::move(directory), cached->items,
-            stop_source_.get_token());
+    thumbnail_prefetcher_->Enqueue(account_key(), cached->items,
+                                   stop_source_.get_token());
+    std::optional<CacheManager::ChangeFeedState> change_feed;
+    if (provider_->IsChangeFeedSupported()) {
+      change_feed = co_await cache_manager_->Get(
+          account_key(), CacheManager::ChangeFeedKey{}, stop_token);
+    }
+    if (change_feed && ChangeFeedPoller::IsUpToDate(
+                           *change_feed, cached->update_time, current_time)) {
+      updated->SetValue(std::nullopt);
+    } else {
+      RunTask(UpdateDirectoryListCache, account_key(), cache_manager_,
+              current_time, updated, std::move(directory),
+              stop_source_.get_token());
+    }
     co_return VersionedDirectoryContent{
         .content =
             [](auto items) -> Generator<AbstractCloudProvider::PageData> {
@@ -105,6 +158,44 @@ Task<VersionedDirectoryContent> CloudProviderAccount::ListDirectory(
   }
 }
 
+Generator<AbstractCloudProvider::PageData> CloudProviderAccount::SearchItems(
+    std::string query, stdx::stop_token stop_token) const {
+  if (provider_->IsSearchSupported()) {
+    std::optional<std::string> page_token;
+    size_t remaining = kMaxSearchResultCount;
+    do {
+      auto page_data =
+          co_await provider_->SearchItemsPage(query, page_token, stop_token);
+      page_token = std::move(page_data.next_page_token);
+      if (page_data.items.size() >= remaining) {
+        page_data.items.erase(page_data.items.begin() + remaining,
+                              page_data.items.end());
+        page_token = std::nullopt;
+      }
+      remaining -= page_data.items.size();
+      co_yield std::move(page_data);
+    } while (page_token);
+  } else if (auto state =
+                 co_await metadata_index_->GetCrawlState(account_key(),
+                                                         stop_token);
+             state && (state->complete || state->generation > 1)) {
+    AbstractCloudProvider::PageData page_data;
+    for (auto& entry : co_await metadata_index_->Search(
+             {account_key()},
+             MetadataIndex::Query{.text = std::move(query),
+                                  .limit = kMaxSearchResultCount},
+             std::move(stop_token))) {
+      page_data.items.emplace_back(std::move(entry.item));
+    }
+    co_yield std::move(page_data);
+  } else {
+    co_yield AbstractCloudProvider::PageData{
+        .items = co_await cache_manager_->SearchItems(
+            account_key(), std::move(query), kMaxSearchResultCount,
+            std::move(stop_token))};
+  }
+}
+
 Task<VersionedItem> CloudProviderAccount::GetItemById(
     std::string id, stdx::stop_token stop_token) const {
   auto current_time = clock_->Now();
@@ -155,6 +246,164 @@ Task<VersionedItem> CloudProviderAccount::GetItemById(
   }
 }
 
+Task<CacheManager::DirectorySize> CloudProviderAccount::GetDirectorySize(
+    AbstractCloudProvider::Directory directory,
+    stdx::stop_token stop_token) const {
+  if (auto cached = co_await cache_manager_->Get(
+          account_key(), CacheManager::DirectorySizeKey{directory.id},
+          stop_token)) {
+    co_return *cached;
+  }
+  struct ListedDirectory {
+    std::string id;
+    int64_t size = 0;
+    int64_t file_count = 0;
+    std::vector<std::string> subdirectory_ids;
+  };
+  int64_t current_time = clock_->Now();
+  std::string root_id = directory.id;
+  std::unordered_map<std::string, CacheManager::DirectorySize> sizes;
+  // Parents always come before their subdirectories.
+  std::vector<ListedDirectory> listed;
+  std::unordered_set<std::string> visited{root_id};
+  std::vector<AbstractCloudProvider::Directory> pending{std::move(directory)};
+  while (!pending.empty()) {
+    std::vector<Task<std::vector<AbstractCloudProvider::Item>>> tasks;
+    std::vector<std::string> ids;
+    while (!pending.empty() &&
+           tasks.size() < kMaxConcurrentDirectorySizeListings) {
+      ids.emplace_back(pending.back().id);
+      tasks.emplace_back(ListAndCacheDirectory(account_key(), cache_manager_,
+                                               current_time,
+                                               std::move(pending.back()),
+                                               stop_token));
+      pending.pop_back();
+    }
+    auto results = co_await WhenAll(std::move(tasks));
+    std::vector<AbstractCloudProvider::Directory> found;
+    for (size_t i = 0; i < results.size(); i++) {
+      ListedDirectory& entry =
+          listed.emplace_back(ListedDirectory{.id = std::move(ids[i])});
+      for (auto& item : results[i]) {
+        if (auto* file = std::get_if<AbstractCloudProvider::File>(&item)) {
+          entry.size += file->size.value_or(0);
+          entry.file_count++;
+        } else {
+          auto& subdirectory =
+              std::get<AbstractCloudProvider::Directory>(item);
+          entry.subdirectory_ids.emplace_back(subdirectory.id);
+          if (visited.insert(subdirectory.id).second) {
+            found.emplace_back(std::move(subdirectory));
+          }
+        }
+      }
+    }
+    std::vector<std::string> found_ids;
+    for (const auto& d : found) {
+      found_ids.emplace_back(d.id);
+    }
+    auto cached = co_await cache_manager_->GetDirectorySizes(
+        account_key(), std::move(found_ids), stop_token);
+    for (auto& d : found) {
+      if (auto it = cached.find(d.id); it != cached.end()) {
+        sizes.emplace(d.id, it->second);
+      } else {
+        pending.emplace_back(std::move(d));
+      }
+    }
+  }
+  std::vector<std::pair<CacheManager::DirectorySizeKey,
+                        CacheManager::DirectorySize>>
+      computed;
+  for (auto it = listed.rbegin(); it != listed.rend(); it++) {
+    CacheManager::DirectorySize size{.size = it->size,
+                                     .file_count = it->file_count,
+                                     .update_time = current_time};
+    for (const auto& id : it->subdirectory_ids) {
+      // Missing only if the tree has a cycle.
+      if (auto s = sizes.find(id); s != sizes.end()) {
+        size.size += s->second.size;
+        size.file_count += s->second.file_count;
+      }
+    }
+    sizes.insert_or_assign(it->id, size);
+    computed.emplace_back(CacheManager::DirectorySizeKey{std::move(it->id)},
+                          size);
+  }
+  co_await cache_manager_->Put(account_key(), std::move(computed),
+                               std::move(stop_token));
+  co_return sizes.at(root_id);
+}
+
+Task<std::unordered_map<std::string, CacheManager::DirectorySize>>
+CloudProviderAccount::GetCachedDirectorySizes(
+    std::vector<std::string> directory_ids, stdx::stop_token stop_token) const {
+  return cache_manager_->GetDirectorySizes(
+      account_key(), std::move(directory_ids), std::move(stop_token));
+}
+
+Task<AbstractCloudProvider::GeneralData> CloudProviderAccount::GetGeneralData(
+    stdx::stop_token stop_token) const {
+  GeneralDataCache& cache = *general_data_;
+  bool up_to_date = cache.data_generation == cache.generation &&
+                    clock_->Now() - cache.update_time <= kGeneralDataTimeToLive;
+  if (cache.data && up_to_date) {
+    co_return *cache.data;
+  }
+  bool started = false;
+  if (!cache.refresh) {
+    cache.refresh.emplace(
+        GeneralDataCache::Refresh{.provider = provider_,
+                                  .cache = general_data_,
+                                  .clock = clock_,
+                                  .generation = cache.generation,
+                                  .stop_token = stop_source_.get_token()});
+    started = true;
+  }
+  if (cache.data) {
+    if (started) {
+      RunTask([cache = general_data_,
+               stop_token = stop_source_.get_token()]() -> Task<> {
+        try {
+          if (cache->refresh) {
+            co_await cache->refresh->Get(stop_token);
+          }
+        } catch (...) {
+        }
+      });
+    }
+    co_return *cache.data;
+  }
+  co_return co_await cache.refresh->Get(std::move(stop_token));
+}
+
+void CloudProviderAccount::InvalidateGeneralData() const {
+  general_data_->generation++;
+}
+
+Task<AbstractCloudProvider::GeneralData>
+CloudProviderAccount::GeneralDataCache::Refresh::operator()() const {
+  std::optional<AbstractCloudProvider::GeneralData> data;
+  std::exception_ptr exception;
+  try {
+    data = co_await provider->GetGeneralData(stop_token);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+  if (auto d = cache.lock(); d && !stop_token.stop_requested()) {
+    d->refresh = std::nullopt;
+    if (data) {
+      d->data = *data;
+      d->update_time = clock->Now();
+      d->data_generation = generation;
+    }
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+  co_return std::move(*data);
+}
+
 template <typename Item>
 Task<VersionedThumbnail> CloudProviderAccount::GetItemThumbnailWithFallback(
     Item item, ThumbnailQuality quality, http::Range range,
@@ -170,68 +419,46 @@ Task<VersionedThumbnail> CloudProviderAccount::GetItemThumbnailWithFallback(
       RunTask([account_key = account_key(),
                thumbnail_generator = thumbnail_generator_,
                cache_manager = cache_manager_, current_time,
-               provider = provider_, item = std::move(item), quality, range,
+               item = std::move(item), quality, range,
                stop_token = stop_source_.get_token(),
                updated]() mutable -> Task<> {
         try {
-          AbstractCloudProvider::Thumbnail thumbnail =
-              co_await ::coro::cloudstorage::util::GetItemThumbnailWithFallback(
-                  thumbnail_generator, provider.get(), item, quality,
-                  http::Range{}, stop_token);
-          auto image_bytes = co_await http::GetBody(std::move(thumbnail.data));
-          CacheManager::ImageData image_data{
-              .image_bytes =
-                  std::vector<char>(image_bytes.begin(), image_bytes.end()),
-              .mime_type = thumbnail.mime_type,
-              .update_time = current_time};
-          co_await cache_manager->Put(std::move(account_key),
-                                      CacheManager::ImageKey{item.id, quality},
-                                      image_data, std::move(stop_token));
-          int64_t size = static_cast<int64_t>(image_data.image_bytes.size());
-          std::string data(image_data.image_bytes.begin(),
-                           image_data.image_bytes.end());
-          updated->SetValue(AbstractCloudProvider::Thumbnail{
-              .data = ToGenerator(Trim(std::move(data), range)),
-              .size = size,
-              .mime_type = std::move(image_data.mime_type)});
+          CacheManager::ImageData image_data = co_await FetchAndCacheThumbnail(
+              thumbnail_generator, cache_manager, std::move(account_key),
+              std::move(item), quality, current_time, std::move(stop_token));
+          updated->SetValue(ToThumbnail(std::move(image_data), range));
         } catch (...) {
           updated->SetException(std::current_exception());
         }
       });
     }
-    int64_t size = static_cast<int64_t>(image_data->image_bytes.size());
-    std::string data(image_data->image_bytes.begin(),
-                     image_data->image_bytes.end());
     updated->SetValue(std::nullopt);
+    int64_t update_time = image_data->update_time;
     co_return VersionedThumbnail{
-        .thumbnail =
-            AbstractCloudProvider::Thumbnail{
-                .data = ToGenerator(Trim(std::move(data), range)),
-                .size = size,
-                .mime_type = std::move(image_data->mime_type)},
-        .update_time = image_data->update_time,
+        .thumbnail = ToThumbnail(std::move(*image_data), range),
+        .update_time = update_time,
         .updated = std::move(updated)};
   }
   try {
-    AbstractCloudProvider::Thumbnail thumbnail =
-        co_await ::coro::cloudstorage::util::GetItemThumbnailWithFallback(
-            thumbnail_generator_, provider_.get(), item, quality, http::Range{},
-            stop_token);
-    auto image_bytes = co_await http::GetBody(std::move(thumbnail.data));
-    co_await cache_manager_->Put(
-        account_key(), CacheManager::ImageKey{item.id, quality},
-        CacheManager::ImageData{.image_bytes = std::vector<char>(
-                                    image_bytes.begin(), image_bytes.end()),
-                                .mime_type = thumbnail.mime_type,
-                                .update_time = current_time},
-        std::move(stop_token));
+    if constexpr (std::is_same_v<Item, AbstractCloudProvider::File>) {
+      if (quality == ThumbnailQuality::kLow) {
+        if (auto prefetched = co_await thumbnail_prefetcher_->Claim(
+                account_key(), item, stop_token)) {
+          updated->SetValue(std::nullopt);
+          int64_t update_time = prefetched->update_time;
+          co_return VersionedThumbnail{
+              .thumbnail = ToThumbnail(std::move(*prefetched), range),
+              .update_time = update_time,
+              .updated = std::move(updated)};
+        }
+      }
+    }
+    CacheManager::ImageData image_data = co_await FetchAndCacheThumbnail(
+        thumbnail_generator_, cache_manager_, account_key(), std::move(item),
+        quality, current_time, std::move(stop_token));
     updated->SetValue(std::nullopt);
     co_return VersionedThumbnail{
-        .thumbnail =
-            AbstractCloudProvider::Thumbnail{
-                .data = ToGenerator(Trim(std::move(image_bytes), range)),
-                .size = thumbnail.size,
-                .mime_type = std::move(thumbnail.mime_type)},
+        .thumbnail = ToThumbnail(std::move(image_data), range),
         .update_time = current_time,
         .updated = updated};
   } catch (...) {
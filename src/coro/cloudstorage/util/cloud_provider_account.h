@@ -5,12 +5,17 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "coro/cloudstorage/util/abstract_cloud_provider.h"
 #include "coro/cloudstorage/util/cache_manager.h"
 #include "coro/cloudstorage/util/clock.h"
+#include "coro/cloudstorage/util/metadata_index.h"
 #include "coro/cloudstorage/util/string_utils.h"
 #include "coro/cloudstorage/util/thumbnail_generator.h"
+#include "coro/cloudstorage/util/thumbnail_prefetcher.h"
+#include "coro/shared_promise.h"
 #include "coro/stdx/stop_source.h"
 #include "coro/stdx/stop_token.h"
 #include "coro/util/type_list.h"
@@ -49,6 +54,23 @@ class CloudProviderAccount {
     }
   };
 
+  CloudProviderAccount(std::string username, int64_t version,
+                       std::unique_ptr<AbstractCloudProvider> account,
+                       CacheManager* cache_manager, const Clock* clock,
+                       const ThumbnailGenerator* thumbnail_generator,
+                       ThumbnailPrefetcher* thumbnail_prefetcher,
+                       const MetadataIndex* metadata_index)
+      : username_(std::move(username)),
+        version_(version),
+        type_(account->GetId()),
+        provider_(std::move(account)),
+        cache_manager_(cache_manager),
+        clock_(clock),
+        thumbnail_generator_(thumbnail_generator),
+        thumbnail_prefetcher_(thumbnail_prefetcher),
+        metadata_index_(metadata_index),
+        general_data_(std::make_shared<GeneralDataCache>()) {}
+
   std::string_view type() const { return type_; }
   Id id() const { return {type_, std::string(username())}; }
   std::string_view username() const { return username_; }
@@ -56,29 +78,65 @@ class CloudProviderAccount {
   const auto& provider() const { return provider_; }
   stdx::stop_token stop_token() const { return stop_source_.get_token(); }
 
+  // Returns the cached listing of the directory if there is one and refreshes
+  // it in the background, unless the change feed of the account keeps it up
+  // to date.
   Task<VersionedDirectoryContent> ListDirectory(
       AbstractCloudProvider::Directory, stdx::stop_token) const;
 
   Task<VersionedItem> GetItemById(std::string id,
                                   stdx::stop_token stop_token) const;
 
+  // Yields pages of the items whose name contains `query`, 1000 items at most.
+  // Uses the search of the cloud if it has one, the metadata index once the
+  // account has been fully crawled and the metadata cache otherwise.
+  Generator<AbstractCloudProvider::PageData> SearchItems(
+      std::string query, stdx::stop_token stop_token) const;
+
+  // Returns the total size and number of the files under `directory`. Uses
+  // the stored sizes where it can and lists the rest of the tree, a few
+  // directories at a time.
+  Task<CacheManager::DirectorySize> GetDirectorySize(
+      AbstractCloudProvider::Directory directory,
+      stdx::stop_token stop_token) const;
+
+  // Returns the sizes of those of `directory_ids` which are known without
+  // listing anything.
+  Task<std::unordered_map<std::string, CacheManager::DirectorySize>>
+  GetCachedDirectorySizes(std::vector<std::string> directory_ids,
+                          stdx::stop_token stop_token) const;
+
   template <typename Item>
   Task<VersionedThumbnail> GetItemThumbnailWithFallback(Item, ThumbnailQuality,
                                                         http::Range,
                                                         stdx::stop_token) const;
 
+  // Returns the cached quota of the account. Once it is out of date it is
+  // still returned immediately while a single refresh runs in the background.
+  Task<AbstractCloudProvider::GeneralData> GetGeneralData(
+      stdx::stop_token) const;
+
+  // Marks the cached quota as out of date, e.g. after an upload or a delete.
+  void InvalidateGeneralData() const;
+
  private:
-  CloudProviderAccount(std::string username, int64_t version,
-                       std::unique_ptr<AbstractCloudProvider> account,
-                       CacheManager* cache_manager, const Clock* clock,
-                       const ThumbnailGenerator* thumbnail_generator)
-      : username_(std::move(username)),
-        version_(version),
-        type_(account->GetId()),
-        provider_(std::move(account)),
-        cache_manager_(cache_manager),
-        clock_(clock),
-        thumbnail_generator_(thumbnail_generator) {}
+  struct GeneralDataCache {
+    struct Refresh {
+      Task<AbstractCloudProvider::GeneralData> operator()() const;
+
+      std::shared_ptr<AbstractCloudProvider> provider;
+      std::weak_ptr<GeneralDataCache> cache;
+      const Clock* clock;
+      int64_t generation;
+      stdx::stop_token stop_token;
+    };
+
+    std::optional<AbstractCloudProvider::GeneralData> data;
+    int64_t update_time = 0;
+    int64_t data_generation = 0;
+    int64_t generation = 0;
+    std::optional<SharedPromise<Refresh>> refresh;
+  };
 
   friend class AccountManagerHandler;
 
@@ -93,6 +151,9 @@ class CloudProviderAccount {
   CacheManager* cache_manager_;
   const Clock* clock_;
   const ThumbnailGenerator* thumbnail_generator_;
+  ThumbnailPrefetcher* thumbnail_prefetcher_;
+  const MetadataIndex* metadata_index_;
+  std::shared_ptr<GeneralDataCache> general_data_;
   stdx::stop_source stop_source_;
 };
 
@@ -8,6 +8,9 @@ namespace {
 
 using Item = AbstractCloudProvider::Item;
 
+constexpr ThumbnailQuality kThumbnailQualities[] = {ThumbnailQuality::kLow,
+                                                    ThumbnailQuality::kHigh};
+
 Task<Item> GetItemByPathComponents(
     const AbstractCloudProvider* p,
     AbstractCloudProvider::Directory current_directory,
@@ -51,22 +54,47 @@ Task<Item> GetItemByPath(const AbstractCloudProvider* d,
       std::move(stop_token));
 }
 
-Task<std::string> GenerateThumbnail(
-    const ThumbnailGenerator* thumbnail_generator,
-    const AbstractCloudProvider* provider, AbstractCloudProvider::File item,
-    stdx::stop_token stop_token) {
+// Both levels get the same picture; renditions of the same options are encoded
+// only once.
+ThumbnailOptions GetThumbnailOptions(ThumbnailQuality quality) {
+  switch (quality) {
+    case ThumbnailQuality::kLow:
+    case ThumbnailQuality::kHigh:
+      return {.size = 256, .codec = ThumbnailOptions::Codec::PNG};
+  }
+  throw RuntimeError("invalid thumbnail quality");
+}
+
+std::string GetMimeType(ThumbnailOptions::Codec codec) {
+  switch (codec) {
+    case ThumbnailOptions::Codec::PNG:
+      return "image/png";
+    case ThumbnailOptions::Codec::JPEG:
+      return "image/jpeg";
+  }
+  throw RuntimeError("invalid thumbnail codec");
+}
+
+void CheckThumbnailSupported(const AbstractCloudProvider::File& item) {
   switch (GetFileType(item.mime_type)) {
     case FileType::kImage:
     case FileType::kVideo:
-      return (*thumbnail_generator)(
-          provider, std::move(item),
-          ThumbnailOptions{.codec = ThumbnailOptions::Codec::PNG},
-          std::move(stop_token));
+      return;
     default:
       throw CloudException(CloudException::Type::kNotFound);
   }
 }
 
+Task<std::string> GenerateThumbnail(
+    const ThumbnailGenerator* thumbnail_generator,
+    const AbstractCloudProvider* provider, AbstractCloudProvider::File item,
+    ThumbnailQuality quality, stdx::stop_token stop_token) {
+  CheckThumbnailSupported(item);
+  co_return co_await (*thumbnail_generator)(provider, std::move(item),
+                                            GetThumbnailOptions(quality),
+                                            std::move(stop_token));
+}
+
 Task<AbstractCloudProvider::Thumbnail> GetThumbnail(
     const ThumbnailGenerator* thumbnail_generator,
     const AbstractCloudProvider* provider, AbstractCloudProvider::File file,
@@ -77,12 +105,67 @@ Task<AbstractCloudProvider::Thumbnail> GetThumbnail(
   } catch (...) {
   }
   std::string image_bytes = co_await GenerateThumbnail(
-      thumbnail_generator, provider, file, std::move(stop_token));
+      thumbnail_generator, provider, file, quality, std::move(stop_token));
   int64_t size = image_bytes.size();
   co_return AbstractCloudProvider::Thumbnail{
       .data = ToGenerator(Trim(std::move(image_bytes), range)),
       .size = size,
-      .mime_type = "image/png"};
+      .mime_type = GetMimeType(GetThumbnailOptions(quality).codec)};
+}
+
+// A generated thumbnail is rendered for all quality levels out of a single
+// decode, and all of them are stored. With `keyframe_only`, the frame is taken
+// from the first keyframe after the seek point instead, for every level alike.
+Task<CacheManager::ImageData> FetchAndCacheFileThumbnail(
+    const ThumbnailGenerator* thumbnail_generator, CacheManager* cache_manager,
+    CacheManager::AccountKey account, AbstractCloudProvider::File file,
+    ThumbnailQuality quality, bool keyframe_only, int64_t update_time,
+    stdx::stop_token stop_token) {
+  std::vector<std::pair<CacheManager::ImageKey, CacheManager::ImageData>>
+      images;
+  try {
+    auto thumbnail = co_await account.provider->GetItemThumbnail(
+        file, quality, http::Range{}, stop_token);
+    auto image_bytes = co_await http::GetBody(std::move(thumbnail.data));
+    images.emplace_back(
+        CacheManager::ImageKey{.item_id = file.id, .quality = quality},
+        CacheManager::ImageData{
+            .image_bytes =
+                std::vector<char>(image_bytes.begin(), image_bytes.end()),
+            .mime_type = std::move(thumbnail.mime_type),
+            .update_time = update_time});
+  } catch (...) {
+  }
+  if (images.empty()) {
+    CheckThumbnailSupported(file);
+    std::vector<ThumbnailQuality> qualities = {quality};
+    for (ThumbnailQuality q : kThumbnailQualities) {
+      if (q != quality) {
+        qualities.push_back(q);
+      }
+    }
+    std::vector<ThumbnailOptions> renditions;
+    for (ThumbnailQuality q : qualities) {
+      ThumbnailOptions options = GetThumbnailOptions(q);
+      options.keyframe_only = keyframe_only;
+      renditions.push_back(options);
+    }
+    std::vector<std::string> thumbnails = co_await (*thumbnail_generator)(
+        account.provider.get(), file, renditions, stop_token);
+    for (size_t i = 0; i < thumbnails.size(); i++) {
+      images.emplace_back(
+          CacheManager::ImageKey{.item_id = file.id, .quality = qualities[i]},
+          CacheManager::ImageData{
+              .image_bytes =
+                  std::vector<char>(thumbnails[i].begin(), thumbnails[i].end()),
+              .mime_type = GetMimeType(renditions[i].codec),
+              .update_time = update_time});
+    }
+  }
+  CacheManager::ImageData requested = images[0].second;
+  co_await cache_manager->Put(std::move(account), std::move(images),
+                              std::move(stop_token));
+  co_return requested;
 }
 
 }  // namespace
@@ -132,6 +215,50 @@ GetItemThumbnailWithFallback<AbstractCloudProvider::Directory>(
                                     std::move(stop_token));
 }
 
+template <>
+Task<CacheManager::ImageData>
+FetchAndCacheThumbnail<AbstractCloudProvider::File>(
+    const ThumbnailGenerator* thumbnail_generator, CacheManager* cache_manager,
+    CacheManager::AccountKey account, AbstractCloudProvider::File file,
+    ThumbnailQuality quality, int64_t update_time,
+    stdx::stop_token stop_token) {
+  return FetchAndCacheFileThumbnail(
+      thumbnail_generator, cache_manager, std::move(account), std::move(file),
+      quality, /*keyframe_only=*/false, update_time, std::move(stop_token));
+}
+
+template <>
+Task<CacheManager::ImageData>
+FetchAndCacheThumbnail<AbstractCloudProvider::Directory>(
+    const ThumbnailGenerator*, CacheManager* cache_manager,
+    CacheManager::AccountKey account,
+    AbstractCloudProvider::Directory directory, ThumbnailQuality quality,
+    int64_t update_time, stdx::stop_token stop_token) {
+  auto thumbnail = co_await account.provider->GetItemThumbnail(
+      directory, quality, http::Range{}, stop_token);
+  auto image_bytes = co_await http::GetBody(std::move(thumbnail.data));
+  CacheManager::ImageData image_data{
+      .image_bytes = std::vector<char>(image_bytes.begin(), image_bytes.end()),
+      .mime_type = std::move(thumbnail.mime_type),
+      .update_time = update_time};
+  co_await cache_manager->Put(
+      std::move(account),
+      CacheManager::ImageKey{.item_id = std::move(directory.id),
+                             .quality = quality},
+      image_data, std::move(stop_token));
+  co_return image_data;
+}
+
+Task<CacheManager::ImageData> PrefetchThumbnail(
+    const ThumbnailGenerator* thumbnail_generator, CacheManager* cache_manager,
+    CacheManager::AccountKey account, AbstractCloudProvider::File file,
+    int64_t update_time, stdx::stop_token stop_token) {
+  return FetchAndCacheFileThumbnail(
+      thumbnail_generator, cache_manager, std::move(account), std::move(file),
+      ThumbnailQuality::kLow, /*keyframe_only=*/true, update_time,
+      std::move(stop_token));
+}
+
 Task<AbstractCloudProvider::Item> GetItemById(
     const AbstractCloudProvider* provider, std::string id,
     stdx::stop_token stop_token) {
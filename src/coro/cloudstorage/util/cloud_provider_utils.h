@@ -62,6 +62,36 @@ GetItemThumbnailWithFallback<AbstractCloudProvider::Directory>(
     AbstractCloudProvider::Directory, ThumbnailQuality, http::Range,
     stdx::stop_token);
 
+// Fetches the thumbnail from the provider, falling back to generating it, and
+// stores it in the cache. A generated thumbnail is rendered in all quality
+// levels out of a single decode, and all of them are stored.
+template <typename Item>
+Task<CacheManager::ImageData> FetchAndCacheThumbnail(
+    const ThumbnailGenerator*, CacheManager*, CacheManager::AccountKey, Item,
+    ThumbnailQuality, int64_t update_time, stdx::stop_token) = delete;
+
+template <>
+Task<CacheManager::ImageData>
+FetchAndCacheThumbnail<AbstractCloudProvider::File>(
+    const ThumbnailGenerator*, CacheManager*, CacheManager::AccountKey,
+    AbstractCloudProvider::File, ThumbnailQuality, int64_t update_time,
+    stdx::stop_token);
+
+template <>
+Task<CacheManager::ImageData>
+FetchAndCacheThumbnail<AbstractCloudProvider::Directory>(
+    const ThumbnailGenerator*, CacheManager*, CacheManager::AccountKey,
+    AbstractCloudProvider::Directory, ThumbnailQuality, int64_t update_time,
+    stdx::stop_token);
+
+// Like `FetchAndCacheThumbnail` for the low quality level, but a generated
+// thumbnail is taken from the first keyframe after the seek point instead of
+// out of a couple hundred decoded frames, and is cached for every quality
+// level. Meant for thumbnails generated ahead of time.
+Task<CacheManager::ImageData> PrefetchThumbnail(
+    const ThumbnailGenerator*, CacheManager*, CacheManager::AccountKey,
+    AbstractCloudProvider::File, int64_t update_time, stdx::stop_token);
+
 template <typename T>
 struct TypedItemId {
   enum class Type { kFile, kDirectory } type;
@@ -3,15 +3,13 @@
 #include <fmt/format.h>
 
 #include "coro/cloudstorage/util/assets.h"
+#include "coro/cloudstorage/util/handler_utils.h"
 #include "coro/cloudstorage/util/string_utils.h"
-#include "coro/util/regex.h"
 
 namespace coro::cloudstorage::util {
 
 namespace {
 
-namespace re = coro::util::re;
-
 Generator<std::string> GetDashPlayer(std::string path,
                                      std::string thumbnail_url) {
   co_yield fmt::format(fmt::runtime(kDashPlayerHtml),
@@ -24,13 +22,11 @@ Generator<std::string> GetDashPlayer(std::string path,
 Task<http::Response<>> DashHandler::operator()(
     http::Request<> request, stdx::stop_token stop_token) const {
   auto uri = http::ParseUri(request.url);
-  re::smatch results;
-  if (!re::regex_match(uri.path.value(), results,
-                       re::regex(R"(\/dash\/[^\/]+\/[^\/]+\/(.*)$)"))) {
+  auto item_path = GetAccountItemPath(uri.path.value(), "dash");
+  if (!item_path) {
     co_return http::Response<>{.status = 400};
   }
-  std::string item_id = http::DecodeUri(
-      http::DecodeUri(ToStringView(results[1].begin(), results[1].end())));
+  std::string item_id = http::DecodeUri(http::DecodeUri(*item_path));
 
   co_return http::Response<>{
       .status = 200,
@@ -2,12 +2,15 @@
 
 #include <duktape.h>
 
+#include <list>
 #include <memory>
+#include <mutex>
 #include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "coro/exception.h"
 
@@ -25,33 +28,118 @@ class JsException : public RuntimeError {
                      std::move(stacktrace)) {}
 };
 
+constexpr size_t kMaxPooledContextCount = 8;
+
 struct DukHeapDeleter {
   void operator()(duk_context* ctx) const { duk_destroy_heap(ctx); }
 };
 
-}  // namespace
+using DukContext = std::unique_ptr<duk_context, DukHeapDeleter>;
 
-std::string EvaluateJavascript(const Function& function,
-                               std::span<const std::string> arguments) {
-  std::unique_ptr<duk_context, DukHeapDeleter> ctx(duk_create_heap_default());
+// Everything that goes into the compiled function, so that a heap is never
+// reused for different code.
+struct FunctionKey {
+  std::string name;
+  std::vector<std::string> args;
+  std::string source;
+
+  bool operator==(const FunctionKey&) const = default;
+};
+
+FunctionKey GetFunctionKey(const Function& function) {
+  return FunctionKey{
+      .name = function.name, .args = function.args, .source = function.source};
+}
+
+// Creates a heap with `function` compiled and stored as the global `decode`.
+DukContext CreateContext(const Function& function) {
+  DukContext ctx(duk_create_heap_default());
   if (!ctx) {
     throw JsException("Can't alloc duk_context.");
   }
   std::stringstream source_code;
-  source_code << "{";
+  source_code << "var decode=function(";
   for (size_t i = 0; i < function.args.size(); i++) {
-    source_code << "var " << function.args[i] << "=\"" << arguments[i]
-                << "\";\n";
+    source_code << (i > 0 ? "," : "") << function.args[i];
   }
-  source_code << "function decode()" << function.source << "};decode()";
+  source_code << ")" << function.source;
   if (duk_peval_string(ctx.get(), std::move(source_code).str().c_str()) != 0) {
     throw JsException(duk_safe_to_string(ctx.get(), -1));
   }
+  duk_pop(ctx.get());
+  return ctx;
+}
+
+// Idle heaps with their function already compiled, most recently used first.
+// A heap is only ever used by one thread at a time: it is removed from the
+// pool for the duration of a call and returned afterwards.
+class ContextPool {
+ public:
+  DukContext Acquire(const FunctionKey& key) {
+    std::unique_lock lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->key == key) {
+        DukContext ctx = std::move(it->ctx);
+        entries_.erase(it);
+        return ctx;
+      }
+    }
+    return nullptr;
+  }
+
+  void Release(FunctionKey key, DukContext ctx) {
+    std::unique_lock lock(mutex_);
+    entries_.push_front(Entry{.key = std::move(key), .ctx = std::move(ctx)});
+    if (entries_.size() > kMaxPooledContextCount) {
+      entries_.pop_back();
+    }
+  }
+
+ private:
+  struct Entry {
+    FunctionKey key;
+    DukContext ctx;
+  };
+
+  std::mutex mutex_;
+  std::list<Entry> entries_;
+};
+
+ContextPool& GetContextPool() {
+  static ContextPool* pool = new ContextPool;
+  return *pool;
+}
+
+}  // namespace
+
+std::string EvaluateJavascript(const Function& function,
+                               std::span<const std::string> arguments) {
+  FunctionKey key = GetFunctionKey(function);
+  DukContext ctx = GetContextPool().Acquire(key);
+  if (!ctx) {
+    ctx = CreateContext(function);
+  }
+  duk_get_global_string(ctx.get(), "decode");
+  for (size_t i = 0; i < function.args.size(); i++) {
+    if (i < arguments.size()) {
+      duk_push_lstring(ctx.get(), arguments[i].data(), arguments[i].size());
+    } else {
+      duk_push_undefined(ctx.get());
+    }
+  }
+  if (duk_pcall(ctx.get(), static_cast<duk_idx_t>(function.args.size())) !=
+      DUK_EXEC_SUCCESS) {
+    throw JsException(duk_safe_to_string(ctx.get(), -1));
+  }
+  std::string result;
   if (const char* str = duk_get_string(ctx.get(), -1)) {
-    return str;
+    result = str;
   } else {
     throw JsException("Last evaluated value is not a string.");
   }
+  duk_pop(ctx.get());
+  GetContextPool().Release(std::move(key), std::move(ctx));
+  return result;
 }
 
 }  // namespace coro::cloudstorage::util::js
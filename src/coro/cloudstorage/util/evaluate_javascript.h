@@ -13,6 +13,9 @@ struct Function {
   std::string source;
 };
 
+// Calls `function` with `arguments`. Compiled functions are kept in a bounded
+// pool of Duktape heaps keyed by the whole function, so repeated calls skip
+// heap creation and compilation. Safe to call from any thread.
 std::string EvaluateJavascript(const Function& function,
                                std::span<const std::string> arguments);
 
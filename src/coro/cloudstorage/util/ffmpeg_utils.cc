@@ -48,7 +48,7 @@ std::unique_ptr<AVFormatContext, AVFormatContextDeleter> CreateFormatContext(
 }
 
 std::unique_ptr<AVCodecContext, AVCodecContextDeleter> CreateCodecContext(
-    AVFormatContext* context, int stream_index) {
+    AVFormatContext* context, int stream_index, AVDictionary** options) {
   auto* codec =
       avcodec_find_decoder(context->streams[stream_index]->codecpar->codec_id);
   if (!codec) {
@@ -63,7 +63,7 @@ std::unique_ptr<AVCodecContext, AVCodecContextDeleter> CreateCodecContext(
       avcodec_parameters_to_context(codec_context.get(),
                                     context->streams[stream_index]->codecpar),
       "avcodec_parameters_to_context");
-  CheckAVError(avcodec_open2(codec_context.get(), codec, nullptr),
+  CheckAVError(avcodec_open2(codec_context.get(), codec, options),
                "avcodec_open2");
   return codec_context;
 }
@@ -31,7 +31,8 @@ void CheckAVError(int code, std::string_view call);
 std::unique_ptr<AVFormatContext, AVFormatContextDeleter> CreateFormatContext(
     AVIOContext* io_context);
 std::unique_ptr<AVCodecContext, AVCodecContextDeleter> CreateCodecContext(
-    AVFormatContext* context, int stream_index);
+    AVFormatContext* context, int stream_index,
+    AVDictionary** options = nullptr);
 std::unique_ptr<AVPacket, AVPacketDeleter> CreatePacket();
 
 }  // namespace coro::cloudstorage::util
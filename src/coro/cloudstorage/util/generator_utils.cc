@@ -1,9 +1,100 @@
 #include "coro/cloudstorage/util/generator_utils.h"
 
 #include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <utility>
+
+#include "coro/exception.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/util/raii_utils.h"
 
 namespace coro::cloudstorage::util {
 
+namespace {
+
+using ::coro::util::AtScopeExit;
+
+struct CoalesceState {
+  size_t buffer_size;
+  // Chunks ready to be written out, in order.
+  std::deque<std::string> chunks;
+  // Small chunks merged so far, all of which come after `chunks`.
+  std::string buffer;
+  std::chrono::steady_clock::time_point buffer_start;
+  bool eof = false;
+  bool closed = false;
+  std::exception_ptr exception;
+  Promise<void>* reader_ready = nullptr;
+  Promise<void>* writer_ready = nullptr;
+  // Stops the pending flush timer.
+  stdx::stop_source timer;
+};
+
+void Resume(Promise<void>*& ready) {
+  if (auto* promise = std::exchange(ready, nullptr)) {
+    promise->SetValue();
+  }
+}
+
+void FlushBuffer(CoalesceState* state) {
+  if (!state->buffer.empty()) {
+    state->chunks.emplace_back(std::move(state->buffer));
+    state->buffer.clear();
+  }
+}
+
+Task<> FillCoalesceState(std::shared_ptr<CoalesceState> state,
+                         Generator<std::string> body) {
+  try {
+    FOR_CO_AWAIT(std::string & chunk, body) {
+      while (!state->chunks.empty() && !state->closed) {
+        Promise<void> ready;
+        state->writer_ready = &ready;
+        co_await ready;
+      }
+      if (state->closed) {
+        co_return;
+      }
+      if (chunk.empty()) {
+        continue;
+      }
+      if (chunk.size() >= state->buffer_size) {
+        FlushBuffer(state.get());
+        state->chunks.emplace_back(std::move(chunk));
+      } else {
+        if (state->buffer.empty()) {
+          state->buffer_start = std::chrono::steady_clock::now();
+        }
+        state->buffer += chunk;
+        if (state->buffer.size() >= state->buffer_size) {
+          FlushBuffer(state.get());
+        }
+      }
+      Resume(state->reader_ready);
+    }
+  } catch (...) {
+    state->exception = std::current_exception();
+  }
+  FlushBuffer(state.get());
+  state->eof = true;
+  Resume(state->reader_ready);
+}
+
+Task<> ResumeAfter(const coro::util::EventLoop* event_loop,
+                   std::shared_ptr<CoalesceState> state, int delay_ms,
+                   stdx::stop_token stop_token) {
+  try {
+    co_await event_loop->Wait(delay_ms, std::move(stop_token));
+    Resume(state->reader_ready);
+  } catch (const InterruptedException&) {
+  }
+}
+
+}  // namespace
+
 Generator<std::string> Take(Generator<std::string>& generator,
                             Generator<std::string>::iterator& iterator,
                             size_t at_most) {
@@ -38,4 +129,55 @@ Generator<std::string> Take(Generator<std::string>& generator,
   }
 }
 
+Generator<std::string> Coalesce(const coro::util::EventLoop* event_loop,
+                                Generator<std::string> body,
+                                size_t buffer_size,
+                                std::chrono::milliseconds max_delay) {
+  auto state = std::make_shared<CoalesceState>();
+  state->buffer_size = buffer_size;
+  RunTask(FillCoalesceState(state, std::move(body)));
+  auto scope_guard = AtScopeExit([&] {
+    state->closed = true;
+    state->reader_ready = nullptr;
+    state->timer.request_stop();
+    Resume(state->writer_ready);
+  });
+  while (true) {
+    if (!state->chunks.empty()) {
+      std::string chunk = std::move(state->chunks.front());
+      state->chunks.pop_front();
+      Resume(state->writer_ready);
+      co_yield std::move(chunk);
+      continue;
+    }
+    if (state->eof) {
+      if (state->exception) {
+        std::rethrow_exception(state->exception);
+      }
+      co_return;
+    }
+    auto delay = state->buffer.empty()
+                     ? std::chrono::milliseconds::max()
+                     : std::chrono::duration_cast<std::chrono::milliseconds>(
+                           state->buffer_start + max_delay -
+                           std::chrono::steady_clock::now());
+    if (delay.count() <= 0) {
+      std::string chunk = std::move(state->buffer);
+      state->buffer.clear();
+      Resume(state->writer_ready);
+      co_yield std::move(chunk);
+      continue;
+    }
+    Promise<void> ready;
+    state->reader_ready = &ready;
+    if (delay != std::chrono::milliseconds::max()) {
+      state->timer = stdx::stop_source();
+      RunTask(ResumeAfter(event_loop, state, static_cast<int>(delay.count()),
+                          state->timer.get_token()));
+    }
+    co_await ready;
+    state->timer.request_stop();
+  }
+}
+
 }  // namespace coro::cloudstorage::util
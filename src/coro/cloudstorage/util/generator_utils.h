@@ -1,9 +1,11 @@
 #ifndef CORO_CLOUDSTORAGE_GENERATOR_UTILS_H
 #define CORO_CLOUDSTORAGE_GENERATOR_UTILS_H
 
+#include <chrono>
 #include <string>
 
 #include "coro/generator.h"
+#include "coro/util/event_loop.h"
 
 namespace coro::cloudstorage::util {
 
@@ -20,6 +22,17 @@ Generator<std::string> Take(Generator<std::string>& generator,
                             Generator<std::string>::iterator& iterator,
                             size_t at_most);
 
+// Merges small chunks of `body` into chunks of about `buffer_size` bytes so
+// that each of them doesn't end up as a separate write to the socket. Chunks
+// that are at least `buffer_size` bytes long are passed through untouched.
+// Buffered data is also flushed `max_delay` after the oldest buffered chunk
+// arrived, even if `body` doesn't produce anything more by then. `body` is
+// read ahead by at most about two buffers.
+Generator<std::string> Coalesce(
+    const coro::util::EventLoop* event_loop, Generator<std::string> body,
+    size_t buffer_size = 64 * 1024,
+    std::chrono::milliseconds max_delay = std::chrono::milliseconds(50));
+
 }  // namespace coro::cloudstorage::util
 
 #endif
\ No newline at end of file
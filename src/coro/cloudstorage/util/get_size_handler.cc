@@ -23,8 +23,26 @@ auto GetSizeHandler::operator()(Request request,
                                  .username = account_username->second}) {
       auto stop_token_or =
           MakeStopTokenOr(std::move(stop_token), account.stop_token());
-      auto volume_data = co_await account.provider()->GetGeneralData(
-          stop_token_or.GetToken());
+      if (auto directory_id = query.find("directory_id");
+          directory_id != query.end()) {
+        auto item = co_await account.GetItemById(directory_id->second,
+                                                 stop_token_or.GetToken());
+        auto* directory =
+            std::get_if<AbstractCloudProvider::Directory>(&item.item);
+        if (!directory) {
+          co_return Response{.status = 400};
+        }
+        auto size = co_await account.GetDirectorySize(
+            std::move(*directory), stop_token_or.GetToken());
+        nlohmann::json json;
+        json["size"] = size.size;
+        json["file_count"] = size.file_count;
+        co_return Response{.status = 200,
+                           .headers = {{"Content-Type", "application/json"}},
+                           .body = http::CreateBody(json.dump())};
+      }
+      auto volume_data =
+          co_await account.GetGeneralData(stop_token_or.GetToken());
       nlohmann::json json;
       if (volume_data.space_total) {
         json["space_total"] = *volume_data.space_total;
@@ -10,6 +10,9 @@
 
 namespace coro::cloudstorage::util {
 
+// Handles `/size?account_type=&account_username=`, which returns the quota of
+// the account. With `directory_id=` it returns the total size and number of
+// the files under that directory instead.
 struct GetSizeHandler {
   using Request = http::Request<>;
   using Response = http::Response<>;
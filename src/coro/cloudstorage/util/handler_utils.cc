@@ -44,4 +44,21 @@ std::vector<std::string> GetEffectivePath(std::string_view uri_path) {
   return components;
 }
 
+std::optional<std::string_view> GetAccountItemPath(std::string_view path,
+                                                   std::string_view route) {
+  if (!path.starts_with('/') || !path.substr(1).starts_with(route) ||
+      path.substr(1 + route.size(), 1) != "/") {
+    return std::nullopt;
+  }
+  path.remove_prefix(route.size() + 2);
+  for (int i = 0; i < 2; i++) {
+    auto separator = path.find('/');
+    if (separator == 0 || separator == std::string_view::npos) {
+      return std::nullopt;
+    }
+    path.remove_prefix(separator + 1);
+  }
+  return path;
+}
+
 }  // namespace coro::cloudstorage::util
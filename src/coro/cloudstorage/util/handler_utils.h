@@ -1,6 +1,7 @@
 #ifndef CORO_CLOUDSTORAGE_HANDLER_UTILS_H
 #define CORO_CLOUDSTORAGE_HANDLER_UTILS_H
 
+#include <optional>
 #include <span>
 #include <sstream>
 #include <string_view>
@@ -32,6 +33,12 @@ std::string GetPath(const Request& request) {
 
 std::vector<std::string> GetEffectivePath(std::string_view uri_path);
 
+// Splits a path of the form `/<route>/<account type>/<username>/<rest>` and
+// returns the still encoded `<rest>`, or nullopt if `path` doesn't start with
+// `route` or doesn't have that shape.
+std::optional<std::string_view> GetAccountItemPath(std::string_view path,
+                                                   std::string_view route);
+
 template <typename Request>
 auto ToFileContent(AbstractCloudProvider* p,
                    const AbstractCloudProvider::Directory& parent,
@@ -0,0 +1,88 @@
+#include "coro/cloudstorage/util/html_template.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "coro/cloudstorage/util/string_utils.h"
+
+namespace coro::cloudstorage::util {
+
+void AppendEscapedHtml(std::string_view text, std::string& output) {
+  size_t begin = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    std::string_view replacement;
+    switch (text[i]) {
+      case '&':
+        replacement = "&amp;";
+        break;
+      case '<':
+        replacement = "&lt;";
+        break;
+      case '>':
+        replacement = "&gt;";
+        break;
+      case '"':
+        replacement = "&quot;";
+        break;
+      case '\'':
+        replacement = "&#39;";
+        break;
+      default:
+        continue;
+    }
+    output.append(text.substr(begin, i - begin));
+    output.append(replacement);
+    begin = i + 1;
+  }
+  output.append(text.substr(begin));
+}
+
+HtmlTemplate::HtmlTemplate(std::string_view source,
+                           std::initializer_list<std::string_view> parameters)
+    : parameter_count_(parameters.size()) {
+  std::string literal;
+  size_t i = 0;
+  while (i < source.size()) {
+    if (source.substr(i).starts_with("{{") ||
+        source.substr(i).starts_with("}}")) {
+      literal += source[i];
+      i += 2;
+    } else if (source[i] == '{') {
+      auto end = source.find('}', i);
+      if (end == std::string_view::npos) {
+        throw std::invalid_argument("unterminated placeholder");
+      }
+      std::string_view name = source.substr(i + 1, end - i - 1);
+      auto it = std::find(parameters.begin(), parameters.end(), name);
+      if (it == parameters.end()) {
+        throw std::invalid_argument(StrCat("unknown placeholder ", name));
+      }
+      chunks_.push_back(
+          Chunk{.literal = std::move(literal),
+                .parameter = static_cast<int>(it - parameters.begin())});
+      literal.clear();
+      i = end + 1;
+    } else if (source[i] == '}') {
+      throw std::invalid_argument("unmatched '}'");
+    } else {
+      literal += source[i];
+      i++;
+    }
+  }
+  chunks_.push_back(Chunk{.literal = std::move(literal), .parameter = -1});
+}
+
+void HtmlTemplate::Render(std::span<const std::string_view> values,
+                          std::string& output) const {
+  if (values.size() != parameter_count_) {
+    throw std::invalid_argument("invalid number of template arguments");
+  }
+  for (const Chunk& chunk : chunks_) {
+    output.append(chunk.literal);
+    if (chunk.parameter != -1) {
+      AppendEscapedHtml(values[chunk.parameter], output);
+    }
+  }
+}
+
+}  // namespace coro::cloudstorage::util
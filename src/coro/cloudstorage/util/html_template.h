@@ -0,0 +1,44 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_HTML_TEMPLATE_H
+#define CORO_CLOUDSTORAGE_UTIL_HTML_TEMPLATE_H
+
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace coro::cloudstorage::util {
+
+// Appends `text` to `output` with the characters that are special in HTML
+// text and attribute values replaced by character references.
+void AppendEscapedHtml(std::string_view text, std::string& output);
+
+// An HTML asset with fmt-style named placeholders (`{name}`, with `{{` and
+// `}}` for literal braces), split into literal chunks once so that rendering
+// is a sequence of appends. Substituted values are HTML-escaped.
+class HtmlTemplate {
+ public:
+  // Throws std::invalid_argument if `source` refers to a placeholder that is
+  // not in `parameters` or is malformed.
+  HtmlTemplate(std::string_view source,
+               std::initializer_list<std::string_view> parameters);
+
+  // Appends the template to `output`; `values[i]` is substituted for the i-th
+  // entry of `parameters`.
+  void Render(std::span<const std::string_view> values,
+              std::string& output) const;
+
+ private:
+  struct Chunk {
+    std::string literal;
+    // Index of the parameter that follows `literal`, or -1 for the last chunk.
+    int parameter;
+  };
+
+  std::vector<Chunk> chunks_;
+  size_t parameter_count_;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_HTML_TEMPLATE_H
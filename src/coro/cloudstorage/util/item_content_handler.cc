@@ -1,22 +1,17 @@
 #include "coro/cloudstorage/util/item_content_handler.h"
 
 #include "coro/cloudstorage/util/handler_utils.h"
-#include "coro/util/regex.h"
 
 namespace coro::cloudstorage::util {
 
-namespace re = coro::util::re;
-
 Task<http::Response<>> ItemContentHandler::operator()(
     http::Request<> request, stdx::stop_token stop_token) const {
   auto uri = http::ParseUri(request.url);
-  re::smatch results;
-  if (!re::regex_match(uri.path.value(), results,
-                       re::regex(R"(\/content\/[^\/]+\/[^\/]+\/(.*)$)"))) {
+  auto item_path = GetAccountItemPath(uri.path.value(), "content");
+  if (!item_path) {
     co_return http::Response<>{.status = 400};
   }
-  std::string item_id = http::DecodeUri(
-      http::DecodeUri(ToStringView(results[1].begin(), results[1].end())));
+  std::string item_id = http::DecodeUri(http::DecodeUri(*item_path));
   auto item = co_await account_.GetItemById(item_id, stop_token);
   auto* file = std::get_if<AbstractCloudProvider::File>(&item.item);
   if (!file) {
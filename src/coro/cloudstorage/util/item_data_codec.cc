@@ -0,0 +1,112 @@
+#include "coro/cloudstorage/util/item_data_codec.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "coro/exception.h"
+
+namespace coro::cloudstorage::util {
+
+ItemDataWriter::ItemDataWriter(ItemDataFormat format) {
+  data_ += static_cast<char>(format);
+}
+
+void ItemDataWriter::WriteBool(bool value) { data_ += value ? '\1' : '\0'; }
+
+void ItemDataWriter::WriteUint64(uint64_t value) {
+  while (value >= 0x80) {
+    data_ += static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  data_ += static_cast<char>(value);
+}
+
+void ItemDataWriter::WriteInt64(int64_t value) {
+  WriteUint64((static_cast<uint64_t>(value) << 1) ^
+              static_cast<uint64_t>(value >> 63));
+}
+
+void ItemDataWriter::WriteString(std::string_view value) {
+  WriteUint64(value.size());
+  data_ += value;
+}
+
+void ItemDataWriter::WriteOptionalString(
+    const std::optional<std::string>& value) {
+  WriteBool(value.has_value());
+  if (value) {
+    WriteString(*value);
+  }
+}
+
+void ItemDataWriter::WriteStringList(const std::vector<std::string>& value) {
+  WriteUint64(value.size());
+  for (const auto& entry : value) {
+    WriteString(entry);
+  }
+}
+
+void ItemDataWriter::WriteBytes(std::span<const uint8_t> value) {
+  data_.append(reinterpret_cast<const char*>(value.data()), value.size());
+}
+
+ItemDataFormat ItemDataReader::ReadFormat() {
+  return static_cast<ItemDataFormat>(Take(1)[0]);
+}
+
+bool ItemDataReader::ReadBool() { return Take(1)[0] != '\0'; }
+
+uint64_t ItemDataReader::ReadUint64() {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    auto byte = static_cast<uint8_t>(Take(1)[0]);
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw RuntimeError("invalid varint in item data");
+}
+
+int64_t ItemDataReader::ReadInt64() {
+  uint64_t value = ReadUint64();
+  return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+std::string ItemDataReader::ReadString() {
+  uint64_t size = ReadUint64();
+  return std::string(Take(size));
+}
+
+std::optional<std::string> ItemDataReader::ReadOptionalString() {
+  if (!ReadBool()) {
+    return std::nullopt;
+  }
+  return ReadString();
+}
+
+std::vector<std::string> ItemDataReader::ReadStringList() {
+  uint64_t size = ReadUint64();
+  std::vector<std::string> result;
+  result.reserve(std::min<uint64_t>(size, data_.size()));
+  for (uint64_t i = 0; i < size; i++) {
+    result.emplace_back(ReadString());
+  }
+  return result;
+}
+
+void ItemDataReader::ReadBytes(std::span<uint8_t> output) {
+  std::string_view bytes = Take(output.size());
+  std::copy(bytes.begin(), bytes.end(), output.begin());
+}
+
+std::string_view ItemDataReader::Take(size_t size) {
+  if (size > data_.size()) {
+    throw RuntimeError("truncated item data");
+  }
+  std::string_view result = data_.substr(0, size);
+  data_.remove_prefix(size);
+  return result;
+}
+
+}  // namespace coro::cloudstorage::util
@@ -0,0 +1,71 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_ITEM_DATA_CODEC_H
+#define CORO_CLOUDSTORAGE_UTIL_ITEM_DATA_CODEC_H
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace coro::cloudstorage::util {
+
+// Leading byte of the data returned by `AbstractCloudProvider::EncodeItemData`.
+enum class ItemDataFormat : uint8_t {
+  // CBOR of `AbstractCloudProvider::ToJson`.
+  kCbor = 0,
+  // The variant index of the item followed by the fields which are not common
+  // to all providers, written with `ItemDataWriter`.
+  kCompact = 1,
+};
+
+// Writes values into a compact buffer. Integers are written as LEB128
+// varints, strings with their length in front. The values carry no tags, so
+// they have to be read back in the same order with `ItemDataReader`.
+class ItemDataWriter {
+ public:
+  explicit ItemDataWriter(ItemDataFormat format);
+
+  void WriteBool(bool value);
+  void WriteUint64(uint64_t value);
+  // Zigzag encoded, so that small negative values stay short.
+  void WriteInt64(int64_t value);
+  void WriteString(std::string_view value);
+  void WriteOptionalString(const std::optional<std::string>& value);
+  void WriteStringList(const std::vector<std::string>& value);
+  // Writes `value` as is; the reader has to know its length.
+  void WriteBytes(std::span<const uint8_t> value);
+
+  std::string data() && { return std::move(data_); }
+
+ private:
+  std::string data_;
+};
+
+// Reads the values written by `ItemDataWriter`. Throws `RuntimeError` if the
+// data ends early.
+class ItemDataReader {
+ public:
+  explicit ItemDataReader(std::string_view data) : data_(data) {}
+
+  ItemDataFormat ReadFormat();
+  bool ReadBool();
+  uint64_t ReadUint64();
+  int64_t ReadInt64();
+  std::string ReadString();
+  std::optional<std::string> ReadOptionalString();
+  std::vector<std::string> ReadStringList();
+  void ReadBytes(std::span<uint8_t> output);
+
+  // Data that wasn't read yet.
+  std::string_view remaining() const { return data_; }
+
+ private:
+  std::string_view Take(size_t size);
+
+  std::string_view data_;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_ITEM_DATA_CODEC_H
@@ -6,14 +6,11 @@
 
 #include "coro/cloudstorage/util/cloud_provider_utils.h"
 #include "coro/cloudstorage/util/handler_utils.h"
-#include "coro/util/regex.h"
 
 namespace coro::cloudstorage::util {
 
 namespace {
 
-namespace re = coro::util::re;
-
 std::string_view GetIconName(AbstractCloudProvider::Directory) {
   return "folder";
 }
@@ -87,9 +84,8 @@ Task<http::Response<>> GetItemThumbnail(CloudProviderAccount account, Item d,
 Task<http::Response<>> ItemThumbnailHandler::operator()(
     http::Request<> request, stdx::stop_token stop_token) const {
   auto uri = http::ParseUri(request.url);
-  re::smatch results;
-  if (!re::regex_match(uri.path.value(), results,
-                       re::regex(R"(\/thumbnail\/[^\/]+\/[^\/]+\/(.*)$)"))) {
+  auto item_path = GetAccountItemPath(uri.path.value(), "thumbnail");
+  if (!item_path) {
     co_return http::Response<>{.status = 400};
   }
   ThumbnailQuality quality = [&] {
@@ -103,8 +99,7 @@ Task<http::Response<>> ItemThumbnailHandler::operator()(
     }
     return ThumbnailQuality::kLow;
   }();
-  std::string item_id =
-      http::DecodeUri(ToStringView(results[1].begin(), results[1].end()));
+  std::string item_id = http::DecodeUri(*item_path);
   auto range = [&]() -> std::optional<http::Range> {
     if (auto header = http::GetHeader(request.headers, "Range")) {
       return http::ParseRange(std::move(*header));
@@ -1,55 +1,90 @@
 #include "coro/cloudstorage/util/list_directory_handler.h"
 
-#include <fmt/format.h>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
 
 #include "coro/cloudstorage/util/cloud_provider_utils.h"
+#include "coro/cloudstorage/util/handler_utils.h"
+#include "coro/cloudstorage/util/html_template.h"
 #include "coro/cloudstorage/util/serialize_utils.h"
-#include "coro/util/regex.h"
 
 namespace coro::cloudstorage::util {
 
 namespace {
 
-namespace re = coro::util::re;
+const HtmlTemplate& GetItemEntryTemplate() {
+  static const HtmlTemplate kTemplate(
+      kItemEntryHtml, {"name", "size", "timestamp", "url", "thumbnail_url"});
+  return kTemplate;
+}
 
-std::string RewriteThumbnailUrl(std::string_view host, std::string url) {
-  auto host_uri = http::ParseUri(StrCat("//", host));
-  if (!host_uri.host->ends_with(".localhost")) {
-    return url;
+// Points thumbnail urls at the `img.` subdomain when the server is accessed
+// through a `.localhost` name. The Host header is only parsed once per
+// request.
+class ThumbnailUrlRewriter {
+ public:
+  explicit ThumbnailUrlRewriter(std::string_view host) {
+    auto host_uri = http::ParseUri(StrCat("//", host));
+    if (host_uri.host->ends_with(".localhost")) {
+      image_host_ = StrCat("img.", *host_uri.host);
+      image_port_ = host_uri.port;
+      auto root = http::ParseUri("/");
+      root.host = image_host_;
+      root.port = image_port_;
+      std::string origin = http::ToString(root);
+      origin.pop_back();
+      image_origin_ = std::move(origin);
+    }
   }
-  auto uri = http::ParseUri(url);
-  uri.host = StrCat("img.", *host_uri.host);
-  uri.port = host_uri.port;
-  std::string rewritten = http::ToString(uri);
-  return rewritten;
-}
 
-std::string GetItemEntry(
-    std::string_view host, const AbstractCloudProvider::Item& item,
+  std::string operator()(std::string url) const {
+    if (!image_host_) {
+      return url;
+    }
+    if (url.starts_with('/') && !url.starts_with("//")) {
+      return StrCat(*image_origin_, url);
+    }
+    auto uri = http::ParseUri(url);
+    uri.host = image_host_;
+    uri.port = image_port_;
+    return http::ToString(uri);
+  }
+
+ private:
+  std::optional<std::string> image_host_;
+  decltype(http::Uri::port) image_port_;
+  std::optional<std::string> image_origin_;
+};
+
+void AppendItemEntry(
+    const ThumbnailUrlRewriter& rewrite_thumbnail_url,
+    const AbstractCloudProvider::Item& item,
     const stdx::any_invocable<std::string(std::string_view item_id) const>&
         list_url_generator,
     const stdx::any_invocable<std::string(std::string_view item_id) const>&
         thumbnail_url_generator,
     const stdx::any_invocable<std::string(const AbstractCloudProvider::File&)
-                                  const>& content_url_generator) {
-  return std::visit(
+                                  const>& content_url_generator,
+    std::string& output) {
+  std::visit(
       [&]<typename Item>(const Item& d) {
-        return fmt::format(
-            fmt::runtime(kItemEntryHtml), fmt::arg("name", d.name),
-            fmt::arg("size", SizeToString(d.size)),
-            fmt::arg("timestamp", TimeStampToString(d.timestamp)),
-            fmt::arg(
-                "url",
-                [&] {
-                  if constexpr (std::is_same_v<
-                                    Item, AbstractCloudProvider::Directory>) {
-                    return list_url_generator(d.id);
-                  } else {
-                    return content_url_generator(d);
-                  }
-                }()),
-            fmt::arg("thumbnail_url",
-                     RewriteThumbnailUrl(host, thumbnail_url_generator(d.id))));
+        std::string size = SizeToString(d.size);
+        std::string timestamp = TimeStampToString(d.timestamp);
+        std::string url = [&] {
+          if constexpr (std::is_same_v<Item,
+                                       AbstractCloudProvider::Directory>) {
+            return list_url_generator(d.id);
+          } else {
+            return content_url_generator(d);
+          }
+        }();
+        std::string thumbnail_url =
+            rewrite_thumbnail_url(thumbnail_url_generator(d.id));
+        std::string_view values[] = {d.name, size, timestamp, url,
+                                     thumbnail_url};
+        GetItemEntryTemplate().Render(values, output);
       },
       item);
 }
@@ -60,13 +95,11 @@ auto ListDirectoryHandler::operator()(http::Request<> request,
                                       stdx::stop_token stop_token)
     -> Task<http::Response<>> {
   auto uri = http::ParseUri(request.url);
-  re::smatch results;
-  if (!re::regex_match(uri.path.value(), results,
-                       re::regex(R"(\/list\/[^\/]+\/[^\/]+\/(.*)$)"))) {
+  auto item_path = GetAccountItemPath(uri.path.value(), "list");
+  if (!item_path) {
     co_return http::Response<>{.status = 400};
   }
-  std::string item_id =
-      http::DecodeUri(ToStringView(results[1].begin(), results[1].end()));
+  std::string item_id = http::DecodeUri(*item_path);
   auto item = co_await account_.GetItemById(item_id, stop_token);
   auto* directory = std::get_if<AbstractCloudProvider::Directory>(&item.item);
   if (!directory) {
@@ -81,6 +114,32 @@ auto ListDirectoryHandler::operator()(http::Request<> request,
           std::move(*directory), std::move(versioned.content), stop_token)};
 }
 
+Task<> ListDirectoryHandler::FillDirectorySizes(
+    std::span<AbstractCloudProvider::Item> items,
+    stdx::stop_token stop_token) const {
+  std::vector<std::string> directory_ids;
+  for (const auto& item : items) {
+    if (const auto* directory =
+            std::get_if<AbstractCloudProvider::Directory>(&item);
+        directory && !directory->size) {
+      directory_ids.emplace_back(directory->id);
+    }
+  }
+  if (directory_ids.empty()) {
+    co_return;
+  }
+  auto sizes = co_await account_.GetCachedDirectorySizes(
+      std::move(directory_ids), std::move(stop_token));
+  for (auto& item : items) {
+    if (auto* directory = std::get_if<AbstractCloudProvider::Directory>(&item);
+        directory && !directory->size) {
+      if (auto it = sizes.find(directory->id); it != sizes.end()) {
+        directory->size = it->second.size;
+      }
+    }
+  }
+}
+
 Generator<std::string> ListDirectoryHandler::GetDirectoryContent(
     std::string host, AbstractCloudProvider::Directory parent,
     Generator<AbstractCloudProvider::PageData> page_data,
@@ -98,17 +157,23 @@ Generator<std::string> ListDirectoryHandler::GetDirectoryContent(
       "</head>"
       "<body class='root-container'>"
       "<table class='content-table'>";
-  std::string parent_entry =
-      fmt::format(fmt::runtime(kItemEntryHtml), fmt::arg("name", ".."),
-                  fmt::arg("size", ""), fmt::arg("timestamp", ""),
-                  fmt::arg("url", "javascript: history.go(-1)"),
-                  fmt::arg("thumbnail_url",
-                           RewriteThumbnailUrl(host, "/static/folder.svg")));
+  ThumbnailUrlRewriter rewrite_thumbnail_url(host);
+  std::string parent_entry;
+  std::string parent_thumbnail_url =
+      rewrite_thumbnail_url("/static/folder.svg");
+  std::string_view parent_values[] = {
+      "..", "", "", "javascript: history.go(-1)", parent_thumbnail_url};
+  GetItemEntryTemplate().Render(parent_values, parent_entry);
   co_yield std::move(parent_entry);
-  FOR_CO_AWAIT(const auto& page, page_data) {
+  FOR_CO_AWAIT(auto& page, page_data) {
+    co_await FillDirectorySizes(page.items, stop_token);
+    std::string chunk;
     for (const auto& item : page.items) {
-      co_yield GetItemEntry(host, item, list_url_generator_,
-                            thumbnail_url_generator_, content_url_generator_);
+      AppendItemEntry(rewrite_thumbnail_url, item, list_url_generator_,
+                      thumbnail_url_generator_, content_url_generator_, chunk);
+    }
+    if (!chunk.empty()) {
+      co_yield std::move(chunk);
     }
   }
   co_yield "</table>"
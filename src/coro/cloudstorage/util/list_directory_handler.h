@@ -1,6 +1,8 @@
 #ifndef CORO_CLOUDSTORAGE_UTIL_LIST_DIRECTORY_HANDLER_H
 #define CORO_CLOUDSTORAGE_UTIL_LIST_DIRECTORY_HANDLER_H
 
+#include <span>
+
 #include "coro/cloudstorage/util/assets.h"
 #include "coro/cloudstorage/util/cache_manager.h"
 #include "coro/cloudstorage/util/clock.h"
@@ -30,6 +32,11 @@ class ListDirectoryHandler {
                                     stdx::stop_token stop_token);
 
  private:
+  // Shows the stored recursive sizes of the directories which have no size of
+  // their own.
+  Task<> FillDirectorySizes(std::span<AbstractCloudProvider::Item> items,
+                            stdx::stop_token stop_token) const;
+
   Generator<std::string> GetDirectoryContent(
       std::string host, AbstractCloudProvider::Directory parent,
       Generator<AbstractCloudProvider::PageData> page_data,
@@ -246,6 +246,14 @@ MergedCloudProvider::Item MergedCloudProvider::ToItem(const nlohmann::json &) {
   throw std::runtime_error("not implemented");
 }
 
+void MergedCloudProvider::WriteItemData(const ItemData &, ItemDataWriter &) {
+  throw std::runtime_error("not implemented");
+}
+
+void MergedCloudProvider::ReadItemData(ItemDataReader &, ItemData &) {
+  throw std::runtime_error("not implemented");
+}
+
 auto MergedCloudProvider::GetAccount(const AccountId &account_id) const
     -> const Account * {
   return const_cast<MergedCloudProvider *>(this)->GetAccount(account_id);
@@ -116,6 +116,10 @@ class MergedCloudProvider {
 
   static Item ToItem(const nlohmann::json &);
 
+  static void WriteItemData(const ItemData &, ItemDataWriter &);
+
+  static void ReadItemData(ItemDataReader &, ItemData &);
+
  private:
   struct Account {
     std::string id;
@@ -0,0 +1,619 @@
+#include "coro/cloudstorage/util/metadata_index.h"
+
+#include <sqlite3.h>
+
+#include <nlohmann/json.hpp>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "coro/cloudstorage/util/string_utils.h"
+#include "coro/exception.h"
+
+namespace coro::cloudstorage::util {
+
+namespace {
+
+// Parts of FTS5 such as external content tables and the trigram tokenizer
+// can't be declared through sqlite_orm, so the index talks to SQLite
+// directly over its own connection to the cache database. The schema is
+// created in a single transaction, so that nothing is left behind if the
+// SQLite library lacks FTS5 or the trigram tokenizer.
+constexpr const char* kSchema = R"(
+BEGIN;
+CREATE TABLE IF NOT EXISTS metadata_index_entry (
+  entry_id INTEGER PRIMARY KEY,
+  account_type TEXT NOT NULL,
+  account_username TEXT NOT NULL,
+  id TEXT NOT NULL,
+  type INTEGER NOT NULL,
+  name TEXT NOT NULL,
+  path TEXT NOT NULL,
+  size INTEGER,
+  timestamp INTEGER,
+  mime_type TEXT NOT NULL,
+  content BLOB NOT NULL,
+  generation INTEGER NOT NULL,
+  UNIQUE (account_type, account_username, id));
+CREATE INDEX IF NOT EXISTS metadata_index_entry_size
+  ON metadata_index_entry (account_type, account_username, size);
+CREATE INDEX IF NOT EXISTS metadata_index_entry_timestamp
+  ON metadata_index_entry (account_type, account_username, timestamp);
+CREATE INDEX IF NOT EXISTS metadata_index_entry_generation
+  ON metadata_index_entry (account_type, account_username, generation);
+CREATE VIRTUAL TABLE IF NOT EXISTS metadata_index_name USING fts5(
+  name, content='metadata_index_entry', content_rowid='entry_id',
+  tokenize='trigram');
+CREATE TRIGGER IF NOT EXISTS metadata_index_entry_insert
+  AFTER INSERT ON metadata_index_entry BEGIN
+    INSERT INTO metadata_index_name (rowid, name)
+      VALUES (new.entry_id, new.name);
+  END;
+CREATE TRIGGER IF NOT EXISTS metadata_index_entry_delete
+  AFTER DELETE ON metadata_index_entry BEGIN
+    INSERT INTO metadata_index_name (metadata_index_name, rowid, name)
+      VALUES ('delete', old.entry_id, old.name);
+  END;
+CREATE TRIGGER IF NOT EXISTS metadata_index_entry_update
+  AFTER UPDATE OF name ON metadata_index_entry BEGIN
+    INSERT INTO metadata_index_name (metadata_index_name, rowid, name)
+      VALUES ('delete', old.entry_id, old.name);
+    INSERT INTO metadata_index_name (rowid, name)
+      VALUES (new.entry_id, new.name);
+  END;
+CREATE TABLE IF NOT EXISTS metadata_index_crawl (
+  account_type TEXT NOT NULL,
+  account_username TEXT NOT NULL,
+  generation INTEGER NOT NULL,
+  complete INTEGER NOT NULL,
+  update_time INTEGER NOT NULL,
+  PRIMARY KEY (account_type, account_username));
+CREATE TABLE IF NOT EXISTS metadata_index_pending (
+  account_type TEXT NOT NULL,
+  account_username TEXT NOT NULL,
+  directory_id TEXT NOT NULL,
+  path TEXT NOT NULL,
+  content BLOB NOT NULL,
+  PRIMARY KEY (account_type, account_username, directory_id));
+COMMIT;
+)";
+
+// Same as the one of the connection of `CacheManager`, which writes to the
+// same file.
+constexpr int kBusyTimeoutMs = 10000;
+
+// The trigram tokenizer can't match anything shorter.
+constexpr size_t kMinFullTextQueryLength = 3;
+
+void Check(sqlite3* db, int code) {
+  if (code != SQLITE_OK && code != SQLITE_ROW && code != SQLITE_DONE) {
+    throw RuntimeError(StrCat("sqlite: ", sqlite3_errmsg(db)));
+  }
+}
+
+void Execute(sqlite3* db, const char* sql) {
+  Check(db, sqlite3_exec(db, sql, /*callback=*/nullptr, /*arg=*/nullptr,
+                         /*errmsg=*/nullptr));
+}
+
+class Statement {
+ public:
+  Statement(sqlite3* db, std::string_view sql) : db_(db) {
+    Check(db_, sqlite3_prepare_v2(db_, sql.data(), static_cast<int>(sql.size()),
+                                  &stmt_, /*pzTail=*/nullptr));
+  }
+  Statement(const Statement&) = delete;
+  ~Statement() { sqlite3_finalize(stmt_); }
+
+  Statement& operator=(const Statement&) = delete;
+
+  Statement& Bind(std::string_view text) {
+    Check(db_, sqlite3_bind_text(stmt_, ++bind_index_, text.data(),
+                                 static_cast<int>(text.size()),
+                                 SQLITE_TRANSIENT));
+    return *this;
+  }
+
+  Statement& Bind(int64_t value) {
+    Check(db_, sqlite3_bind_int64(stmt_, ++bind_index_, value));
+    return *this;
+  }
+
+  Statement& Bind(std::optional<int64_t> value) {
+    if (value) {
+      return Bind(*value);
+    }
+    Check(db_, sqlite3_bind_null(stmt_, ++bind_index_));
+    return *this;
+  }
+
+  Statement& Bind(const std::vector<char>& blob) {
+    Check(db_, sqlite3_bind_blob(stmt_, ++bind_index_, blob.data(),
+                                 static_cast<int>(blob.size()),
+                                 SQLITE_TRANSIENT));
+    return *this;
+  }
+
+  // Returns whether a row is available.
+  bool Step() {
+    int code = sqlite3_step(stmt_);
+    Check(db_, code);
+    return code == SQLITE_ROW;
+  }
+
+  void Reset() {
+    Check(db_, sqlite3_reset(stmt_));
+    Check(db_, sqlite3_clear_bindings(stmt_));
+    bind_index_ = 0;
+  }
+
+  int64_t GetInt64(int column) const {
+    return sqlite3_column_int64(stmt_, column);
+  }
+
+  std::string GetText(int column) const {
+    const auto* text =
+        reinterpret_cast<const char*>(sqlite3_column_text(stmt_, column));
+    return std::string(text ? text : "", sqlite3_column_bytes(stmt_, column));
+  }
+
+  std::vector<char> GetBlob(int column) const {
+    const auto* blob =
+        reinterpret_cast<const char*>(sqlite3_column_blob(stmt_, column));
+    return std::vector<char>(blob, blob + sqlite3_column_bytes(stmt_, column));
+  }
+
+ private:
+  sqlite3* db_;
+  sqlite3_stmt* stmt_ = nullptr;
+  int bind_index_ = 0;
+};
+
+// Rolls back unless committed.
+class Transaction {
+ public:
+  explicit Transaction(sqlite3* db) : db_(db) {
+    Execute(db_, "BEGIN IMMEDIATE");
+  }
+  Transaction(const Transaction&) = delete;
+  ~Transaction() {
+    if (db_) {
+      sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+    }
+  }
+
+  Transaction& operator=(const Transaction&) = delete;
+
+  void Commit() { Execute(std::exchange(db_, nullptr), "COMMIT"); }
+
+ private:
+  sqlite3* db_;
+};
+
+std::vector<char> ToCbor(const nlohmann::json& json) {
+  std::vector<char> output;
+  nlohmann::json::to_cbor(json, output);
+  return output;
+}
+
+size_t GetCharacterCount(std::string_view text) {
+  size_t count = 0;
+  for (char c : text) {
+    if ((static_cast<uint8_t>(c) & 0xC0) != 0x80) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Escapes the wildcards of a LIKE pattern with '\'.
+std::string EscapeLikePattern(std::string_view text) {
+  std::string result;
+  for (char c : text) {
+    if (c == '%' || c == '_' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result;
+}
+
+// Quotes `text` as a single FTS5 phrase.
+std::string ToFullTextQuery(std::string_view text) {
+  std::string result = "\"";
+  for (char c : text) {
+    if (c == '"') {
+      result += '"';
+    }
+    result += c;
+  }
+  result += '"';
+  return result;
+}
+
+std::optional<int64_t> GetGeneration(sqlite3* db, std::string_view account_type,
+                                     std::string_view account_username) {
+  Statement statement(db,
+                      "SELECT generation FROM metadata_index_crawl "
+                      "WHERE account_type = ? AND account_username = ?");
+  statement.Bind(account_type).Bind(account_username);
+  if (!statement.Step()) {
+    return std::nullopt;
+  }
+  return statement.GetInt64(0);
+}
+
+}  // namespace
+
+struct MetadataIndex::Database {
+  explicit Database(const std::string& path) {
+    if (int code = sqlite3_open(path.c_str(), &handle); code != SQLITE_OK) {
+      std::string message = sqlite3_errmsg(handle);
+      sqlite3_close(handle);
+      throw RuntimeError(StrCat("sqlite: ", message));
+    }
+    sqlite3_busy_timeout(handle, kBusyTimeoutMs);
+    // Lets the readers of either connection go on while the other one
+    // writes.
+    sqlite3_exec(handle, "PRAGMA journal_mode=WAL", /*callback=*/nullptr,
+                 /*arg=*/nullptr, /*errmsg=*/nullptr);
+  }
+  Database(const Database&) = delete;
+  ~Database() { sqlite3_close(handle); }
+
+  Database& operator=(const Database&) = delete;
+
+  sqlite3* handle = nullptr;
+};
+
+MetadataIndex::MetadataIndex(std::string path,
+                             const coro::util::EventLoop* event_loop)
+    : worker_(event_loop, /*thread_count=*/1, "index") {
+  try {
+    auto db = std::make_unique<Database>(path);
+    Execute(db->handle, kSchema);
+    db_ = std::move(db);
+  } catch (const RuntimeError&) {
+    // Closing the connection rolls back the schema, and the index stays
+    // unavailable.
+  }
+}
+
+MetadataIndex::~MetadataIndex() = default;
+
+bool MetadataIndex::IsAvailable() const { return db_ != nullptr; }
+
+sqlite3* MetadataIndex::GetHandle() const {
+  if (!db_) {
+    throw RuntimeError("metadata index unavailable");
+  }
+  return db_->handle;
+}
+
+auto MetadataIndex::Search(std::vector<CacheManager::AccountKey> accounts,
+                           Query query, stdx::stop_token stop_token) const
+    -> Task<std::vector<Entry>> {
+  if (accounts.empty() || !IsAvailable()) {
+    co_return std::vector<Entry>();
+  }
+  bool full_text = GetCharacterCount(query.text) >= kMinFullTextQueryLength;
+  std::string sql =
+      "SELECT account_type, account_username, path, content "
+      "FROM metadata_index_entry WHERE (account_type, account_username) IN "
+      "(VALUES ";
+  for (size_t i = 0; i < accounts.size(); i++) {
+    sql += i == 0 ? "(?, ?)" : ", (?, ?)";
+  }
+  sql += ")";
+  if (full_text) {
+    sql +=
+        " AND entry_id IN (SELECT rowid FROM metadata_index_name "
+        "WHERE metadata_index_name MATCH ?)";
+  }
+  if (query.prefix || (!full_text && !query.text.empty())) {
+    sql += " AND name LIKE ? ESCAPE '\\'";
+  }
+  if (query.type) {
+    sql += " AND type = ?";
+  }
+  if (query.min_size) {
+    sql += " AND size >= ?";
+  }
+  if (query.max_size) {
+    sql += " AND size <= ?";
+  }
+  if (query.min_timestamp) {
+    sql += " AND timestamp >= ?";
+  }
+  if (query.max_timestamp) {
+    sql += " AND timestamp <= ?";
+  }
+  sql += " ORDER BY name LIMIT ?";
+
+  auto* db = GetHandle();
+  auto rows = co_await worker_.Do(std::move(stop_token), [&] {
+    Statement statement(db, sql);
+    for (const auto& account : accounts) {
+      statement.Bind(account.provider->GetId()).Bind(account.username);
+    }
+    if (full_text) {
+      statement.Bind(ToFullTextQuery(query.text));
+    }
+    if (query.prefix) {
+      statement.Bind(StrCat(EscapeLikePattern(query.text), '%'));
+    } else if (!full_text && !query.text.empty()) {
+      statement.Bind(StrCat('%', EscapeLikePattern(query.text), '%'));
+    }
+    if (query.type) {
+      statement.Bind(static_cast<int64_t>(*query.type));
+    }
+    for (const auto& bound : {query.min_size, query.max_size,
+                              query.min_timestamp, query.max_timestamp}) {
+      if (bound) {
+        statement.Bind(*bound);
+      }
+    }
+    statement.Bind(static_cast<int64_t>(query.limit));
+    std::vector<std::tuple<std::string, std::string, std::string,
+                           std::vector<char>>>
+        rows;
+    while (statement.Step()) {
+      rows.emplace_back(statement.GetText(0), statement.GetText(1),
+                        statement.GetText(2), statement.GetBlob(3));
+    }
+    return rows;
+  });
+  std::vector<Entry> entries;
+  entries.reserve(rows.size());
+  for (auto& [account_type, account_username, path, content] : rows) {
+    for (const auto& account : accounts) {
+      if (account.provider->GetId() == account_type &&
+          account.username == account_username) {
+        entries.emplace_back(
+            Entry{.account = account,
+                  .path = std::move(path),
+                  .item = account.provider->ToItem(
+                      nlohmann::json::from_cbor(content))});
+        break;
+      }
+    }
+  }
+  co_return entries;
+}
+
+auto MetadataIndex::GetCrawlState(CacheManager::AccountKey account,
+                                  stdx::stop_token stop_token) const
+    -> Task<std::optional<CrawlState>> {
+  if (!IsAvailable()) {
+    co_return std::nullopt;
+  }
+  auto* db = GetHandle();
+  co_return co_await worker_.Do(
+      std::move(stop_token), [&]() -> std::optional<CrawlState> {
+        Statement statement(db,
+                            "SELECT generation, complete, update_time "
+                            "FROM metadata_index_crawl "
+                            "WHERE account_type = ? AND account_username = ?");
+        statement.Bind(account.provider->GetId()).Bind(account.username);
+        if (!statement.Step()) {
+          return std::nullopt;
+        }
+        return CrawlState{.generation = statement.GetInt64(0),
+                          .complete = statement.GetInt64(1) != 0,
+                          .update_time = statement.GetInt64(2)};
+      });
+}
+
+Task<> MetadataIndex::StartCrawl(CacheManager::AccountKey account,
+                                 AbstractCloudProvider::Directory root,
+                                 int64_t update_time,
+                                 stdx::stop_token stop_token) {
+  auto* db = GetHandle();
+  std::string account_type(account.provider->GetId());
+  std::string root_id = root.id;
+  auto content = ToCbor(account.provider->ToJson(std::move(root)));
+  co_await worker_.Do(std::move(stop_token), [&] {
+    Transaction transaction(db);
+    int64_t generation =
+        GetGeneration(db, account_type, account.username).value_or(0) + 1;
+    Statement remove_pending(db,
+                             "DELETE FROM metadata_index_pending "
+                             "WHERE account_type = ? AND account_username = ?");
+    remove_pending.Bind(account_type).Bind(account.username).Step();
+    Statement add_pending(db,
+                          "INSERT INTO metadata_index_pending (account_type, "
+                          "account_username, directory_id, path, content) "
+                          "VALUES (?, ?, ?, '', ?)");
+    add_pending.Bind(account_type)
+        .Bind(account.username)
+        .Bind(root_id)
+        .Bind(content)
+        .Step();
+    Statement put_crawl(db,
+                        "INSERT OR REPLACE INTO metadata_index_crawl "
+                        "(account_type, account_username, generation, "
+                        "complete, update_time) VALUES (?, ?, ?, 0, ?)");
+    put_crawl.Bind(account_type)
+        .Bind(account.username)
+        .Bind(generation)
+        .Bind(update_time)
+        .Step();
+    transaction.Commit();
+  });
+}
+
+auto MetadataIndex::GetPendingDirectory(CacheManager::AccountKey account,
+                                        stdx::stop_token stop_token) const
+    -> Task<std::optional<PendingDirectory>> {
+  auto* db = GetHandle();
+  auto row = co_await worker_.Do(
+      std::move(stop_token),
+      [&]() -> std::optional<std::pair<std::string, std::vector<char>>> {
+        Statement statement(db,
+                            "SELECT path, content FROM metadata_index_pending "
+                            "WHERE account_type = ? AND account_username = ? "
+                            "LIMIT 1");
+        statement.Bind(account.provider->GetId()).Bind(account.username);
+        if (!statement.Step()) {
+          return std::nullopt;
+        }
+        return std::make_pair(statement.GetText(0), statement.GetBlob(1));
+      });
+  if (!row) {
+    co_return std::nullopt;
+  }
+  co_return PendingDirectory{
+      .directory = std::get<AbstractCloudProvider::Directory>(
+          account.provider->ToItem(nlohmann::json::from_cbor(row->second))),
+      .path = std::move(row->first)};
+}
+
+Task<> MetadataIndex::PutDirectoryContent(
+    CacheManager::AccountKey account, PendingDirectory parent,
+    std::vector<AbstractCloudProvider::Item> items,
+    stdx::stop_token stop_token) {
+  struct Row {
+    std::string id;
+    ItemType type;
+    std::string name;
+    std::string path;
+    std::optional<int64_t> size;
+    std::optional<int64_t> timestamp;
+    std::string mime_type;
+    std::vector<char> content;
+  };
+  std::vector<Row> rows;
+  rows.reserve(items.size());
+  for (const auto& item : items) {
+    std::visit(
+        [&]<typename T>(const T& d) {
+          Row row{.id = d.id,
+                  .type = std::is_same_v<T, AbstractCloudProvider::File>
+                              ? ItemType::kFile
+                              : ItemType::kDirectory,
+                  .name = d.name,
+                  .path = StrCat(parent.path, '/', d.name),
+                  .size = d.size,
+                  .timestamp = d.timestamp,
+                  .content = ToCbor(account.provider->ToJson(item))};
+          if constexpr (std::is_same_v<T, AbstractCloudProvider::File>) {
+            row.mime_type = d.mime_type;
+          }
+          rows.emplace_back(std::move(row));
+        },
+        item);
+  }
+  auto* db = GetHandle();
+  std::string account_type(account.provider->GetId());
+  co_await worker_.Do(std::move(stop_token), [&] {
+    Transaction transaction(db);
+    auto generation = GetGeneration(db, account_type, account.username);
+    if (!generation) {
+      throw RuntimeError("crawl not started");
+    }
+    Statement get_generation(db,
+                             "SELECT generation FROM metadata_index_entry "
+                             "WHERE account_type = ? AND account_username = ? "
+                             "AND id = ?");
+    Statement put_entry(
+        db,
+        "INSERT INTO metadata_index_entry (account_type, account_username, "
+        "id, type, name, path, size, timestamp, mime_type, content, "
+        "generation) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) "
+        "ON CONFLICT (account_type, account_username, id) DO UPDATE SET "
+        "type = excluded.type, name = excluded.name, path = excluded.path, "
+        "size = excluded.size, timestamp = excluded.timestamp, "
+        "mime_type = excluded.mime_type, content = excluded.content, "
+        "generation = excluded.generation");
+    Statement add_pending(db,
+                          "INSERT OR REPLACE INTO metadata_index_pending "
+                          "(account_type, account_username, directory_id, "
+                          "path, content) VALUES (?, ?, ?, ?, ?)");
+    for (const Row& row : rows) {
+      get_generation.Bind(account_type).Bind(account.username).Bind(row.id);
+      // A directory reachable through several parents is only listed once
+      // per crawl.
+      bool seen = get_generation.Step() && get_generation.GetInt64(0) ==
+                                               *generation;
+      get_generation.Reset();
+      put_entry.Bind(account_type)
+          .Bind(account.username)
+          .Bind(row.id)
+          .Bind(static_cast<int64_t>(row.type))
+          .Bind(row.name)
+          .Bind(row.path)
+          .Bind(row.size)
+          .Bind(row.timestamp)
+          .Bind(row.mime_type)
+          .Bind(row.content)
+          .Bind(*generation)
+          .Step();
+      put_entry.Reset();
+      if (row.type == ItemType::kDirectory && !seen) {
+        add_pending.Bind(account_type)
+            .Bind(account.username)
+            .Bind(row.id)
+            .Bind(row.path)
+            .Bind(row.content)
+            .Step();
+        add_pending.Reset();
+      }
+    }
+    Statement remove_pending(db,
+                             "DELETE FROM metadata_index_pending "
+                             "WHERE account_type = ? AND account_username = ? "
+                             "AND directory_id = ?");
+    remove_pending.Bind(account_type)
+        .Bind(account.username)
+        .Bind(parent.directory.id)
+        .Step();
+    transaction.Commit();
+  });
+}
+
+Task<> MetadataIndex::RemovePendingDirectory(CacheManager::AccountKey account,
+                                             std::string directory_id,
+                                             stdx::stop_token stop_token) {
+  auto* db = GetHandle();
+  co_await worker_.Do(std::move(stop_token), [&] {
+    Statement statement(db,
+                        "DELETE FROM metadata_index_pending "
+                        "WHERE account_type = ? AND account_username = ? "
+                        "AND directory_id = ?");
+    statement.Bind(account.provider->GetId())
+        .Bind(account.username)
+        .Bind(directory_id)
+        .Step();
+  });
+}
+
+Task<> MetadataIndex::FinishCrawl(CacheManager::AccountKey account,
+                                  int64_t update_time,
+                                  stdx::stop_token stop_token) {
+  auto* db = GetHandle();
+  std::string account_type(account.provider->GetId());
+  co_await worker_.Do(std::move(stop_token), [&] {
+    Transaction transaction(db);
+    auto generation = GetGeneration(db, account_type, account.username);
+    if (!generation) {
+      throw RuntimeError("crawl not started");
+    }
+    Statement remove_stale(db,
+                           "DELETE FROM metadata_index_entry "
+                           "WHERE account_type = ? AND account_username = ? "
+                           "AND generation < ?");
+    remove_stale.Bind(account_type)
+        .Bind(account.username)
+        .Bind(*generation)
+        .Step();
+    Statement finish(db,
+                     "UPDATE metadata_index_crawl "
+                     "SET complete = 1, update_time = ? "
+                     "WHERE account_type = ? AND account_username = ?");
+    finish.Bind(update_time).Bind(account_type).Bind(account.username).Step();
+    transaction.Commit();
+  });
+}
+
+}  // namespace coro::cloudstorage::util
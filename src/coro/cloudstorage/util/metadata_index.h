@@ -0,0 +1,113 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_METADATA_INDEX_H
+#define CORO_CLOUDSTORAGE_UTIL_METADATA_INDEX_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "coro/cloudstorage/util/abstract_cloud_provider.h"
+#include "coro/cloudstorage/util/cache_manager.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/thread_pool.h"
+
+struct sqlite3;
+
+namespace coro::cloudstorage::util {
+
+// Metadata of every item of the accounts, kept in the cache database with a
+// trigram FTS5 index over the names. Filled by `MetadataIndexer`, which walks
+// each account's tree and records its progress here so that a crawl resumes
+// where it stopped. If the SQLite library can't provide the index, it stays
+// empty and `IsAvailable()` returns false.
+class MetadataIndex {
+ public:
+  enum class ItemType { kFile, kDirectory };
+
+  struct Query {
+    // Matched against names ignoring case. May be empty.
+    std::string text;
+    // Whether names must start with `text` rather than merely contain it.
+    bool prefix = false;
+    std::optional<ItemType> type;
+    std::optional<int64_t> min_size;
+    std::optional<int64_t> max_size;
+    std::optional<int64_t> min_timestamp;
+    std::optional<int64_t> max_timestamp;
+    int limit = 100;
+  };
+
+  struct Entry {
+    CacheManager::AccountKey account;
+    // Slash separated names of the ancestors and of the item itself.
+    std::string path;
+    AbstractCloudProvider::Item item;
+  };
+
+  struct CrawlState {
+    int64_t generation;
+    bool complete;
+    // When the crawl started, or finished once it is complete.
+    int64_t update_time;
+  };
+
+  struct PendingDirectory {
+    AbstractCloudProvider::Directory directory;
+    std::string path;
+  };
+
+  MetadataIndex(std::string path, const coro::util::EventLoop* event_loop);
+  MetadataIndex(const MetadataIndex&) = delete;
+  ~MetadataIndex();
+
+  MetadataIndex& operator=(const MetadataIndex&) = delete;
+
+  bool IsAvailable() const;
+
+  // Returns at most `query.limit` entries of `accounts`, ordered by name.
+  Task<std::vector<Entry>> Search(
+      std::vector<CacheManager::AccountKey> accounts, Query query,
+      stdx::stop_token stop_token) const;
+
+  Task<std::optional<CrawlState>> GetCrawlState(
+      CacheManager::AccountKey account, stdx::stop_token stop_token) const;
+
+  // Starts the next generation of the crawl of the account from `root`.
+  Task<> StartCrawl(CacheManager::AccountKey account,
+                    AbstractCloudProvider::Directory root, int64_t update_time,
+                    stdx::stop_token stop_token);
+
+  // Returns a directory which still has to be listed in the current crawl.
+  Task<std::optional<PendingDirectory>> GetPendingDirectory(
+      CacheManager::AccountKey account, stdx::stop_token stop_token) const;
+
+  // Stores the content of a pending directory, queues its subdirectories and
+  // marks it as listed.
+  Task<> PutDirectoryContent(CacheManager::AccountKey account,
+                             PendingDirectory parent,
+                             std::vector<AbstractCloudProvider::Item> items,
+                             stdx::stop_token stop_token);
+
+  Task<> RemovePendingDirectory(CacheManager::AccountKey account,
+                                std::string directory_id,
+                                stdx::stop_token stop_token);
+
+  // Drops the entries which were not seen during the current crawl and marks
+  // it as complete.
+  Task<> FinishCrawl(CacheManager::AccountKey account, int64_t update_time,
+                     stdx::stop_token stop_token);
+
+ private:
+  struct Database;
+
+  sqlite3* GetHandle() const;
+
+  std::unique_ptr<Database> db_;
+  mutable coro::util::ThreadPool worker_;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_METADATA_INDEX_H
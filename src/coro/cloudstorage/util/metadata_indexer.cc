@@ -0,0 +1,146 @@
+#include "coro/cloudstorage/util/metadata_indexer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "coro/cloudstorage/cloud_exception.h"
+#include "coro/exception.h"
+#include "coro/util/stop_token_or.h"
+
+namespace coro::cloudstorage::util {
+
+namespace {
+
+using ::coro::RunTask;
+using ::coro::util::MakeUniqueStopTokenOr;
+
+// Leaves the startup to the requests of the user.
+constexpr int kStartDelayMs = 30 * 1000;
+// Delay between two requests of the crawl of a single account.
+constexpr int kRequestIntervalMs = 1000;
+constexpr int kMinRetryDelayMs = 10 * 1000;
+constexpr int kMaxRetryDelayMs = 60 * 60 * 1000;
+constexpr int64_t kRecrawlInterval = 24LL * 60 * 60;
+
+// Providers whose tree isn't worth mirroring: the listings of YouTube are
+// generated from its API rather than stored, and the local filesystem can be
+// listed directly at no cost.
+bool IsIndexed(const AbstractCloudProvider& provider) {
+  auto id = provider.GetId();
+  return id != "youtube" && id != "local";
+}
+
+// Does a single step of the crawl of `account`. Returns how long to wait
+// before the next one.
+Task<int> CrawlStep(const coro::util::EventLoop* event_loop,
+                    MetadataIndex* index, const Clock* clock,
+                    const CacheManager::AccountKey& account,
+                    stdx::stop_token stop_token) {
+  auto state = co_await index->GetCrawlState(account, stop_token);
+  int64_t now = clock->Now();
+  if (state && state->complete) {
+    int64_t next_crawl_time = state->update_time + kRecrawlInterval;
+    if (now < next_crawl_time) {
+      co_return static_cast<int>(std::min<int64_t>(
+          (next_crawl_time - now) * 1000, kMaxRetryDelayMs));
+    }
+  }
+  if (!state || state->complete) {
+    auto root = co_await account.provider->GetRoot(stop_token);
+    co_await index->StartCrawl(account, std::move(root), now,
+                               std::move(stop_token));
+    co_return kRequestIntervalMs;
+  }
+  auto pending = co_await index->GetPendingDirectory(account, stop_token);
+  if (!pending) {
+    co_await index->FinishCrawl(account, now, std::move(stop_token));
+    co_return 0;
+  }
+  std::vector<AbstractCloudProvider::Item> items;
+  bool found = true;
+  try {
+    std::optional<std::string> page_token;
+    do {
+      auto page_data = co_await account.provider->ListDirectoryPage(
+          pending->directory, std::move(page_token), stop_token);
+      std::move(page_data.items.begin(), page_data.items.end(),
+                std::back_inserter(items));
+      page_token = std::move(page_data.next_page_token);
+      if (page_token) {
+        co_await event_loop->Wait(kRequestIntervalMs, stop_token);
+      }
+    } while (page_token);
+  } catch (const CloudException& e) {
+    if (e.type() != CloudException::Type::kNotFound) {
+      throw;
+    }
+    found = false;
+  }
+  if (found) {
+    co_await index->PutDirectoryContent(account, std::move(*pending),
+                                        std::move(items),
+                                        std::move(stop_token));
+  } else {
+    co_await index->RemovePendingDirectory(
+        account, std::move(pending->directory.id), std::move(stop_token));
+  }
+  co_return kRequestIntervalMs;
+}
+
+Task<> Crawl(const coro::util::EventLoop* event_loop, MetadataIndex* index,
+             const Clock* clock, CacheManager::AccountKey account,
+             stdx::stop_token stop_token) {
+  co_await event_loop->Wait(kStartDelayMs, stop_token);
+  int retry_delay_ms = kMinRetryDelayMs;
+  while (true) {
+    int delay_ms;
+    try {
+      delay_ms =
+          co_await CrawlStep(event_loop, index, clock, account, stop_token);
+      retry_delay_ms = kMinRetryDelayMs;
+    } catch (const InterruptedException&) {
+      throw;
+    } catch (...) {
+      if (stop_token.stop_requested()) {
+        throw InterruptedException();
+      }
+      delay_ms = retry_delay_ms;
+      retry_delay_ms = std::min(retry_delay_ms * 2, kMaxRetryDelayMs);
+    }
+    if (delay_ms > 0) {
+      co_await event_loop->Wait(delay_ms, stop_token);
+    }
+  }
+}
+
+}  // namespace
+
+MetadataIndexer::MetadataIndexer(const coro::util::EventLoop* event_loop,
+                                 MetadataIndex* index, const Clock* clock)
+    : event_loop_(event_loop), index_(index), clock_(clock) {}
+
+MetadataIndexer::~MetadataIndexer() { stop_source_.request_stop(); }
+
+void MetadataIndexer::Add(CacheManager::AccountKey account,
+                          stdx::stop_token stop_token) {
+  if (!index_->IsAvailable() || !IsIndexed(*account.provider)) {
+    return;
+  }
+  RunTask([event_loop = event_loop_, index = index_, clock = clock_,
+           account = std::move(account), stop_token = std::move(stop_token),
+           indexer_stop_token = stop_source_.get_token()]() -> Task<> {
+    auto stop_token_or =
+        MakeUniqueStopTokenOr(std::move(stop_token), indexer_stop_token);
+    try {
+      co_await Crawl(event_loop, index, clock, account,
+                     stop_token_or->GetToken());
+    } catch (const InterruptedException&) {
+    }
+  });
+}
+
+}  // namespace coro::cloudstorage::util
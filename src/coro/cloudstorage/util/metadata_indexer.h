@@ -0,0 +1,40 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_METADATA_INDEXER_H
+#define CORO_CLOUDSTORAGE_UTIL_METADATA_INDEXER_H
+
+#include "coro/cloudstorage/util/cache_manager.h"
+#include "coro/cloudstorage/util/clock.h"
+#include "coro/cloudstorage/util/metadata_index.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::cloudstorage::util {
+
+// Walks the trees of the accounts into `MetadataIndex` in the background and
+// walks them again once a day. Every account has at most one request in
+// flight and its requests are spaced out, so that the crawl stays well within
+// the rate limits of the clouds. Must only be used from the event loop thread.
+class MetadataIndexer {
+ public:
+  MetadataIndexer(const coro::util::EventLoop* event_loop, MetadataIndex* index,
+                  const Clock* clock);
+  MetadataIndexer(const MetadataIndexer&) = delete;
+  ~MetadataIndexer();
+
+  MetadataIndexer& operator=(const MetadataIndexer&) = delete;
+
+  // Keeps the index of `account` up to date until `stop_token` is stopped.
+  // Does nothing if the index is unavailable or the cloud of the account is
+  // not worth indexing.
+  void Add(CacheManager::AccountKey account, stdx::stop_token stop_token);
+
+ private:
+  const coro::util::EventLoop* event_loop_;
+  MetadataIndex* index_;
+  const Clock* clock_;
+  stdx::stop_source stop_source_;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_METADATA_INDEXER_H
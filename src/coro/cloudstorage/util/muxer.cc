@@ -58,7 +58,7 @@ auto CreateMuxerIOContext(std::string* data) {
 
 class MuxerContext {
  public:
-  MuxerContext(coro::util::ThreadPool* thread_pool, AVIOContext* video,
+  MuxerContext(ThreadPoolScheduler* scheduler, AVIOContext* video,
                AVIOContext* audio, MuxerOptions options,
                stdx::stop_token stop_token);
 
@@ -89,7 +89,7 @@ class MuxerContext {
   Stream CreateStream(AVIOContext* io_context, AVMediaType type) const;
 
   std::unique_ptr<std::string> data_ = std::make_unique<std::string>();
-  coro::util::ThreadPool* thread_pool_;
+  ThreadPoolScheduler* scheduler_;
   std::unique_ptr<std::FILE, FileDeleter> file_;
   std::unique_ptr<AVIOContext, AVIOContextDeleter> io_context_;
   std::unique_ptr<AVFormatContext, AVFormatWriteContextDeleter> format_context_;
@@ -97,10 +97,10 @@ class MuxerContext {
   stdx::stop_token stop_token_;
 };
 
-MuxerContext::MuxerContext(coro::util::ThreadPool* thread_pool,
-                           AVIOContext* video, AVIOContext* audio,
-                           MuxerOptions options, stdx::stop_token stop_token)
-    : thread_pool_(thread_pool),
+MuxerContext::MuxerContext(ThreadPoolScheduler* scheduler, AVIOContext* video,
+                           AVIOContext* audio, MuxerOptions options,
+                           stdx::stop_token stop_token)
+    : scheduler_(scheduler),
       file_(options.buffered ? CreateTmpFile() : nullptr),
       io_context_(options.buffered ? CreateMuxerIOContext(file_.get())
                                    : CreateMuxerIOContext(data_.get())),
@@ -170,9 +170,9 @@ Generator<std::string> MuxerContext::GetContent() {
       if (!stream.is_eof && !stream.packet) {
         stream.packet = CreatePacket();
         while (true) {
-          auto read_packet = co_await thread_pool_->Do(
-              stop_token_, av_read_frame, stream.format_context.get(),
-              stream.packet.get());
+          auto read_packet = co_await scheduler_->Do(
+              ThreadPoolScheduler::Priority::kPlayback, stop_token_,
+              av_read_frame, stream.format_context.get(), stream.packet.get());
           if (read_packet != 0 && read_packet != AVERROR_EOF) {
             CheckAVError(read_packet, "av_read_frame");
           } else {
@@ -239,7 +239,8 @@ Generator<std::string> MuxerContext::GetContent() {
   std::cerr << "TRANSCODE DONE\n";
 
   if (file_) {
-    FOR_CO_AWAIT(std::string & chunk, ReadFile(thread_pool_, file_.get())) {
+    FOR_CO_AWAIT(std::string & chunk,
+                 ReadFile(scheduler_->thread_pool(), file_.get())) {
       co_yield std::move(chunk);
     }
   }
@@ -251,11 +252,14 @@ template <typename F1, typename F2>
 auto Muxer::InParallel(F1&& f1, F2&& f2, stdx::stop_token stop_token) const
     -> std::tuple<decltype(f1()), decltype(f2())> {
   std::promise<std::tuple<decltype(f1()), decltype(f2())>> promise;
+  // Called from a job that already holds one of the scheduler's threads, so
+  // this goes straight to the pool to avoid waiting on itself.
+  auto* thread_pool = scheduler_->thread_pool();
   event_loop_->RunOnEventLoop([&]() -> Task<> {
     try {
       promise.set_value(
-          co_await WhenAll(thread_pool_->Do(stop_token, std::forward<F1>(f1)),
-                           thread_pool_->Do(stop_token, std::forward<F2>(f2))));
+          co_await WhenAll(thread_pool->Do(stop_token, std::forward<F1>(f1)),
+                           thread_pool->Do(stop_token, std::forward<F2>(f2))));
     } catch (...) {
       promise.set_exception(std::current_exception());
     }
@@ -271,20 +275,21 @@ Generator<std::string> Muxer::operator()(
     stdx::stop_token stop_token) const {
   std::unique_ptr<AVIOContext, AVIOContextDeleter> video_io_context;
   std::unique_ptr<AVIOContext, AVIOContextDeleter> audio_io_context;
-  auto muxer_context = co_await thread_pool_->Do(stop_token, [&] {
-    std::tie(video_io_context, audio_io_context) = InParallel(
-        [&] {
-          return CreateIOContext(event_loop_, video_cloud_provider,
-                                 std::move(video_track), stop_token);
-        },
-        [&] {
-          return CreateIOContext(event_loop_, audio_cloud_provider,
-                                 std::move(audio_track), stop_token);
-        },
-        stop_token);
-    return MuxerContext(thread_pool_, video_io_context.get(),
-                        audio_io_context.get(), options, stop_token);
-  });
+  auto muxer_context = co_await scheduler_->Do(
+      ThreadPoolScheduler::Priority::kPlayback, stop_token, [&] {
+        std::tie(video_io_context, audio_io_context) = InParallel(
+            [&] {
+              return CreateIOContext(event_loop_, video_cloud_provider,
+                                     std::move(video_track), stop_token);
+            },
+            [&] {
+              return CreateIOContext(event_loop_, audio_cloud_provider,
+                                     std::move(audio_track), stop_token);
+            },
+            stop_token);
+        return MuxerContext(scheduler_, video_io_context.get(),
+                            audio_io_context.get(), options, stop_token);
+      });
   FOR_CO_AWAIT(std::string & chunk, muxer_context.GetContent()) {
     if (!chunk.empty()) {
       co_yield std::move(chunk);
@@ -2,7 +2,7 @@
 #define CORO_CLOUDSTORAGE_FUSE_MUXER_H
 
 #include "coro/cloudstorage/util/abstract_cloud_provider.h"
-#include "coro/util/thread_pool.h"
+#include "coro/cloudstorage/util/thread_pool_scheduler.h"
 
 namespace coro::cloudstorage::util {
 
@@ -16,8 +16,8 @@ struct MuxerOptions {
 class Muxer {
  public:
   Muxer(const coro::util::EventLoop* event_loop,
-        coro::util::ThreadPool* thread_pool)
-      : event_loop_(event_loop), thread_pool_(thread_pool) {}
+        ThreadPoolScheduler* scheduler)
+      : event_loop_(event_loop), scheduler_(scheduler) {}
 
   Generator<std::string> operator()(AbstractCloudProvider* video_cloud_provider,
                                     AbstractCloudProvider::File video_track,
@@ -32,7 +32,7 @@ class Muxer {
       -> std::tuple<decltype(f1()), decltype(f2())>;
 
   const coro::util::EventLoop* event_loop_;
-  coro::util::ThreadPool* thread_pool_;
+  ThreadPoolScheduler* scheduler_;
 };
 
 }  // namespace coro::cloudstorage::util
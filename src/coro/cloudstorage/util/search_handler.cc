@@ -0,0 +1,251 @@
+#include "coro/cloudstorage/util/search_handler.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "coro/cloudstorage/util/exception_utils.h"
+#include "coro/cloudstorage/util/string_utils.h"
+#include "coro/cloudstorage/util/timing_out_stop_token.h"
+#include "coro/promise.h"
+#include "coro/util/raii_utils.h"
+#include "coro/util/stop_token_or.h"
+
+namespace coro::cloudstorage::util {
+
+namespace {
+
+using ::coro::util::AtScopeExit;
+using ::coro::util::MakeUniqueStopTokenOr;
+
+constexpr int kAccountTimeoutMs = 10000;
+constexpr int kDefaultIndexResultCount = 100;
+constexpr int kMaxIndexResultCount = 1000;
+
+struct SearchState {
+  std::deque<std::string> chunks;
+  size_t pending_count = 0;
+  Promise<void>* ready = nullptr;
+};
+
+void Notify(SearchState* d) {
+  if (auto* ready = std::exchange(d->ready, nullptr)) {
+    ready->SetValue();
+  }
+}
+
+nlohmann::json ToJson(const CloudProviderAccount::Id& account_id,
+                      const AbstractCloudProvider::Item& item) {
+  nlohmann::json json;
+  json["account_type"] = account_id.type;
+  json["account_username"] = account_id.username;
+  std::visit(
+      [&]<typename T>(const T& d) {
+        json["id"] = d.id;
+        json["name"] = d.name;
+        if (d.size) {
+          json["size"] = *d.size;
+        }
+        if (d.timestamp) {
+          json["timestamp"] = *d.timestamp;
+        }
+        if constexpr (std::is_same_v<T, AbstractCloudProvider::File>) {
+          json["type"] = "file";
+          json["mime_type"] = d.mime_type;
+        } else {
+          json["type"] = "directory";
+        }
+        json["url"] =
+            StrCat(std::is_same_v<T, AbstractCloudProvider::File> ? "/content/"
+                                                                  : "/list/",
+                   account_id.type, '/', http::EncodeUri(account_id.username),
+                   '/', http::EncodeUri(d.id));
+      },
+      item);
+  return json;
+}
+
+Task<> SearchAccount(const coro::util::EventLoop* event_loop,
+                     CloudProviderAccount account, std::string query,
+                     std::shared_ptr<SearchState> d,
+                     stdx::stop_token stop_token) {
+  auto scope_guard = AtScopeExit([&] {
+    d->pending_count--;
+    Notify(d.get());
+  });
+  TimingOutStopToken timeout(*event_loop,
+                             StrCat("SearchItems ", account.type()),
+                             kAccountTimeoutMs);
+  auto stop_token_or = MakeUniqueStopTokenOr(account.stop_token(), stop_token,
+                                             timeout.GetToken());
+  try {
+    auto pages =
+        account.SearchItems(std::move(query), stop_token_or->GetToken());
+    FOR_CO_AWAIT(const AbstractCloudProvider::PageData& page, pages) {
+      std::string chunk;
+      for (const auto& item : page.items) {
+        chunk += ToJson(account.id(), item).dump();
+        chunk += '\n';
+      }
+      if (!chunk.empty()) {
+        d->chunks.emplace_back(std::move(chunk));
+        Notify(d.get());
+      }
+    }
+  } catch (...) {
+    if (stop_token.stop_requested()) {
+      co_return;
+    }
+    nlohmann::json json;
+    json["account_type"] = account.type();
+    json["account_username"] = account.username();
+    json["error"] = timeout.GetToken().stop_requested()
+                        ? "timed out"
+                        : GetErrorMetadata().what;
+    d->chunks.emplace_back(json.dump() + '\n');
+  }
+}
+
+Generator<std::string> GetSearchResults(
+    const coro::util::EventLoop* event_loop,
+    std::vector<CloudProviderAccount> accounts, std::string query,
+    stdx::stop_token stop_token) {
+  auto d = std::make_shared<SearchState>();
+  d->pending_count = accounts.size();
+  stdx::stop_source stop_source;
+  stdx::stop_callback cb(std::move(stop_token),
+                         [&] { stop_source.request_stop(); });
+  auto scope_guard = AtScopeExit([&] {
+    d->ready = nullptr;
+    stop_source.request_stop();
+  });
+  for (auto& account : accounts) {
+    RunTask(SearchAccount(event_loop, std::move(account), query, d,
+                          stop_source.get_token()));
+  }
+  while (!d->chunks.empty() || d->pending_count > 0) {
+    if (d->chunks.empty()) {
+      Promise<void> ready;
+      d->ready = &ready;
+      co_await ready;
+      continue;
+    }
+    std::string chunk = std::move(d->chunks.front());
+    d->chunks.pop_front();
+    co_yield std::move(chunk);
+  }
+}
+
+std::optional<int64_t> GetNumber(const auto& query, std::string_view key) {
+  auto it = query.find(std::string(key));
+  if (it == query.end()) {
+    return std::nullopt;
+  }
+  return std::stoll(it->second);
+}
+
+// Returns nullopt if none of the parameters specific to the index are set.
+std::optional<MetadataIndex::Query> GetIndexQuery(const auto& query) {
+  MetadataIndex::Query result;
+  bool present = false;
+  if (auto it = query.find("prefix"); it != query.end()) {
+    result.prefix = it->second == "true";
+    present = true;
+  }
+  if (auto it = query.find("type"); it != query.end()) {
+    if (it->second == "file") {
+      result.type = MetadataIndex::ItemType::kFile;
+    } else if (it->second == "directory") {
+      result.type = MetadataIndex::ItemType::kDirectory;
+    } else {
+      throw std::invalid_argument("invalid type");
+    }
+    present = true;
+  }
+  result.min_size = GetNumber(query, "min_size");
+  result.max_size = GetNumber(query, "max_size");
+  result.min_timestamp = GetNumber(query, "min_timestamp");
+  result.max_timestamp = GetNumber(query, "max_timestamp");
+  auto limit = GetNumber(query, "limit");
+  if (!present && !result.min_size && !result.max_size &&
+      !result.min_timestamp && !result.max_timestamp && !limit) {
+    return std::nullopt;
+  }
+  result.limit = static_cast<int>(std::clamp<int64_t>(
+      limit.value_or(kDefaultIndexResultCount), 1, kMaxIndexResultCount));
+  if (auto it = query.find("query"); it != query.end()) {
+    result.text = it->second;
+  }
+  return result;
+}
+
+Generator<std::string> GetIndexSearchResults(
+    const MetadataIndex* metadata_index,
+    std::vector<CacheManager::AccountKey> accounts, MetadataIndex::Query query,
+    stdx::stop_token stop_token) {
+  auto entries = co_await metadata_index->Search(
+      std::move(accounts), std::move(query), std::move(stop_token));
+  std::string chunk;
+  for (const auto& entry : entries) {
+    auto json = ToJson(
+        CloudProviderAccount::Id{
+            .type = std::string(entry.account.provider->GetId()),
+            .username = entry.account.username},
+        entry.item);
+    json["path"] = entry.path;
+    chunk += json.dump();
+    chunk += '\n';
+  }
+  co_yield std::move(chunk);
+}
+
+}  // namespace
+
+auto SearchHandler::operator()(Request request,
+                               stdx::stop_token stop_token) const
+    -> Task<Response> {
+  auto query =
+      http::ParseQuery(http::ParseUri(request.url).query.value_or(""));
+  std::optional<MetadataIndex::Query> index_query;
+  try {
+    index_query = GetIndexQuery(query);
+  } catch (const std::exception&) {
+    co_return Response{.status = 400};
+  }
+  if (index_query) {
+    if (!metadata_index->IsAvailable()) {
+      co_return Response{.status = 501};
+    }
+    std::vector<CacheManager::AccountKey> account_keys;
+    for (const auto& account : accounts) {
+      account_keys.emplace_back(CacheManager::AccountKey{
+          account.provider(), std::string(account.username())});
+    }
+    co_return Response{
+        .status = 200,
+        .headers = {{"Content-Type", "application/x-ndjson"}},
+        .body = GetIndexSearchResults(metadata_index, std::move(account_keys),
+                                      std::move(*index_query),
+                                      std::move(stop_token))};
+  }
+  auto it = query.find("query");
+  if (it == query.end() || it->second.empty()) {
+    co_return Response{.status = 400};
+  }
+  co_return Response{
+      .status = 200,
+      .headers = {{"Content-Type", "application/x-ndjson"}},
+      .body = GetSearchResults(
+          event_loop,
+          std::vector<CloudProviderAccount>(accounts.begin(), accounts.end()),
+          std::move(it->second), std::move(stop_token))};
+}
+
+}  // namespace coro::cloudstorage::util
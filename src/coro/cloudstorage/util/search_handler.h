@@ -0,0 +1,37 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_SEARCH_HANDLER_H
+#define CORO_CLOUDSTORAGE_UTIL_SEARCH_HANDLER_H
+
+#include <span>
+
+#include "coro/cloudstorage/util/cloud_provider_account.h"
+#include "coro/cloudstorage/util/metadata_index.h"
+#include "coro/http/http.h"
+#include "coro/http/http_parse.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::cloudstorage::util {
+
+// Handles `/search?query=<text>`. The query is sent to all accounts at once
+// and the matching items are streamed back as JSON lines in the order in which
+// they arrive. Accounts that fail or don't finish in time are reported with an
+// `error` line.
+//
+// With any of `prefix=true`, `type=file|directory`, `min_size`, `max_size`,
+// `min_timestamp`, `max_timestamp` or `limit` the query is answered from
+// `MetadataIndex` instead, and each line also carries the `path` of the item.
+// Such queries fail with 501 if the index is unavailable.
+struct SearchHandler {
+  using Request = http::Request<>;
+  using Response = http::Response<>;
+
+  Task<Response> operator()(Request request, stdx::stop_token stop_token) const;
+
+  const coro::util::EventLoop* event_loop;
+  const MetadataIndex* metadata_index;
+  std::span<const CloudProviderAccount> accounts;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_SEARCH_HANDLER_H
@@ -0,0 +1,78 @@
+#include "coro/cloudstorage/util/thread_pool_scheduler.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "coro/exception.h"
+#include "coro/stdx/stop_callback.h"
+
+namespace coro::cloudstorage::util {
+
+namespace {
+
+int ToIndex(ThreadPoolScheduler::Priority priority) {
+  return static_cast<int>(priority);
+}
+
+}  // namespace
+
+ThreadPoolScheduler::ThreadPoolScheduler(
+    const coro::util::EventLoop* event_loop,
+    coro::util::ThreadPool* thread_pool, int thread_count)
+    : event_loop_(event_loop),
+      thread_pool_(thread_pool),
+      thread_count_(std::max(thread_count, 1)),
+      reserved_playback_thread_count_(
+          thread_count_ > 1 ? std::max(thread_count_ / 4, 1) : 0) {}
+
+Task<> ThreadPoolScheduler::Acquire(Priority priority,
+                                    stdx::stop_token stop_token) {
+  if (stop_token.stop_requested()) {
+    throw InterruptedException();
+  }
+  auto& waiters = waiters_[ToIndex(priority)];
+  if (waiters.empty() && HasFreeThread(priority)) {
+    running_count_[ToIndex(priority)]++;
+    co_return;
+  }
+  auto waiter = std::make_shared<Waiter>();
+  waiters.push_back(waiter);
+  stdx::stop_callback stop_callback(stop_token, [this, priority, waiter] {
+    event_loop_->RunOnEventLoop([this, priority, waiter] {
+      if (!waiter->done) {
+        waiter->done = true;
+        std::erase(waiters_[ToIndex(priority)], waiter);
+        waiter->promise.SetException(
+            std::make_exception_ptr(InterruptedException()));
+      }
+    });
+  });
+  co_await waiter->promise;
+}
+
+void ThreadPoolScheduler::Release(Priority priority) {
+  running_count_[ToIndex(priority)]--;
+  for (Priority p : {Priority::kPlayback, Priority::kThumbnail}) {
+    auto& waiters = waiters_[ToIndex(p)];
+    while (!waiters.empty() && HasFreeThread(p)) {
+      auto waiter = std::move(waiters.back());
+      waiters.pop_back();
+      waiter->done = true;
+      running_count_[ToIndex(p)]++;
+      waiter->promise.SetValue();
+    }
+  }
+}
+
+bool ThreadPoolScheduler::HasFreeThread(Priority priority) const {
+  int running = running_count_[ToIndex(Priority::kPlayback)] +
+                running_count_[ToIndex(Priority::kThumbnail)];
+  if (running >= thread_count_) {
+    return false;
+  }
+  return priority == Priority::kPlayback ||
+         running_count_[ToIndex(Priority::kThumbnail)] <
+             thread_count_ - reserved_playback_thread_count_;
+}
+
+}  // namespace coro::cloudstorage::util
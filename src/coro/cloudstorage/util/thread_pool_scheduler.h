@@ -0,0 +1,64 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_THREAD_POOL_SCHEDULER_H
+#define CORO_CLOUDSTORAGE_UTIL_THREAD_POOL_SCHEDULER_H
+
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "coro/promise.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+#include "coro/util/raii_utils.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::cloudstorage::util {
+
+// Admits at most `thread_count` jobs into `thread_pool` at a time, so that the
+// order in which they run is decided here instead of by the pool's FIFO
+// queue. Playback jobs always go first and have a share of the threads that
+// thumbnail jobs can't take. Within a priority class the newest job goes
+// first. Jobs whose stop token fires while they wait are dropped. Must only
+// be used from the event loop thread.
+class ThreadPoolScheduler {
+ public:
+  enum class Priority { kThumbnail, kPlayback };
+
+  ThreadPoolScheduler(const coro::util::EventLoop* event_loop,
+                      coro::util::ThreadPool* thread_pool, int thread_count);
+
+  coro::util::ThreadPool* thread_pool() const { return thread_pool_; }
+
+  template <typename F, typename... Args>
+  Task<std::invoke_result_t<F, Args...>> Do(Priority priority,
+                                            stdx::stop_token stop_token,
+                                            F func, Args... args) {
+    co_await Acquire(priority, stop_token);
+    auto guard = coro::util::AtScopeExit([&] { Release(priority); });
+    co_return co_await thread_pool_->Do(std::move(stop_token),
+                                        std::move(func), std::move(args)...);
+  }
+
+ private:
+  struct Waiter {
+    Promise<void> promise;
+    bool done = false;
+  };
+
+  Task<> Acquire(Priority priority, stdx::stop_token stop_token);
+  void Release(Priority priority);
+  bool HasFreeThread(Priority priority) const;
+
+  const coro::util::EventLoop* event_loop_;
+  coro::util::ThreadPool* thread_pool_;
+  int thread_count_;
+  int reserved_playback_thread_count_;
+  std::array<int, 2> running_count_{};
+  std::array<std::vector<std::shared_ptr<Waiter>>, 2> waiters_;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_THREAD_POOL_SCHEDULER_H
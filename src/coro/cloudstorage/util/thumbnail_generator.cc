@@ -8,12 +8,13 @@ extern "C" {
 #include <libavformat/avformat.h>
 #include <libavutil/avutil.h>
 #include <libavutil/display.h>
-#include <libavutil/imgutils.h>
 #include <libswscale/swscale.h>
 }
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
@@ -38,13 +39,6 @@ struct AVFrameDeleter {
   void operator()(AVFrame* frame) const { av_frame_free(&frame); }
 };
 
-struct AVFrameConvertedDeleter {
-  void operator()(AVFrame* frame) const {
-    av_freep(&frame->data);
-    av_frame_free(&frame);
-  }
-};
-
 struct SwsContextDeleter {
   void operator()(SwsContext* context) const { sws_freeContext(context); }
 };
@@ -186,7 +180,8 @@ class GraphBuilder {
 };
 
 auto DecodeFrame(AVFormatContext* context, AVCodecContext* codec_context,
-                 int stream_index, std::atomic_bool* interrupted) {
+                 int stream_index, std::atomic_bool* interrupted,
+                 bool keyframe_only = false) {
   std::unique_ptr<AVFrame, AVFrameDeleter> result_frame;
   while (!result_frame) {
     if (*interrupted) {
@@ -197,7 +192,9 @@ auto DecodeFrame(AVFormatContext* context, AVCodecContext* codec_context,
     if (read_packet != 0 && read_packet != AVERROR_EOF) {
       CheckAVError(read_packet, "av_read_frame");
     } else {
-      if (read_packet == 0 && packet->stream_index != stream_index) {
+      if (read_packet == 0 &&
+          (packet->stream_index != stream_index ||
+           (keyframe_only && !(packet->flags & AV_PKT_FLAG_KEY)))) {
         continue;
       }
       auto send_packet = avcodec_send_packet(
@@ -269,28 +266,25 @@ auto RotateFrame(std::unique_ptr<AVFrame, AVFrameDeleter> frame,
   return graph.PullFrame().value();
 }
 
-auto ConvertFrame(const AVFrame* frame, AVPixelFormat format) {
+auto ScaleFrame(const AVFrame* frame, ImageSize size, AVPixelFormat format) {
   std::unique_ptr<SwsContext, SwsContextDeleter> sws_context(sws_getContext(
-      frame->width, frame->height, AVPixelFormat(frame->format), frame->width,
-      frame->height, format, SWS_BICUBIC,
+      frame->width, frame->height, AVPixelFormat(frame->format), size.width,
+      size.height, format, SWS_BICUBIC,
       /*srcFilter=*/nullptr, /*dstFilter=*/nullptr, /*param=*/nullptr));
   if (!sws_context) {
     throw RuntimeError("sws_getContext returned null");
   }
-  std::unique_ptr<AVFrame, AVFrameConvertedDeleter> target_frame(
-      av_frame_alloc());
+  std::unique_ptr<AVFrame, AVFrameDeleter> target_frame(av_frame_alloc());
   if (!target_frame) {
     throw RuntimeError("av_frame_alloc");
   }
   CheckAVError(av_frame_copy_props(target_frame.get(), frame),
                "av_frame_copy_props");
   target_frame->format = format;
-  target_frame->width = frame->width;
-  target_frame->height = frame->height;
-  CheckAVError(
-      av_image_alloc(target_frame->data, target_frame->linesize, frame->width,
-                     frame->height, format, /*align=*/32),
-      "av_image_alloc");
+  target_frame->width = size.width;
+  target_frame->height = size.height;
+  CheckAVError(av_frame_get_buffer(target_frame.get(), /*align=*/32),
+               "av_frame_get_buffer");
   CheckAVError(
       sws_scale(sws_context.get(), frame->data, frame->linesize, 0,
                 frame->height, target_frame->data, target_frame->linesize),
@@ -298,7 +292,35 @@ auto ConvertFrame(const AVFrame* frame, AVPixelFormat format) {
   return target_frame;
 }
 
-auto ConvertFrame(const AVFrame* frame, const AVCodec* codec) {
+auto ConvertFrame(const AVFrame* frame, AVPixelFormat format) {
+  return ScaleFrame(frame, {frame->width, frame->height}, format);
+}
+
+std::unique_ptr<AVFrame, AVFrameDeleter> ResizeFrame(const AVFrame* frame,
+                                                     int target_size) {
+  ImageSize size = GetThumbnailSize({frame->width, frame->height}, target_size);
+  if (size.width == frame->width && size.height == frame->height) {
+    std::unique_ptr<AVFrame, AVFrameDeleter> clone(av_frame_clone(frame));
+    if (!clone) {
+      throw RuntimeError("av_frame_clone");
+    }
+    return clone;
+  }
+  return ScaleFrame(frame, size, AVPixelFormat(frame->format));
+}
+
+const AVCodec* GetEncoder(ThumbnailOptions options) {
+  auto* codec = avcodec_find_encoder(
+      options.codec == ThumbnailOptions::Codec::JPEG ? AV_CODEC_ID_MJPEG
+                                                     : AV_CODEC_ID_PNG);
+  if (!codec) {
+    throw LogicError("codec not found");
+  }
+  return codec;
+}
+
+AVPixelFormat GetEncoderPixelFormat(AVPixelFormat source,
+                                    const AVCodec* codec) {
   const AVPixelFormat* pix_fmts = nullptr;
   CheckAVError(avcodec_get_supported_config(
                    /*avctx=*/nullptr, codec, AV_CODEC_CONFIG_PIX_FORMAT,
@@ -313,21 +335,15 @@ auto ConvertFrame(const AVFrame* frame, const AVCodec* codec) {
     }
   }
   supported.emplace_back(AV_PIX_FMT_NONE);
-  AVPixelFormat format = avcodec_find_best_pix_fmt_of_list(
-      supported.data(), AVPixelFormat(frame->format), /*has_alpha=*/false,
-      /*loss_ptr=*/nullptr);
-  return ConvertFrame(frame, format);
+  return avcodec_find_best_pix_fmt_of_list(supported.data(), source,
+                                           /*has_alpha=*/false,
+                                           /*loss_ptr=*/nullptr);
 }
 
 std::string EncodeFrame(std::unique_ptr<AVFrame, AVFrameDeleter> input_frame,
                         ThumbnailOptions options,
                         std::atomic_bool* interrupted) {
-  auto* codec = avcodec_find_encoder(
-      options.codec == ThumbnailOptions::Codec::JPEG ? AV_CODEC_ID_MJPEG
-                                                     : AV_CODEC_ID_PNG);
-  if (!codec) {
-    throw LogicError("codec not found");
-  }
+  const AVCodec* codec = GetEncoder(options);
   int orientation = [&] {
     if (AVDictionaryEntry* entry =
             av_dict_get(input_frame->metadata, "Orientation", nullptr, 0)) {
@@ -343,7 +359,11 @@ std::string EncodeFrame(std::unique_ptr<AVFrame, AVFrameDeleter> input_frame,
     CheckAVError(av_dict_set_int(&input_frame->metadata, "Orientation", 1, 0),
                  "av_dict_set_int");
   }
-  auto frame = ConvertFrame(input_frame.get(), codec);
+  AVPixelFormat format =
+      GetEncoderPixelFormat(AVPixelFormat(input_frame->format), codec);
+  auto frame = input_frame->format == format
+                   ? std::move(input_frame)
+                   : ConvertFrame(input_frame.get(), format);
   std::unique_ptr<AVCodecContext, AVCodecContextDeleter> context(
       avcodec_alloc_context3(codec));
   if (!context) {
@@ -425,22 +445,102 @@ bool IsFrameBlack(const AVFrame* input) {
       input->format == format ? input : ConvertFrame(input, format).get());
 }
 
-auto GetThumbnailFrame(AVIOContext* io_context, ThumbnailOptions options,
-                       std::atomic_bool* interrupted) {
-  auto context = CreateFormatContext(io_context);
-  auto stream = av_find_best_stream(context.get(), AVMEDIA_TYPE_VIDEO, -1, -1,
-                                    nullptr, 0);
-  CheckAVError(stream, "av_find_best_stream");
+void SeekToThumbnailPosition(AVFormatContext* context) {
   if (context->duration > 0) {
-    if (int err = av_seek_frame(context.get(), -1, context->duration / 10, 0);
+    if (int err = av_seek_frame(context, -1, context->duration / 10, 0);
         err < 0) {
       if (err != AVERROR(EPERM)) {
-        CheckAVError(av_seek_frame(context.get(), 0, 0,
+        CheckAVError(av_seek_frame(context, 0, 0,
                                    AVSEEK_FLAG_BYTE | AVSEEK_FLAG_BACKWARD),
                      "av_seek_frame");
       }
     }
   }
+}
+
+int GetStreamOrientation(const AVStream* stream) {
+  const AVPacketSideData* stream_matrix =
+      av_packet_side_data_get(stream->codecpar->coded_side_data,
+                              stream->codecpar->nb_coded_side_data,
+                              AV_PKT_DATA_DISPLAYMATRIX);
+  if (stream_matrix != nullptr) {
+    return GetExifOrientation(
+        reinterpret_cast<const int32_t*>(stream_matrix->data));
+  } else {
+    return 0;
+  }
+}
+
+void SetFrameOrientation(AVFrame* frame, int stream_orientation) {
+  AVFrameSideData* frame_matrix =
+      av_frame_get_side_data(frame, AV_FRAME_DATA_DISPLAYMATRIX);
+  int orientation =
+      frame_matrix
+          ? GetExifOrientation(reinterpret_cast<int32_t*>(frame_matrix->data))
+          : stream_orientation;
+  if (orientation != 0) {
+    CheckAVError(
+        av_dict_set_int(&frame->metadata, "Orientation", orientation, 0),
+        "av_dict_set_int");
+  }
+}
+
+// Returns the largest power of two by which the decoder may shrink the image
+// while still producing at least the thumbnail's resolution.
+int GetLowres(const AVCodecParameters* codecpar, int target_size) {
+  const AVCodec* decoder = avcodec_find_decoder(codecpar->codec_id);
+  if (!decoder) {
+    return 0;
+  }
+  ImageSize size =
+      GetThumbnailSize({codecpar->width, codecpar->height}, target_size);
+  int lowres = 0;
+  while (lowres < decoder->max_lowres &&
+         (codecpar->width >> (lowres + 1)) >= size.width &&
+         (codecpar->height >> (lowres + 1)) >= size.height) {
+    lowres++;
+  }
+  return lowres;
+}
+
+auto GetKeyframeThumbnailFrame(AVIOContext* io_context,
+                               ThumbnailOptions options,
+                               std::atomic_bool* interrupted) {
+  auto context = CreateFormatContext(io_context);
+  auto stream = av_find_best_stream(context.get(), AVMEDIA_TYPE_VIDEO, -1, -1,
+                                    nullptr, 0);
+  CheckAVError(stream, "av_find_best_stream");
+  SeekToThumbnailPosition(context.get());
+  AVDictionary* codec_options = nullptr;
+  auto scope_guard = AtScopeExit([&] { av_dict_free(&codec_options); });
+  CheckAVError(av_dict_set(&codec_options, "skip_frame", "nokey", 0),
+               "av_dict_set");
+  int lowres = GetLowres(context->streams[stream]->codecpar, options.size);
+  CheckAVError(av_dict_set_int(&codec_options, "lowres", lowres, 0),
+               "av_dict_set_int");
+  auto codec_context =
+      CreateCodecContext(context.get(), stream, &codec_options);
+  auto frame = DecodeFrame(context.get(), codec_context.get(), stream,
+                           interrupted, /*keyframe_only=*/true);
+  if (!frame) {
+    throw LogicError("Couldn't extract any frame.");
+  }
+  SetFrameOrientation(frame.get(),
+                      GetStreamOrientation(context->streams[stream]));
+  ImageSize size =
+      GetThumbnailSize({frame->width, frame->height}, options.size);
+  return ScaleFrame(
+      frame.get(), size,
+      GetEncoderPixelFormat(AVPixelFormat(frame->format), GetEncoder(options)));
+}
+
+auto GetThumbnailFrame(AVIOContext* io_context, ThumbnailOptions options,
+                       std::atomic_bool* interrupted) {
+  auto context = CreateFormatContext(io_context);
+  auto stream = av_find_best_stream(context.get(), AVMEDIA_TYPE_VIDEO, -1, -1,
+                                    nullptr, 0);
+  CheckAVError(stream, "av_find_best_stream");
+  SeekToThumbnailPosition(context.get());
   auto codec_context = CreateCodecContext(context.get(), stream);
   auto size = GetThumbnailSize({codec_context->width, codec_context->height},
                                options.size);
@@ -453,18 +553,7 @@ auto GetThumbnailFrame(AVIOContext* io_context, ThumbnailOptions options,
   Graph thumbnail_graph =
       std::move(GraphBuilder(read_graph).AddFilter("thumbnail", {})).Build();
 
-  int stream_orientation = [&] {
-    const AVPacketSideData* stream_matrix = av_packet_side_data_get(
-        context->streams[stream]->codecpar->coded_side_data,
-        context->streams[stream]->codecpar->nb_coded_side_data,
-        AV_PKT_DATA_DISPLAYMATRIX);
-    if (stream_matrix != nullptr) {
-      return GetExifOrientation(
-          reinterpret_cast<const int32_t*>(stream_matrix->data));
-    } else {
-      return 0;
-    }
-  }();
+  int stream_orientation = GetStreamOrientation(context->streams[stream]);
 
   int read_frame_count = 0;
   int written_frame_count = 0;
@@ -488,27 +577,40 @@ auto GetThumbnailFrame(AVIOContext* io_context, ThumbnailOptions options,
     auto frame =
         DecodeFrame(context.get(), codec_context.get(), stream, interrupted);
     if (frame) {
-      AVFrameSideData* frame_matrix =
-          av_frame_get_side_data(frame.get(), AV_FRAME_DATA_DISPLAYMATRIX);
-      int orientation =
-          frame_matrix ? GetExifOrientation(
-                             reinterpret_cast<int32_t*>(frame_matrix->data))
-                       : stream_orientation;
-      if (orientation != 0) {
-        CheckAVError(
-            av_dict_set_int(&frame->metadata, "Orientation", orientation, 0),
-            "av_dict_set_int");
-      }
+      SetFrameOrientation(frame.get(), stream_orientation);
     }
     read_frame_count++;
     read_graph.WriteFrame(read_frame_count < 200 ? frame.get() : nullptr);
   }
 }
 
-std::string GenerateThumbnail(AVIOContext* io_context, ThumbnailOptions options,
-                              std::atomic_bool* interrupted) {
-  return EncodeFrame(GetThumbnailFrame(io_context, options, interrupted),
-                     options, interrupted);
+std::vector<std::string> GenerateThumbnails(
+    AVIOContext* io_context, std::span<const ThumbnailOptions> renditions,
+    std::atomic_bool* interrupted) {
+  if (renditions.empty()) {
+    return {};
+  }
+  const ThumbnailOptions& largest = *std::max_element(
+      renditions.begin(), renditions.end(),
+      [](const auto& a, const auto& b) { return a.size < b.size; });
+  auto frame = largest.keyframe_only
+                   ? GetKeyframeThumbnailFrame(io_context, largest, interrupted)
+                   : GetThumbnailFrame(io_context, largest, interrupted);
+  std::vector<std::string> thumbnails;
+  for (size_t i = 0; i < renditions.size(); i++) {
+    const ThumbnailOptions& options = renditions[i];
+    auto same = std::find_if(
+        renditions.begin(), renditions.begin() + i, [&](const auto& other) {
+          return other.size == options.size && other.codec == options.codec;
+        });
+    if (same != renditions.begin() + i) {
+      thumbnails.emplace_back(thumbnails[same - renditions.begin()]);
+    } else {
+      thumbnails.emplace_back(EncodeFrame(
+          ResizeFrame(frame.get(), options.size), options, interrupted));
+    }
+  }
+  return thumbnails;
 }
 
 }  // namespace
@@ -516,18 +618,30 @@ std::string GenerateThumbnail(AVIOContext* io_context, ThumbnailOptions options,
 Task<std::string> ThumbnailGenerator::operator()(
     const AbstractCloudProvider* provider, AbstractCloudProvider::File file,
     ThumbnailOptions options, stdx::stop_token stop_token) const {
+  auto thumbnails = co_await (*this)(provider, std::move(file),
+                                     std::vector<ThumbnailOptions>{options},
+                                     std::move(stop_token));
+  co_return std::move(thumbnails[0]);
+}
+
+Task<std::vector<std::string>> ThumbnailGenerator::operator()(
+    const AbstractCloudProvider* provider, AbstractCloudProvider::File file,
+    std::vector<ThumbnailOptions> renditions,
+    stdx::stop_token stop_token) const {
   std::unique_ptr<AVIOContext, AVIOContextDeleter> io_context;
   std::atomic_bool interrupted = false;
   stdx::stop_callback cb(stop_token, [&] { interrupted = true; });
-  co_return co_await thread_pool_->Do(stop_token, [&] {
-    try {
-      io_context = CreateIOContext(event_loop_, provider, std::move(file),
-                                   std::move(stop_token));
-      return GenerateThumbnail(io_context.get(), options, &interrupted);
-    } catch (const std::exception& e) {
-      throw ThumbnailGeneratorException(e.what());
-    }
-  });
+  co_return co_await scheduler_->Do(
+      ThreadPoolScheduler::Priority::kThumbnail, stop_token, [&] {
+        try {
+          io_context = CreateIOContext(event_loop_, provider, std::move(file),
+                                       std::move(stop_token));
+          return GenerateThumbnails(io_context.get(), renditions,
+                                    &interrupted);
+        } catch (const std::exception& e) {
+          throw ThumbnailGeneratorException(e.what());
+        }
+      });
 }
 
 }  // namespace coro::cloudstorage::util
@@ -1,10 +1,13 @@
 #ifndef CORO_CLOUDSTORAGE_UTIL_GENERATE_THUMBNAIL_H
 #define CORO_CLOUDSTORAGE_UTIL_GENERATE_THUMBNAIL_H
 
+#include <string>
+#include <vector>
+
 #include "coro/cloudstorage/util/abstract_cloud_provider.h"
+#include "coro/cloudstorage/util/thread_pool_scheduler.h"
 #include "coro/cloudstorage/util/thumbnail_options.h"
 #include "coro/task.h"
-#include "coro/util/thread_pool.h"
 
 namespace coro::cloudstorage::util {
 
@@ -21,17 +24,25 @@ class ThumbnailGeneratorException : public std::exception {
 
 class ThumbnailGenerator {
  public:
-  ThumbnailGenerator(coro::util::ThreadPool* thread_pool,
+  ThumbnailGenerator(ThreadPoolScheduler* scheduler,
                      const coro::util::EventLoop* event_loop)
-      : thread_pool_(thread_pool), event_loop_(event_loop) {}
+      : scheduler_(scheduler), event_loop_(event_loop) {}
 
   Task<std::string> operator()(const AbstractCloudProvider* provider,
                                AbstractCloudProvider::File file,
                                ThumbnailOptions options,
                                stdx::stop_token stop_token) const;
 
+  // Decodes the file once and encodes the picked frame with each of
+  // `renditions`, in order. The frame is picked at the size of the largest
+  // rendition. Renditions of the same size and codec are encoded once.
+  Task<std::vector<std::string>> operator()(
+      const AbstractCloudProvider* provider, AbstractCloudProvider::File file,
+      std::vector<ThumbnailOptions> renditions,
+      stdx::stop_token stop_token) const;
+
  private:
-  coro::util::ThreadPool* thread_pool_;
+  ThreadPoolScheduler* scheduler_;
   const coro::util::EventLoop* event_loop_;
 };
 
@@ -6,6 +6,10 @@ namespace coro::cloudstorage::util {
 struct ThumbnailOptions {
   int size = 256;
   enum class Codec { PNG, JPEG } codec;
+  // Takes the first keyframe at or after the seek point, decoded at reduced
+  // resolution where the decoder supports it, instead of picking the most
+  // representative out of the following couple hundred frames.
+  bool keyframe_only = false;
 };
 
 }  // namespace coro::cloudstorage::util
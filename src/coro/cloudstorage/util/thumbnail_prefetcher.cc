@@ -0,0 +1,185 @@
+#include "coro/cloudstorage/util/thumbnail_prefetcher.h"
+
+#include <iterator>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "coro/cloudstorage/util/cloud_provider_utils.h"
+#include "coro/cloudstorage/util/string_utils.h"
+#include "coro/util/stop_token_or.h"
+
+namespace coro::cloudstorage::util {
+
+namespace {
+
+using ::coro::RunTask;
+using ::coro::util::MakeUniqueStopTokenOr;
+
+constexpr size_t kMaxQueueSize = 1024;
+
+std::string GetKey(const CacheManager::AccountKey& account,
+                   std::string_view item_id) {
+  return StrCat(account.provider->GetId(), '|', account.username, '|',
+                item_id);
+}
+
+}  // namespace
+
+ThumbnailPrefetcher::ThumbnailPrefetcher(
+    const ThumbnailGenerator* thumbnail_generator, CacheManager* cache_manager,
+    const Clock* clock, int max_concurrent_jobs)
+    : thumbnail_generator_(thumbnail_generator),
+      cache_manager_(cache_manager),
+      clock_(clock),
+      max_concurrent_jobs_(max_concurrent_jobs) {}
+
+ThumbnailPrefetcher::~ThumbnailPrefetcher() { stop_source_.request_stop(); }
+
+void ThumbnailPrefetcher::Enqueue(
+    CacheManager::AccountKey account,
+    std::span<const AbstractCloudProvider::Item> items,
+    stdx::stop_token stop_token) {
+  int64_t listing = ++listing_count_;
+  std::vector<AbstractCloudProvider::File> files;
+  for (const auto& item : items) {
+    const auto* file = std::get_if<AbstractCloudProvider::File>(&item);
+    if (!file) {
+      continue;
+    }
+    FileType type = GetFileType(file->mime_type);
+    if (type == FileType::kImage || type == FileType::kVideo) {
+      files.push_back(*file);
+    }
+  }
+  if (files.empty()) {
+    return;
+  }
+  RunTask([d = this, account = std::move(account), files = std::move(files),
+           listing, account_stop_token = std::move(stop_token),
+           stop_token = stop_source_.get_token()]() mutable -> Task<> {
+    std::vector<std::string> ids;
+    for (const auto& file : files) {
+      ids.push_back(file.id);
+    }
+    std::unordered_set<std::string> cached;
+    try {
+      cached = co_await d->cache_manager_->GetImageItemIds(
+          account, std::move(ids), ThumbnailQuality::kLow, stop_token);
+    } catch (...) {
+    }
+    if (stop_token.stop_requested()) {
+      co_return;
+    }
+    std::erase_if(files, [&](const AbstractCloudProvider::File& file) {
+      return cached.contains(file.id);
+    });
+    d->Queue(std::move(account), std::move(files), listing,
+             std::move(account_stop_token));
+  });
+}
+
+Task<std::optional<CacheManager::ImageData>> ThumbnailPrefetcher::Claim(
+    CacheManager::AccountKey account, AbstractCloudProvider::File file,
+    stdx::stop_token stop_token) {
+  std::string key = GetKey(account, file.id);
+  if (auto it = queued_.find(key); it != queued_.end()) {
+    queue_.erase(it->second.priority);
+    queued_.erase(it);
+    co_return std::nullopt;
+  }
+  if (auto it = running_.find(key); it != running_.end()) {
+    auto job = it->second;
+    try {
+      co_return co_await job->Get(stop_token);
+    } catch (...) {
+      if (stop_token.stop_requested()) {
+        throw;
+      }
+    }
+  }
+  co_return std::nullopt;
+}
+
+void ThumbnailPrefetcher::Queue(CacheManager::AccountKey account,
+                                std::vector<AbstractCloudProvider::File> files,
+                                int64_t listing, stdx::stop_token stop_token) {
+  int64_t position = 0;
+  for (auto& file : files) {
+    std::string key = GetKey(account, file.id);
+    if (running_.contains(key)) {
+      continue;
+    }
+    Priority priority{
+        .listing = listing,
+        .is_video = GetFileType(file.mime_type) == FileType::kVideo,
+        .position = position++};
+    if (auto it = queued_.find(key); it != queued_.end()) {
+      queue_.erase(it->second.priority);
+      it->second.priority = priority;
+    } else {
+      queued_.emplace(key, QueuedFile{.account = account,
+                                      .file = std::move(file),
+                                      .stop_token = stop_token,
+                                      .priority = priority});
+    }
+    queue_.emplace(priority, std::move(key));
+  }
+  while (queue_.size() > kMaxQueueSize) {
+    auto last = std::prev(queue_.end());
+    queued_.erase(last->second);
+    queue_.erase(last);
+  }
+  StartJobs();
+}
+
+void ThumbnailPrefetcher::StartJobs() {
+  while (static_cast<int>(running_.size()) < max_concurrent_jobs_ &&
+         !queue_.empty()) {
+    auto it = queued_.find(queue_.begin()->second);
+    queue_.erase(queue_.begin());
+    QueuedFile queued = std::move(it->second);
+    queued_.erase(it);
+    if (queued.stop_token.stop_requested()) {
+      continue;
+    }
+    std::string key = GetKey(queued.account, queued.file.id);
+    auto job = std::make_shared<SharedPromise<GenerateThumbnail>>(
+        GenerateThumbnail{.thumbnail_generator = thumbnail_generator_,
+                          .cache_manager = cache_manager_,
+                          .clock = clock_,
+                          .account = std::move(queued.account),
+                          .file = std::move(queued.file),
+                          .account_stop_token = std::move(queued.stop_token),
+                          .stop_token = stop_source_.get_token()});
+    running_.emplace(key, job);
+    RunTask([d = this, key = std::move(key), job = std::move(job),
+             stop_token = stop_source_.get_token()]() -> Task<> {
+      try {
+        co_await job->Get(stop_token);
+      } catch (...) {
+      }
+      if (!stop_token.stop_requested()) {
+        d->running_.erase(key);
+        d->StartJobs();
+      }
+    });
+  }
+}
+
+Task<CacheManager::ImageData>
+ThumbnailPrefetcher::GenerateThumbnail::operator()() const {
+  auto stop_token_or = MakeUniqueStopTokenOr(account_stop_token, stop_token);
+  if (auto cached = co_await cache_manager->Get(
+          account,
+          CacheManager::ImageKey{.item_id = file.id,
+                                 .quality = ThumbnailQuality::kLow},
+          stop_token_or->GetToken())) {
+    co_return std::move(*cached);
+  }
+  co_return co_await PrefetchThumbnail(thumbnail_generator, cache_manager,
+                                      account, file, clock->Now(),
+                                      stop_token_or->GetToken());
+}
+
+}  // namespace coro::cloudstorage::util
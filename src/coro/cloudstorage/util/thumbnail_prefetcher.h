@@ -0,0 +1,103 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_THUMBNAIL_PREFETCHER_H
+#define CORO_CLOUDSTORAGE_UTIL_THUMBNAIL_PREFETCHER_H
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "coro/cloudstorage/util/abstract_cloud_provider.h"
+#include "coro/cloudstorage/util/cache_manager.h"
+#include "coro/cloudstorage/util/clock.h"
+#include "coro/cloudstorage/util/thumbnail_generator.h"
+#include "coro/shared_promise.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+
+namespace coro::cloudstorage::util {
+
+// Generates low quality thumbnails of listed media files ahead of time and
+// stores them in the cache. Generated video thumbnails use the first keyframe
+// after the seek point, see `PrefetchThumbnail`. Must only be used from the
+// event loop thread.
+class ThumbnailPrefetcher {
+ public:
+  ThumbnailPrefetcher(const ThumbnailGenerator* thumbnail_generator,
+                      CacheManager* cache_manager, const Clock* clock,
+                      int max_concurrent_jobs);
+  ThumbnailPrefetcher(const ThumbnailPrefetcher&) = delete;
+  ~ThumbnailPrefetcher();
+
+  ThumbnailPrefetcher& operator=(const ThumbnailPrefetcher&) = delete;
+
+  // Queues images and videos out of `items` whose low quality thumbnail isn't
+  // cached yet. Files from the most recent call are processed first.
+  void Enqueue(CacheManager::AccountKey account,
+               std::span<const AbstractCloudProvider::Item> items,
+               stdx::stop_token stop_token);
+
+  // Lets an on-demand request jump the queue. If the thumbnail is being
+  // generated in the background, waits for that job and returns its result;
+  // if it is only queued, drops it. Returns nothing if the thumbnail is to be
+  // generated by the caller, including when the background job fails.
+  Task<std::optional<CacheManager::ImageData>> Claim(
+      CacheManager::AccountKey account, AbstractCloudProvider::File file,
+      stdx::stop_token stop_token);
+
+ private:
+  struct Priority {
+    int64_t listing;
+    bool is_video;
+    int64_t position;
+
+    friend bool operator<(const Priority& a, const Priority& b) {
+      return std::make_tuple(-a.listing, a.is_video, a.position) <
+             std::make_tuple(-b.listing, b.is_video, b.position);
+    }
+  };
+
+  struct QueuedFile {
+    CacheManager::AccountKey account;
+    AbstractCloudProvider::File file;
+    stdx::stop_token stop_token;
+    Priority priority;
+  };
+
+  struct GenerateThumbnail {
+    Task<CacheManager::ImageData> operator()() const;
+
+    const ThumbnailGenerator* thumbnail_generator;
+    CacheManager* cache_manager;
+    const Clock* clock;
+    CacheManager::AccountKey account;
+    AbstractCloudProvider::File file;
+    stdx::stop_token account_stop_token;
+    stdx::stop_token stop_token;
+  };
+
+  void Queue(CacheManager::AccountKey account,
+             std::vector<AbstractCloudProvider::File> files, int64_t listing,
+             stdx::stop_token stop_token);
+  void StartJobs();
+
+  const ThumbnailGenerator* thumbnail_generator_;
+  CacheManager* cache_manager_;
+  const Clock* clock_;
+  int max_concurrent_jobs_;
+  int64_t listing_count_ = 0;
+  std::map<Priority, std::string> queue_;
+  std::unordered_map<std::string, QueuedFile> queued_;
+  std::unordered_map<std::string,
+                     std::shared_ptr<SharedPromise<GenerateThumbnail>>>
+      running_;
+  stdx::stop_source stop_source_;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_THUMBNAIL_PREFETCHER_H
@@ -23,6 +23,16 @@ AbstractCloudProvider::Item TimingOutCloudProvider::ToItem(
   return provider_->ToItem(json);
 }
 
+std::string TimingOutCloudProvider::EncodeItemData(
+    const AbstractCloudProvider::Item& item) const {
+  return provider_->EncodeItemData(item);
+}
+
+void TimingOutCloudProvider::DecodeItemData(
+    std::string_view data, AbstractCloudProvider::Item& item) const {
+  provider_->DecodeItemData(data, item);
+}
+
 Task<AbstractCloudProvider::Directory> TimingOutCloudProvider::GetRoot(
     stdx::stop_token stop_token) const {
   auto context_token = CreateStopToken("GetRoot", std::move(stop_token));
@@ -45,6 +55,37 @@ Task<AbstractCloudProvider::PageData> TimingOutCloudProvider::ListDirectoryPage(
       std::move(directory), std::move(page_token), context_token.GetToken());
 }
 
+bool TimingOutCloudProvider::IsSearchSupported() const {
+  return provider_->IsSearchSupported();
+}
+
+Task<AbstractCloudProvider::PageData> TimingOutCloudProvider::SearchItemsPage(
+    std::string query, std::optional<std::string> page_token,
+    stdx::stop_token stop_token) const {
+  auto context_token =
+      CreateStopToken("SearchItemsPage", std::move(stop_token));
+  co_return co_await provider_->SearchItemsPage(
+      std::move(query), std::move(page_token), context_token.GetToken());
+}
+
+bool TimingOutCloudProvider::IsChangeFeedSupported() const {
+  return provider_->IsChangeFeedSupported();
+}
+
+Task<std::string> TimingOutCloudProvider::GetChangeCursor(
+    stdx::stop_token stop_token) const {
+  auto context_token =
+      CreateStopToken("GetChangeCursor", std::move(stop_token));
+  co_return co_await provider_->GetChangeCursor(context_token.GetToken());
+}
+
+Task<AbstractCloudProvider::ChangePage> TimingOutCloudProvider::GetChanges(
+    std::string cursor, stdx::stop_token stop_token) const {
+  auto context_token = CreateStopToken("GetChanges", std::move(stop_token));
+  co_return co_await provider_->GetChanges(std::move(cursor),
+                                           context_token.GetToken());
+}
+
 Task<AbstractCloudProvider::GeneralData> TimingOutCloudProvider::GetGeneralData(
     stdx::stop_token stop_token) const {
   auto context_token = CreateStopToken("GetGeneralData", std::move(stop_token));
@@ -1,6 +1,8 @@
 #ifndef CORO_CLOUDSTORAGE_UTIL_TIMING_OUT_CLOUD_PROVIDER_H
 #define CORO_CLOUDSTORAGE_UTIL_TIMING_OUT_CLOUD_PROVIDER_H
 
+#include <string>
+#include <string_view>
 #include <utility>
 
 #include "coro/cloudstorage/util/abstract_cloud_provider.h"
@@ -25,6 +27,12 @@ class TimingOutCloudProvider : public AbstractCloudProvider {
 
   AbstractCloudProvider::Item ToItem(const nlohmann::json&) const override;
 
+  std::string EncodeItemData(
+      const AbstractCloudProvider::Item& item) const override;
+
+  void DecodeItemData(std::string_view data,
+                      AbstractCloudProvider::Item& item) const override;
+
   Task<AbstractCloudProvider::Directory> GetRoot(
       stdx::stop_token stop_token) const override;
 
@@ -36,6 +44,20 @@ class TimingOutCloudProvider : public AbstractCloudProvider {
       std::optional<std::string> page_token,
       stdx::stop_token stop_token) const override;
 
+  bool IsSearchSupported() const override;
+
+  Task<AbstractCloudProvider::PageData> SearchItemsPage(
+      std::string query, std::optional<std::string> page_token,
+      stdx::stop_token stop_token) const override;
+
+  bool IsChangeFeedSupported() const override;
+
+  Task<std::string> GetChangeCursor(
+      stdx::stop_token stop_token) const override;
+
+  Task<AbstractCloudProvider::ChangePage> GetChanges(
+      std::string cursor, stdx::stop_token stop_token) const override;
+
   Task<AbstractCloudProvider::GeneralData> GetGeneralData(
       stdx::stop_token stop_token) const override;
 
@@ -0,0 +1,151 @@
+#include "coro/cloudstorage/util/transfer_handler.h"
+
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+#include "coro/cloudstorage/cloud_exception.h"
+#include "coro/cloudstorage/util/cloud_provider_utils.h"
+#include "coro/cloudstorage/util/string_utils.h"
+#include "coro/util/stop_token_or.h"
+#include "coro/when_all.h"
+
+namespace coro::cloudstorage::util {
+
+namespace {
+
+using ::coro::util::MakeUniqueStopTokenOr;
+
+std::optional<CloudProviderAccount> FindAccount(
+    std::span<const CloudProviderAccount> accounts,
+    const CloudProviderAccount::Id& account_id) {
+  for (const auto& account : accounts) {
+    if (account.id() == account_id) {
+      return account;
+    }
+  }
+  return std::nullopt;
+}
+
+std::string_view ToString(TransferManager::JobState state) {
+  switch (state) {
+    case TransferManager::JobState::kRunning:
+      return "running";
+    case TransferManager::JobState::kDone:
+      return "done";
+    case TransferManager::JobState::kFailed:
+      return "failed";
+    case TransferManager::JobState::kCancelled:
+      return "cancelled";
+  }
+  throw std::invalid_argument("invalid job state");
+}
+
+nlohmann::json ToJson(const TransferManager::JobStatus& status) {
+  nlohmann::json json;
+  json["id"] = status.id;
+  json["name"] = status.name;
+  json["state"] = ToString(status.state);
+  json["file_count"] = status.file_count;
+  json["total_bytes"] = status.total_bytes;
+  json["listing_complete"] = status.listing_complete;
+  json["transferred_file_count"] = status.transferred_file_count;
+  json["transferred_bytes"] = status.transferred_bytes;
+  json["failed_item_count"] = status.failed_item_count;
+  json["throughput"] = status.throughput;
+  if (status.eta) {
+    json["eta"] = *status.eta;
+  }
+  if (status.error) {
+    json["error"] = *status.error;
+  }
+  return json;
+}
+
+http::Response<> ToResponse(int status, const nlohmann::json& json) {
+  return http::Response<>{.status = status,
+                          .headers = {{"Content-Type", "application/json"}},
+                          .body = http::CreateBody(json.dump())};
+}
+
+}  // namespace
+
+auto TransferHandler::operator()(Request request,
+                                 stdx::stop_token stop_token) const
+    -> Task<Response> {
+  auto uri = http::ParseUri(request.url);
+  auto components = SplitString(uri.path.value_or(""), '/');
+  if (components.empty() || components.size() > 2) {
+    co_return Response{.status = 404};
+  }
+  if (components.size() == 2) {
+    int64_t id;
+    try {
+      id = std::stoll(components[1]);
+    } catch (const std::exception&) {
+      co_return Response{.status = 404};
+    }
+    if (request.method == http::Method::kGet) {
+      auto status = transfer_manager->GetJob(id);
+      if (!status) {
+        co_return Response{.status = 404};
+      }
+      co_return ToResponse(200, ToJson(*status));
+    } else if (request.method == http::Method::kDelete) {
+      co_return Response{.status = transfer_manager->Remove(id) ? 204 : 404};
+    } else {
+      co_return Response{.status = 405};
+    }
+  }
+  if (request.method == http::Method::kGet) {
+    nlohmann::json json = nlohmann::json::array();
+    for (const auto& status : transfer_manager->GetJobs()) {
+      json.push_back(ToJson(status));
+    }
+    co_return ToResponse(200, json);
+  }
+  if (request.method != http::Method::kPost) {
+    co_return Response{.status = 405};
+  }
+  auto query = http::ParseQuery(uri.query.value_or(""));
+  auto source_type = query.find("source_type");
+  auto source_username = query.find("source_username");
+  auto source_id = query.find("source_id");
+  auto destination_type = query.find("destination_type");
+  auto destination_username = query.find("destination_username");
+  auto destination_id = query.find("destination_id");
+  if (source_type == query.end() || source_username == query.end() ||
+      source_id == query.end() || destination_type == query.end() ||
+      destination_username == query.end() ||
+      destination_id == query.end()) {
+    co_return Response{.status = 400};
+  }
+  auto source_account = FindAccount(
+      accounts, {source_type->second, source_username->second});
+  auto destination_account = FindAccount(
+      accounts, {destination_type->second, destination_username->second});
+  if (!source_account || !destination_account) {
+    co_return Response{.status = 404};
+  }
+  auto stop_token_or = MakeUniqueStopTokenOr(source_account->stop_token(),
+                                             destination_account->stop_token(),
+                                             std::move(stop_token));
+  auto [source, destination] = co_await WhenAll(
+      GetItemById(source_account->provider().get(), source_id->second,
+                  stop_token_or->GetToken()),
+      GetItemById(destination_account->provider().get(),
+                  destination_id->second, stop_token_or->GetToken()));
+  auto* destination_directory =
+      std::get_if<AbstractCloudProvider::Directory>(&destination);
+  if (!destination_directory) {
+    co_return Response{.status = 400};
+  }
+  nlohmann::json json;
+  json["id"] = transfer_manager->Start(*source_account, std::move(source),
+                                       *destination_account,
+                                       std::move(*destination_directory));
+  co_return ToResponse(201, json);
+}
+
+}  // namespace coro::cloudstorage::util
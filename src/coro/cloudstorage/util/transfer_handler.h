@@ -0,0 +1,32 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_TRANSFER_HANDLER_H
+#define CORO_CLOUDSTORAGE_UTIL_TRANSFER_HANDLER_H
+
+#include <span>
+
+#include "coro/cloudstorage/util/cloud_provider_account.h"
+#include "coro/cloudstorage/util/transfer_manager.h"
+#include "coro/http/http.h"
+#include "coro/http/http_parse.h"
+#include "coro/stdx/stop_token.h"
+
+namespace coro::cloudstorage::util {
+
+// Job API of `TransferManager`:
+//   POST /transfer?source_type=&source_username=&source_id=
+//                  &destination_type=&destination_username=&destination_id=
+//     starts copying the source item into the destination directory,
+//   GET /transfer lists the jobs, GET /transfer/<id> returns one of them,
+//   DELETE /transfer/<id> cancels a running job or forgets a finished one.
+struct TransferHandler {
+  using Request = http::Request<>;
+  using Response = http::Response<>;
+
+  Task<Response> operator()(Request request, stdx::stop_token stop_token) const;
+
+  TransferManager* transfer_manager;
+  std::span<const CloudProviderAccount> accounts;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_TRANSFER_HANDLER_H
@@ -0,0 +1,461 @@
+#include "coro/cloudstorage/util/transfer_manager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <utility>
+
+#include "coro/cloudstorage/util/exception_utils.h"
+#include "coro/cloudstorage/util/string_utils.h"
+#include "coro/exception.h"
+#include "coro/promise.h"
+#include "coro/stdx/stop_callback.h"
+#include "coro/util/raii_utils.h"
+#include "coro/util/stop_token_or.h"
+
+namespace coro::cloudstorage::util {
+
+namespace {
+
+using ::coro::RunTask;
+using ::coro::util::AtScopeExit;
+using ::coro::util::MakeUniqueStopTokenOr;
+
+// How much data read from the source may wait for the destination to take
+// it, per file.
+constexpr size_t kPipeCapacity = 8 * 1024 * 1024;
+constexpr int kMaxConcurrentListingCount = 4;
+constexpr int kMaxConcurrentJobCount = 4;
+constexpr size_t kMaxFinishedJobCount = 64;
+constexpr auto kThroughputWindow = std::chrono::seconds(10);
+constexpr auto kThroughputSampleInterval = std::chrono::seconds(1);
+
+struct Pipe {
+  std::deque<std::string> chunks;
+  size_t size = 0;
+  bool eof = false;
+  bool closed = false;
+  std::exception_ptr exception;
+  Promise<void>* reader_ready = nullptr;
+  Promise<void>* writer_ready = nullptr;
+};
+
+void Resume(Promise<void>*& ready) {
+  if (auto* promise = std::exchange(ready, nullptr)) {
+    promise->SetValue();
+  }
+}
+
+Task<> FillPipe(std::shared_ptr<Pipe> pipe,
+                std::shared_ptr<AbstractCloudProvider> provider,
+                AbstractCloudProvider::File file, stdx::stop_token stop_token) {
+  try {
+    auto data = provider->GetFileContent(std::move(file), http::Range{},
+                                         std::move(stop_token));
+    FOR_CO_AWAIT(std::string & chunk, data) {
+      while (pipe->size >= kPipeCapacity && !pipe->closed) {
+        Promise<void> ready;
+        pipe->writer_ready = &ready;
+        co_await ready;
+      }
+      if (pipe->closed) {
+        co_return;
+      }
+      pipe->size += chunk.size();
+      pipe->chunks.emplace_back(std::move(chunk));
+      Resume(pipe->reader_ready);
+    }
+  } catch (...) {
+    pipe->exception = std::current_exception();
+  }
+  pipe->eof = true;
+  Resume(pipe->reader_ready);
+}
+
+Generator<std::string> ReadPipe(std::shared_ptr<Pipe> pipe) {
+  auto scope_guard = AtScopeExit([&] {
+    pipe->closed = true;
+    pipe->reader_ready = nullptr;
+    Resume(pipe->writer_ready);
+  });
+  while (true) {
+    if (!pipe->chunks.empty()) {
+      std::string chunk = std::move(pipe->chunks.front());
+      pipe->chunks.pop_front();
+      pipe->size -= chunk.size();
+      Resume(pipe->writer_ready);
+      co_yield std::move(chunk);
+    } else if (pipe->eof) {
+      if (pipe->exception) {
+        std::rethrow_exception(pipe->exception);
+      }
+      co_return;
+    } else {
+      Promise<void> ready;
+      pipe->reader_ready = &ready;
+      co_await ready;
+    }
+  }
+}
+
+}  // namespace
+
+// Admits at most `capacity` holders at a time, in the order in which they
+// asked.
+class TransferManager::Limiter {
+ public:
+  Limiter(const coro::util::EventLoop* event_loop, int capacity)
+      : event_loop_(event_loop), capacity_(std::max(capacity, 1)) {}
+
+  Task<> Acquire(stdx::stop_token stop_token) {
+    if (stop_token.stop_requested()) {
+      throw InterruptedException();
+    }
+    std::erase_if(waiters_, [](const auto& waiter) { return waiter->done; });
+    if (waiters_.empty() && count_ < capacity_) {
+      count_++;
+      co_return;
+    }
+    auto waiter = std::make_shared<Waiter>();
+    waiters_.push_back(waiter);
+    stdx::stop_callback stop_callback(stop_token, [this, waiter] {
+      event_loop_->RunOnEventLoop([waiter] {
+        if (!waiter->done) {
+          waiter->done = true;
+          waiter->promise.SetException(
+              std::make_exception_ptr(InterruptedException()));
+        }
+      });
+    });
+    co_await waiter->promise;
+  }
+
+  void Release() {
+    count_--;
+    while (!waiters_.empty() && count_ < capacity_) {
+      auto waiter = std::move(waiters_.front());
+      waiters_.pop_front();
+      if (!waiter->done) {
+        waiter->done = true;
+        count_++;
+        waiter->promise.SetValue();
+      }
+    }
+  }
+
+ private:
+  struct Waiter {
+    Promise<void> promise;
+    bool done = false;
+  };
+
+  const coro::util::EventLoop* event_loop_;
+  int capacity_;
+  int count_ = 0;
+  std::deque<std::shared_ptr<Waiter>> waiters_;
+};
+
+struct TransferManager::Job {
+  using Clock = std::chrono::steady_clock;
+
+  Job(int64_t id, std::string name, CloudProviderAccount source,
+      CloudProviderAccount destination,
+      std::shared_ptr<Limiter> upload_limiter,
+      const coro::util::EventLoop* event_loop)
+      : id(id),
+        name(std::move(name)),
+        source(std::move(source)),
+        destination(std::move(destination)),
+        upload_limiter(std::move(upload_limiter)),
+        listing_limiter(event_loop, kMaxConcurrentListingCount) {}
+
+  void AddTransferredBytes(int64_t size) {
+    transferred_bytes += size;
+    auto now = Clock::now();
+    if (samples.empty() ||
+        now - samples.back().first >= kThroughputSampleInterval) {
+      samples.emplace_back(now, transferred_bytes);
+    }
+    while (now - samples.front().first > kThroughputWindow) {
+      samples.pop_front();
+    }
+  }
+
+  JobStatus GetStatus() const {
+    JobStatus status{.id = id,
+                     .name = name,
+                     .state = state,
+                     .file_count = file_count,
+                     .total_bytes = total_bytes,
+                     .listing_complete = pending_listing_count == 0,
+                     .transferred_file_count = transferred_file_count,
+                     .transferred_bytes = transferred_bytes,
+                     .failed_item_count = failed_item_count,
+                     .throughput = 0,
+                     .error = error};
+    if (state != JobState::kRunning) {
+      return status;
+    }
+    auto now = Clock::now();
+    auto it = std::find_if(samples.begin(), samples.end(), [&](const auto& s) {
+      return now - s.first <= kThroughputWindow;
+    });
+    if (it != samples.end() && now > it->first) {
+      status.throughput =
+          static_cast<double>(transferred_bytes - it->second) /
+          std::chrono::duration<double>(now - it->first).count();
+    }
+    if (status.listing_complete && status.throughput > 0) {
+      status.eta = static_cast<int64_t>(
+          static_cast<double>(std::max<int64_t>(
+              total_bytes - transferred_bytes, 0)) /
+          status.throughput);
+    }
+    return status;
+  }
+
+  int64_t id;
+  std::string name;
+  CloudProviderAccount source;
+  CloudProviderAccount destination;
+  std::shared_ptr<Limiter> upload_limiter;
+  Limiter listing_limiter;
+  JobState state = JobState::kRunning;
+  int64_t file_count = 0;
+  int64_t total_bytes = 0;
+  int64_t pending_listing_count = 0;
+  int64_t transferred_file_count = 0;
+  int64_t transferred_bytes = 0;
+  int64_t failed_item_count = 0;
+  // Items started by `StartItem` which are not done yet.
+  int64_t running_item_count = 0;
+  // Resumed once `running_item_count` drops to zero.
+  Promise<void>* idle = nullptr;
+  std::optional<std::string> error;
+  // Pairs of time and `transferred_bytes` at that time.
+  std::deque<std::pair<Clock::time_point, int64_t>> samples;
+  stdx::stop_source stop_source;
+};
+
+TransferManager::TransferManager(const coro::util::EventLoop* event_loop,
+                                 int max_concurrent_uploads_per_account)
+    : event_loop_(event_loop),
+      max_concurrent_uploads_per_account_(max_concurrent_uploads_per_account),
+      job_limiter_(
+          std::make_shared<Limiter>(event_loop, kMaxConcurrentJobCount)) {}
+
+TransferManager::~TransferManager() { stop_source_.request_stop(); }
+
+int64_t TransferManager::Start(
+    CloudProviderAccount source_account, AbstractCloudProvider::Item source,
+    CloudProviderAccount destination_account,
+    AbstractCloudProvider::Directory destination_parent) {
+  if (jobs_.size() >= kMaxFinishedJobCount) {
+    std::vector<int64_t> finished;
+    for (const auto& [id, job] : jobs_) {
+      if (job->state != JobState::kRunning) {
+        finished.push_back(id);
+      }
+    }
+    std::sort(finished.begin(), finished.end());
+    for (size_t i = 0; i + kMaxFinishedJobCount <= finished.size(); i++) {
+      jobs_.erase(finished[i]);
+    }
+  }
+  int64_t id = next_job_id_++;
+  auto upload_limiter = GetUploadLimiter(destination_account);
+  auto job = std::make_shared<Job>(
+      id, std::visit([](const auto& d) { return d.name; }, source),
+      std::move(source_account), std::move(destination_account),
+      std::move(upload_limiter), event_loop_);
+  OnItemFound(job.get(), source);
+  jobs_.emplace(id, job);
+  RunTask([job = std::move(job), job_limiter = job_limiter_,
+           source = std::move(source),
+           destination_parent = std::move(destination_parent),
+           stop_token = stop_source_.get_token()]() mutable -> Task<> {
+    auto stop_token_or = MakeUniqueStopTokenOr(
+        job->source.stop_token(), job->destination.stop_token(),
+        job->stop_source.get_token(), stop_token);
+    try {
+      co_await job_limiter->Acquire(stop_token_or->GetToken());
+      auto job_guard = AtScopeExit([&] { job_limiter->Release(); });
+      co_await job->upload_limiter->Acquire(stop_token_or->GetToken());
+      StartItem(job, std::move(source), std::move(destination_parent),
+                stop_token_or->GetToken());
+      while (job->running_item_count > 0) {
+        Promise<void> idle;
+        job->idle = &idle;
+        co_await idle;
+      }
+    } catch (const InterruptedException&) {
+    }
+    if (stop_token_or->GetToken().stop_requested()) {
+      job->state = JobState::kCancelled;
+    } else if (job->failed_item_count > 0) {
+      job->state = JobState::kFailed;
+    } else {
+      job->state = JobState::kDone;
+    }
+    job->destination.InvalidateGeneralData();
+  });
+  return id;
+}
+
+auto TransferManager::GetJobs() const -> std::vector<JobStatus> {
+  std::vector<JobStatus> result;
+  for (const auto& [id, job] : jobs_) {
+    result.emplace_back(job->GetStatus());
+  }
+  std::sort(result.begin(), result.end(),
+            [](const auto& a, const auto& b) { return a.id < b.id; });
+  return result;
+}
+
+auto TransferManager::GetJob(int64_t id) const -> std::optional<JobStatus> {
+  if (auto it = jobs_.find(id); it != jobs_.end()) {
+    return it->second->GetStatus();
+  }
+  return std::nullopt;
+}
+
+bool TransferManager::Remove(int64_t id) {
+  auto it = jobs_.find(id);
+  if (it == jobs_.end()) {
+    return false;
+  }
+  if (it->second->state == JobState::kRunning) {
+    it->second->stop_source.request_stop();
+  } else {
+    jobs_.erase(it);
+  }
+  return true;
+}
+
+void TransferManager::StartItem(
+    std::shared_ptr<Job> job, AbstractCloudProvider::Item item,
+    AbstractCloudProvider::Directory destination_parent,
+    stdx::stop_token stop_token) {
+  job->running_item_count++;
+  RunTask([job = std::move(job), item = std::move(item),
+           destination_parent = std::move(destination_parent),
+           stop_token = std::move(stop_token)]() mutable -> Task<> {
+    co_await CopyItem(job, std::move(item), std::move(destination_parent),
+                      std::move(stop_token));
+    if (--job->running_item_count == 0) {
+      Resume(job->idle);
+    }
+  });
+}
+
+Task<> TransferManager::CopyItem(
+    std::shared_ptr<Job> job, AbstractCloudProvider::Item item,
+    AbstractCloudProvider::Directory destination_parent,
+    stdx::stop_token stop_token) {
+  // The upload slot is kept while a file is copied, but only while a
+  // directory is created: its items take slots of their own.
+  bool holds_upload_slot = true;
+  auto release_guard = AtScopeExit([&] {
+    if (holds_upload_slot) {
+      job->upload_limiter->Release();
+    }
+  });
+  try {
+    if (auto* file = std::get_if<AbstractCloudProvider::File>(&item)) {
+      co_await CopyFile(job, std::move(*file), std::move(destination_parent),
+                        stop_token);
+    } else {
+      auto listing_guard = AtScopeExit([&] { job->pending_listing_count--; });
+      auto directory =
+          std::get<AbstractCloudProvider::Directory>(std::move(item));
+      auto destination = co_await job->destination.provider()->CreateDirectory(
+          std::move(destination_parent), directory.name, stop_token);
+      holds_upload_slot = false;
+      job->upload_limiter->Release();
+      co_await CopyDirectory(job, std::move(directory), std::move(destination),
+                             stop_token);
+    }
+  } catch (...) {
+    if (!stop_token.stop_requested()) {
+      job->failed_item_count++;
+      job->error = GetErrorMetadata().what;
+    }
+  }
+}
+
+Task<> TransferManager::CopyFile(
+    std::shared_ptr<Job> job, AbstractCloudProvider::File file,
+    AbstractCloudProvider::Directory destination_parent,
+    stdx::stop_token stop_token) {
+  if (!file.size &&
+      job->destination.provider()->IsFileContentSizeRequired(
+          destination_parent)) {
+    throw CloudException("size of the file is unknown");
+  }
+  // Stops the download once the upload is over, whichever way it ended.
+  stdx::stop_source read_stop_source;
+  stdx::stop_callback stop_callback(stop_token,
+                                    [&] { read_stop_source.request_stop(); });
+  auto stop_guard = AtScopeExit([&] { read_stop_source.request_stop(); });
+  auto pipe = std::make_shared<Pipe>();
+  RunTask(FillPipe(pipe, job->source.provider(), file,
+                   read_stop_source.get_token()));
+  auto data = [](std::shared_ptr<Job> job,
+                 Generator<std::string> data) -> Generator<std::string> {
+    FOR_CO_AWAIT(std::string & chunk, data) {
+      job->AddTransferredBytes(static_cast<int64_t>(chunk.size()));
+      co_yield std::move(chunk);
+    }
+  }(job, ReadPipe(pipe));
+  co_await job->destination.provider()->CreateFile(
+      std::move(destination_parent), file.name,
+      AbstractCloudProvider::FileContent{.data = std::move(data),
+                                         .size = file.size},
+      stop_token);
+  job->transferred_file_count++;
+}
+
+Task<> TransferManager::CopyDirectory(
+    std::shared_ptr<Job> job, AbstractCloudProvider::Directory directory,
+    AbstractCloudProvider::Directory destination,
+    stdx::stop_token stop_token) {
+  std::optional<std::string> page_token;
+  do {
+    // The listing slot is kept until every item of the page has started, so
+    // that only a few pages wait for upload slots at a time.
+    co_await job->listing_limiter.Acquire(stop_token);
+    auto listing_guard = AtScopeExit([&] { job->listing_limiter.Release(); });
+    auto page = co_await job->source.provider()->ListDirectoryPage(
+        directory, std::move(page_token), stop_token);
+    for (auto& entry : page.items) {
+      OnItemFound(job.get(), entry);
+      co_await job->upload_limiter->Acquire(stop_token);
+      StartItem(job, std::move(entry), destination, stop_token);
+    }
+    page_token = std::move(page.next_page_token);
+  } while (page_token);
+}
+
+void TransferManager::OnItemFound(Job* job,
+                                  const AbstractCloudProvider::Item& item) {
+  if (const auto* file = std::get_if<AbstractCloudProvider::File>(&item)) {
+    job->file_count++;
+    job->total_bytes += file->size.value_or(0);
+  } else {
+    job->pending_listing_count++;
+  }
+}
+
+auto TransferManager::GetUploadLimiter(const CloudProviderAccount& account)
+    -> std::shared_ptr<Limiter> {
+  auto& limiter = upload_limiters_[StrCat(account.type(), '/',
+                                          account.username())];
+  if (!limiter) {
+    limiter = std::make_shared<Limiter>(event_loop_,
+                                        max_concurrent_uploads_per_account_);
+  }
+  return limiter;
+}
+
+}  // namespace coro::cloudstorage::util
@@ -0,0 +1,111 @@
+#ifndef CORO_CLOUDSTORAGE_UTIL_TRANSFER_MANAGER_H
+#define CORO_CLOUDSTORAGE_UTIL_TRANSFER_MANAGER_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "coro/cloudstorage/util/abstract_cloud_provider.h"
+#include "coro/cloudstorage/util/cloud_provider_account.h"
+#include "coro/stdx/stop_source.h"
+#include "coro/stdx/stop_token.h"
+#include "coro/task.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::cloudstorage::util {
+
+// Copies files and directory trees between accounts. File data is streamed
+// from `GetFileContent` of the source into `CreateFile` of the destination
+// through a bounded in-memory pipe. Each item starts being copied as soon as
+// it is listed, once one of the upload slots of the destination account is
+// free; creating a directory takes a slot too. Directories are listed a few
+// pages at a time and only a few jobs run at once, the rest wait for their
+// turn. Must only be used from the event loop thread.
+class TransferManager {
+ public:
+  enum class JobState { kRunning, kDone, kFailed, kCancelled };
+
+  struct JobStatus {
+    int64_t id;
+    std::string name;
+    JobState state;
+    // Files and bytes found so far; final once `listing_complete` is set.
+    int64_t file_count;
+    int64_t total_bytes;
+    bool listing_complete;
+    int64_t transferred_file_count;
+    int64_t transferred_bytes;
+    int64_t failed_item_count;
+    // Bytes per second over the last few seconds.
+    double throughput;
+    // Seconds left at the current throughput.
+    std::optional<int64_t> eta;
+    std::optional<std::string> error;
+  };
+
+  TransferManager(const coro::util::EventLoop* event_loop,
+                  int max_concurrent_uploads_per_account);
+  TransferManager(const TransferManager&) = delete;
+  ~TransferManager();
+
+  TransferManager& operator=(const TransferManager&) = delete;
+
+  // Starts copying `source` into `destination_parent`. Returns the job id.
+  int64_t Start(CloudProviderAccount source_account,
+                AbstractCloudProvider::Item source,
+                CloudProviderAccount destination_account,
+                AbstractCloudProvider::Directory destination_parent);
+
+  std::vector<JobStatus> GetJobs() const;
+
+  std::optional<JobStatus> GetJob(int64_t id) const;
+
+  // Cancels a running job, forgets a finished one. Returns false if there is
+  // no job with `id`.
+  bool Remove(int64_t id);
+
+ private:
+  class Limiter;
+  struct Job;
+
+  // Starts copying `item` in the background. The caller must hold a slot of
+  // `job->upload_limiter`, which is handed over to the copy.
+  static void StartItem(std::shared_ptr<Job> job,
+                        AbstractCloudProvider::Item item,
+                        AbstractCloudProvider::Directory destination_parent,
+                        stdx::stop_token stop_token);
+
+  static Task<> CopyItem(std::shared_ptr<Job> job,
+                         AbstractCloudProvider::Item item,
+                         AbstractCloudProvider::Directory destination_parent,
+                         stdx::stop_token stop_token);
+
+  static Task<> CopyFile(std::shared_ptr<Job> job,
+                         AbstractCloudProvider::File file,
+                         AbstractCloudProvider::Directory destination_parent,
+                         stdx::stop_token stop_token);
+
+  // Lists `directory` into `destination`, which has already been created.
+  static Task<> CopyDirectory(std::shared_ptr<Job> job,
+                              AbstractCloudProvider::Directory directory,
+                              AbstractCloudProvider::Directory destination,
+                              stdx::stop_token stop_token);
+
+  static void OnItemFound(Job* job, const AbstractCloudProvider::Item& item);
+
+  std::shared_ptr<Limiter> GetUploadLimiter(const CloudProviderAccount&);
+
+  const coro::util::EventLoop* event_loop_;
+  int max_concurrent_uploads_per_account_;
+  int64_t next_job_id_ = 1;
+  std::unordered_map<int64_t, std::shared_ptr<Job>> jobs_;
+  std::unordered_map<std::string, std::shared_ptr<Limiter>> upload_limiters_;
+  std::shared_ptr<Limiter> job_limiter_;
+  stdx::stop_source stop_source_;
+};
+
+}  // namespace coro::cloudstorage::util
+
+#endif  // CORO_CLOUDSTORAGE_UTIL_TRANSFER_MANAGER_H
@@ -1,6 +1,10 @@
 #include "coro/cloudstorage/util/webdav_handler.h"
 
 #include <iostream>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "coro/cloudstorage/util/cloud_provider_utils.h"
 #include "coro/cloudstorage/util/string_utils.h"
@@ -96,48 +100,72 @@ Generator<std::string> GetWebDavItemResponse(std::string path, Item item) {
   co_yield "</d:multistatus>";
 }
 
+// Returns the stored recursive sizes of the directories among `items`.
+Task<std::unordered_map<std::string, CacheManager::DirectorySize>>
+GetDirectorySizes(const CloudProviderAccount& account,
+                  std::span<const ItemT> items, stdx::stop_token stop_token) {
+  std::vector<std::string> directory_ids;
+  for (const auto& item : items) {
+    if (const auto* directory =
+            std::get_if<AbstractCloudProvider::Directory>(&item)) {
+      directory_ids.emplace_back(directory->id);
+    }
+  }
+  if (directory_ids.empty()) {
+    co_return std::unordered_map<std::string, CacheManager::DirectorySize>();
+  }
+  co_return co_await account.GetCachedDirectorySizes(std::move(directory_ids),
+                                                     std::move(stop_token));
+}
+
 Generator<std::string> GetWebDavResponse(
-    AbstractCloudProvider::Directory directory,
+    CloudProviderAccount account, AbstractCloudProvider::Directory directory,
     Generator<AbstractCloudProvider::PageData> page_data, Request request,
-    std::string path) {
+    std::string path, stdx::stop_token stop_token) {
   co_yield R"(<?xml version="1.0" encoding="utf-8"?><d:multistatus xmlns:d="DAV:">)";
   ElementData current_element_data{
       .path = path, .name = directory.name, .is_directory = true};
+  if (auto sizes = co_await account.GetCachedDirectorySizes({directory.id},
+                                                            stop_token);
+      !sizes.empty()) {
+    current_element_data.quota_used_bytes = sizes.begin()->second.size;
+  }
   co_yield GetElement(current_element_data);
   if (http::GetHeader(request.headers, "Depth").value_or("1") == "1") {
+    std::string href;
     FOR_CO_AWAIT(const auto& page, page_data) {
+      auto sizes = co_await GetDirectorySizes(account, page.items, stop_token);
+      std::string chunk;
       for (const auto& item : page.items) {
-        auto id = std::visit([](const auto& item) { return item.id; }, item);
-        auto name =
-            std::visit([](const auto& item) { return item.name; }, item);
-        auto timestamp =
-            std::visit([](const auto& item) { return item.timestamp; }, item);
-        ElementData element_data(
-            {.path = StrCat(path, http::EncodeUri(name)),
-             .name = name,
-             .is_directory = std::visit(
-                 []<typename T>(const T&) {
-                   return std::is_same_v<T, AbstractCloudProvider::Directory>;
-                 },
-                 item),
-             .timestamp = timestamp});
         std::visit(
             [&]<typename T>(const T& item) {
+              href.assign(path);
+              AppendEncodedUri(item.name, href);
+              ElementData element_data{
+                  .path = href,
+                  .name = item.name,
+                  .is_directory =
+                      std::is_same_v<T, AbstractCloudProvider::Directory>,
+                  .timestamp = item.timestamp};
               if constexpr (std::is_same_v<T, AbstractCloudProvider::File>) {
                 element_data.mime_type = item.mime_type;
                 element_data.size = item.size;
+              } else if (auto it = sizes.find(item.id); it != sizes.end()) {
+                element_data.quota_used_bytes = it->second.size;
               }
+              AppendElement(element_data, chunk);
             },
             item);
-        co_yield GetElement(element_data);
       }
+      co_yield std::move(chunk);
     }
   }
   co_yield "</d:multistatus>";
 }
 
 template <typename Item>
-Task<Response> HandleExistingItem(CloudProvider* provider, Request request,
+Task<Response> HandleExistingItem(const CloudProviderAccount& account,
+                                  CloudProvider* provider, Request request,
                                   std::span<const std::string> path, Item d,
                                   stdx::stop_token stop_token) {
   if (request.method == http::Method::kProppatch) {
@@ -194,12 +222,13 @@ Task<Response> HandleExistingItem(CloudProvider* provider, Request request,
       if (directory_path.empty() || directory_path.back() != '/') {
         directory_path += '/';
       }
+      auto content = ListDirectory(provider, d, stop_token);
       co_return Response{
           .status = 207,
           .headers = {{"Content-Type", "text/xml"}},
-          .body = GetWebDavResponse(
-              d, ListDirectory(provider, d, std::move(stop_token)),
-              std::move(request), directory_path)};
+          .body = GetWebDavResponse(account, d, std::move(content),
+                                    std::move(request), directory_path,
+                                    std::move(stop_token))};
     } else {
       co_return Response{.status = 207,
                          .headers = {{"Content-Type", "text/html"}},
@@ -249,19 +278,26 @@ auto WebDAVHandler::operator()(Request request,
       throw CloudException("invalid path");
     }
     auto parent_path = GetDirectoryPath(path);
-    co_return co_await std::visit(
+    auto response = co_await std::visit(
         CreateFileF{provider, path.back(), std::move(request), stop_token},
         co_await GetItemByPathComponents(
             provider,
             std::vector<std::string>(parent_path.begin(), parent_path.end()),
             stop_token));
+    account_.InvalidateGeneralData();
+    co_return response;
   } else {
-    co_return co_await std::visit(
+    bool is_delete = request.method == http::Method::kDelete;
+    auto response = co_await std::visit(
         [&](const auto& d) {
-          return HandleExistingItem(provider, std::move(request), path, d,
-                                    stop_token);
+          return HandleExistingItem(account_, provider, std::move(request),
+                                    path, d, stop_token);
         },
         co_await GetItemByPathComponents(provider, path, stop_token));
+    if (is_delete) {
+      account_.InvalidateGeneralData();
+    }
+    co_return response;
   }
 }
 
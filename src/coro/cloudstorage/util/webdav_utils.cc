@@ -1,69 +1,189 @@
 #include "coro/cloudstorage/util/webdav_utils.h"
 
 #include <array>
-#include <cstring>
-#include <sstream>
-
-#include "coro/http/http_parse.h"
+#include <charconv>
 
 namespace coro::cloudstorage::util {
 
 namespace {
 
+constexpr std::string_view kMultiStatusBegin =
+    R"(<?xml version="1.0" encoding="utf-8"?><d:multistatus xmlns:d="DAV:">)";
+constexpr std::string_view kMultiStatusEnd = "</d:multistatus>";
+
 constexpr std::array<std::string_view, 7> kDayNames = {
     "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
 constexpr std::array<std::string_view, 12> kMonthNames = {
     "Jan", "Feb", "Mar", "Apr", "May", "Jun",
     "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
 
-std::string GetRFC1123(int64_t timestamp) {
-  const int kBufferSize = 29;
-  tm tm = coro::http::gmtime(timestamp);
-  std::string buffer(kBufferSize, 0);
-  strftime(buffer.data(), kBufferSize + 1, "---, %d --- %Y %H:%M:%S GMT", &tm);
-  memcpy(buffer.data(), kDayNames[tm.tm_wday].data(), 3);
-  memcpy(buffer.data() + 8, kMonthNames[tm.tm_mon].data(), 3);
-  return buffer;
+struct CivilDate {
+  int64_t year;
+  int month;
+  int day;
+};
+
+// Converts days since 1970-01-01 to a proleptic Gregorian date, see
+// http://howardhinnant.github.io/date_algorithms.html#civil_from_days.
+CivilDate GetCivilDate(int64_t days) {
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  int64_t day_of_era = days - era * 146097;
+  int64_t year_of_era = (day_of_era - day_of_era / 1460 +
+                         day_of_era / 36524 - day_of_era / 146096) /
+                        365;
+  int64_t day_of_year =
+      day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  int64_t shifted_month = (5 * day_of_year + 2) / 153;
+  int day = static_cast<int>(day_of_year - (153 * shifted_month + 2) / 5 + 1);
+  int month = static_cast<int>(shifted_month < 10 ? shifted_month + 3
+                                                  : shifted_month - 9);
+  int64_t year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+  return CivilDate{.year = year, .month = month, .day = day};
+}
+
+void AppendTwoDigits(int value, std::string& output) {
+  output += static_cast<char>('0' + value / 10);
+  output += static_cast<char>('0' + value % 10);
+}
+
+void AppendInt(int64_t value, std::string& output) {
+  std::array<char, 24> buffer;
+  auto [end, ec] =
+      std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+  output.append(buffer.data(), end);
+}
+
+void AppendEscapedXml(std::string_view text, std::string& output) {
+  size_t begin = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    std::string_view replacement;
+    switch (text[i]) {
+      case '&':
+        replacement = "&amp;";
+        break;
+      case '<':
+        replacement = "&lt;";
+        break;
+      case '>':
+        replacement = "&gt;";
+        break;
+      default:
+        continue;
+    }
+    output.append(text.substr(begin, i - begin));
+    output.append(replacement);
+    begin = i + 1;
+  }
+  output.append(text.substr(begin));
 }
 
 }  // namespace
 
+void AppendEncodedUri(std::string_view text, std::string& output) {
+  constexpr std::string_view kHexDigits = "0123456789ABCDEF";
+  for (char c : text) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+        (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+        c == '~') {
+      output += c;
+    } else {
+      auto byte = static_cast<uint8_t>(c);
+      output += '%';
+      output += kHexDigits[byte >> 4];
+      output += kHexDigits[byte & 15];
+    }
+  }
+}
+
+void AppendRFC1123(int64_t timestamp, std::string& output) {
+  constexpr int64_t kSecondsPerDay = 24 * 60 * 60;
+  int64_t days = timestamp / kSecondsPerDay;
+  int64_t seconds = timestamp % kSecondsPerDay;
+  if (seconds < 0) {
+    seconds += kSecondsPerDay;
+    days--;
+  }
+  CivilDate date = GetCivilDate(days);
+  // 1970-01-01 was a Thursday.
+  int64_t weekday = (days + 4) % 7;
+  if (weekday < 0) {
+    weekday += 7;
+  }
+  output.append(kDayNames[weekday]);
+  output.append(", ");
+  AppendTwoDigits(date.day, output);
+  output += ' ';
+  output.append(kMonthNames[date.month - 1]);
+  output += ' ';
+  AppendInt(date.year, output);
+  output += ' ';
+  AppendTwoDigits(static_cast<int>(seconds / 3600), output);
+  output += ':';
+  AppendTwoDigits(static_cast<int>(seconds / 60 % 60), output);
+  output += ':';
+  AppendTwoDigits(static_cast<int>(seconds % 60), output);
+  output.append(" GMT");
+}
+
 std::string GetMultiStatusResponse(std::span<const std::string> responses) {
-  std::stringstream stream;
-  stream
-      << R"(<?xml version="1.0" encoding="utf-8"?><d:multistatus xmlns:d="DAV:">)";
+  size_t size = kMultiStatusBegin.size() + kMultiStatusEnd.size();
   for (const std::string &response : responses) {
-    stream << response;
+    size += response.size();
   }
-  stream << "</d:multistatus>";
-  return stream.str();
+  std::string output;
+  output.reserve(size);
+  output.append(kMultiStatusBegin);
+  for (const std::string &response : responses) {
+    output.append(response);
+  }
+  output.append(kMultiStatusEnd);
+  return output;
 }
 
 std::string GetElement(const ElementData &data) {
-  std::stringstream stream;
-  stream << "<d:response><d:href>" << data.path
-         << (data.is_directory && !data.path.empty() && data.path.back() != '/'
-                 ? "/"
-                 : "")
-         << "</d:href>"
-         << "<d:propstat><d:status>HTTP/1.1 200 OK</d:status>"
-         << "<d:prop>"
-         << "<d:displayname>" << http::EncodeUri(data.name)
-         << "</d:displayname>";
+  std::string output;
+  AppendElement(data, output);
+  return output;
+}
+
+void AppendElement(const ElementData &data, std::string &output) {
+  output.append("<d:response><d:href>");
+  AppendEscapedXml(data.path, output);
+  if (data.is_directory && !data.path.empty() && data.path.back() != '/') {
+    output += '/';
+  }
+  output.append(
+      "</d:href>"
+      "<d:propstat><d:status>HTTP/1.1 200 OK</d:status>"
+      "<d:prop>"
+      "<d:displayname>");
+  AppendEncodedUri(data.name, output);
+  output.append("</d:displayname>");
   if (data.size) {
-    stream << "<d:getcontentlength>" << *data.size << "</d:getcontentlength>";
+    output.append("<d:getcontentlength>");
+    AppendInt(*data.size, output);
+    output.append("</d:getcontentlength>");
   }
   if (data.mime_type) {
-    stream << "<d:getcontenttype>" << *data.mime_type << "</d:getcontenttype>";
+    output.append("<d:getcontenttype>");
+    AppendEscapedXml(*data.mime_type, output);
+    output.append("</d:getcontenttype>");
   }
   if (data.timestamp) {
-    stream << "<d:getlastmodified>" << GetRFC1123(*data.timestamp)
-           << "</d:getlastmodified>";
+    output.append("<d:getlastmodified>");
+    AppendRFC1123(*data.timestamp, output);
+    output.append("</d:getlastmodified>");
+  }
+  if (data.quota_used_bytes) {
+    output.append("<d:quota-used-bytes>");
+    AppendInt(*data.quota_used_bytes, output);
+    output.append("</d:quota-used-bytes>");
   }
-  stream << "<d:resourcetype>" << (data.is_directory ? "<d:collection/>" : "")
-         << "</d:resourcetype>"
-         << "</d:prop></d:propstat></d:response>";
-  return stream.str();
+  output.append(data.is_directory
+                    ? "<d:resourcetype><d:collection/></d:resourcetype>"
+                    : "<d:resourcetype></d:resourcetype>");
+  output.append("</d:prop></d:propstat></d:response>");
 }
 
 }  // namespace coro::cloudstorage::util
@@ -4,23 +4,37 @@
 #include <optional>
 #include <span>
 #include <string>
+#include <string_view>
 
 #include "coro/generator.h"
 
 namespace coro::cloudstorage::util {
 
 struct ElementData {
-  std::string path;
-  std::string name;
+  std::string_view path;
+  std::string_view name;
   bool is_directory;
   std::optional<int64_t> size;
-  std::optional<std::string> mime_type;
+  std::optional<std::string_view> mime_type;
   std::optional<int64_t> timestamp;
+  // Total size of the files under a directory (RFC 4331).
+  std::optional<int64_t> quota_used_bytes;
 };
 
 std::string GetMultiStatusResponse(std::span<const std::string> responses);
 std::string GetElement(const ElementData&);
 
+// Appends the <d:response> element describing `data` to `output`.
+void AppendElement(const ElementData& data, std::string& output);
+
+// Appends `text` with every byte other than the RFC 3986 unreserved
+// characters percent-encoded.
+void AppendEncodedUri(std::string_view text, std::string& output);
+
+// Appends `timestamp` formatted as an RFC 1123 date, e.g.
+// "Sun, 06 Nov 1994 08:49:37 GMT".
+void AppendRFC1123(int64_t timestamp, std::string& output);
+
 }  // namespace coro::cloudstorage::util
 
 #endif  // CORO_CLOUDSTORAGE_WEBDAV_UTILS_H
@@ -0,0 +1,210 @@
+#include "coro/cloudstorage/util/cache_manager.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <sqlite3.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "coro/cloudstorage/test/fake_cloud_provider.h"
+#include "coro/cloudstorage/test/test_event_loop.h"
+#include "coro/cloudstorage/test/test_utils.h"
+
+namespace coro::cloudstorage::test {
+namespace {
+
+using ::coro::cloudstorage::util::AbstractCloudProvider;
+using ::coro::cloudstorage::util::CacheDatabase;
+using ::coro::cloudstorage::util::CacheDatabaseDeleter;
+using ::coro::cloudstorage::util::CacheManager;
+using ::coro::cloudstorage::util::CreateCacheDatabase;
+using ::testing::ElementsAre;
+
+std::vector<std::string> GetNames(
+    const std::vector<AbstractCloudProvider::Item>& items) {
+  std::vector<std::string> names;
+  for (const auto& item : items) {
+    names.emplace_back(std::visit([](const auto& d) { return d.name; }, item));
+  }
+  return names;
+}
+
+class CacheManagerTest : public ::testing::Test {
+ protected:
+  void Put(AbstractCloudProvider::Directory directory) {
+    loop_.Do([&] {
+      return cache_manager_.Put(
+          account_,
+          CacheManager::DirectoryContent{
+              .parent = directory,
+              .items = provider_->GetChildren(directory.id),
+              .update_time = 1},
+          stop_token_);
+    });
+  }
+
+  std::vector<std::string> GetListing(std::string directory_id) {
+    auto content = loop_.Do([&] {
+      return cache_manager_.Get(
+          account_, CacheManager::ParentDirectoryKey{std::move(directory_id)},
+          stop_token_);
+    });
+    return content ? GetNames(content->items) : std::vector<std::string>{};
+  }
+
+  void ApplyChanges(std::vector<AbstractCloudProvider::Change> changes) {
+    loop_.Do([&] {
+      return cache_manager_.ApplyChanges(
+          account_, std::move(changes),
+          CacheManager::ChangeFeedState{
+              .cursor = "cursor", .start_time = 0, .update_time = 2},
+          stop_token_);
+    });
+  }
+
+  std::vector<std::string> Search(std::string query) {
+    return GetNames(loop_.Do([&] {
+      return cache_manager_.SearchItems(account_, std::move(query),
+                                        /*limit=*/100, stop_token_);
+    }));
+  }
+
+  void Execute(const char* statement) {
+    sqlite3* db;
+    ASSERT_EQ(sqlite3_open(std::string(cache_file_.path()).c_str(), &db),
+              SQLITE_OK);
+    EXPECT_EQ(sqlite3_exec(db, statement, /*callback=*/nullptr,
+                           /*arg=*/nullptr, /*errmsg=*/nullptr),
+              SQLITE_OK);
+    sqlite3_close(db);
+  }
+
+  // Counts the rows which weren't migrated to the current encoding yet.
+  int CountLegacyRows() {
+    sqlite3* db;
+    if (sqlite3_open(std::string(cache_file_.path()).c_str(), &db) !=
+        SQLITE_OK) {
+      return -1;
+    }
+    int count = -1;
+    sqlite3_exec(
+        db, "SELECT COUNT(*) FROM item WHERE encoding_version < 2",
+        [](void* count, int, char** values, char**) {
+          *static_cast<int*>(count) = std::stoi(values[0]);
+          return 0;
+        },
+        &count, /*errmsg=*/nullptr);
+    sqlite3_close(db);
+    return count;
+  }
+
+  // Checks `predicate` until it holds or a few seconds pass. Returns whether
+  // it held.
+  template <typename F>
+  bool WaitUntil(F predicate) {
+    for (int i = 0; i < 5000; i++) {
+      if (predicate()) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+
+  TemporaryFile cache_file_;
+  TestEventLoop loop_;
+  std::unique_ptr<CacheDatabase, CacheDatabaseDeleter> db_ =
+      CreateCacheDatabase(std::string(cache_file_.path()));
+  CacheManager cache_manager_{db_.get(), loop_.event_loop()};
+  std::shared_ptr<FakeCloudProvider> provider_ =
+      std::make_shared<FakeCloudProvider>();
+  CacheManager::AccountKey account_{.provider = provider_,
+                                    .username = "test"};
+  stdx::stop_token stop_token_;
+};
+
+TEST_F(CacheManagerTest, MigratesLegacyRowsInBackground) {
+  provider_->AddFile("root", "report.pdf", "pdf");
+  provider_->AddFile("root", "notes.txt", "txt");
+  Put(std::get<AbstractCloudProvider::Directory>(
+      loop_.Do([&] { return provider_->GetItem("root", stop_token_); })));
+  // Rows stored before the typed columns existed got their default values.
+  Execute(
+      "UPDATE item SET encoding_version = 0, type = 0, name = '', "
+      "size = NULL, timestamp = NULL, mime_type = '', "
+      // Drops the format byte, which leaves the CBOR of the whole item.
+      "content = substr(content, 2)");
+
+  EXPECT_THAT(GetListing("root"), ElementsAre("report.pdf", "notes.txt"));
+  EXPECT_TRUE(WaitUntil([&] { return CountLegacyRows() == 0; }));
+  EXPECT_THAT(Search("report"), ElementsAre("report.pdf"));
+  EXPECT_THAT(GetListing("root"), ElementsAre("report.pdf", "notes.txt"));
+}
+
+TEST_F(CacheManagerTest, MigrationDropsListingsOfUndecodableRows) {
+  provider_->AddFile("root", "report.pdf", "pdf");
+  provider_->AddFile("root", "notes.txt", "txt");
+  Put(std::get<AbstractCloudProvider::Directory>(
+      loop_.Do([&] { return provider_->GetItem("root", stop_token_); })));
+  Execute(
+      "UPDATE item SET encoding_version = 0, content = X'FF' "
+      "WHERE name = 'notes.txt'");
+
+  // Triggers the migration.
+  Search("report");
+
+  EXPECT_TRUE(WaitUntil([&] { return CountLegacyRows() == 0; }));
+  EXPECT_THAT(GetListing("root"), ElementsAre());
+  EXPECT_THAT(Search("report"), ElementsAre("report.pdf"));
+}
+
+TEST_F(CacheManagerTest, ApplyChangesUpdatesStoredListings) {
+  auto docs = provider_->AddDirectory("root", "docs");
+  auto draft = provider_->AddFile("root", "draft.txt", "draft");
+  auto old = provider_->AddFile("root", "old.txt", "old");
+  provider_->AddFile(docs.id, "manual.pdf", "pdf");
+  Put(std::get<AbstractCloudProvider::Directory>(
+      loop_.Do([&] { return provider_->GetItem("root", stop_token_); })));
+  Put(docs);
+
+  ApplyChanges(
+      {{.id = "new",
+        .name = "new.txt",
+        .parents = {"root"},
+        .item = AbstractCloudProvider::File{.id = "new",
+                                            .name = "new.txt",
+                                            .size = 3,
+                                            .mime_type = "text/plain"}},
+       {.id = draft.id,
+        .name = draft.name,
+        .parents = {docs.id},
+        .item = draft},
+       {.id = old.id, .name = old.name, .parents = {"root"}}});
+
+  EXPECT_THAT(GetListing("root"), ElementsAre("docs", "new.txt"));
+  EXPECT_THAT(GetListing(docs.id), ElementsAre("manual.pdf", "draft.txt"));
+  auto state = loop_.Do([&] {
+    return cache_manager_.Get(account_, CacheManager::ChangeFeedKey{},
+                              stop_token_);
+  });
+  ASSERT_TRUE(state);
+  EXPECT_EQ(state->cursor, "cursor");
+}
+
+TEST_F(CacheManagerTest, ApplyChangesRemovesItemsMatchedByName) {
+  provider_->AddFile("root", "kept.txt", "kept");
+  provider_->AddFile("root", "removed.txt", "removed");
+  Put(std::get<AbstractCloudProvider::Directory>(
+      loop_.Do([&] { return provider_->GetItem("root", stop_token_); })));
+
+  ApplyChanges({{.name = "removed.txt", .parents = {"root"}}});
+
+  EXPECT_THAT(GetListing("root"), ElementsAre("kept.txt"));
+}
+
+}  // namespace
+}  // namespace coro::cloudstorage::test
@@ -0,0 +1,150 @@
+#include "coro/cloudstorage/util/change_feed_poller.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "coro/cloudstorage/test/fake_cloud_provider.h"
+#include "coro/cloudstorage/test/test_event_loop.h"
+#include "coro/cloudstorage/test/test_utils.h"
+
+namespace coro::cloudstorage::test {
+namespace {
+
+using ::coro::cloudstorage::util::AbstractCloudProvider;
+using ::coro::cloudstorage::util::CacheDatabase;
+using ::coro::cloudstorage::util::CacheDatabaseDeleter;
+using ::coro::cloudstorage::util::CacheManager;
+using ::coro::cloudstorage::util::ChangeFeedPoller;
+using ::coro::cloudstorage::util::Clock;
+using ::coro::cloudstorage::util::CreateCacheDatabase;
+
+bool Contains(const CacheManager::DirectoryContent& content,
+              std::string_view name) {
+  for (const auto& item : content.items) {
+    if (std::visit([](const auto& d) { return d.name; }, item) == name) {
+      return true;
+    }
+  }
+  return false;
+}
+
+class ChangeFeedPollerTest : public ::testing::Test {
+ protected:
+  ChangeFeedPollerTest() {
+    provider_->AddFile("root", "file.txt", "content");
+    loop_.Do([&]() -> Task<> {
+      co_await cache_manager_.Put(
+          account_,
+          CacheManager::DirectoryContent{
+              .parent = co_await provider_->GetRoot(stop_token_),
+              .items = provider_->GetChildren("root"),
+              .update_time = clock_.Now()},
+          stop_token_);
+      poller_.emplace(loop_.event_loop(), &cache_manager_, &clock_,
+                      ChangeFeedPoller::Config{.start_delay_ms = 0,
+                                               .poll_interval_ms = 1,
+                                               .request_interval_ms = 1,
+                                               .min_retry_delay_ms = 1,
+                                               .max_retry_delay_ms = 1});
+      poller_->Add(account_, stop_token_);
+    });
+  }
+
+  ~ChangeFeedPollerTest() override {
+    // Stops the polling on the thread of the event loop.
+    loop_.Do([&]() -> Task<> {
+      poller_.reset();
+      co_return;
+    });
+  }
+
+  // Checks `predicate` on the event loop until it holds or a few seconds
+  // pass. Returns whether it held.
+  template <typename F>
+  bool WaitUntil(F predicate) {
+    return loop_.Do([&]() -> Task<bool> {
+      for (int i = 0; i < 5000; i++) {
+        if (co_await predicate()) {
+          co_return true;
+        }
+        co_await loop_.event_loop()->Wait(1, stop_token_);
+      }
+      co_return false;
+    });
+  }
+
+  bool WaitForFeed() {
+    return WaitUntil([&]() -> Task<bool> {
+      co_return (co_await cache_manager_.Get(
+                     account_, CacheManager::ChangeFeedKey{}, stop_token_))
+          .has_value();
+    });
+  }
+
+  template <typename F>
+  bool WaitForListing(F predicate) {
+    return WaitUntil([&]() -> Task<bool> {
+      auto content = co_await cache_manager_.Get(
+          account_, CacheManager::ParentDirectoryKey{"root"}, stop_token_);
+      co_return content && predicate(*content);
+    });
+  }
+
+  TemporaryFile cache_file_;
+  TestEventLoop loop_;
+  Clock clock_;
+  std::unique_ptr<CacheDatabase, CacheDatabaseDeleter> db_ =
+      CreateCacheDatabase(std::string(cache_file_.path()));
+  CacheManager cache_manager_{db_.get(), loop_.event_loop()};
+  std::shared_ptr<FakeCloudProvider> provider_ =
+      std::make_shared<FakeCloudProvider>(
+          FakeCloudProvider::Config{.change_feed_supported = true});
+  CacheManager::AccountKey account_{.provider = provider_,
+                                    .username = "test"};
+  stdx::stop_token stop_token_;
+  std::optional<ChangeFeedPoller> poller_;
+};
+
+TEST_F(ChangeFeedPollerTest, AppliesChangesToCachedListings) {
+  ASSERT_TRUE(WaitForFeed());
+
+  provider_->AddChange(
+      {.id = "new",
+       .name = "new.txt",
+       .parents = {"root"},
+       .item = AbstractCloudProvider::File{.id = "new", .name = "new.txt"}});
+
+  EXPECT_TRUE(WaitForListing([](const auto& content) {
+    return Contains(content, "new.txt") && Contains(content, "file.txt");
+  }));
+
+  provider_->AddChange({.name = "file.txt", .parents = {"root"}});
+
+  EXPECT_TRUE(WaitForListing([](const auto& content) {
+    return !Contains(content, "file.txt");
+  }));
+}
+
+TEST_F(ChangeFeedPollerTest, SkipsAccountsWithoutChangeFeed) {
+  auto provider = std::make_shared<FakeCloudProvider>(
+      FakeCloudProvider::Config{.id = "other"});
+  CacheManager::AccountKey account{.provider = provider, .username = "test"};
+  loop_.Do([&]() -> Task<> {
+    poller_->Add(account, stop_token_);
+    co_await loop_.event_loop()->Wait(10, stop_token_);
+  });
+
+  EXPECT_FALSE(loop_.Do([&] {
+    return cache_manager_.Get(account, CacheManager::ChangeFeedKey{},
+                              stop_token_);
+  }));
+}
+
+}  // namespace
+}  // namespace coro::cloudstorage::test
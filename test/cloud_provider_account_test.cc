@@ -0,0 +1,92 @@
+#include "coro/cloudstorage/util/cloud_provider_account.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "coro/cloudstorage/test/fake_cloud_provider.h"
+#include "coro/cloudstorage/test/test_event_loop.h"
+#include "coro/cloudstorage/test/test_utils.h"
+#include "coro/cloudstorage/util/thread_pool_scheduler.h"
+#include "coro/http/http.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::cloudstorage::test {
+namespace {
+
+using ::coro::cloudstorage::util::AbstractCloudProvider;
+using ::coro::cloudstorage::util::CacheManager;
+using ::coro::cloudstorage::util::Clock;
+using ::coro::cloudstorage::util::CloudProviderAccount;
+using ::coro::cloudstorage::util::CreateCacheDatabase;
+using ::coro::cloudstorage::util::ThreadPoolScheduler;
+using ::coro::cloudstorage::util::ThumbnailGenerator;
+using ::coro::cloudstorage::util::ThumbnailQuality;
+
+TEST(CloudProviderAccountTest, StopsNativeSearchAfterResultLimit) {
+  TestEventLoop loop;
+  auto provider = std::make_unique<FakeCloudProvider>(
+      FakeCloudProvider::Config{.page_size = 100, .search_supported = true});
+  auto* fake = provider.get();
+  for (int i = 0; i < 1500; i++) {
+    fake->AddFile("root", "file" + std::to_string(i), "content");
+  }
+  CloudProviderAccount account("test", /*version=*/0, std::move(provider),
+                               /*cache_manager=*/nullptr, /*clock=*/nullptr,
+                               /*thumbnail_generator=*/nullptr,
+                               /*thumbnail_prefetcher=*/nullptr,
+                               /*metadata_index=*/nullptr);
+
+  size_t item_count = loop.Do([&]() -> Task<size_t> {
+    size_t count = 0;
+    auto pages = account.SearchItems("file", stdx::stop_token());
+    FOR_CO_AWAIT(const AbstractCloudProvider::PageData& page, pages) {
+      count += page.items.size();
+    }
+    co_return count;
+  });
+
+  EXPECT_EQ(item_count, 1000u);
+  EXPECT_EQ(fake->search_items_page_count(), 10);
+}
+
+TEST(CloudProviderAccountTest, GeneratedThumbnailIsCachedForAllQualities) {
+  TemporaryFile cache_file;
+  TestEventLoop loop;
+  Clock clock;
+  auto db = CreateCacheDatabase(std::string(cache_file.path()));
+  CacheManager cache_manager(db.get(), loop.event_loop());
+  coro::util::ThreadPool thread_pool(loop.event_loop(), /*thread_count=*/1,
+                                     "thumbnail");
+  ThreadPoolScheduler scheduler(loop.event_loop(), &thread_pool,
+                                /*thread_count=*/1);
+  ThumbnailGenerator thumbnail_generator(&scheduler, loop.event_loop());
+  auto provider = std::make_unique<FakeCloudProvider>();
+  auto* fake = provider.get();
+  auto file = fake->AddFile("root", "video.mp4",
+                            GetTestFileContent("video.mp4"), "video/mp4");
+  CloudProviderAccount account("test", /*version=*/0, std::move(provider),
+                               &cache_manager, &clock, &thumbnail_generator,
+                               /*thumbnail_prefetcher=*/nullptr,
+                               /*metadata_index=*/nullptr);
+  auto get_thumbnail = [&](ThumbnailQuality quality) {
+    return loop.Do([&]() -> Task<std::string> {
+      auto thumbnail = co_await account.GetItemThumbnailWithFallback(
+          file, quality, http::Range{}, stdx::stop_token());
+      co_return co_await http::GetBody(std::move(thumbnail.thumbnail.data));
+    });
+  };
+
+  std::string high = get_thumbnail(ThumbnailQuality::kHigh);
+  int content_request_count = fake->content_request_count(file.id);
+  std::string low = get_thumbnail(ThumbnailQuality::kLow);
+
+  EXPECT_GT(content_request_count, 0);
+  EXPECT_EQ(fake->content_request_count(file.id), content_request_count);
+  EXPECT_EQ(low, high);
+}
+
+}  // namespace
+}  // namespace coro::cloudstorage::test
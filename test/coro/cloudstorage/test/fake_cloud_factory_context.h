@@ -34,6 +34,14 @@ class TestCloudProviderAccount {
         std::move(args)...);
   }
 
+  auto provider() const {
+    return event_loop_->Do(
+        [this]() -> Task<std::shared_ptr<
+                     coro::cloudstorage::util::AbstractCloudProvider>> {
+          co_return GetAccount().provider();
+        });
+  }
+
  private:
   friend class FakeCloudFactoryContext;
 
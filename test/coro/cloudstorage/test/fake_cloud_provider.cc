@@ -0,0 +1,407 @@
+#include "coro/cloudstorage/test/fake_cloud_provider.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "coro/cloudstorage/cloud_exception.h"
+#include "coro/util/raii_utils.h"
+
+namespace coro::cloudstorage::test {
+
+namespace {
+
+using ::coro::cloudstorage::util::ThumbnailQuality;
+using ::coro::util::AtScopeExit;
+
+constexpr std::string_view kRootId = "root";
+
+}  // namespace
+
+FakeCloudProvider::FakeCloudProvider(Config config)
+    : id_(std::move(config.id)),
+      page_size_(config.page_size),
+      search_supported_(config.search_supported),
+      change_feed_supported_(config.change_feed_supported),
+      event_loop_(config.event_loop),
+      content_delay_ms_(config.content_delay_ms) {
+  nodes_.emplace(std::string(kRootId),
+                 Node{.item = Directory{.id = std::string(kRootId)}});
+}
+
+auto FakeCloudProvider::AddDirectory(std::string_view parent_id,
+                                     std::string name) -> Directory {
+  return std::get<Directory>(
+      AddItem(parent_id, Directory{.name = std::move(name)}, /*content=*/""));
+}
+
+auto FakeCloudProvider::AddFile(std::string_view parent_id, std::string name,
+                                std::string content, std::string mime_type)
+    -> File {
+  auto size = static_cast<int64_t>(content.size());
+  return std::get<File>(AddItem(parent_id,
+                                File{.name = std::move(name),
+                                     .size = size,
+                                     .mime_type = std::move(mime_type)},
+                                std::move(content)));
+}
+
+void FakeCloudProvider::AddChange(Change change) {
+  std::lock_guard lock(mutex_);
+  changes_.emplace_back(std::move(change));
+}
+
+auto FakeCloudProvider::GetChildren(std::string_view id) const
+    -> std::vector<Item> {
+  std::lock_guard lock(mutex_);
+  std::vector<Item> items;
+  for (const auto& item_id : order_) {
+    const auto& node = nodes_.at(item_id);
+    if (node.parent_id == id) {
+      items.emplace_back(node.item);
+    }
+  }
+  return items;
+}
+
+std::string FakeCloudProvider::GetContent(std::string_view id) const {
+  std::lock_guard lock(mutex_);
+  auto it = nodes_.find(std::string(id));
+  if (it == nodes_.end()) {
+    throw CloudException(CloudException::Type::kNotFound);
+  }
+  return it->second.content;
+}
+
+int FakeCloudProvider::content_request_count(std::string_view id) const {
+  std::lock_guard lock(mutex_);
+  auto it = nodes_.find(std::string(id));
+  return it == nodes_.end() ? 0 : it->second.content_request_count;
+}
+
+int FakeCloudProvider::list_directory_page_count() const {
+  std::lock_guard lock(mutex_);
+  return list_directory_page_count_;
+}
+
+int FakeCloudProvider::search_items_page_count() const {
+  std::lock_guard lock(mutex_);
+  return search_items_page_count_;
+}
+
+int FakeCloudProvider::max_concurrent_write_count() const {
+  std::lock_guard lock(mutex_);
+  return max_concurrent_write_count_;
+}
+
+auto FakeCloudProvider::GetRoot(stdx::stop_token) const -> Task<Directory> {
+  co_return std::get<Directory>(Get(kRootId));
+}
+
+auto FakeCloudProvider::GetItem(std::string id, stdx::stop_token) const
+    -> Task<Item> {
+  co_return Get(id);
+}
+
+nlohmann::json FakeCloudProvider::ToJson(const Item& item) const {
+  return std::visit(
+      []<typename T>(const T& d) {
+        nlohmann::json json;
+        json["id"] = d.id;
+        json["name"] = d.name;
+        if (d.size) {
+          json["size"] = *d.size;
+        }
+        if (d.timestamp) {
+          json["timestamp"] = *d.timestamp;
+        }
+        if constexpr (std::is_same_v<T, File>) {
+          json["type"] = "file";
+          json["mime_type"] = d.mime_type;
+        } else {
+          json["type"] = "directory";
+        }
+        return json;
+      },
+      item);
+}
+
+auto FakeCloudProvider::ToItem(const nlohmann::json& json) const -> Item {
+  auto read = [&](auto d) {
+    d.id = json.at("id");
+    d.name = json.at("name");
+    if (json.contains("size")) {
+      d.size = json["size"].get<int64_t>();
+    }
+    if (json.contains("timestamp")) {
+      d.timestamp = json["timestamp"].get<int64_t>();
+    }
+    return d;
+  };
+  if (json.at("type") == "file") {
+    auto file = read(File{});
+    file.mime_type = json.at("mime_type");
+    return file;
+  }
+  return read(Directory{});
+}
+
+auto FakeCloudProvider::ListDirectoryPage(Directory directory,
+                                          std::optional<std::string> page_token,
+                                          stdx::stop_token) const
+    -> Task<PageData> {
+  Get(directory.id);
+  {
+    std::lock_guard lock(mutex_);
+    list_directory_page_count_++;
+  }
+  auto items = GetChildren(directory.id);
+  size_t offset = page_token ? std::stoull(*page_token) : 0;
+  size_t end = std::min(items.size(), offset + page_size_);
+  PageData page_data{
+      .items = std::vector<Item>(items.begin() + offset, items.begin() + end)};
+  if (end < items.size()) {
+    page_data.next_page_token = std::to_string(end);
+  }
+  co_return page_data;
+}
+
+auto FakeCloudProvider::SearchItemsPage(std::string query,
+                                        std::optional<std::string> page_token,
+                                        stdx::stop_token) const
+    -> Task<PageData> {
+  if (!search_supported_) {
+    throw CloudException("search not supported");
+  }
+  std::vector<Item> items;
+  {
+    std::lock_guard lock(mutex_);
+    search_items_page_count_++;
+    for (const auto& id : order_) {
+      const auto& item = nodes_.at(id).item;
+      if (std::visit([](const auto& d) { return d.name; }, item).find(query) !=
+          std::string::npos) {
+        items.emplace_back(item);
+      }
+    }
+  }
+  size_t offset = page_token ? std::stoull(*page_token) : 0;
+  size_t end = std::min(items.size(), offset + page_size_);
+  PageData page_data{
+      .items = std::vector<Item>(items.begin() + offset, items.begin() + end)};
+  if (end < items.size()) {
+    page_data.next_page_token = std::to_string(end);
+  }
+  co_return page_data;
+}
+
+Task<std::string> FakeCloudProvider::GetChangeCursor(stdx::stop_token) const {
+  std::lock_guard lock(mutex_);
+  co_return std::to_string(changes_.size());
+}
+
+auto FakeCloudProvider::GetChanges(std::string cursor, stdx::stop_token) const
+    -> Task<ChangePage> {
+  std::lock_guard lock(mutex_);
+  size_t offset = std::stoull(cursor);
+  size_t end = std::min(changes_.size(), offset + page_size_);
+  co_return ChangePage{
+      .changes = std::vector<Change>(changes_.begin() + offset,
+                                     changes_.begin() + end),
+      .cursor = std::to_string(end),
+      .has_more = end < changes_.size()};
+}
+
+auto FakeCloudProvider::GetGeneralData(stdx::stop_token) const
+    -> Task<GeneralData> {
+  co_return GeneralData{.username = "test"};
+}
+
+Generator<std::string> FakeCloudProvider::GetFileContent(
+    File file, http::Range range, stdx::stop_token stop_token) const {
+  {
+    std::lock_guard lock(mutex_);
+    if (auto it = nodes_.find(file.id); it != nodes_.end()) {
+      it->second.content_request_count++;
+    }
+  }
+  if (event_loop_ && content_delay_ms_ > 0) {
+    co_await event_loop_->Wait(content_delay_ms_, std::move(stop_token));
+  }
+  auto content = GetContent(file.id);
+  int64_t end = range.end.value_or(static_cast<int64_t>(content.size()) - 1);
+  co_yield content.substr(range.start, end - range.start + 1);
+}
+
+auto FakeCloudProvider::RenameItem(Directory item, std::string new_name,
+                                   stdx::stop_token) const -> Task<Directory> {
+  co_return Update(std::move(item), std::move(new_name), std::nullopt);
+}
+
+auto FakeCloudProvider::RenameItem(File item, std::string new_name,
+                                   stdx::stop_token) const -> Task<File> {
+  co_return Update(std::move(item), std::move(new_name), std::nullopt);
+}
+
+auto FakeCloudProvider::CreateDirectory(Directory parent, std::string name,
+                                        stdx::stop_token stop_token) const
+    -> Task<Directory> {
+  co_await BeginWrite(stop_token);
+  auto guard = AtScopeExit([&] { EndWrite(); });
+  co_return std::get<Directory>(
+      AddItem(parent.id, Directory{.name = std::move(name)}, /*content=*/""));
+}
+
+Task<> FakeCloudProvider::RemoveItem(Directory item, stdx::stop_token) const {
+  Remove(item.id);
+  co_return;
+}
+
+Task<> FakeCloudProvider::RemoveItem(File item, stdx::stop_token) const {
+  Remove(item.id);
+  co_return;
+}
+
+auto FakeCloudProvider::MoveItem(File source, Directory destination,
+                                 stdx::stop_token) const -> Task<File> {
+  co_return Update(std::move(source), std::nullopt, std::move(destination.id));
+}
+
+auto FakeCloudProvider::MoveItem(Directory source, Directory destination,
+                                 stdx::stop_token) const -> Task<Directory> {
+  co_return Update(std::move(source), std::nullopt, std::move(destination.id));
+}
+
+auto FakeCloudProvider::CreateFile(Directory parent, std::string name,
+                                   FileContent content,
+                                   stdx::stop_token stop_token) const
+    -> Task<File> {
+  co_await BeginWrite(stop_token);
+  auto guard = AtScopeExit([&] { EndWrite(); });
+  std::string data;
+  FOR_CO_AWAIT(std::string & chunk, content.data) { data += chunk; }
+  if (content.size && *content.size != static_cast<int64_t>(data.size())) {
+    throw CloudException("size mismatch");
+  }
+  auto size = static_cast<int64_t>(data.size());
+  co_return std::get<File>(
+      AddItem(parent.id,
+              File{.name = std::move(name),
+                   .size = size,
+                   .mime_type = "application/octet-stream"},
+              std::move(data)));
+}
+
+auto FakeCloudProvider::GetItemThumbnail(File, http::Range,
+                                         stdx::stop_token) const
+    -> Task<Thumbnail> {
+  throw CloudException(CloudException::Type::kNotFound);
+}
+
+auto FakeCloudProvider::GetItemThumbnail(Directory, http::Range,
+                                         stdx::stop_token) const
+    -> Task<Thumbnail> {
+  throw CloudException(CloudException::Type::kNotFound);
+}
+
+auto FakeCloudProvider::GetItemThumbnail(File, ThumbnailQuality, http::Range,
+                                         stdx::stop_token) const
+    -> Task<Thumbnail> {
+  throw CloudException(CloudException::Type::kNotFound);
+}
+
+auto FakeCloudProvider::GetItemThumbnail(Directory, ThumbnailQuality,
+                                         http::Range, stdx::stop_token) const
+    -> Task<Thumbnail> {
+  throw CloudException(CloudException::Type::kNotFound);
+}
+
+auto FakeCloudProvider::AddItem(std::string_view parent_id, Item item,
+                                std::string content) const -> Item {
+  std::lock_guard lock(mutex_);
+  auto parent = nodes_.find(std::string(parent_id));
+  if (parent == nodes_.end() ||
+      !std::holds_alternative<Directory>(parent->second.item)) {
+    throw CloudException(CloudException::Type::kNotFound);
+  }
+  std::string id = std::to_string(next_id_++);
+  std::visit([&](auto& d) { d.id = id; }, item);
+  order_.emplace_back(id);
+  nodes_.emplace(id, Node{.item = item,
+                          .parent_id = std::string(parent_id),
+                          .content = std::move(content)});
+  return item;
+}
+
+auto FakeCloudProvider::Get(std::string_view id) const -> Item {
+  std::lock_guard lock(mutex_);
+  auto it = nodes_.find(std::string(id));
+  if (it == nodes_.end()) {
+    throw CloudException(CloudException::Type::kNotFound);
+  }
+  return it->second.item;
+}
+
+template <typename T>
+T FakeCloudProvider::Update(T item, std::optional<std::string> name,
+                            std::optional<std::string> parent_id) const {
+  std::lock_guard lock(mutex_);
+  auto it = nodes_.find(item.id);
+  if (it == nodes_.end()) {
+    throw CloudException(CloudException::Type::kNotFound);
+  }
+  auto& d = std::get<T>(it->second.item);
+  if (name) {
+    d.name = std::move(*name);
+  }
+  if (parent_id) {
+    it->second.parent_id = std::move(*parent_id);
+  }
+  return d;
+}
+
+void FakeCloudProvider::Remove(std::string_view id) const {
+  std::lock_guard lock(mutex_);
+  std::vector<std::string> removed{std::string(id)};
+  for (size_t i = 0; i < removed.size(); i++) {
+    for (const auto& [child_id, node] : nodes_) {
+      if (node.parent_id == removed[i]) {
+        removed.emplace_back(child_id);
+      }
+    }
+  }
+  for (const auto& removed_id : removed) {
+    if (nodes_.erase(removed_id) == 0) {
+      throw CloudException(CloudException::Type::kNotFound);
+    }
+    if (auto it = std::find(order_.begin(), order_.end(), removed_id);
+        it != order_.end()) {
+      order_.erase(it);
+    }
+  }
+}
+
+Task<> FakeCloudProvider::BeginWrite(stdx::stop_token stop_token) const {
+  {
+    std::lock_guard lock(mutex_);
+    write_count_++;
+    max_concurrent_write_count_ =
+        std::max(max_concurrent_write_count_, write_count_);
+  }
+  if (event_loop_) {
+    try {
+      co_await event_loop_->Wait(1, std::move(stop_token));
+    } catch (...) {
+      EndWrite();
+      throw;
+    }
+  }
+}
+
+void FakeCloudProvider::EndWrite() const {
+  std::lock_guard lock(mutex_);
+  write_count_--;
+}
+
+}  // namespace coro::cloudstorage::test
@@ -0,0 +1,164 @@
+#ifndef CORO_CLOUDSTORAGE_TEST_FAKE_CLOUD_PROVIDER_H
+#define CORO_CLOUDSTORAGE_TEST_FAKE_CLOUD_PROVIDER_H
+
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "coro/cloudstorage/util/abstract_cloud_provider.h"
+#include "coro/util/event_loop.h"
+
+namespace coro::cloudstorage::test {
+
+// Cloud provider which keeps its tree in memory. Items are listed in the order
+// in which they were added, `page_size` at a time. The change feed reports the
+// changes passed to `AddChange`. Given an event loop, creating a file or a
+// directory waits on it for a moment, so that several can be in progress, and
+// reading a file waits `content_delay_ms` before returning anything.
+class FakeCloudProvider
+    : public coro::cloudstorage::util::AbstractCloudProvider {
+ public:
+  struct Config {
+    std::string id = "fake";
+    int page_size = 100;
+    bool search_supported = false;
+    bool change_feed_supported = false;
+    const coro::util::EventLoop* event_loop = nullptr;
+    int content_delay_ms = 0;
+  };
+
+  explicit FakeCloudProvider(Config config);
+  FakeCloudProvider() : FakeCloudProvider(Config{}) {}
+
+  Directory AddDirectory(std::string_view parent_id, std::string name);
+  File AddFile(std::string_view parent_id, std::string name,
+               std::string content,
+               std::string mime_type = "application/octet-stream");
+  void AddChange(Change change);
+
+  // Returns the items of the directory `id`, in the order they were added.
+  std::vector<Item> GetChildren(std::string_view id) const;
+  std::string GetContent(std::string_view id) const;
+
+  // Number of times the content of the file `id` was read.
+  int content_request_count(std::string_view id) const;
+  int list_directory_page_count() const;
+  int search_items_page_count() const;
+  // Largest number of files and directories created at the same time.
+  int max_concurrent_write_count() const;
+
+  std::string_view GetId() const override { return id_; }
+
+  Task<Directory> GetRoot(stdx::stop_token) const override;
+
+  Task<Item> GetItem(std::string id, stdx::stop_token) const override;
+
+  nlohmann::json ToJson(const Item&) const override;
+
+  Item ToItem(const nlohmann::json&) const override;
+
+  bool IsFileContentSizeRequired(const Directory&) const override {
+    return false;
+  }
+
+  Task<PageData> ListDirectoryPage(Directory directory,
+                                   std::optional<std::string> page_token,
+                                   stdx::stop_token stop_token) const override;
+
+  bool IsSearchSupported() const override { return search_supported_; }
+
+  Task<PageData> SearchItemsPage(std::string query,
+                                 std::optional<std::string> page_token,
+                                 stdx::stop_token stop_token) const override;
+
+  bool IsChangeFeedSupported() const override {
+    return change_feed_supported_;
+  }
+
+  Task<std::string> GetChangeCursor(stdx::stop_token) const override;
+
+  Task<ChangePage> GetChanges(std::string cursor,
+                              stdx::stop_token) const override;
+
+  Task<GeneralData> GetGeneralData(stdx::stop_token) const override;
+
+  Generator<std::string> GetFileContent(
+      File file, http::Range range, stdx::stop_token stop_token) const override;
+
+  Task<Directory> RenameItem(Directory item, std::string new_name,
+                             stdx::stop_token stop_token) const override;
+  Task<File> RenameItem(File item, std::string new_name,
+                        stdx::stop_token stop_token) const override;
+
+  Task<Directory> CreateDirectory(Directory parent, std::string name,
+                                  stdx::stop_token stop_token) const override;
+
+  Task<> RemoveItem(Directory item, stdx::stop_token stop_token) const override;
+  Task<> RemoveItem(File item, stdx::stop_token stop_token) const override;
+
+  Task<File> MoveItem(File source, Directory destination,
+                      stdx::stop_token stop_token) const override;
+  Task<Directory> MoveItem(Directory source, Directory destination,
+                           stdx::stop_token stop_token) const override;
+
+  Task<File> CreateFile(Directory parent, std::string name, FileContent content,
+                        stdx::stop_token stop_token) const override;
+
+  Task<Thumbnail> GetItemThumbnail(File item, http::Range range,
+                                   stdx::stop_token stop_token) const override;
+
+  Task<Thumbnail> GetItemThumbnail(Directory item, http::Range range,
+                                   stdx::stop_token stop_token) const override;
+
+  Task<Thumbnail> GetItemThumbnail(File item,
+                                   coro::cloudstorage::util::ThumbnailQuality,
+                                   http::Range range,
+                                   stdx::stop_token stop_token) const override;
+
+  Task<Thumbnail> GetItemThumbnail(Directory item,
+                                   coro::cloudstorage::util::ThumbnailQuality,
+                                   http::Range range,
+                                   stdx::stop_token stop_token) const override;
+
+ private:
+  struct Node {
+    Item item;
+    std::string parent_id;
+    std::string content;
+    int content_request_count = 0;
+  };
+
+  Item AddItem(std::string_view parent_id, Item item,
+               std::string content) const;
+  Item Get(std::string_view id) const;
+  template <typename T>
+  T Update(T item, std::optional<std::string> name,
+           std::optional<std::string> parent_id) const;
+  void Remove(std::string_view id) const;
+  Task<> BeginWrite(stdx::stop_token stop_token) const;
+  void EndWrite() const;
+
+  std::string id_;
+  int page_size_;
+  bool search_supported_;
+  bool change_feed_supported_;
+  const coro::util::EventLoop* event_loop_;
+  int content_delay_ms_;
+  mutable std::mutex mutex_;
+  mutable std::unordered_map<std::string, Node> nodes_;
+  // Ids of the items in the order in which they were added.
+  mutable std::vector<std::string> order_;
+  mutable int64_t next_id_ = 0;
+  std::vector<Change> changes_;
+  mutable int list_directory_page_count_ = 0;
+  mutable int search_items_page_count_ = 0;
+  mutable int write_count_ = 0;
+  mutable int max_concurrent_write_count_ = 0;
+};
+
+}  // namespace coro::cloudstorage::test
+
+#endif  // CORO_CLOUDSTORAGE_TEST_FAKE_CLOUD_PROVIDER_H
@@ -49,6 +49,24 @@ HttpRequestStubbingBuilder&& HttpRequestStubbingBuilder::WithBody(
   return std::move(*this);
 }
 
+HttpRequestStubbingBuilder&& HttpRequestStubbingBuilder::WithRequestCount(
+    std::atomic<int>* request_count) && {
+  request_count_ = request_count;
+  return std::move(*this);
+}
+
+template <typename F>
+auto HttpRequestStubbingBuilder::CountRequests(F request_f) {
+  return [request_count = request_count_, request_f = std::move(request_f)](
+             http::Request<std::string> request,
+             stdx::stop_token stop_token) mutable -> Task<Response> {
+    if (request_count) {
+      ++*request_count;
+    }
+    return request_f(std::move(request), std::move(stop_token));
+  };
+}
+
 HttpRequestStubbing HttpRequestStubbingBuilder::WillReturn(
     std::string_view message) && {
   return std::move(*this).WillReturn(
@@ -56,44 +74,47 @@ HttpRequestStubbing HttpRequestStubbingBuilder::WillReturn(
 }
 
 HttpRequestStubbing HttpRequestStubbingBuilder::WillNotReturn() && {
-  return HttpRequestStubbing{
-      .matcher = std::move(*this).CreateRequestMatcher(),
-      .request_f = [](http::Request<std::string> request,
-                      stdx::stop_token stop_token) -> Task<Response> {
-        coro::Promise<void> promise;
-        stdx::stop_callback stop_callback{
-            std::move(stop_token),
-            [&] { promise.SetException(InterruptedException()); }};
-        co_await promise;
-        co_return Response{};
-      }};
+  auto request_f = CountRequests([](http::Request<std::string> request,
+                                    stdx::stop_token stop_token)
+                                     -> Task<Response> {
+    coro::Promise<void> promise;
+    stdx::stop_callback stop_callback{
+        std::move(stop_token),
+        [&] { promise.SetException(InterruptedException()); }};
+    co_await promise;
+    co_return Response{};
+  });
+  return HttpRequestStubbing{.matcher = std::move(*this).CreateRequestMatcher(),
+                             .request_f = std::move(request_f)};
 }
 
 HttpRequestStubbing HttpRequestStubbingBuilder::WillReturn(
     ResponseContent response) && {
-  return HttpRequestStubbing{
-      .matcher = std::move(*this).CreateRequestMatcher(),
-      .request_f = [response = std::move(response)](
-                       http::Request<std::string> request,
-                       stdx::stop_token) mutable -> Task<Response> {
-        Response d{.status = response.status,
-                   .headers = std::move(response.headers)};
-        d.headers.emplace_back("Content-Length",
-                               std::to_string(response.body.size()));
-        d.body = http::CreateBody(std::move(response.body));
-        co_return d;
-      }};
+  auto request_f = CountRequests([response = std::move(response)](
+                                     http::Request<std::string> request,
+                                     stdx::stop_token) mutable
+                                     -> Task<Response> {
+    Response d{.status = response.status,
+               .headers = std::move(response.headers)};
+    d.headers.emplace_back("Content-Length",
+                           std::to_string(response.body.size()));
+    d.body = http::CreateBody(std::move(response.body));
+    co_return d;
+  });
+  return HttpRequestStubbing{.matcher = std::move(*this).CreateRequestMatcher(),
+                             .request_f = std::move(request_f)};
 }
 
 HttpRequestStubbing HttpRequestStubbingBuilder::WillRespondToRangeRequestWith(
     std::string_view message) && {
+  auto request_f = CountRequests([message = std::string(message)](
+                                     http::Request<std::string> request,
+                                     stdx::stop_token) -> Task<Response> {
+    co_return RespondToRangeRequestWith(request, message);
+  });
   return HttpRequestStubbing{
       .matcher = std::move(*this).CreateRequestMatcher(),
-      .request_f = [message = std::string(message)](
-                       http::Request<std::string> request,
-                       stdx::stop_token) -> Task<Response> {
-        co_return RespondToRangeRequestWith(request, message);
-      },
+      .request_f = std::move(request_f),
       .pending = false};
 }
 
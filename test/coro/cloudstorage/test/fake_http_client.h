@@ -4,6 +4,7 @@
 #include <coro/http/http.h>
 #include <coro/stdx/any_invocable.h>
 
+#include <atomic>
 #include <string>
 
 #include "coro/cloudstorage/test/matcher.h"
@@ -32,6 +33,10 @@ class HttpRequestStubbingBuilder {
 
   HttpRequestStubbingBuilder&& WithBody(Matcher<std::string> body_matcher) &&;
 
+  // Increments `request_count` every time the stubbing responds to a request.
+  HttpRequestStubbingBuilder&& WithRequestCount(
+      std::atomic<int>* request_count) &&;
+
   HttpRequestStubbing WillReturn(std::string_view message) &&;
 
   HttpRequestStubbing WillReturn(ResponseContent response) &&;
@@ -45,8 +50,12 @@ class HttpRequestStubbingBuilder {
   stdx::any_invocable<bool(const http::Request<std::string>&) const>
   CreateRequestMatcher() &&;
 
+  template <typename F>
+  auto CountRequests(F request_f);
+
   Matcher<std::string> url_matcher_;
   std::optional<Matcher<std::string>> body_matcher_;
+  std::atomic<int>* request_count_ = nullptr;
 };
 
 HttpRequestStubbingBuilder HttpRequest(Matcher<std::string> url_matcher);
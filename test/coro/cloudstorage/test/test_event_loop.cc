@@ -0,0 +1,34 @@
+#include "coro/cloudstorage/test/test_event_loop.h"
+
+#include <limits>
+
+#include "coro/exception.h"
+#include "coro/task.h"
+
+namespace coro::cloudstorage::test {
+
+TestEventLoop::TestEventLoop() : thread_([this] { RunThread(); }) {
+  ready_.get_future().get();
+}
+
+TestEventLoop::~TestEventLoop() {
+  event_loop_->RunOnEventLoop([&] { stop_source_.request_stop(); });
+  thread_.join();
+}
+
+void TestEventLoop::RunThread() {
+  event_loop_.emplace();
+  // The pending wait keeps the loop from running out of events until the
+  // object is destroyed.
+  RunTask([&]() -> Task<> {
+    try {
+      co_await event_loop_->Wait(std::numeric_limits<int>::max(),
+                                 stop_source_.get_token());
+    } catch (const InterruptedException&) {
+    }
+  });
+  ready_.set_value();
+  event_loop_->EnterLoop();
+}
+
+}  // namespace coro::cloudstorage::test
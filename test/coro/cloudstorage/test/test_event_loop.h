@@ -0,0 +1,44 @@
+#ifndef CORO_CLOUDSTORAGE_TEST_TEST_EVENT_LOOP_H
+#define CORO_CLOUDSTORAGE_TEST_TEST_EVENT_LOOP_H
+
+#include <coro/util/event_loop.h>
+
+#include <future>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "coro/stdx/stop_source.h"
+
+namespace coro::cloudstorage::test {
+
+// Runs an event loop on a thread of its own for as long as the object lives.
+class TestEventLoop {
+ public:
+  TestEventLoop();
+  TestEventLoop(const TestEventLoop&) = delete;
+  TestEventLoop(TestEventLoop&&) = delete;
+  TestEventLoop& operator=(const TestEventLoop&) = delete;
+  TestEventLoop& operator=(TestEventLoop&&) = delete;
+  ~TestEventLoop();
+
+  const coro::util::EventLoop* event_loop() const { return &*event_loop_; }
+
+  // Runs the task returned by `f` on the event loop and waits for its result.
+  template <typename F>
+  auto Do(F f) {
+    return event_loop_->Do(std::move(f));
+  }
+
+ private:
+  void RunThread();
+
+  std::optional<coro::util::EventLoop> event_loop_;
+  stdx::stop_source stop_source_;
+  std::promise<void> ready_;
+  std::thread thread_;
+};
+
+}  // namespace coro::cloudstorage::test
+
+#endif  // CORO_CLOUDSTORAGE_TEST_TEST_EVENT_LOOP_H
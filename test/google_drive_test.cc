@@ -1,17 +1,26 @@
 #include <fmt/format.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "coro/cloudstorage/test/fake_cloud_factory_context.h"
 #include "coro/cloudstorage/test/fake_http_client.h"
 #include "coro/cloudstorage/test/test_utils.h"
+#include "coro/cloudstorage/util/item_data_codec.h"
 
 namespace coro::cloudstorage::test {
 namespace {
 
 using ::coro::cloudstorage::util::AbstractCloudProvider;
 using ::coro::cloudstorage::util::CloudProviderAccount;
+using ::coro::cloudstorage::util::ItemDataFormat;
 
-TEST(GoogleDriveTest, ListDirectory) {
+FakeHttpClient CreateListDirectoryHttpClient() {
   FakeHttpClient http;
   http.Expect(HttpRequest("https://accounts.google.com/o/oauth2/token")
                   .WillReturn(R"js({
@@ -51,7 +60,11 @@ TEST(GoogleDriveTest, ListDirectory) {
                 ],
                 "nextPageToken": "next-page-token"
               })js"));
-  FakeCloudFactoryContext test_helper(std::move(http));
+  return http;
+}
+
+TEST(GoogleDriveTest, ListDirectory) {
+  FakeCloudFactoryContext test_helper(CreateListDirectoryHttpClient());
   ASSERT_EQ(test_helper.Fetch({.url = "/auth/google?code=test"}).status, 302);
 
   auto account = test_helper.GetAccount(
@@ -72,5 +85,72 @@ TEST(GoogleDriveTest, ListDirectory) {
   EXPECT_EQ(file->mime_type, "video/mp4");
 }
 
+TEST(GoogleDriveTest, RoundTripsCachedItemData) {
+  FakeCloudFactoryContext test_helper(CreateListDirectoryHttpClient());
+  ASSERT_EQ(test_helper.Fetch({.url = "/auth/google?code=test"}).status, 302);
+  auto account = test_helper.GetAccount(
+      CloudProviderAccount::Id{.type = "google", .username = "test@gmail.com"});
+  auto page_data =
+      account.ListDirectoryPage(account.GetRoot(), /*page_token=*/std::nullopt);
+  ASSERT_EQ(page_data.items.size(), 1);
+  const auto& file = std::get<AbstractCloudProvider::File>(page_data.items[0]);
+  auto provider = account.provider();
+
+  std::string data = provider->EncodeItemData(file);
+  AbstractCloudProvider::Item decoded =
+      AbstractCloudProvider::File{.id = file.id,
+                                  .name = file.name,
+                                  .size = file.size,
+                                  .timestamp = file.timestamp,
+                                  .mime_type = file.mime_type};
+  provider->DecodeItemData(data, decoded);
+
+  EXPECT_EQ(static_cast<ItemDataFormat>(data[0]), ItemDataFormat::kCompact);
+  EXPECT_EQ(provider->ToJson(decoded), provider->ToJson(file));
+}
+
+// Compares decoding a cached item from the compact encoding with decoding it
+// from the CBOR of the whole item. Disabled by default, run it with
+// --gtest_also_run_disabled_tests to see the numbers.
+TEST(GoogleDriveTest, DISABLED_CachedItemDecodeThroughput) {
+  FakeCloudFactoryContext test_helper(CreateListDirectoryHttpClient());
+  ASSERT_EQ(test_helper.Fetch({.url = "/auth/google?code=test"}).status, 302);
+  auto account = test_helper.GetAccount(
+      CloudProviderAccount::Id{.type = "google", .username = "test@gmail.com"});
+  auto page_data =
+      account.ListDirectoryPage(account.GetRoot(), /*page_token=*/std::nullopt);
+  ASSERT_EQ(page_data.items.size(), 1);
+  const auto& file = std::get<AbstractCloudProvider::File>(page_data.items[0]);
+  auto provider = account.provider();
+  std::vector<uint8_t> cbor = nlohmann::json::to_cbor(provider->ToJson(file));
+  std::string compact = provider->EncodeItemData(file);
+  constexpr int kIterations = 100000;
+  auto measure = [&](std::string_view name, size_t size, auto decode) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      AbstractCloudProvider::Item item = decode();
+      ASSERT_EQ(std::get<AbstractCloudProvider::File>(item).id, file.id);
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << size << " bytes, "
+              << kIterations / elapsed.count() << " items/s\n";
+  };
+
+  measure("cbor", cbor.size(),
+          [&] { return provider->ToItem(nlohmann::json::from_cbor(cbor)); });
+  measure("compact", compact.size(), [&] {
+    // The common fields come from the columns of the cache.
+    AbstractCloudProvider::Item item =
+        AbstractCloudProvider::File{.id = file.id,
+                                    .name = file.name,
+                                    .size = file.size,
+                                    .timestamp = file.timestamp,
+                                    .mime_type = file.mime_type};
+    provider->DecodeItemData(compact, item);
+    return item;
+  });
+}
+
 }  // namespace
 }  // namespace coro::cloudstorage::test
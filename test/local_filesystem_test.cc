@@ -0,0 +1,204 @@
+#include "coro/cloudstorage/providers/local_filesystem.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "coro/cloudstorage/cloud_exception.h"
+#include "coro/cloudstorage/test/test_event_loop.h"
+#include "coro/cloudstorage/test/test_utils.h"
+#include "coro/cloudstorage/util/generator_utils.h"
+#include "coro/cloudstorage/util/string_utils.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::cloudstorage::test {
+namespace {
+
+using ::coro::cloudstorage::util::StrCat;
+using ::coro::cloudstorage::util::ToGenerator;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+using File = LocalFileSystem::File;
+using Directory = LocalFileSystem::Directory;
+
+// A directory under the test run directory which is removed together with
+// its content on destruction.
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    std::random_device random;
+    do {
+      path_ = std::filesystem::path(kTestRunDirectory) /
+              StrCat("local.", random());
+    } while (!std::filesystem::create_directory(path_));
+  }
+  TemporaryDirectory(const TemporaryDirectory&) = delete;
+  TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+  ~TemporaryDirectory() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+  }
+
+  const std::filesystem::path& path() const { return path_; }
+
+ private:
+  std::filesystem::path path_;
+};
+
+// Names of the entries of `path`, including the hidden ones.
+std::vector<std::string> GetEntries(const std::filesystem::path& path) {
+  std::vector<std::string> names;
+  for (const auto& entry : std::filesystem::directory_iterator(path)) {
+    names.emplace_back(entry.path().filename().string());
+  }
+  return names;
+}
+
+class LocalFileSystemTest : public ::testing::TestWithParam<bool> {
+ protected:
+  File CreateFile(const Directory& parent, std::string_view name,
+                  std::string content, std::optional<int64_t> size) {
+    return loop_.Do([&] {
+      return provider_.CreateFile(
+          parent, name,
+          LocalFileSystem::FileContent{.data = ToGenerator(std::move(content)),
+                                       .size = size},
+          stop_token_);
+    });
+  }
+
+  File CreateFile(const Directory& parent, std::string_view name,
+                  std::string content) {
+    auto size = static_cast<int64_t>(content.size());
+    return CreateFile(parent, name, std::move(content), size);
+  }
+
+  Directory CreateDirectory(const Directory& parent, std::string name) {
+    return loop_.Do([&] {
+      return provider_.CreateDirectory(parent, std::move(name), stop_token_);
+    });
+  }
+
+  std::string GetContent(const File& file) {
+    return loop_.Do([&]() -> Task<std::string> {
+      std::string content;
+      FOR_CO_AWAIT(std::string & chunk,
+                   provider_.GetFileContent(file, http::Range{}, stop_token_)) {
+        content += chunk;
+      }
+      co_return content;
+    });
+  }
+
+  TemporaryDirectory directory_;
+  Directory root_{{.id = directory_.path().string(), .name = "root"}};
+  TestEventLoop loop_;
+  coro::util::ThreadPool thread_pool_{loop_.event_loop(), /*thread_count=*/2,
+                                      "local"};
+  LocalFileSystem provider_{
+      &thread_pool_, LocalFileSystem::Auth::AuthToken{.root = root_.id},
+      LocalFileSystem::Config{.use_named_temporary_files = GetParam()}};
+  stdx::stop_token stop_token_;
+};
+
+TEST_P(LocalFileSystemTest, CreatesFile) {
+  File file = CreateFile(root_, "file.txt", "content");
+
+  EXPECT_EQ(file.name, "file.txt");
+  EXPECT_EQ(file.size, 7);
+  EXPECT_EQ(GetContent(file), "content");
+  // No temporary file is left behind.
+  EXPECT_THAT(GetEntries(directory_.path()), UnorderedElementsAre("file.txt"));
+}
+
+TEST_P(LocalFileSystemTest, DoesNotReplaceExistingFile) {
+  File file = CreateFile(root_, "file.txt", "first");
+
+  EXPECT_THROW(CreateFile(root_, "file.txt", "second"), CloudException);
+
+  EXPECT_EQ(GetContent(file), "first");
+  EXPECT_THAT(GetEntries(directory_.path()), UnorderedElementsAre("file.txt"));
+}
+
+TEST_P(LocalFileSystemTest, RejectsContentOfOtherThanDeclaredSize) {
+  EXPECT_THROW(CreateFile(root_, "file.txt", "content", /*size=*/8),
+               CloudException);
+
+  EXPECT_THAT(GetEntries(directory_.path()), IsEmpty());
+}
+
+TEST_P(LocalFileSystemTest, RenamesItems) {
+  File file = CreateFile(root_, "file.txt", "content");
+  CreateFile(root_, "taken.txt", "taken");
+  Directory directory = CreateDirectory(root_, "directory");
+
+  File renamed = loop_.Do(
+      [&] { return provider_.RenameItem(file, "renamed.txt", stop_token_); });
+  Directory renamed_directory = loop_.Do([&] {
+    return provider_.RenameItem(directory, "renamed", stop_token_);
+  });
+
+  EXPECT_EQ(renamed.name, "renamed.txt");
+  EXPECT_EQ(GetContent(renamed), "content");
+  EXPECT_EQ(renamed_directory.name, "renamed");
+  EXPECT_THROW(loop_.Do([&] {
+                 return provider_.RenameItem(renamed, "taken.txt",
+                                             stop_token_);
+               }),
+               CloudException);
+  EXPECT_THAT(GetEntries(directory_.path()),
+              UnorderedElementsAre("renamed.txt", "taken.txt", "renamed"));
+}
+
+TEST_P(LocalFileSystemTest, MovesItems) {
+  File file = CreateFile(root_, "file.txt", "content");
+  Directory source = CreateDirectory(root_, "source");
+  CreateFile(source, "nested.txt", "nested");
+  Directory destination = CreateDirectory(root_, "destination");
+  CreateFile(destination, "file.txt", "taken");
+
+  Directory moved_directory = loop_.Do(
+      [&] { return provider_.MoveItem(source, destination, stop_token_); });
+
+  EXPECT_EQ(moved_directory.name, "source");
+  EXPECT_THAT(GetEntries(moved_directory.id),
+              UnorderedElementsAre("nested.txt"));
+  EXPECT_THROW(loop_.Do([&] {
+                 return provider_.MoveItem(file, destination, stop_token_);
+               }),
+               CloudException);
+  EXPECT_EQ(GetContent(file), "content");
+  EXPECT_THAT(GetEntries(directory_.path()),
+              UnorderedElementsAre("file.txt", "destination"));
+}
+
+TEST_P(LocalFileSystemTest, RemovesItems) {
+  File file = CreateFile(root_, "file.txt", "content");
+  Directory directory = CreateDirectory(root_, "directory");
+  CreateFile(directory, "nested.txt", "nested");
+
+  loop_.Do([&] { return provider_.RemoveItem(file, stop_token_); });
+  loop_.Do([&] { return provider_.RemoveItem(directory, stop_token_); });
+
+  EXPECT_THAT(GetEntries(directory_.path()), IsEmpty());
+  EXPECT_THROW(
+      loop_.Do([&] { return provider_.RemoveItem(file, stop_token_); }),
+      CloudException);
+}
+
+// Runs every test with an unnamed O_TMPFILE file, where supported, and with a
+// hidden `.part` file created by mkstemps.
+INSTANTIATE_TEST_SUITE_P(TemporaryFiles, LocalFileSystemTest,
+                         ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                           return info.param ? "NamedTemporaryFile"
+                                             : "UnnamedTemporaryFile";
+                         });
+
+}  // namespace
+}  // namespace coro::cloudstorage::test
@@ -0,0 +1,156 @@
+#include "coro/cloudstorage/util/metadata_index.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "coro/cloudstorage/test/fake_cloud_provider.h"
+#include "coro/cloudstorage/test/test_event_loop.h"
+#include "coro/cloudstorage/test/test_utils.h"
+#include "coro/cloudstorage/util/cache_manager.h"
+#include "coro/when_all.h"
+
+namespace coro::cloudstorage::test {
+namespace {
+
+using ::coro::cloudstorage::util::CacheManager;
+using ::coro::cloudstorage::util::CreateCacheDatabase;
+using ::coro::cloudstorage::util::MetadataIndex;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+std::vector<std::string> GetPaths(
+    const std::vector<MetadataIndex::Entry>& entries) {
+  std::vector<std::string> paths;
+  for (const auto& entry : entries) {
+    paths.emplace_back(entry.path);
+  }
+  return paths;
+}
+
+class MetadataIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!index_.IsAvailable()) {
+      GTEST_SKIP() << "SQLite lacks FTS5 with the trigram tokenizer";
+    }
+  }
+
+  // Crawls the whole tree of `provider_` into the index.
+  void Crawl() {
+    loop_.Do([&]() -> Task<> {
+      co_await index_.StartCrawl(account_,
+                                 co_await provider_->GetRoot(stop_token_),
+                                 /*update_time=*/0, stop_token_);
+      while (auto pending =
+                 co_await index_.GetPendingDirectory(account_, stop_token_)) {
+        auto page_data = co_await provider_->ListDirectoryPage(
+            pending->directory, /*page_token=*/std::nullopt, stop_token_);
+        co_await index_.PutDirectoryContent(account_, std::move(*pending),
+                                            std::move(page_data.items),
+                                            stop_token_);
+      }
+      co_await index_.FinishCrawl(account_, /*update_time=*/1, stop_token_);
+    });
+  }
+
+  std::vector<MetadataIndex::Entry> Search(MetadataIndex::Query query) {
+    return loop_.Do([&] {
+      return index_.Search({account_}, std::move(query), stop_token_);
+    });
+  }
+
+  TemporaryFile cache_file_;
+  TestEventLoop loop_;
+  MetadataIndex index_{std::string(cache_file_.path()), loop_.event_loop()};
+  std::shared_ptr<FakeCloudProvider> provider_ =
+      std::make_shared<FakeCloudProvider>();
+  CacheManager::AccountKey account_{.provider = provider_,
+                                    .username = "test"};
+  stdx::stop_token stop_token_;
+};
+
+TEST_F(MetadataIndexTest, FindsItemsAnywhereInTheTree) {
+  auto directory = provider_->AddDirectory("root", "Photos");
+  provider_->AddFile(directory.id, "holiday.jpg", "jpg");
+  provider_->AddFile("root", "Holiday plans.txt", "txt");
+  provider_->AddFile("root", "notes.txt", "txt");
+
+  Crawl();
+
+  EXPECT_THAT(GetPaths(Search({.text = "holiday"})),
+              ElementsAre("/Holiday plans.txt", "/Photos/holiday.jpg"));
+  EXPECT_THAT(GetPaths(Search({.text = "ho", .prefix = true})),
+              ElementsAre("/Holiday plans.txt", "/Photos/holiday.jpg"));
+  EXPECT_THAT(GetPaths(Search(
+                  {.text = "o", .type = MetadataIndex::ItemType::kDirectory})),
+              ElementsAre("/Photos"));
+}
+
+TEST_F(MetadataIndexTest, DropsItemsRemovedBeforeRecrawl) {
+  auto file = provider_->AddFile("root", "report.pdf", "pdf");
+  Crawl();
+  loop_.Do([&]() -> Task<> {
+    co_await provider_->RemoveItem(file, stop_token_);
+  });
+
+  Crawl();
+
+  EXPECT_THAT(Search({.text = "report"}), IsEmpty());
+}
+
+TEST_F(MetadataIndexTest, SharesDatabaseWithCacheManager) {
+  auto cache_db = CreateCacheDatabase(std::string(cache_file_.path()));
+  CacheManager cache_manager(cache_db.get(), loop_.event_loop());
+  for (int i = 0; i < 20; i++) {
+    provider_->AddFile("root", "file" + std::to_string(i), "content");
+  }
+  auto directory = provider_->AddDirectory("root", "directory");
+  auto items = provider_->GetChildren("root");
+
+  loop_.Do([&]() -> Task<> {
+    co_await index_.StartCrawl(account_, directory, /*update_time=*/0,
+                               stop_token_);
+    auto pending = co_await index_.GetPendingDirectory(account_, stop_token_);
+    std::vector<Task<bool>> cache_writes;
+    std::vector<Task<>> index_writes;
+    for (int i = 0; i < 20; i++) {
+      cache_writes.emplace_back(cache_manager.Put(
+          account_,
+          CacheManager::DirectoryContent{
+              .parent = directory, .items = items, .update_time = i},
+          stop_token_));
+      index_writes.emplace_back(index_.PutDirectoryContent(
+          account_, *pending, items, stop_token_));
+    }
+    co_await WhenAll(WhenAll(std::move(cache_writes)),
+                     WhenAll(std::move(index_writes)));
+  });
+
+  EXPECT_THAT(Search({.text = "file", .limit = 100}), SizeIs(20));
+}
+
+TEST(MetadataIndexUnavailableTest, DegradesToEmptyIndex) {
+  TestEventLoop loop;
+  MetadataIndex index("/nonexistent/directory/cache.db", loop.event_loop());
+  CacheManager::AccountKey account{
+      .provider = std::make_shared<FakeCloudProvider>(), .username = "test"};
+
+  EXPECT_FALSE(index.IsAvailable());
+  EXPECT_EQ(loop.Do([&] {
+              return index.GetCrawlState(account, stdx::stop_token());
+            }),
+            std::nullopt);
+  EXPECT_THAT(loop.Do([&] {
+                return index.Search({account}, {.text = "file"},
+                                    stdx::stop_token());
+              }),
+              IsEmpty());
+}
+
+}  // namespace
+}  // namespace coro::cloudstorage::test
@@ -0,0 +1,168 @@
+#include "coro/cloudstorage/util/thread_pool_scheduler.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "coro/cloudstorage/test/test_event_loop.h"
+#include "coro/exception.h"
+#include "coro/task.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::cloudstorage::test {
+namespace {
+
+using ::coro::cloudstorage::util::ThreadPoolScheduler;
+using ::testing::ElementsAre;
+
+using Priority = ThreadPoolScheduler::Priority;
+
+// Holds the threads of the jobs that wait on it until it's opened.
+class Gate {
+ public:
+  void Open() {
+    std::call_once(opened_, [&] { promise_.set_value(); });
+  }
+  void Wait() const { future_.wait(); }
+
+ private:
+  std::promise<void> promise_;
+  std::shared_future<void> future_ = promise_.get_future().share();
+  std::once_flag opened_;
+};
+
+// Checks `predicate` until it holds or a few seconds pass. Returns whether it
+// held.
+template <typename F>
+bool WaitUntil(F predicate) {
+  for (int i = 0; i < 5000; i++) {
+    if (predicate()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+class ThreadPoolSchedulerTest : public ::testing::Test {
+ protected:
+  explicit ThreadPoolSchedulerTest(int thread_count = 1)
+      : thread_pool_(loop_.event_loop(), thread_count, "scheduler"),
+        scheduler_(loop_.event_loop(), &thread_pool_, thread_count) {}
+
+  ~ThreadPoolSchedulerTest() override {
+    gate_.Open();
+    EXPECT_TRUE(WaitUntil([&] { return finished_ == scheduled_; }));
+  }
+
+  // Schedules `job` without waiting for it to finish.
+  void Schedule(Priority priority, std::function<void()> job,
+                stdx::stop_token stop_token = {}) {
+    scheduled_++;
+    loop_.Do([&]() -> Task<> {
+      RunTask([this, priority, job = std::move(job),
+               stop_token = std::move(stop_token)]() -> Task<> {
+        try {
+          co_await scheduler_.Do(priority, std::move(stop_token),
+                                 std::move(job));
+        } catch (const InterruptedException&) {
+          interrupted_++;
+        }
+        finished_++;
+      });
+      co_return;
+    });
+  }
+
+  Gate gate_;
+  TestEventLoop loop_;
+  coro::util::ThreadPool thread_pool_;
+  ThreadPoolScheduler scheduler_;
+  int scheduled_ = 0;
+  std::atomic<int> finished_ = 0;
+  std::atomic<int> interrupted_ = 0;
+};
+
+class ThreadPoolSchedulerWithReserveTest : public ThreadPoolSchedulerTest {
+ protected:
+  // One of the four threads is reserved for playback.
+  ThreadPoolSchedulerWithReserveTest()
+      : ThreadPoolSchedulerTest(/*thread_count=*/4) {}
+};
+
+TEST_F(ThreadPoolSchedulerWithReserveTest,
+       PlaybackRunsWhileThumbnailsHoldUnreservedThreads) {
+  std::atomic<int> thumbnails_started = 0;
+  for (int i = 0; i < 4; i++) {
+    Schedule(Priority::kThumbnail, [&] {
+      thumbnails_started++;
+      gate_.Wait();
+    });
+  }
+  ASSERT_TRUE(WaitUntil([&] { return thumbnails_started == 3; }));
+
+  bool playback_ran = loop_.Do([&] {
+    return scheduler_.Do(Priority::kPlayback, stdx::stop_token(),
+                         [] { return true; });
+  });
+
+  EXPECT_TRUE(playback_ran);
+  EXPECT_EQ(thumbnails_started, 3);
+  gate_.Open();
+}
+
+TEST_F(ThreadPoolSchedulerTest, RunsNewestJobFirstWithinPriority) {
+  std::atomic<bool> started = false;
+  Schedule(Priority::kThumbnail, [&] {
+    started = true;
+    gate_.Wait();
+  });
+  ASSERT_TRUE(WaitUntil([&] { return started.load(); }));
+  std::mutex mutex;
+  std::vector<int> order;
+  for (int i = 1; i <= 3; i++) {
+    Schedule(Priority::kThumbnail, [&, i] {
+      std::lock_guard lock(mutex);
+      order.push_back(i);
+    });
+  }
+
+  gate_.Open();
+
+  ASSERT_TRUE(WaitUntil([&] { return finished_ == scheduled_; }));
+  EXPECT_THAT(order, ElementsAre(3, 2, 1));
+}
+
+TEST_F(ThreadPoolSchedulerTest, DropsInterruptedWaiterWithoutTakingThread) {
+  std::atomic<bool> started = false;
+  Schedule(Priority::kThumbnail, [&] {
+    started = true;
+    gate_.Wait();
+  });
+  ASSERT_TRUE(WaitUntil([&] { return started.load(); }));
+  std::atomic<bool> interrupted_job_ran = false;
+  std::atomic<bool> next_job_ran = false;
+  stdx::stop_source stop_source;
+  Schedule(Priority::kThumbnail, [&] { next_job_ran = true; });
+  Schedule(
+      Priority::kThumbnail, [&] { interrupted_job_ran = true; },
+      stop_source.get_token());
+
+  stop_source.request_stop();
+
+  ASSERT_TRUE(WaitUntil([&] { return interrupted_ == 1; }));
+  gate_.Open();
+  ASSERT_TRUE(WaitUntil([&] { return finished_ == scheduled_; }));
+  EXPECT_TRUE(next_job_ran);
+  EXPECT_FALSE(interrupted_job_ran);
+}
+
+}  // namespace
+}  // namespace coro::cloudstorage::test
@@ -2,6 +2,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+
 #include "coro/cloudstorage/test/fake_cloud_factory_context.h"
 #include "coro/cloudstorage/test/fake_http_client.h"
 #include "coro/cloudstorage/test/test_utils.h"
@@ -57,6 +59,7 @@ TEST(ThumbnailGeneratorTest, GetCloudThumbnailTest) {
 }
 
 TEST(ThumbnailGeneratorTest, ThumbnailGeneratorTest) {
+  std::atomic<int> content_request_count = 0;
   FakeHttpClient http;
   http.Expect(HttpRequest("https://accounts.google.com/o/oauth2/token")
                   .WillReturn(R"js({
@@ -93,6 +96,7 @@ TEST(ThumbnailGeneratorTest, ThumbnailGeneratorTest) {
                   .WillReturn(ResponseContent{.status = 404}))
       .Expect(
           HttpRequest("https://www.googleapis.com/drive/v3/files/id1?alt=media")
+              .WithRequestCount(&content_request_count)
               .WillRespondToRangeRequestWith(GetTestFileContent("video.mp4")));
   FakeCloudFactoryContext test_helper(std::move(http));
   ASSERT_EQ(test_helper.Fetch({.url = "/auth/google?code=test"}).status, 302);
@@ -104,9 +108,11 @@ TEST(ThumbnailGeneratorTest, ThumbnailGeneratorTest) {
   EXPECT_EQ(response.status, 200);
   EXPECT_TRUE(AreVideosEquiv(response.body, GetTestFileContent("thumbnail.png"),
                              "png"));
+  EXPECT_LE(content_request_count, 2);
 }
 
 TEST(ThumbnailGeneratorTest, ThumbnailGeneratorRespectsExifOrientation) {
+  std::atomic<int> content_request_count = 0;
   FakeHttpClient http;
   http.Expect(HttpRequest("https://accounts.google.com/o/oauth2/token")
                   .WillReturn(R"js({
@@ -143,6 +149,7 @@ TEST(ThumbnailGeneratorTest, ThumbnailGeneratorRespectsExifOrientation) {
                   .WillReturn(ResponseContent{.status = 404}))
       .Expect(
           HttpRequest("https://www.googleapis.com/drive/v3/files/id1?alt=media")
+              .WithRequestCount(&content_request_count)
               .WillRespondToRangeRequestWith(
                   GetTestFileContent("frame-exif.jpg")));
   FakeCloudFactoryContext test_helper(std::move(http));
@@ -155,6 +162,7 @@ TEST(ThumbnailGeneratorTest, ThumbnailGeneratorRespectsExifOrientation) {
   EXPECT_EQ(response.status, 200);
   EXPECT_TRUE(AreVideosEquiv(response.body,
                              GetTestFileContent("thumbnail-exif.png"), "png"));
+  EXPECT_EQ(content_request_count, 1);
 }
 
 }  // namespace
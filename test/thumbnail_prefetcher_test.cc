@@ -0,0 +1,216 @@
+#include "coro/cloudstorage/util/thumbnail_prefetcher.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "coro/cloudstorage/test/fake_cloud_provider.h"
+#include "coro/cloudstorage/test/test_event_loop.h"
+#include "coro/cloudstorage/test/test_utils.h"
+#include "coro/cloudstorage/util/thread_pool_scheduler.h"
+#include "coro/util/thread_pool.h"
+
+namespace coro::cloudstorage::test {
+namespace {
+
+using ::coro::cloudstorage::util::AbstractCloudProvider;
+using ::coro::cloudstorage::util::CacheDatabase;
+using ::coro::cloudstorage::util::CacheDatabaseDeleter;
+using ::coro::cloudstorage::util::CacheManager;
+using ::coro::cloudstorage::util::Clock;
+using ::coro::cloudstorage::util::CreateCacheDatabase;
+using ::coro::cloudstorage::util::ThreadPoolScheduler;
+using ::coro::cloudstorage::util::ThumbnailGenerator;
+using ::coro::cloudstorage::util::ThumbnailOptions;
+using ::coro::cloudstorage::util::ThumbnailPrefetcher;
+using ::coro::cloudstorage::util::ThumbnailQuality;
+using ::testing::ElementsAre;
+
+class ThumbnailPrefetcherTest : public ::testing::Test {
+ protected:
+  ThumbnailPrefetcherTest() {
+    loop_.Do([&]() -> Task<> {
+      prefetcher_.emplace(&thumbnail_generator_, &cache_manager_, &clock_,
+                          /*max_concurrent_jobs=*/1);
+      co_return;
+    });
+  }
+
+  ~ThumbnailPrefetcherTest() override {
+    // Stops the jobs on the thread of the event loop.
+    loop_.Do([&]() -> Task<> {
+      prefetcher_.reset();
+      co_return;
+    });
+  }
+
+  void Enqueue(const CacheManager::AccountKey& account,
+               std::vector<AbstractCloudProvider::Item> items) {
+    loop_.Do([&]() -> Task<> {
+      prefetcher_->Enqueue(account, items, stop_token_);
+      co_return;
+    });
+  }
+
+  // Checks `predicate` on the event loop until it holds or a few seconds
+  // pass. Returns whether it held.
+  template <typename F>
+  bool WaitUntil(F predicate) {
+    return loop_.Do([&]() -> Task<bool> {
+      for (int i = 0; i < 5000; i++) {
+        if (co_await predicate()) {
+          co_return true;
+        }
+        co_await loop_.event_loop()->Wait(1, stop_token_);
+      }
+      co_return false;
+    });
+  }
+
+  std::optional<CacheManager::ImageData> GetThumbnail(
+      std::string_view item_id, ThumbnailQuality quality) {
+    return loop_.Do([&] {
+      return cache_manager_.Get(
+          account_,
+          CacheManager::ImageKey{.item_id = std::string(item_id),
+                                 .quality = quality},
+          stop_token_);
+    });
+  }
+
+  bool WaitForThumbnail(std::string_view item_id) {
+    return WaitUntil([&]() -> Task<bool> {
+      co_return (co_await cache_manager_.Get(
+                     account_,
+                     CacheManager::ImageKey{.item_id = std::string(item_id),
+                                            .quality = ThumbnailQuality::kLow},
+                     stop_token_))
+          .has_value();
+    });
+  }
+
+  TemporaryFile cache_file_;
+  TestEventLoop loop_;
+  Clock clock_;
+  std::unique_ptr<CacheDatabase, CacheDatabaseDeleter> db_ =
+      CreateCacheDatabase(std::string(cache_file_.path()));
+  CacheManager cache_manager_{db_.get(), loop_.event_loop()};
+  coro::util::ThreadPool thread_pool_{loop_.event_loop(), /*thread_count=*/1,
+                                      "thumbnail"};
+  ThreadPoolScheduler scheduler_{loop_.event_loop(), &thread_pool_,
+                                 /*thread_count=*/1};
+  ThumbnailGenerator thumbnail_generator_{&scheduler_, loop_.event_loop()};
+  std::shared_ptr<FakeCloudProvider> provider_ =
+      std::make_shared<FakeCloudProvider>();
+  CacheManager::AccountKey account_{.provider = provider_,
+                                    .username = "test"};
+  stdx::stop_token stop_token_;
+  std::optional<ThumbnailPrefetcher> prefetcher_;
+};
+
+TEST_F(ThumbnailPrefetcherTest, GeneratesThumbnailsOfMediaFiles) {
+  auto video = provider_->AddFile("root", "video.mp4",
+                                  GetTestFileContent("video.mp4"), "video/mp4");
+  auto notes = provider_->AddFile("root", "notes.txt", "notes", "text/plain");
+
+  Enqueue(account_, provider_->GetChildren("root"));
+
+  EXPECT_TRUE(WaitForThumbnail(video.id));
+  EXPECT_EQ(provider_->content_request_count(notes.id), 0);
+}
+
+TEST_F(ThumbnailPrefetcherTest, CachesThumbnailForEveryQuality) {
+  auto video = provider_->AddFile("root", "video.mp4",
+                                  GetTestFileContent("video.mp4"), "video/mp4");
+
+  Enqueue(account_, provider_->GetChildren("root"));
+
+  ASSERT_TRUE(WaitForThumbnail(video.id));
+  auto low = GetThumbnail(video.id, ThumbnailQuality::kLow);
+  auto high = GetThumbnail(video.id, ThumbnailQuality::kHigh);
+  ASSERT_TRUE(low);
+  ASSERT_TRUE(high);
+  EXPECT_EQ(low->image_bytes, high->image_bytes);
+}
+
+// Compares the throughput of the keyframe path used for prefetching with the
+// path used for thumbnails generated on demand. Disabled by default, run it
+// with --gtest_also_run_disabled_tests to see the numbers.
+TEST_F(ThumbnailPrefetcherTest, DISABLED_KeyframeOnlyThroughput) {
+  auto video = provider_->AddFile("root", "video.mp4",
+                                  GetTestFileContent("video.mp4"), "video/mp4");
+  constexpr int kIterations = 20;
+  for (bool keyframe_only : {false, true}) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; i++) {
+      auto thumbnail = loop_.Do([&] {
+        return thumbnail_generator_(
+            provider_.get(), video,
+            ThumbnailOptions{.codec = ThumbnailOptions::Codec::PNG,
+                             .keyframe_only = keyframe_only},
+            stop_token_);
+      });
+      ASSERT_FALSE(thumbnail.empty());
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << (keyframe_only ? "keyframe_only" : "default") << ": "
+              << kIterations / elapsed.count() << " thumbnails/s\n";
+  }
+}
+
+TEST_F(ThumbnailPrefetcherTest, SkipsFilesWithCachedThumbnails) {
+  auto cached = provider_->AddFile(
+      "root", "cached.mp4", GetTestFileContent("video.mp4"), "video/mp4");
+  auto video = provider_->AddFile("root", "video.mp4",
+                                  GetTestFileContent("video.mp4"), "video/mp4");
+  loop_.Do([&] {
+    return cache_manager_.Put(
+        account_,
+        CacheManager::ImageKey{.item_id = cached.id,
+                               .quality = ThumbnailQuality::kLow},
+        CacheManager::ImageData{.image_bytes = {'p', 'n', 'g'},
+                                .mime_type = "image/png",
+                                .update_time = 0},
+        stop_token_);
+  });
+
+  Enqueue(account_, provider_->GetChildren("root"));
+
+  ASSERT_TRUE(WaitForThumbnail(video.id));
+  EXPECT_EQ(provider_->content_request_count(cached.id), 0);
+  auto image = GetThumbnail(cached.id, ThumbnailQuality::kLow);
+  ASSERT_TRUE(image);
+  EXPECT_THAT(image->image_bytes, ElementsAre('p', 'n', 'g'));
+}
+
+TEST_F(ThumbnailPrefetcherTest, ClaimFallsBackWhenBackgroundJobFails) {
+  auto provider = std::make_shared<FakeCloudProvider>(
+      FakeCloudProvider::Config{.id = "slow",
+                                .event_loop = loop_.event_loop(),
+                                .content_delay_ms = 100});
+  CacheManager::AccountKey account{.provider = provider, .username = "test"};
+  auto file =
+      provider->AddFile("root", "broken.mp4", "not a video", "video/mp4");
+
+  Enqueue(account, provider->GetChildren("root"));
+  // The background job is reading the file.
+  ASSERT_TRUE(WaitUntil([&]() -> Task<bool> {
+    co_return provider->content_request_count(file.id) > 0;
+  }));
+
+  auto claimed = loop_.Do(
+      [&] { return prefetcher_->Claim(account, file, stop_token_); });
+
+  EXPECT_FALSE(claimed.has_value());
+}
+
+}  // namespace
+}  // namespace coro::cloudstorage::test
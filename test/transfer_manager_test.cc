@@ -0,0 +1,147 @@
+#include "coro/cloudstorage/util/transfer_manager.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "coro/cloudstorage/test/fake_cloud_provider.h"
+#include "coro/cloudstorage/test/test_event_loop.h"
+
+namespace coro::cloudstorage::test {
+namespace {
+
+using ::coro::cloudstorage::util::AbstractCloudProvider;
+using ::coro::cloudstorage::util::CloudProviderAccount;
+using ::coro::cloudstorage::util::TransferManager;
+using ::testing::ElementsAre;
+using ::testing::Le;
+using ::testing::SizeIs;
+using ::testing::UnorderedElementsAre;
+
+constexpr int kMaxConcurrentUploads = 2;
+
+CloudProviderAccount CreateAccount(std::unique_ptr<FakeCloudProvider> provider,
+                                   std::string username) {
+  return CloudProviderAccount(std::move(username), /*version=*/0,
+                              std::move(provider), /*cache_manager=*/nullptr,
+                              /*clock=*/nullptr,
+                              /*thumbnail_generator=*/nullptr,
+                              /*thumbnail_prefetcher=*/nullptr,
+                              /*metadata_index=*/nullptr);
+}
+
+std::vector<std::string> GetNames(
+    const std::vector<AbstractCloudProvider::Item>& items) {
+  std::vector<std::string> names;
+  for (const auto& item : items) {
+    names.emplace_back(std::visit([](const auto& d) { return d.name; }, item));
+  }
+  return names;
+}
+
+class TransferManagerTest : public ::testing::Test {
+ protected:
+  TransferManagerTest() {
+    auto source = std::make_unique<FakeCloudProvider>(
+        FakeCloudProvider::Config{.page_size = 3});
+    auto destination = std::make_unique<FakeCloudProvider>(
+        FakeCloudProvider::Config{.event_loop = loop_.event_loop()});
+    source_ = source.get();
+    destination_ = destination.get();
+    source_account_.emplace(CreateAccount(std::move(source), "source"));
+    destination_account_.emplace(
+        CreateAccount(std::move(destination), "destination"));
+  }
+
+  // Copies `item` into the root of the destination and waits until the job
+  // is over.
+  TransferManager::JobStatus Copy(AbstractCloudProvider::Item item) {
+    return loop_.Do([&]() -> Task<TransferManager::JobStatus> {
+      int64_t id = transfer_manager_.Start(
+          *source_account_, std::move(item), *destination_account_,
+          co_await destination_->GetRoot(stdx::stop_token()));
+      while (true) {
+        auto status = transfer_manager_.GetJob(id);
+        if (status->state != TransferManager::JobState::kRunning) {
+          co_return *status;
+        }
+        co_await loop_.event_loop()->Wait(1, stdx::stop_token());
+      }
+    });
+  }
+
+  // Returns the id of the directory `name` in `parent_id` of the destination.
+  std::string GetDestinationDirectory(std::string_view parent_id,
+                                      std::string_view name) {
+    for (const auto& item : destination_->GetChildren(parent_id)) {
+      if (const auto* directory =
+              std::get_if<AbstractCloudProvider::Directory>(&item);
+          directory && directory->name == name) {
+        return directory->id;
+      }
+    }
+    ADD_FAILURE() << "no directory " << name;
+    return "";
+  }
+
+  TestEventLoop loop_;
+  FakeCloudProvider* source_;
+  FakeCloudProvider* destination_;
+  std::optional<CloudProviderAccount> source_account_;
+  std::optional<CloudProviderAccount> destination_account_;
+  TransferManager transfer_manager_{loop_.event_loop(), kMaxConcurrentUploads};
+};
+
+TEST_F(TransferManagerTest, CopiesDirectoryTree) {
+  auto photos = source_->AddDirectory("root", "Photos");
+  auto holiday = source_->AddDirectory(photos.id, "Holiday");
+  source_->AddFile(holiday.id, "beach.jpg", "beach");
+  source_->AddFile(photos.id, "cat.jpg", "cat");
+  source_->AddDirectory(photos.id, "Empty");
+
+  auto status = Copy(photos);
+
+  EXPECT_EQ(status.state, TransferManager::JobState::kDone);
+  EXPECT_EQ(status.file_count, 2);
+  EXPECT_EQ(status.transferred_file_count, 2);
+  EXPECT_EQ(status.transferred_bytes, 8);
+  EXPECT_TRUE(status.listing_complete);
+  auto photos_id = GetDestinationDirectory("root", "Photos");
+  EXPECT_THAT(GetNames(destination_->GetChildren(photos_id)),
+              UnorderedElementsAre("Holiday", "cat.jpg", "Empty"));
+  auto holiday_children =
+      destination_->GetChildren(GetDestinationDirectory(photos_id, "Holiday"));
+  ASSERT_THAT(GetNames(holiday_children), ElementsAre("beach.jpg"));
+  EXPECT_EQ(destination_->GetContent(
+                std::get<AbstractCloudProvider::File>(holiday_children[0]).id),
+            "beach");
+}
+
+TEST_F(TransferManagerTest, LimitsConcurrentWritesIncludingDirectories) {
+  auto directory = source_->AddDirectory("root", "directory");
+  for (int i = 0; i < 10; i++) {
+    auto subdirectory =
+        source_->AddDirectory(directory.id, "directory" + std::to_string(i));
+    source_->AddDirectory(subdirectory.id, "nested");
+    source_->AddFile(subdirectory.id, "file", "content");
+  }
+
+  auto status = Copy(directory);
+
+  EXPECT_EQ(status.state, TransferManager::JobState::kDone);
+  EXPECT_EQ(status.transferred_file_count, 10);
+  EXPECT_THAT(destination_->GetChildren(
+                  GetDestinationDirectory("root", "directory")),
+              SizeIs(10));
+  EXPECT_THAT(destination_->max_concurrent_write_count(),
+              Le(kMaxConcurrentUploads));
+}
+
+}  // namespace
+}  // namespace coro::cloudstorage::test